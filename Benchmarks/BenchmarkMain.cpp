@@ -0,0 +1,123 @@
+/*
+    BenchmarkMain.cpp
+    =================
+    
+    Entry point of the jdrummer_bench console target.
+    
+    USAGE
+    -----
+        jdrummer_bench [--benchmark grooves|onsets|tempo|process|search|state|all]
+                       [--grooves <dir>] [--items <n>] [--block <samples>]
+                       [--rate <hz>] [--seconds <s>]
+                       [--kits <dir>] [--kit <name>] [--blocks <n,n,...>] [--parallel]
+                       [--library <n>] [--iterations <n>]
+    
+    Defaults: all benchmarks, the repo's Grooves folder, 200 items,
+    32-sample blocks, 48 kHz, 60 seconds of audio.
+    
+    The process benchmark sweeps every kit in the repo's soundfonts folder
+    (or just --kit) over --blocks (default 32 to 2048), and plays 5 seconds
+    per configuration unless --seconds is given. --parallel adds a multi-out
+    run with the groups rendered on worker threads, next to the serial one.
+    
+    The search benchmark uses a made-up library of --library grooves
+    (default 20000).
+    
+    The state benchmark saves and restores the plugin --iterations times
+    per format (default 20).
+*/
+
+#include "Benchmarks.h"
+
+static juce::String getOption(const juce::ArgumentList& args, const juce::String& option,
+                              const juce::String& defaultValue)
+{
+    return args.containsOption(option) ? args.getValueForOption(option) : defaultValue;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    
+    // Run from the build directory or the repo root
+    juce::File groovesDir = juce::File::getCurrentWorkingDirectory().getChildFile("Grooves");
+    if (args.containsOption("--grooves"))
+        groovesDir = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--grooves"));
+    
+    const int numItems = getOption(args, "--items", "200").getIntValue();
+    const int blockSize = getOption(args, "--block", "32").getIntValue();
+    const double sampleRate = getOption(args, "--rate", "48000").getDoubleValue();
+    const double seconds = getOption(args, "--seconds", "60").getDoubleValue();
+    
+    if (numItems <= 0 || blockSize <= 0 || sampleRate <= 0.0 || seconds <= 0.0)
+    {
+        std::cerr << "Invalid benchmark options" << std::endl;
+        return 1;
+    }
+    
+    juce::File kitsDir = juce::File::getCurrentWorkingDirectory().getChildFile("soundfonts");
+    if (args.containsOption("--kits"))
+        kitsDir = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--kits"));
+    
+    std::vector<int> blockSizes;
+    juce::StringArray blockTokens;
+    blockTokens.addTokens(getOption(args, "--blocks", "32,64,128,256,512,1024,2048"), ",", "");
+    
+    for (const auto& token : blockTokens)
+    {
+        const int size = token.trim().getIntValue();
+        if (size <= 0)
+        {
+            std::cerr << "Invalid block size: " << token << std::endl;
+            return 1;
+        }
+        
+        blockSizes.push_back(size);
+    }
+    
+    if (blockSizes.empty())
+    {
+        std::cerr << "Invalid benchmark options" << std::endl;
+        return 1;
+    }
+    
+    const double processSeconds = args.containsOption("--seconds") ? seconds : 5.0;
+    
+    const int librarySize = getOption(args, "--library", "20000").getIntValue();
+    if (librarySize <= 0)
+    {
+        std::cerr << "Invalid benchmark options" << std::endl;
+        return 1;
+    }
+    
+    const int iterations = getOption(args, "--iterations", "20").getIntValue();
+    if (iterations <= 0)
+    {
+        std::cerr << "Invalid benchmark options" << std::endl;
+        return 1;
+    }
+    
+    const juce::String benchmark = getOption(args, "--benchmark", "all");
+    int result = 0;
+    
+    if (benchmark == "grooves" || benchmark == "all")
+        result |= Benchmarks::runGrooveScheduling(groovesDir, numItems, blockSize, sampleRate, seconds);
+    
+    if (benchmark == "onsets" || benchmark == "all")
+        result |= Benchmarks::runOnsetDetection(sampleRate, seconds);
+    
+    if (benchmark == "tempo" || benchmark == "all")
+        result |= Benchmarks::runTempoEstimation(sampleRate, seconds);
+    
+    if (benchmark == "process" || benchmark == "all")
+        result |= Benchmarks::runProcessBlock(kitsDir, getOption(args, "--kit", ""), groovesDir,
+                                              blockSizes, sampleRate, processSeconds, args.containsOption("--parallel"));
+    
+    if (benchmark == "search" || benchmark == "all")
+        result |= Benchmarks::runGrooveSearch(librarySize);
+    
+    if (benchmark == "state" || benchmark == "all")
+        result |= Benchmarks::runStateRestore(iterations);
+    
+    return result;
+}
@@ -0,0 +1,76 @@
+/*
+    Benchmarks.h
+    ============
+    
+    Headless benchmarks for jdrummer's real-time hot paths, run by the
+    jdrummer_bench console target (see BenchmarkMain.cpp).
+    
+    Every benchmark prints ONE line of key=value pairs per configuration,
+    so results are easy to grep, diff, or collect across commits.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <vector>
+
+namespace Benchmarks
+{
+    /*
+        GROOVE SCHEDULING
+        -----------------
+        Builds a composition of numItems grooves from groovesDir and times
+        GrooveManager::processBlock() over secondsOfAudio at blockSize.
+        Returns 0 on success.
+    */
+    int runGrooveScheduling(const juce::File& groovesDir, int numItems, int blockSize,
+                            double sampleRate, double secondsOfAudio);
+    
+    /*
+        ONSET DETECTION
+        ---------------
+        Throughput of the onset detection functions (and of the original
+        full-window envelope) on secondsOfAudio of a synthetic drum clip.
+    */
+    int runOnsetDetection(double sampleRate, double secondsOfAudio);
+    
+    /*
+        TEMPO ESTIMATION
+        ----------------
+        MiniBPM feature extraction and estimateTempo() on secondsOfAudio
+        of a synthetic drum clip (try --seconds 300 for a 5-minute song).
+    */
+    int runTempoEstimation(double sampleRate, double secondsOfAudio);
+    
+    /*
+        PROCESS BLOCK
+        -------------
+        The whole plugin, headless: JdrummerAudioProcessor::processBlock()
+        playing the densest grooves from groovesDir, for every kit in
+        kitsDir (or just onlyKit), with multi-out off and on, at every
+        block size - and with parallel, multi-out once more with the
+        groups rendered on worker threads. Reports ns/sample, voices/ms
+        and allocations.
+    */
+    int runProcessBlock(const juce::File& kitsDir, const juce::String& onlyKit, const juce::File& groovesDir,
+                        const std::vector<int>& blockSizes, double sampleRate, double secondsOfAudio,
+                        bool parallel);
+    
+    /*
+        GROOVE SEARCH
+        -------------
+        The browser's search over a synthetic library of numGrooves:
+        building the index, and queries typed a keystroke at a time.
+    */
+    int runGrooveSearch(int numGrooves);
+    
+    /*
+        STATE RESTORE
+        -------------
+        Saving and restoring the plugin's state in the old XML chunk and
+        the binary one, iterations times each: chunk size, encode and
+        decode times, setStateInformation(), the work it defers to the
+        message thread, and opening a new instance.
+    */
+    int runStateRestore(int iterations);
+}
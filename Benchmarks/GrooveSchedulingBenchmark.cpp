@@ -0,0 +1,91 @@
+/*
+    GrooveSchedulingBenchmark.cpp
+    =============================
+    
+    Times the groove scheduler on a long composition with tiny buffers -
+    the worst case for per-block overhead: many blocks, few events each.
+    With cursor-based lookup the cost per block should stay flat no matter
+    how many items the composition has.
+*/
+
+#include "Benchmarks.h"
+#include "GrooveManager.h"
+#include "NoteEventBuffer.h"
+#include "RealtimeSafety.h"
+
+int Benchmarks::runGrooveScheduling(const juce::File& groovesDir, int numItems, int blockSize,
+                                    double sampleRate, double secondsOfAudio)
+{
+    GrooveManager grooveManager;
+    grooveManager.setGroovesPath(groovesDir);
+    grooveManager.scanGrooves();
+    
+    // Every groove in the library, in scan order
+    std::vector<std::pair<int, int>> grooveIndices;
+    const auto& categories = grooveManager.getCategories();
+    
+    for (int categoryIndex = 0; categoryIndex < static_cast<int>(categories.size()); ++categoryIndex)
+    {
+        for (int grooveIndex = 0; grooveIndex < static_cast<int>(categories[categoryIndex].grooves.size()); ++grooveIndex)
+            grooveIndices.push_back({ categoryIndex, grooveIndex });
+    }
+    
+    if (grooveIndices.empty())
+    {
+        std::cerr << "No grooves found in " << groovesDir.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    // Cycle through the library until the composition has numItems items
+    for (int i = 0; i < numItems; ++i)
+    {
+        const auto& indices = grooveIndices[static_cast<size_t>(i) % grooveIndices.size()];
+        grooveManager.addToComposer(indices.first, indices.second);
+    }
+    
+    grooveManager.setSampleRate(sampleRate);
+    grooveManager.setPreviewBPM(120.0);
+    grooveManager.startComposerPlayback();
+    
+    NoteEventBuffer events;
+    const int numBlocks = juce::jmax(1, static_cast<int>(secondsOfAudio * sampleRate / blockSize));
+    
+    juce::int64 totalEvents = 0;
+    juce::int64 totalTicks = 0;
+    juce::int64 worstBlockTicks = 0;
+    
+    const RealtimeSafety::ScopedAudioThread audioThreadMarker;
+    const auto allocationsBefore = RealtimeSafety::getAudioThreadAllocationCount();
+    
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        events.clear();
+        
+        const auto start = juce::Time::getHighResolutionTicks();
+        grooveManager.processBlock(120.0, 0.0, false, blockSize, events);
+        const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+        
+        totalTicks += elapsed;
+        worstBlockTicks = juce::jmax(worstBlockTicks, elapsed);
+        totalEvents += events.size();
+    }
+    
+    const auto allocations = RealtimeSafety::getAudioThreadAllocationCount() - allocationsBefore;
+    
+    const double totalNs = juce::Time::highResolutionTicksToSeconds(totalTicks) * 1.0e9;
+    const double worstNs = juce::Time::highResolutionTicksToSeconds(worstBlockTicks) * 1.0e9;
+    
+    std::cout << "benchmark=groove_scheduling"
+              << " items=" << grooveManager.getComposerItems().size()
+              << " block=" << blockSize
+              << " sample_rate=" << sampleRate
+              << " blocks=" << numBlocks
+              << " events=" << totalEvents
+              << " ns_per_block=" << (totalNs / numBlocks)
+              << " worst_ns_per_block=" << worstNs
+              << " ns_per_sample=" << (totalNs / (static_cast<double>(numBlocks) * blockSize))
+              << " allocations=" << allocations
+              << std::endl;
+    
+    return 0;
+}
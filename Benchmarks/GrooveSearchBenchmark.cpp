@@ -0,0 +1,96 @@
+/*
+    GrooveSearchBenchmark.cpp
+    =========================
+    
+    Times the groove browser's search on a synthetic library: building
+    the index once, then a query typed one keystroke at a time (every
+    prefix is a search, as in the browser), with and without filters.
+    The number to watch is max_query_ms - the worst wait for a
+    keystroke's results.
+*/
+
+#include "Benchmarks.h"
+#include "GrooveSearch.h"
+
+// Made-up styles and names, shuffled into a library of numGrooves
+static std::vector<GrooveCategory> makeLibrary(int numGrooves)
+{
+    static const char* styles[] = { "Rock", "Funk", "Jazz", "Hip Hop", "Latin", "Metal", "Blues", "Reggae",
+                                    "Pop", "Disco", "Shuffle", "Country", "Punk", "Soul", "Drum and Bass", "Afro" };
+    static const char* words[] = { "Basic", "Groove", "Fill", "Intro", "Verse", "Chorus", "Bridge", "Ghost",
+                                   "Ride", "Hat", "Tom", "Break", "Half Time", "Double", "Outro", "Crash" };
+    
+    juce::Random random(42);
+    const int numStyles = static_cast<int>(std::size(styles));
+    const int perStyle = juce::jmax(1, numGrooves / numStyles);
+    
+    std::vector<GrooveCategory> categories;
+    for (int style = 0; style < numStyles; ++style)
+    {
+        GrooveCategory category;
+        category.name = styles[style];
+        
+        for (int i = 0; i < perStyle; ++i)
+        {
+            Groove groove;
+            groove.name = juce::String(words[random.nextInt(16)]) + " " + words[random.nextInt(16)]
+                        + " " + juce::String(i + 1);
+            groove.category = category.name;
+            groove.numerator = random.nextInt(4) == 0 ? 6 : 4;
+            groove.denominator = groove.numerator == 6 ? 8 : 4;
+            groove.lengthInBeats = (1 + random.nextInt(8)) * groove.numerator * 4.0 / groove.denominator;
+            groove.numNoteOns = static_cast<int>(groove.lengthInBeats * (1 + random.nextInt(6)));
+            groove.isLoaded = random.nextInt(10) != 0;  // Some never parsed
+            
+            category.grooves.push_back(groove);
+        }
+        
+        categories.push_back(std::move(category));
+    }
+    
+    return categories;
+}
+
+template <typename Function>
+static double timeSeconds(Function&& function)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    function();
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+}
+
+int Benchmarks::runGrooveSearch(int numGrooves)
+{
+    const auto categories = makeLibrary(numGrooves);
+    
+    std::shared_ptr<const GrooveSearchIndex> index;
+    const double buildTime = timeSeconds([&] { index = GrooveSearchIndex::build(categories); });
+    
+    for (const juce::String typed : { "funk ghost", "hlf tme", "rock 4/4 busy <4bars" })
+    {
+        double totalTime = 0.0;
+        double maxTime = 0.0;
+        size_t numResults = 0;
+        
+        for (int length = 1; length <= typed.length(); ++length)
+        {
+            const auto query = GrooveSearchIndex::Query::parse(typed.substring(0, length));
+            const double time = timeSeconds([&] { numResults = index->search(query).size(); });
+            
+            totalTime += time;
+            maxTime = juce::jmax(maxTime, time);
+        }
+        
+        std::cout << "benchmark=groove_search"
+                  << " grooves=" << index->size()
+                  << " query=\"" << typed << "\""
+                  << " keystrokes=" << typed.length()
+                  << " results=" << numResults
+                  << " build_ms=" << buildTime * 1000.0
+                  << " mean_query_ms=" << totalTime * 1000.0 / typed.length()
+                  << " max_query_ms=" << maxTime * 1000.0
+                  << std::endl;
+    }
+    
+    return index->size() > 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/*
+    OnsetDetectionBenchmark.cpp
+    ===========================
+    
+    Compares the throughput (samples per second) of the onset detection
+    functions on a synthetic drum clip: noise bursts on every 8th note
+    over a quiet noise floor.
+    
+    "reference" is the original envelope loop, kept here as the baseline:
+    it recomputes the full sum of squares for every window, so each sample
+    is squared windowSize / hopSize times.
+*/
+
+#include "Benchmarks.h"
+#include "OnsetDetector.h"
+
+static constexpr int windowSize = 1024;
+static constexpr int hopSize = 512;
+static constexpr int chunkSize = 1 << 16;
+
+// The envelope as it was computed before OnsetDetector (push_back, full window sums)
+static std::vector<float> referenceEnvelope(const float* samples, int numSamples)
+{
+    std::vector<float> energyEnvelope;
+    
+    for (int i = 0; i < numSamples - windowSize; i += hopSize)
+    {
+        float energy = 0.0f;
+        for (int j = 0; j < windowSize; ++j)
+        {
+            float sample = samples[i + j];
+            energy += sample * sample;
+        }
+        energy = std::sqrt(energy / static_cast<float>(windowSize));
+        energyEnvelope.push_back(energy);
+    }
+    
+    return energyEnvelope;
+}
+
+static std::vector<float> makeDrumClip(double sampleRate, double seconds)
+{
+    juce::Random random(42);
+    const int numSamples = static_cast<int>(sampleRate * seconds);
+    const int samplesPerHit = static_cast<int>(sampleRate * 0.25);  // 8th notes at 120 BPM
+    
+    std::vector<float> clip(static_cast<size_t>(numSamples));
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int sinceHit = i % samplesPerHit;
+        const float decay = std::exp(-static_cast<float>(sinceHit) / static_cast<float>(sampleRate * 0.03));
+        clip[static_cast<size_t>(i)] = (random.nextFloat() * 2.0f - 1.0f) * (0.02f + 0.9f * decay);
+    }
+    
+    return clip;
+}
+
+template <typename Function>
+static double timeSeconds(Function&& function)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    function();
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+}
+
+static void printResult(const char* name, int numSamples, double seconds, size_t numFrames, size_t numOnsets)
+{
+    std::cout << "benchmark=onset_detection"
+              << " function=" << name
+              << " samples=" << numSamples
+              << " frames=" << numFrames
+              << " onsets=" << numOnsets
+              << " seconds=" << seconds
+              << " samples_per_sec=" << (seconds > 0.0 ? numSamples / seconds : 0.0)
+              << std::endl;
+}
+
+int Benchmarks::runOnsetDetection(double sampleRate, double secondsOfAudio)
+{
+    const auto clip = makeDrumClip(sampleRate, secondsOfAudio);
+    const int numSamples = static_cast<int>(clip.size());
+    
+    std::vector<float> envelope;
+    const double referenceTime = timeSeconds([&] { envelope = referenceEnvelope(clip.data(), numSamples); });
+    printResult("reference", numSamples, referenceTime, envelope.size(), 0);
+    
+    const std::pair<const char*, OnsetDetector::Function> functions[] = {
+        { "energy", OnsetDetector::Function::energy },
+        { "spectral_flux", OnsetDetector::Function::spectralFlux }
+    };
+    
+    for (const auto& entry : functions)
+    {
+        OnsetDetector detector(entry.second, windowSize, hopSize, chunkSize);
+        detector.reserveForLength(numSamples);
+        
+        // Fed in chunks, exactly as AudioAnalyzer::analyzeAudio() does
+        const double seconds = timeSeconds([&]
+        {
+            for (int position = 0; position < numSamples; position += chunkSize)
+                detector.process(clip.data() + position, juce::jmin(chunkSize, numSamples - position));
+        });
+        
+        const auto onsets = detector.findOnsets(sampleRate);
+        printResult(entry.first, numSamples, seconds, detector.getDetectionFunction().size() + 1, onsets.size());
+    }
+    
+    return 0;
+}
@@ -0,0 +1,285 @@
+/*
+    ProcessBlockBenchmark.cpp
+    =========================
+    
+    Drives the whole plugin - JdrummerAudioProcessor::processBlock() - the
+    way a host would, with no audio device and no editor: groove
+    scheduling, note dispatch, rendering and the bus routing, all together.
+    
+    For every kit, with the 16 output buses disabled and then enabled, and
+    for every block size (and, if asked, with multi-out rendered on worker
+    threads too), a composition of the library's densest grooves
+    (most note-ons per beat) is played for secondsOfAudio and processBlock()
+    is timed from the outside. Voice counts come from the processor's own
+    PerformanceMonitor, whose cost (a few clock reads per block) is
+    included in the times.
+    
+    WHAT A LINE REPORTS
+    -------------------
+    - parallel: group rendering on worker threads (see RenderWorkerPool.h)
+    - ns_per_sample: processBlock() time per output sample
+    - worst_block_ns / peak_deadline_percent: the slowest block, also as a
+      share of the time the block lasts (100% = an xrun)
+    - avg_voices / peak_voices: active voices at the end of each block
+    - voices_per_ms: voice-milliseconds of audio rendered per millisecond of
+      CPU - roughly how many voices this configuration could keep up in
+      real time on one core
+    - allocations: heap allocations inside processBlock() (only counted
+      when built with JDRUMMER_COUNT_AUDIO_ALLOCATIONS, see allocation_counting).
+      Any at all makes the benchmark exit with 1, so a counted build of
+      "jdrummer_bench --benchmark process" catches an allocation regression.
+*/
+
+#include "Benchmarks.h"
+#include "PluginProcessor.h"
+#include "RealtimeSafety.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr int numDenseGrooves = 16;
+    
+    // Lets a previous kit or configuration ring out before anything is timed
+    constexpr double settleSeconds = 3.0;
+    constexpr double warmUpSeconds = 0.5;
+    
+    /*
+        DENSE GROOVES
+        -------------
+        Loads the whole library and puts the grooves with the most note-ons
+        per beat into the composer, densest first. The composer loops, so
+        any length of audio keeps playing them.
+    */
+    int composeDenseGrooves(GrooveManager& grooveManager)
+    {
+        struct Candidate
+        {
+            int categoryIndex;
+            int grooveIndex;
+            double notesPerBeat;
+        };
+        
+        std::vector<Candidate> candidates;
+        const auto& categories = grooveManager.getCategories();
+        
+        for (int categoryIndex = 0; categoryIndex < static_cast<int>(categories.size()); ++categoryIndex)
+        {
+            for (int grooveIndex = 0; grooveIndex < static_cast<int>(categories[categoryIndex].grooves.size()); ++grooveIndex)
+            {
+                if (!grooveManager.loadGroove(categoryIndex, grooveIndex))
+                    continue;
+                
+                const auto* groove = grooveManager.getGroove(categoryIndex, grooveIndex);
+                if (groove != nullptr && groove->lengthInBeats > 0.0)
+                    candidates.push_back({ categoryIndex, grooveIndex, groove->numNoteOns / groove->lengthInBeats });
+            }
+        }
+        
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const Candidate& a, const Candidate& b) { return a.notesPerBeat > b.notesPerBeat; });
+        
+        grooveManager.clearComposer();
+        
+        const int count = juce::jmin(numDenseGrooves, static_cast<int>(candidates.size()));
+        for (int i = 0; i < count; ++i)
+            grooveManager.addToComposer(candidates[static_cast<size_t>(i)].categoryIndex,
+                                        candidates[static_cast<size_t>(i)].grooveIndex);
+        
+        return count;
+    }
+    
+    // Every output bus but the main one on or off, and no sidechain input
+    void setMultiOut(JdrummerAudioProcessor& processor, bool enabled)
+    {
+        if (auto* sidechain = processor.getBus(true, 0))
+            sidechain->enable(false);
+        
+        for (int busIndex = 1; busIndex < processor.getBusCount(false); ++busIndex)
+        {
+            if (auto* bus = processor.getBus(false, busIndex))
+                bus->enable(enabled);
+        }
+    }
+    
+    void runFor(JdrummerAudioProcessor& processor, juce::AudioBuffer<float>& buffer, double sampleRate,
+                        double seconds)
+    {
+        juce::MidiBuffer midi;
+        const int numBlocks = static_cast<int>(seconds * sampleRate / buffer.getNumSamples()) + 1;
+        
+        for (int block = 0; block < numBlocks; ++block)
+            processor.processBlock(buffer, midi);
+    }
+    
+    // Kit names have spaces - keep every value a single token
+    juce::String toToken(const juce::String& text)
+    {
+        return text.replaceCharacters(" \t=", "___");
+    }
+}
+
+int Benchmarks::runProcessBlock(const juce::File& kitsDir, const juce::String& onlyKit, const juce::File& groovesDir,
+                                const std::vector<int>& blockSizes, double sampleRate, double secondsOfAudio,
+                                bool parallel)
+{
+    // The processor's parameters and async updates expect a message manager
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    JdrummerAudioProcessor processor;
+    auto& soundFontManager = processor.getSoundFontManager();
+    auto& grooveManager = processor.getGrooveManager();
+    auto& monitor = processor.getPerformanceMonitor();
+    
+    // Kits are converted to the host rate as they load, so the rate comes first
+    const int largestBlock = *std::max_element(blockSizes.begin(), blockSizes.end());
+    setMultiOut(processor, false);
+    processor.setRateAndBufferSizeDetails(sampleRate, largestBlock);
+    processor.prepareToPlay(sampleRate, largestBlock);
+    
+    soundFontManager.setSoundFontsPath(kitsDir);
+    auto kits = soundFontManager.getAvailableKits();
+    
+    if (onlyKit.isNotEmpty())
+    {
+        kits.clear();
+        kits.add(onlyKit);
+    }
+    
+    if (kits.isEmpty())
+    {
+        std::cerr << "No kits found in " << kitsDir.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    grooveManager.setGroovesPath(groovesDir);
+    grooveManager.scanGrooves();
+    
+    if (composeDenseGrooves(grooveManager) == 0)
+    {
+        std::cerr << "No grooves found in " << groovesDir.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    grooveManager.setPreviewBPM(120.0);
+    
+    struct Configuration
+    {
+        bool multiOut;
+        bool parallel;
+    };
+    
+    std::vector<Configuration> configurations { { false, false }, { true, false } };
+    if (parallel)
+        configurations.push_back({ true, true });
+    
+    int result = 0;
+    
+    for (const auto& kit : kits)
+    {
+        if (!soundFontManager.loadKit(kit))
+        {
+            std::cerr << "Could not load kit " << kit << std::endl;
+            result = 1;
+            continue;
+        }
+        
+        for (const auto& configuration : configurations)
+        {
+            const bool multiOut = configuration.multiOut;
+            soundFontManager.setParallelRenderingEnabled(configuration.parallel);
+            
+            for (const int blockSize : blockSizes)
+            {
+                setMultiOut(processor, multiOut);
+                processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+                processor.prepareToPlay(sampleRate, blockSize);
+                
+                const int numChannels = juce::jmax(processor.getTotalNumInputChannels(),
+                                                   processor.getTotalNumOutputChannels());
+                juce::AudioBuffer<float> buffer(numChannels, blockSize);
+                juce::MidiBuffer midi;
+                
+                // Adopt the kit and let the previous run's voices die away, then start the grooves
+                grooveManager.stopComposerPlayback();
+                runFor(processor, buffer, sampleRate, settleSeconds);
+                grooveManager.startComposerPlayback();
+                runFor(processor, buffer, sampleRate, warmUpSeconds);
+                
+                const int numBlocks = juce::jmax(1, static_cast<int>(secondsOfAudio * sampleRate / blockSize));
+                
+                juce::int64 totalTicks = 0;
+                juce::int64 worstBlockTicks = 0;
+                juce::int64 totalEvents = 0;
+                double voiceSum = 0.0;
+                int peakVoices = 0;
+                
+                monitor.setEnabled(true);
+                PerformanceMonitor::BlockStats stats;
+                while (monitor.popBlock(stats)) {}
+                
+                const auto allocationsBefore = RealtimeSafety::getAudioThreadAllocationCount();
+                
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    processor.processBlock(buffer, midi);
+                    const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+                    
+                    totalTicks += elapsed;
+                    worstBlockTicks = juce::jmax(worstBlockTicks, elapsed);
+                    
+                    while (monitor.popBlock(stats))
+                    {
+                        const int voices = stats.getTotalVoices();
+                        voiceSum += voices;
+                        peakVoices = juce::jmax(peakVoices, voices);
+                        totalEvents += stats.numEvents;
+                    }
+                }
+                
+                const auto allocations = RealtimeSafety::getAudioThreadAllocationCount() - allocationsBefore;
+                monitor.setEnabled(false);
+                
+                const double totalNs = juce::Time::highResolutionTicksToSeconds(totalTicks) * 1.0e9;
+                const double worstNs = juce::Time::highResolutionTicksToSeconds(worstBlockTicks) * 1.0e9;
+                const double blockNs = 1.0e9 * blockSize / sampleRate;
+                const double numSamples = static_cast<double>(numBlocks) * blockSize;
+                const double averageVoices = voiceSum / numBlocks;
+                const double voiceMs = averageVoices * numSamples / sampleRate * 1000.0;
+                
+                std::cout << "benchmark=process_block"
+                          << " kit=" << toToken(kit)
+                          << " multi_out=" << (multiOut ? 1 : 0)
+                          << " parallel=" << (soundFontManager.isParallelRenderingEnabled() ? 1 : 0)
+                          << " block=" << blockSize
+                          << " sample_rate=" << sampleRate
+                          << " grooves=" << grooveManager.getComposerItems().size()
+                          << " blocks=" << numBlocks
+                          << " events=" << totalEvents
+                          << " avg_voices=" << averageVoices
+                          << " peak_voices=" << peakVoices
+                          << " ns_per_sample=" << (totalNs / numSamples)
+                          << " worst_block_ns=" << worstNs
+                          << " peak_deadline_percent=" << (100.0 * worstNs / blockNs)
+                          << " voices_per_ms=" << (totalNs > 0.0 ? voiceMs / (totalNs * 1.0e-6) : 0.0)
+                          << " allocations=" << allocations
+                          << " allocation_counting=" << JDRUMMER_COUNT_AUDIO_ALLOCATIONS
+                          << std::endl;
+                
+                // The audio thread must never allocate: a counted build fails the run
+                if (allocations > 0)
+                {
+                    std::cerr << "processBlock() allocated " << allocations << " times (kit " << kit
+                              << ", block " << blockSize << ", multi-out " << (multiOut ? "on" : "off") << ")"
+                              << std::endl;
+                    result = 1;
+                }
+            }
+        }
+    }
+    
+    grooveManager.stopComposerPlayback();
+    processor.releaseResources();
+    
+    return result;
+}
@@ -0,0 +1,157 @@
+/*
+    StateBenchmark.cpp
+    ==================
+    
+    Times saving and restoring the plugin's state the way a host does
+    when a project is saved and opened, in the XML chunk earlier
+    versions wrote and in the binary chunk (see PluginStateFormat.h).
+    
+    A processor with every parameter moved off its default and a groove
+    transform set is saved once; that state is then, per format:
+    
+    - encode_ms: written as a chunk
+    - decode_ms: read back into a ValueTree
+    - restore_ms: handed to setStateInformation() of a running instance
+    - deferred_ms: the part of that restore left for the message thread
+      (see DEFERRED KIT LOAD in PluginProcessor.cpp), run straight after
+    - open_ms: a new instance constructed and restored - what a host
+      waits for per plugin when it opens a project
+    
+    restore_ms is what the host's restore call costs now; before the
+    deferral it cost about restore_ms + deferred_ms, so one run gives the
+    before and after without building an older version.
+    
+    The kit itself loads in the background after deferred_ms (which only
+    queues it), so none of these include parsing an SF2. The round trip
+    check saves the target once its last restore has been applied.
+*/
+
+#include "Benchmarks.h"
+#include "PluginProcessor.h"
+#include "PluginStateFormat.h"
+
+namespace
+{
+    template <typename Function>
+    double timeMilliseconds(Function&& function)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        function();
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+    
+    struct Timings
+    {
+        double total = 0.0;
+        double worst = 0.0;
+        
+        void add(double milliseconds)
+        {
+            total += milliseconds;
+            worst = juce::jmax(worst, milliseconds);
+        }
+    };
+    
+    // Something like a project that has been worked on: no parameter at its default
+    void makeNonDefaultState(JdrummerAudioProcessor& processor)
+    {
+        juce::Random random(42);
+        
+        // Every parameter the way a host sees them (the processor's own getParameters() is its tree)
+        const juce::AudioProcessor& asHost = processor;
+        for (auto* parameter : asHost.getParameters())
+            parameter->setValueNotifyingHost(random.nextFloat());
+        
+        GrooveTransform transform;
+        transform.swing = 0.5f;
+        transform.humanizeBeats = 0.01;
+        transform.velocityHumanize = 0.1f;
+        transform.muteNote(49);
+        transform.replaceNote(46, 42);
+        processor.getGrooveManager().setTransform(transform);
+    }
+    
+    juce::ValueTree getState(JdrummerAudioProcessor& processor)
+    {
+        juce::MemoryBlock chunk;
+        processor.getStateInformation(chunk);
+        return PluginStateFormat::read(chunk.getData(), static_cast<int>(chunk.getSize()));
+    }
+}
+
+int Benchmarks::runStateRestore(int iterations)
+{
+    // The processor's parameters and async updates expect a message manager
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    
+    JdrummerAudioProcessor source;
+    makeNonDefaultState(source);
+    const auto state = getState(source);
+    
+    if (!state.isValid())
+    {
+        std::cerr << "Could not read back the saved state" << std::endl;
+        return 1;
+    }
+    
+    JdrummerAudioProcessor target;
+    int result = 0;
+    
+    for (const bool binary : { false, true })
+    {
+        juce::MemoryBlock chunk;
+        Timings encode, decode, restore, deferred, open;
+        
+        for (int i = 0; i < iterations; ++i)
+        {
+            encode.add(timeMilliseconds([&]
+            {
+                if (binary)
+                    PluginStateFormat::write(state, chunk);
+                else
+                    PluginStateFormat::writeXml(state, chunk);
+            }));
+            
+            decode.add(timeMilliseconds([&]
+            {
+                juce::ignoreUnused(PluginStateFormat::read(chunk.getData(), static_cast<int>(chunk.getSize())));
+            }));
+            
+            restore.add(timeMilliseconds([&]
+            {
+                target.setStateInformation(chunk.getData(), static_cast<int>(chunk.getSize()));
+            }));
+            
+            deferred.add(timeMilliseconds([&]
+            {
+                target.finishPendingRequests();
+            }));
+            
+            open.add(timeMilliseconds([&]
+            {
+                JdrummerAudioProcessor opened;
+                opened.setStateInformation(chunk.getData(), static_cast<int>(chunk.getSize()));
+            }));
+        }
+        
+        // Whatever the format, the restored instance must save what was restored
+        const bool roundTrips = getState(target).isEquivalentTo(state);
+        if (!roundTrips)
+            result = 1;
+        
+        std::cout << "benchmark=state_restore"
+                  << " format=" << (binary ? "binary" : "xml")
+                  << " bytes=" << chunk.getSize()
+                  << " iterations=" << iterations
+                  << " encode_ms=" << encode.total / iterations
+                  << " decode_ms=" << decode.total / iterations
+                  << " restore_ms=" << restore.total / iterations
+                  << " deferred_ms=" << deferred.total / iterations
+                  << " open_ms=" << open.total / iterations
+                  << " worst_open_ms=" << open.worst
+                  << " round_trip=" << (roundTrips ? "ok" : "FAILED")
+                  << std::endl;
+    }
+    
+    return result;
+}
@@ -0,0 +1,78 @@
+/*
+    TempoEstimationBenchmark.cpp
+    ============================
+    
+    Times MiniBPM on a synthetic drum clip, split into the two phases:
+    
+    - process: the per-frame feature extraction, fed in chunks as
+      AudioAnalyzer::analyzeAudio() does (linear in the clip length)
+    - estimate: estimateTempo(), dominated by the autocorrelation of the
+      detection functions - the part that used to grow with length x lags
+*/
+
+#include "Benchmarks.h"
+#include "MiniBpm.h"
+
+static constexpr int chunkSize = 1 << 16;
+
+// Kick on the beat, snare on the backbeat, hats on 8th notes, over a noise floor
+static std::vector<float> makeDrumClip(double sampleRate, double seconds, double bpm)
+{
+    juce::Random random(7);
+    const int numSamples = static_cast<int>(sampleRate * seconds);
+    const double samplesPerEighth = sampleRate * 30.0 / bpm;
+    
+    std::vector<float> clip(static_cast<size_t>(numSamples));
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double eighths = i / samplesPerEighth;
+        const int eighth = static_cast<int>(eighths);
+        const float since = static_cast<float>((eighths - eighth) * samplesPerEighth / sampleRate);
+        
+        const float hat = (random.nextFloat() * 2.0f - 1.0f) * 0.3f * std::exp(-since / 0.01f);
+        const float body = std::sin(since * 2.0f * juce::MathConstants<float>::pi * (eighth % 4 == 0 ? 60.0f : 200.0f))
+                         * ((eighth % 2 == 0) ? 0.8f : 0.0f) * std::exp(-since / 0.08f);
+        
+        clip[static_cast<size_t>(i)] = hat + body + (random.nextFloat() * 2.0f - 1.0f) * 0.01f;
+    }
+    
+    return clip;
+}
+
+template <typename Function>
+static double timeSeconds(Function&& function)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    function();
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+}
+
+int Benchmarks::runTempoEstimation(double sampleRate, double secondsOfAudio)
+{
+    constexpr double clipBpm = 123.0;
+    const auto clip = makeDrumClip(sampleRate, secondsOfAudio, clipBpm);
+    const int numSamples = static_cast<int>(clip.size());
+    
+    breakfastquay::MiniBPM bpmDetector(static_cast<float>(sampleRate));
+    bpmDetector.setBPMRange(55.0, 190.0);
+    
+    const double processTime = timeSeconds([&]
+    {
+        for (int position = 0; position < numSamples; position += chunkSize)
+            bpmDetector.process(clip.data() + position, juce::jmin(chunkSize, numSamples - position));
+    });
+    
+    double bpm = 0.0;
+    const double estimateTime = timeSeconds([&] { bpm = bpmDetector.estimateTempo(); });
+    
+    std::cout << "benchmark=tempo_estimation"
+              << " samples=" << numSamples
+              << " clip_bpm=" << clipBpm
+              << " bpm=" << bpm
+              << " candidates=" << bpmDetector.getTempoCandidates().size()
+              << " process_seconds=" << processTime
+              << " estimate_seconds=" << estimateTime
+              << std::endl;
+    
+    return bpm > 0.0 ? 0 : 1;
+}
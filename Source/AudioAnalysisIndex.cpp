@@ -0,0 +1,225 @@
+/*
+    AudioAnalysisIndex.cpp
+    ======================
+    
+    Reading and writing precomputed audio analyses (see AudioAnalysisIndex.h).
+*/
+
+#include "AudioAnalysisIndex.h"
+#include "GrooveLibraryIndex.h"
+
+AudioAnalysisIndex::AudioAnalysisIndex()
+    : indexFile(getDefaultIndexFile())
+{
+}
+
+void AudioAnalysisIndex::setIndexFile(const juce::File& file)
+{
+    const juce::ScopedLock sl(loadedLock);
+    indexFile = file;
+    loadedFileSize = -1;  // Read the new file on the next lookup
+}
+
+juce::File AudioAnalysisIndex::getDefaultIndexFile()
+{
+    return GrooveLibraryIndex::getDefaultIndexFile().getSiblingFile("audio_analysis_index.bin");
+}
+
+bool AudioAnalysisIndex::getFileStamp(const juce::File& file, juce::int64& modificationTime, juce::int64& fileSize)
+{
+    if (!file.existsAsFile())
+        return false;
+    
+    modificationTime = file.getLastModificationTime().toMilliseconds();
+    fileSize = file.getSize();
+    return true;
+}
+
+bool AudioAnalysisIndex::makeEntry(const juce::File& file, OnsetDetector::Function onsetFunction,
+                                   const RhythmPattern& pattern, Entry& entry)
+{
+    if (!getFileStamp(file, entry.modificationTime, entry.fileSize))
+        return false;
+    
+    entry.path = file.getFullPathName();
+    entry.onsetFunction = static_cast<int>(onsetFunction);
+    entry.pattern = pattern;
+    return true;
+}
+
+bool AudioAnalysisIndex::isUpToDate(const Entry& entry)
+{
+    juce::int64 modificationTime = 0, fileSize = 0;
+    return getFileStamp(juce::File(entry.path), modificationTime, fileSize)
+        && modificationTime == entry.modificationTime && fileSize == entry.fileSize;
+}
+
+std::vector<AudioAnalysisIndex::Entry> AudioAnalysisIndex::readAll() const
+{
+    std::vector<Entry> entries;
+    
+    if (!indexFile.existsAsFile())
+        return entries;
+    
+    juce::FileInputStream stream(indexFile);
+    if (!stream.openedOk())
+        return entries;
+    
+    juce::BufferedInputStream in(stream, 1 << 16);
+    
+    if (in.readInt() != magicNumber || in.readInt() != formatVersion)
+    {
+        DBG("AudioAnalysisIndex: Ignoring index with unknown format: " + indexFile.getFullPathName());
+        return entries;
+    }
+    
+    const int numEntries = in.readInt();
+    if (numEntries < 0)
+        return entries;
+    
+    for (int i = 0; i < numEntries; ++i)
+    {
+        Entry entry;
+        if (!readEntry(in, entry))
+        {
+            DBG("AudioAnalysisIndex: Index is corrupt, ignoring the rest of it");
+            break;
+        }
+        
+        entries.push_back(std::move(entry));
+    }
+    
+    return entries;
+}
+
+void AudioAnalysisIndex::loadIfNeeded() const
+{
+    juce::int64 modificationTime = 0, fileSize = 0;
+    if (!getFileStamp(indexFile, modificationTime, fileSize))
+    {
+        loadedEntries.clear();
+        loadedFileSize = -1;
+        return;
+    }
+    
+    if (modificationTime == loadedModificationTime && fileSize == loadedFileSize)
+        return;
+    
+    loadedEntries.clear();
+    for (auto& entry : readAll())
+    {
+        auto key = getKey(entry);
+        loadedEntries[std::move(key)] = std::move(entry);
+    }
+    
+    loadedModificationTime = modificationTime;
+    loadedFileSize = fileSize;
+}
+
+bool AudioAnalysisIndex::lookup(const juce::File& file, OnsetDetector::Function onsetFunction,
+                                RhythmPattern& pattern) const
+{
+    const juce::ScopedLock sl(loadedLock);
+    loadIfNeeded();
+    
+    const auto found = loadedEntries.find({ file.getFullPathName(), static_cast<int>(onsetFunction) });
+    if (found == loadedEntries.end() || !isUpToDate(found->second))
+        return false;
+    
+    pattern = found->second.pattern;
+    return true;
+}
+
+bool AudioAnalysisIndex::readEntry(juce::InputStream& in, Entry& entry)
+{
+    if (in.isExhausted())
+        return false;
+    
+    entry.path = in.readString();
+    entry.modificationTime = in.readInt64();
+    entry.fileSize = in.readInt64();
+    entry.onsetFunction = in.readInt();
+    
+    auto& pattern = entry.pattern;
+    pattern.bpm = in.readDouble();
+    pattern.confidence = in.readDouble();
+    pattern.beatsPerBar = in.readInt();
+    pattern.lengthInBeats = in.readDouble();
+    
+    const int numAlternatives = in.readInt();
+    if (numAlternatives < 0 || numAlternatives > maxValuesPerEntry)
+        return false;
+    
+    pattern.alternativeBpms.resize(static_cast<size_t>(numAlternatives));
+    for (auto& bpm : pattern.alternativeBpms)
+        bpm = in.readDouble();
+    
+    const int numOnsets = in.readInt();
+    if (numOnsets < 0 || numOnsets > maxValuesPerEntry)
+        return false;
+    
+    pattern.onsetTimesBeats.resize(static_cast<size_t>(numOnsets));
+    for (auto& beat : pattern.onsetTimesBeats)
+        beat = in.readDouble();
+    
+    // A truncated entry reads as zeros - its stamp can't match a real file
+    return true;
+}
+
+void AudioAnalysisIndex::writeEntry(juce::OutputStream& out, const Entry& entry)
+{
+    out.writeString(entry.path);
+    out.writeInt64(entry.modificationTime);
+    out.writeInt64(entry.fileSize);
+    out.writeInt(entry.onsetFunction);
+    
+    const auto& pattern = entry.pattern;
+    out.writeDouble(pattern.bpm);
+    out.writeDouble(pattern.confidence);
+    out.writeInt(pattern.beatsPerBar);
+    out.writeDouble(pattern.lengthInBeats);
+    
+    out.writeInt(static_cast<int>(pattern.alternativeBpms.size()));
+    for (auto bpm : pattern.alternativeBpms)
+        out.writeDouble(bpm);
+    
+    out.writeInt(static_cast<int>(pattern.onsetTimesBeats.size()));
+    for (auto beat : pattern.onsetTimesBeats)
+        out.writeDouble(beat);
+}
+
+bool AudioAnalysisIndex::write(const std::vector<Entry>& entries) const
+{
+    // Whatever happens below, lookup() reads the file again
+    const juce::ScopedLock sl(loadedLock);
+    loadedFileSize = -1;
+    
+    if (!indexFile.getParentDirectory().createDirectory())
+        return false;
+    
+    // Write to a temporary file and swap it in, so a crash never leaves half an index
+    juce::TemporaryFile temp(indexFile);
+    
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+        
+        out.writeInt(magicNumber);
+        out.writeInt(formatVersion);
+        out.writeInt(static_cast<int>(entries.size()));
+        
+        for (const auto& entry : entries)
+            writeEntry(out, entry);
+        
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+    
+    if (!temp.overwriteTargetFileWithTemporary())
+        return false;
+    
+    DBG("AudioAnalysisIndex: Saved " + juce::String(entries.size()) + " analyses to " + indexFile.getFullPathName());
+    return true;
+}
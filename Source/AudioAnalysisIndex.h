@@ -0,0 +1,108 @@
+/*
+    AudioAnalysisIndex.h
+    ====================
+    
+    Precomputed Bandmate analyses of audio files, stored on disk.
+    
+    WHY?
+    ----
+    Analyzing a clip (tempo + onsets) means decoding all of it. For a
+    collection of reference loops that is done once, offline, by the
+    jdrummer_analyze tool (see Tools/AnalyzeMain.cpp); the plugin then just
+    looks the result up when one of those files is dropped in, and only
+    analyzes files it has never seen.
+    
+    CACHE KEY
+    ---------
+    As for the groove library index (GrooveLibraryIndex.h): the file's
+    full path, used only while its modification time AND size still
+    match. The onset detection function is part of the key too, since
+    it changes the detected onsets.
+    
+    LOOKUPS
+    -------
+    lookup() reads the index file once and keeps its entries in a map by
+    key, reading it again only when the file on disk changes (another
+    jdrummer_analyze run) or write() replaces it - a dropped clip costs a
+    map lookup and a couple of stats, not a pass over every analysis.
+    Safe to call from any thread.
+    
+    FILE FORMAT
+    -----------
+    Magic, format version, entry count, entries. An unknown version or
+    any sign of corruption is treated as "no index".
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "AudioAnalyzer.h"
+#include <map>
+#include <vector>
+
+class AudioAnalysisIndex
+{
+public:
+    AudioAnalysisIndex();
+    
+    // Where the index is read from and written to
+    void setIndexFile(const juce::File& file);
+    juce::File getIndexFile() const { return indexFile; }
+    
+    // The default location: next to the groove library index
+    static juce::File getDefaultIndexFile();
+    
+    // One analyzed file
+    struct Entry
+    {
+        juce::String path;
+        juce::int64 modificationTime = 0;
+        juce::int64 fileSize = 0;
+        int onsetFunction = 0;  // OnsetDetector::Function
+        RhythmPattern pattern;
+    };
+    
+    // What an entry is found by: the file's path and the onset function
+    using Key = std::pair<juce::String, int>;
+    static Key getKey(const Entry& entry) { return { entry.path, entry.onsetFunction }; }
+    
+    // An entry for the file as it is now (false if it doesn't exist)
+    static bool makeEntry(const juce::File& file, OnsetDetector::Function onsetFunction,
+                          const RhythmPattern& pattern, Entry& entry);
+    
+    // True if the entry still describes the file as it is now
+    static bool isUpToDate(const Entry& entry);
+    
+    // Every entry in the index (empty if there is no valid index)
+    std::vector<Entry> readAll() const;
+    
+    // Find the analysis of this file, if it's indexed and unchanged
+    bool lookup(const juce::File& file, OnsetDetector::Function onsetFunction, RhythmPattern& pattern) const;
+    
+    // Replace the index with these entries
+    bool write(const std::vector<Entry>& entries) const;
+
+private:
+    static bool getFileStamp(const juce::File& file, juce::int64& modificationTime, juce::int64& fileSize);
+    static bool readEntry(juce::InputStream& in, Entry& entry);
+    static void writeEntry(juce::OutputStream& out, const Entry& entry);
+    
+    // Reads the entries into loadedEntries unless they are of the file as it is now
+    void loadIfNeeded() const;
+    
+    static constexpr int magicNumber = 0x4a444149;  // "JDAI"
+    static constexpr int formatVersion = 1;
+    
+    // More onsets or tempo candidates than this means a corrupt file
+    static constexpr int maxValuesPerEntry = 1 << 20;
+    
+    juce::File indexFile;
+    
+    // The entries lookup() searches, and the stamp of the index file they were read from
+    mutable juce::CriticalSection loadedLock;
+    mutable std::map<Key, Entry> loadedEntries;
+    mutable juce::int64 loadedModificationTime = 0;
+    mutable juce::int64 loadedFileSize = -1;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioAnalysisIndex)
+};
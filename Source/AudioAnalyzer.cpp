@@ -6,12 +6,17 @@
 */
 
 #include "AudioAnalyzer.h"
+#include "AudioAnalysisIndex.h"
 #include "MiniBpm.h"
+#include "OnsetDetector.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <numeric>
 
 AudioAnalyzer::AudioAnalyzer()
 {
+    formatManager.registerBasicFormats();
 }
 
 AudioAnalyzer::~AudioAnalyzer()
@@ -28,11 +33,8 @@ bool AudioAnalyzer::loadAudioFile(const juce::File& file)
         return false;
     }
     
-    // Create an audio format manager and register formats
-    juce::AudioFormatManager formatManager;
-    formatManager.registerBasicFormats();
-    
-    // Create a reader for the file
+    // Create a reader for the file (just to check it and read its format -
+    // the samples are streamed later by analyzeAudio())
     std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
     
     if (reader == nullptr)
@@ -41,25 +43,22 @@ bool AudioAnalyzer::loadAudioFile(const juce::File& file)
         return false;
     }
     
-    // Read the audio data
-    audioSampleRate = reader->sampleRate;
-    int numSamples = static_cast<int>(reader->lengthInSamples);
-    int numChannels = static_cast<int>(reader->numChannels);
-    
-    if (numSamples == 0)
+    if (reader->lengthInSamples == 0)
     {
         DBG("AudioAnalyzer: File has no samples");
         return false;
     }
     
-    // Allocate buffer (mono - use left channel only for consistent BPM detection)
-    audioBuffer.setSize(1, numSamples);
-    audioBuffer.clear();
-    
-    // Read left channel only (more consistent with command-line minibpm)
-    reader->read(&audioBuffer, 0, numSamples, 0, true, false);
+    previewClip = PreviewClip::open(file, formatManager);
+    if (previewClip == nullptr)
+    {
+        DBG("AudioAnalyzer: Could not open clip for playback: " + file.getFullPathName());
+        return false;
+    }
     
-    audioLengthSeconds = static_cast<double>(numSamples) / audioSampleRate;
+    audioFile = file;
+    audioSampleRate = reader->sampleRate;
+    audioLengthSeconds = static_cast<double>(reader->lengthInSamples) / audioSampleRate;
     loadedFileName = file.getFileName();
     audioLoaded = true;
     analysisComplete = false;
@@ -67,20 +66,23 @@ bool AudioAnalyzer::loadAudioFile(const juce::File& file)
     
     DBG("AudioAnalyzer: Loaded " + loadedFileName + " (" 
         + juce::String(audioLengthSeconds, 2) + "s, " 
-        + juce::String(audioSampleRate) + " Hz)");
+        + juce::String(audioSampleRate) + " Hz"
+        + (previewClip->isMemoryMapped() ? ", memory-mapped)" : ")"));
     
     return true;
 }
 
 void AudioAnalyzer::clear()
 {
-    audioBuffer.setSize(0, 0);
+    previewClip.reset();
+    audioFile = juce::File();
     audioLoaded = false;
     analysisComplete = false;
     analysisProgress = 0;
     loadedFileName = "";
     audioLengthSeconds = 0.0;
     detectedPattern = RhythmPattern();
+    queryFeatures = GrooveFeatures();
 }
 
 bool AudioAnalyzer::analyzeAudio()
@@ -91,36 +93,88 @@ bool AudioAnalyzer::analyzeAudio()
         return false;
     }
     
-    analysisProgress = 10;
+    analysisComplete = false;
+    analysisProgress = 0;
+    
+    // Analyzed offline already (and unchanged since)? Then that's the result
+    if (analysisIndex != nullptr && analysisIndex->lookup(audioFile, onsetFunction, detectedPattern))
+    {
+        updateQueryFeatures();
+        analysisProgress = 100;
+        analysisComplete = true;
+        
+        DBG("AudioAnalyzer: Using precomputed analysis of " + loadedFileName
+            + " - BPM: " + juce::String(detectedPattern.bpm, 1));
+        return true;
+    }
+    
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+    if (reader == nullptr)
+    {
+        DBG("AudioAnalyzer: Could not reopen " + audioFile.getFullPathName());
+        return false;
+    }
     
     // Step 1: Try to extract BPM from filename first
     double bpm = extractBPMFromFilename(loadedFileName);
+    const bool detectTempo = bpm <= 0;
     
-    if (bpm > 0)
+    if (!detectTempo)
     {
         DBG("AudioAnalyzer: BPM extracted from filename: " + juce::String(bpm));
         detectedPattern.confidence = 1.0;  // High confidence for filename BPM
     }
-    else
+    
+    // Use minibpm for BPM detection (use default range 55-190 to match command-line tool)
+    breakfastquay::MiniBPM bpmDetector(static_cast<float>(audioSampleRate));
+    bpmDetector.setBPMRange(55.0, 190.0);
+    
+    const juce::int64 totalSamples = reader->lengthInSamples;
+    
+    OnsetDetector onsetDetector(onsetFunction, windowSize, hopSize, analysisChunkSize);
+    onsetDetector.reserveForLength(totalSamples);
+    juce::AudioBuffer<float> chunk(1, analysisChunkSize);
+    
+    // Step 2: Stream the clip, chunk by chunk, through both detectors
+    
+    for (juce::int64 position = 0; position < totalSamples; position += analysisChunkSize)
     {
-        // Step 2: Detect BPM using minibpm
-        bpm = detectBPM();
+        const int numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(analysisChunkSize),
+                                                           totalSamples - position));
+        
+        // Read left channel only (more consistent with command-line minibpm)
+        reader->read(&chunk, 0, numSamples, position, true, false);
+        const float* samples = chunk.getReadPointer(0);
+        
+        if (detectTempo)
+            bpmDetector.process(samples, numSamples);
+        
+        onsetDetector.process(samples, numSamples);
+        
+        // Reading dominates, so it gets most of the progress bar
+        analysisProgress = static_cast<int>(90 * (position + numSamples) / totalSamples);
+    }
+    
+    if (detectTempo)
+    {
+        bpm = bpmDetector.estimateTempo();
         if (bpm <= 0)
         {
             DBG("AudioAnalyzer: Failed to detect BPM");
             return false;
         }
+        
+        storeTempoCandidates(bpmDetector, bpm);
         DBG("AudioAnalyzer: BPM detected by minibpm: " + juce::String(bpm));
     }
     
     detectedPattern.bpm = bpm;
-    analysisProgress = 50;
     
-    // Step 2: Detect onsets (transients/hits)
-    auto onsets = detectOnsets();
-    analysisProgress = 80;
+    // Step 3: Pick the onsets (transients/hits) from the energy envelope
+    auto onsets = onsetDetector.findOnsets(audioSampleRate);
+    analysisProgress = 95;
     
-    // Step 3: Convert onset times to beats
+    // Step 4: Convert onset times to beats
     double beatsPerSecond = bpm / 60.0;
     detectedPattern.onsetTimesBeats.clear();
     
@@ -134,6 +188,8 @@ bool AudioAnalyzer::analyzeAudio()
     detectedPattern.lengthInBeats = audioLengthSeconds * beatsPerSecond;
     detectedPattern.beatsPerBar = 4;  // Assume 4/4 for now
     
+    updateQueryFeatures();
+    
     analysisProgress = 100;
     analysisComplete = true;
     
@@ -144,6 +200,13 @@ bool AudioAnalyzer::analyzeAudio()
     return true;
 }
 
+void AudioAnalyzer::setDetectedPattern(const RhythmPattern& pattern)
+{
+    detectedPattern = pattern;
+    updateQueryFeatures();
+    analysisComplete = true;
+}
+
 double AudioAnalyzer::extractBPMFromFilename(const juce::String& filename)
 {
     // Try to extract BPM from filename patterns like:
@@ -257,20 +320,8 @@ double AudioAnalyzer::extractBPMFromFilename(const juce::String& filename)
     return 0.0;  // No BPM found in filename
 }
 
-double AudioAnalyzer::detectBPM()
+void AudioAnalyzer::storeTempoCandidates(const breakfastquay::MiniBPM& bpmDetector, double bpm)
 {
-    if (!audioLoaded)
-        return 0.0;
-    
-    // Use minibpm for BPM detection (use default range 55-190 to match command-line tool)
-    breakfastquay::MiniBPM bpmDetector(static_cast<float>(audioSampleRate));
-    bpmDetector.setBPMRange(55.0, 190.0);
-    
-    const float* samples = audioBuffer.getReadPointer(0);
-    int numSamples = audioBuffer.getNumSamples();
-    
-    double bpm = bpmDetector.estimateTempoOfSamples(samples, numSamples);
-    
     // Get all tempo candidates and store the top 3
     auto candidates = bpmDetector.getTempoCandidates();
     detectedPattern.alternativeBpms.clear();
@@ -303,248 +354,152 @@ double AudioAnalyzer::detectBPM()
                 + juce::String(detectedPattern.alternativeBpms[i], 1) + " BPM");
         }
     }
-    
-    return bpm;
 }
 
-std::vector<double> AudioAnalyzer::detectOnsets()
+std::vector<GrooveMatch> AudioAnalyzer::findMatchingGrooves(GrooveManager& grooveManager, int maxResults)
 {
-    std::vector<double> onsets;
-    
-    if (!audioLoaded)
-        return onsets;
-    
-    const float* samples = audioBuffer.getReadPointer(0);
-    int numSamples = audioBuffer.getNumSamples();
-    
-    // Simple onset detection using energy difference
-    std::vector<float> energyEnvelope;
-    std::vector<float> energyDiff;
+    std::vector<GrooveMatch> matches;
     
-    // Calculate RMS energy in each window
-    for (int i = 0; i < numSamples - windowSize; i += hopSize)
+    if (!analysisComplete)
     {
-        float energy = 0.0f;
-        for (int j = 0; j < windowSize; ++j)
-        {
-            float sample = samples[i + j];
-            energy += sample * sample;
-        }
-        energy = std::sqrt(energy / static_cast<float>(windowSize));
-        energyEnvelope.push_back(energy);
+        DBG("AudioAnalyzer: Cannot find matches - analysis not complete");
+        return matches;
     }
     
-    if (energyEnvelope.size() < 3)
-        return onsets;
-    
-    // Calculate energy difference (onset detection function)
-    for (size_t i = 1; i < energyEnvelope.size(); ++i)
-    {
-        float diff = energyEnvelope[i] - energyEnvelope[i - 1];
-        energyDiff.push_back(std::max(0.0f, diff));  // Only positive changes (attacks)
-    }
+    // Built once per library, then shared - the manager's lock isn't held while we score
+    const auto features = grooveManager.getGrooveFeatures();
+    if (features == nullptr || features->empty() || maxResults <= 0)
+        return matches;
     
-    // Find global statistics for adaptive threshold
-    float maxDiff = 0.0f;
-    float sumDiff = 0.0f;
-    for (float d : energyDiff)
-    {
-        maxDiff = std::max(maxDiff, d);
-        sumDiff += d;
-    }
-    float meanDiff = sumDiff / static_cast<float>(energyDiff.size());
+    std::vector<float> scores;
+    scoreGrooves(*features, scores);
     
-    // Use a lower threshold - percentage of max energy change
-    float adaptiveThreshold = std::max(meanDiff * 1.5f, maxDiff * 0.1f);
+    // Only the top results need to be in order
+    std::vector<size_t> ranking(features->size());
+    std::iota(ranking.begin(), ranking.end(), size_t { 0 });
     
-    DBG("AudioAnalyzer: Energy diff stats - max: " + juce::String(maxDiff) 
-        + ", mean: " + juce::String(meanDiff)
-        + ", threshold: " + juce::String(adaptiveThreshold));
+    const auto numResults = juce::jmin(static_cast<size_t>(maxResults), ranking.size());
+    std::partial_sort(ranking.begin(), ranking.begin() + static_cast<std::ptrdiff_t>(numResults), ranking.end(),
+                      [&scores](size_t a, size_t b)
+                      {
+                          // Highest score first; ties keep library order
+                          return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+                      });
     
-    // Find peaks in the energy difference
-    for (size_t i = 1; i < energyDiff.size() - 1; ++i)
+    for (size_t rank = 0; rank < numResults; ++rank)
     {
-        if (energyDiff[i] > adaptiveThreshold &&
-            energyDiff[i] >= energyDiff[i - 1] &&
-            energyDiff[i] >= energyDiff[i + 1])
-        {
-            // Convert frame index to time in seconds
-            double timeSeconds = static_cast<double>((i + 1) * hopSize) / audioSampleRate;
+        const auto& entry = (*features)[ranking[rank]];
+        const Groove* groove = grooveManager.getGroove(entry.categoryIndex, entry.grooveIndex);
+        if (groove == nullptr)
+            continue;
+        
+        GrooveMatch match;
+        match.categoryIndex = entry.categoryIndex;
+        match.grooveIndex = entry.grooveIndex;
+        match.categoryName = groove->category;
+        match.grooveName = groove->name;
+        match.matchScore = scores[ranking[rank]];
+        match.bpmDifference = 0.0;  // Grooves don't have inherent BPM
             
-            // Avoid detecting onsets too close together (minimum 80ms apart)
-            if (onsets.empty() || (timeSeconds - onsets.back()) > 0.08)
-            {
-                onsets.push_back(timeSeconds);
-            }
-        }
+        matches.push_back(match);
     }
     
-    DBG("AudioAnalyzer: Detected " + juce::String(onsets.size()) + " onsets");
-    
-    return onsets;
+    return matches;
 }
 
-std::vector<GrooveMatch> AudioAnalyzer::findMatchingGrooves(GrooveManager& grooveManager, int maxResults)
+/*
+    SCORING SWEEP
+    -------------
+    Each worker scores one contiguous slice of the table into its own
+    slice of scores, so there is nothing to synchronize but the finish.
+*/
+void AudioAnalyzer::scoreGrooves(const GrooveFeatureTable& table, std::vector<float>& scores)
 {
-    std::vector<GrooveMatch> matches;
+    const size_t numGrooves = table.size();
+    scores.resize(numGrooves);
     
-    if (!analysisComplete)
+    auto scoreRange = [this, &table, &scores](size_t begin, size_t end)
     {
-        DBG("AudioAnalyzer: Cannot find matches - analysis not complete");
-        return matches;
-    }
+        for (size_t i = begin; i < end; ++i)
+            scores[i] = scoreGroove(queryFeatures, table[i]);
+    };
     
-    const auto& categories = grooveManager.getCategories();
+    const size_t maxJobs = static_cast<size_t>(juce::jmax(1, juce::SystemStats::getNumCpus()));
+    const size_t numJobs = juce::jlimit(size_t { 1 }, maxJobs, numGrooves / minGroovesPerJob);
     
-    // Score each groove in the library
-    for (size_t catIdx = 0; catIdx < categories.size(); ++catIdx)
+    if (numJobs == 1)
     {
-        const auto& category = categories[catIdx];
-        
-        for (size_t grooveIdx = 0; grooveIdx < category.grooves.size(); ++grooveIdx)
-        {
-            // Load the groove if not already loaded
-            grooveManager.loadGroove(static_cast<int>(catIdx), static_cast<int>(grooveIdx));
-            
-            const Groove* groove = grooveManager.getGroove(static_cast<int>(catIdx), 
-                                                           static_cast<int>(grooveIdx));
-            if (groove == nullptr || !groove->isLoaded)
-                continue;
-            
-            // Calculate similarity score
-            double similarity = calculatePatternSimilarity(detectedPattern, *groove);
-            
-            GrooveMatch match;
-            match.categoryIndex = static_cast<int>(catIdx);
-            match.grooveIndex = static_cast<int>(grooveIdx);
-            match.categoryName = category.name;
-            match.grooveName = groove->name;
-            match.matchScore = similarity;
-            match.bpmDifference = 0.0;  // Grooves don't have inherent BPM
-            
-            matches.push_back(match);
-        }
+        scoreRange(0, numGrooves);
+        return;
     }
     
-    // Sort by match score (highest first)
-    std::sort(matches.begin(), matches.end(), 
-              [](const GrooveMatch& a, const GrooveMatch& b) {
-                  return a.matchScore > b.matchScore;
-              });
+    if (matchingPool == nullptr)
+        matchingPool = std::make_unique<juce::ThreadPool>(static_cast<int>(maxJobs) - 1);
+    
+    const size_t groovesPerJob = (numGrooves + numJobs - 1) / numJobs;
+    std::atomic<size_t> jobsRemaining { numJobs - 1 };
+    juce::WaitableEvent allJobsDone;
     
-    // Return top results
-    if (static_cast<int>(matches.size()) > maxResults)
+    for (size_t job = 1; job < numJobs; ++job)
     {
-        matches.resize(maxResults);
+        matchingPool->addJob([&, job]
+        {
+            scoreRange(job * groovesPerJob, juce::jmin(numGrooves, (job + 1) * groovesPerJob));
+            
+            if (--jobsRemaining == 0)
+                allJobsDone.signal();
+        });
     }
     
-    return matches;
+    // This thread takes the first slice instead of idling
+    scoreRange(0, juce::jmin(numGrooves, groovesPerJob));
+    allJobsDone.wait();
 }
 
-double AudioAnalyzer::calculatePatternSimilarity(const RhythmPattern& pattern, const Groove& groove)
+void AudioAnalyzer::updateQueryFeatures()
 {
-    // Count note-on events in groove
-    int grooveNoteCount = 0;
-    for (const auto& evt : groove.events)
-    {
-        if (evt.message.isNoteOn())
-            grooveNoteCount++;
-    }
-    
-    if (pattern.onsetTimesBeats.empty() || grooveNoteCount == 0)
-        return 0.0;
-    
     // Use a single bar (4 beats in 4/4) for comparison - more robust
     const double barLength = 4.0;
+    constexpr int numSlots = GrooveFeatures::numSlots;
     
-    // Create hit patterns quantized to 16th notes (16 slots per bar)
-    const int numSlots = 16;
-    std::vector<int> audioHits(numSlots, 0);
-    std::vector<int> grooveHits(numSlots, 0);
-    
-    // Fill audio pattern (accumulate hits across all bars)
-    for (double beatTime : pattern.onsetTimesBeats)
+    // Accumulate hits across all bars, quantized to 16th notes
+    std::array<int, numSlots> audioHits {};
+    for (double beatTime : detectedPattern.onsetTimesBeats)
     {
         double normalizedTime = std::fmod(beatTime, barLength);
         int slot = static_cast<int>((normalizedTime / barLength) * numSlots);
         slot = std::clamp(slot, 0, numSlots - 1);
-        audioHits[slot]++;
-    }
-    
-    // Fill groove pattern (accumulate hits across all bars)
-    for (const auto& evt : groove.events)
-    {
-        if (evt.message.isNoteOn())
-        {
-            double normalizedTime = std::fmod(evt.timeInBeats, barLength);
-            int slot = static_cast<int>((normalizedTime / barLength) * numSlots);
-            slot = std::clamp(slot, 0, numSlots - 1);
-            grooveHits[slot]++;
-        }
-    }
-    
-    // Normalize the hit counts
-    int maxAudio = 1, maxGroove = 1;
-    for (int i = 0; i < numSlots; ++i)
-    {
-        maxAudio = std::max(maxAudio, audioHits[i]);
-        maxGroove = std::max(maxGroove, grooveHits[i]);
+        audioHits[static_cast<size_t>(slot)]++;
     }
     
-    // Calculate cosine similarity (more tolerant of density differences)
-    double dotProduct = 0.0;
-    double normA = 0.0;
-    double normB = 0.0;
-    
-    for (int i = 0; i < numSlots; ++i)
-    {
-        double a = static_cast<double>(audioHits[i]) / maxAudio;
-        double b = static_cast<double>(grooveHits[i]) / maxGroove;
-        dotProduct += a * b;
-        normA += a * a;
-        normB += b * b;
-    }
+    queryFeatures = GrooveFeatures::fromHistogram(audioHits);
+}
     
-    if (normA < 0.0001 || normB < 0.0001)
-        return 0.0;
+/*
+    PATTERN SIMILARITY
+    ------------------
+    Two measures, weighted 60/40:
+    - cosine similarity of the histograms (tolerant of density differences);
+      both are unit length already, so it's just the dot product
+    - position matching with one slot of tolerance: of all slots where
+      either side has a hit, the share where the other side has a hit
+      in or next to it - three bit operations and two popcounts
+*/
+float AudioAnalyzer::scoreGroove(const GrooveFeatures& query, const GrooveFeatures& groove) noexcept
+{
+    if (query.hitSlots == 0 || groove.hitSlots == 0)
+        return 0.0f;
     
-    double cosineSim = dotProduct / (std::sqrt(normA) * std::sqrt(normB));
+    float cosineSim = 0.0f;
+    for (size_t slot = 0; slot < query.unitHistogram.size(); ++slot)
+        cosineSim += query.unitHistogram[slot] * groove.unitHistogram[slot];
     
-    // Also calculate position-based matching with tolerance
-    int positionMatches = 0;
-    int totalPositions = 0;
+    const juce::uint32 occupiedSlots = query.hitSlots | groove.hitSlots;
+    const juce::uint32 matchedSlots = (query.hitSlots & groove.nearbySlots) | (groove.hitSlots & query.nearbySlots);
     
-    for (int i = 0; i < numSlots; ++i)
-    {
-        bool audioHasHit = audioHits[i] > 0;
-        bool grooveHasHit = grooveHits[i] > 0;
-        
-        // Check this slot and adjacent slots for fuzzy matching
-        bool grooveHasNearbyHit = grooveHasHit;
-        if (i > 0) grooveHasNearbyHit = grooveHasNearbyHit || (grooveHits[i-1] > 0);
-        if (i < numSlots - 1) grooveHasNearbyHit = grooveHasNearbyHit || (grooveHits[i+1] > 0);
-        
-        bool audioHasNearbyHit = audioHasHit;
-        if (i > 0) audioHasNearbyHit = audioHasNearbyHit || (audioHits[i-1] > 0);
-        if (i < numSlots - 1) audioHasNearbyHit = audioHasNearbyHit || (audioHits[i+1] > 0);
-        
-        if (audioHasHit || grooveHasHit)
-        {
-            totalPositions++;
-            if (audioHasHit && grooveHasNearbyHit)
-                positionMatches++;
-            else if (grooveHasHit && audioHasNearbyHit)
-                positionMatches++;
-        }
-    }
-    
-    double positionScore = totalPositions > 0 ? 
-        static_cast<double>(positionMatches) / totalPositions : 0.0;
+    const float positionScore = static_cast<float>(juce::countNumberOfBits(matchedSlots))
+                              / static_cast<float>(juce::countNumberOfBits(occupiedSlots));
     
     // Combine scores (weighted average)
-    double finalScore = (cosineSim * 0.6 + positionScore * 0.4) * 100.0;
-    
-    return finalScore;
+    return (cosineSim * 0.6f + positionScore * 0.4f) * 100.0f;
 }
-
-
@@ -5,6 +5,19 @@
     Analyzes audio files to detect tempo and rhythm patterns.
     Uses minibpm for BPM detection and custom onset detection for rhythm analysis.
     
+    PRECOMPUTED ANALYSES
+    --------------------
+    Files analyzed offline by the jdrummer_analyze tool are looked up in an
+    AudioAnalysisIndex instead of being decoded again.
+    
+    STREAMING ANALYSIS
+    ------------------
+    The clip is never decoded into memory as a whole. analyzeAudio() reads
+    it in fixed-size chunks and feeds each chunk to the tempo detector and
+    to an incremental OnsetDetector, so memory stays bounded however long
+    the clip is, and getAnalysisProgress() reports real progress.
+    Playback uses a PreviewClip (memory-mapped where the format allows).
+    
     This enables the "Bandmate" feature where users can drop in an audio clip
     and get matching drum grooves from the library.
 */
@@ -13,8 +26,15 @@
 
 #include "JuceHeader.h"
 #include "GrooveManager.h"
+#include "OnsetDetector.h"
+#include "PreviewClip.h"
+#include <atomic>
+#include <memory>
 #include <vector>
 
+namespace breakfastquay { class MiniBPM; }
+class AudioAnalysisIndex;
+
 /*
     RHYTHM PATTERN
     --------------
@@ -68,45 +88,96 @@ public:
     // Get the detected rhythm pattern
     const RhythmPattern& getDetectedPattern() const { return detectedPattern; }
     
-    // Find matching grooves from the library
+    // Match a pattern that was detected elsewhere (e.g. from the live input,
+    // see LiveBandmate) - findMatchingGrooves() then scores this one
+    void setDetectedPattern(const RhythmPattern& pattern);
+    
+    /*
+        FIND MATCHING GROOVES
+        ---------------------
+        Scores the analyzed audio against every groove in the library and
+        returns the best maxResults, highest first.
+        
+        The groove side is precomputed (GrooveManager::getGrooveFeatures())
+        and the audio side once per analysis, so a search is just a sweep
+        over one contiguous array - split across a thread pool for large
+        libraries - followed by a partial sort for the top results.
+    */
     std::vector<GrooveMatch> findMatchingGrooves(GrooveManager& grooveManager, int maxResults = 10);
     
+    // Precomputed analyses (see AudioAnalysisIndex.h): analyzeAudio() uses the
+    // indexed result for a file that hasn't changed. nullptr = always analyze.
+    // The index must outlive the analyzer.
+    void setAnalysisIndex(const AudioAnalysisIndex* index) { analysisIndex = index; }
+    
+    // Which onset detection function analyzeAudio() uses (see OnsetDetector.h)
+    // Set it before starting an analysis
+    void setOnsetFunction(OnsetDetector::Function newFunction) { onsetFunction = newFunction; }
+    OnsetDetector::Function getOnsetFunction() const { return onsetFunction; }
+    
     // Clear the loaded audio
     void clear();
     
-    // Get analysis progress (0-100)
-    int getAnalysisProgress() const { return analysisProgress; }
+    // Get analysis progress (0-100) - safe to poll from the UI while analyzing
+    int getAnalysisProgress() const { return analysisProgress.load(); }
     
     // Check if analysis is complete
     bool isAnalysisComplete() const { return analysisComplete; }
     
-    // Get the audio buffer for playback
-    juce::AudioBuffer<float>* getAudioBuffer() { return audioLoaded ? &audioBuffer : nullptr; }
+    // Get the clip for preview playback (nullptr if nothing is loaded)
+    const PreviewClip* getPreviewClip() const { return audioLoaded ? previewClip.get() : nullptr; }
 
 private:
-    // Audio data
-    juce::AudioBuffer<float> audioBuffer;
+    // Audio data - the file is re-read in chunks for analysis
+    juce::AudioFormatManager formatManager;
+    juce::File audioFile;
+    std::unique_ptr<PreviewClip> previewClip;
     double audioSampleRate = 44100.0;
     double audioLengthSeconds = 0.0;
     juce::String loadedFileName;
     bool audioLoaded = false;
     
+    // Precomputed results to look files up in (not owned)
+    const AudioAnalysisIndex* analysisIndex = nullptr;
+    
     // Analysis results
     RhythmPattern detectedPattern;
     bool analysisComplete = false;
-    int analysisProgress = 0;
+    std::atomic<int> analysisProgress { 0 };
     
     // Internal analysis methods
     double extractBPMFromFilename(const juce::String& filename);
-    double detectBPM();
-    std::vector<double> detectOnsets();
-    double calculatePatternSimilarity(const RhythmPattern& pattern, const Groove& groove);
+    void storeTempoCandidates(const breakfastquay::MiniBPM& bpmDetector, double bpm);
+    
+    // Build queryFeatures from the detected onsets (once per analysis)
+    void updateQueryFeatures();
+    
+    // Similarity of two feature vectors (0-100)
+    static float scoreGroove(const GrooveFeatures& query, const GrooveFeatures& groove) noexcept;
+    
+    // Score every entry of the table into scores (same order), in parallel if it's large
+    void scoreGrooves(const GrooveFeatureTable& table, std::vector<float>& scores);
+    
+    // The detected pattern as a feature vector for matching
+    GrooveFeatures queryFeatures;
+    
+    // Workers for the scoring sweep (the calling thread takes a share too) -
+    // only created once a library is big enough to need them, so analyzers
+    // that never score a large library (e.g. one per batch worker) stay light
+    std::unique_ptr<juce::ThreadPool> matchingPool;
+    
+    // Below this many grooves per worker, threads cost more than they save
+    static constexpr size_t minGroovesPerJob = 2048;
     
     // Onset detection parameters
+    OnsetDetector::Function onsetFunction = OnsetDetector::Function::energy;
     static constexpr double onsetThreshold = 0.15;
     static constexpr int hopSize = 512;
     static constexpr int windowSize = 1024;
     
+    // Samples read from the file per analysis step
+    static constexpr int analysisChunkSize = 1 << 16;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioAnalyzer)
 };
 
@@ -0,0 +1,61 @@
+/*
+    AnimationClock.cpp
+    ==================
+    
+    Implementation of the editor's shared animation clock.
+*/
+
+#include "AnimationClock.h"
+
+AnimationClock::AnimationClock(juce::Component& host)
+    : hostComponent(host)
+{
+}
+
+AnimationClock::~AnimationClock()
+{
+    cancelPendingUpdate();
+}
+
+void AnimationClock::startAnimating(Client& client)
+{
+    clients.addIfNotAlreadyThere(&client);
+    
+    if (vblankAttachment == nullptr)
+    {
+        lastFrameMs = juce::Time::getMillisecondCounterHiRes();
+        vblankAttachment = std::make_unique<juce::VBlankAttachment>(&hostComponent, [this]() { frame(); });
+    }
+}
+
+void AnimationClock::stopAnimating(Client& client)
+{
+    clients.removeFirstMatchingValue(&client);
+    
+    if (clients.isEmpty())
+        triggerAsyncUpdate();
+}
+
+void AnimationClock::frame()
+{
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    const double elapsedSeconds = juce::jlimit(0.0, maxFrameSeconds, (nowMs - lastFrameMs) * 0.001);
+    lastFrameMs = nowMs;
+    
+    // Backwards, so a client that has finished can be removed as we go
+    for (int i = clients.size(); --i >= 0;)
+    {
+        if (i < clients.size() && !clients.getUnchecked(i)->animationFrame(elapsedSeconds))
+            clients.remove(i);
+    }
+    
+    if (clients.isEmpty())
+        triggerAsyncUpdate();
+}
+
+void AnimationClock::handleAsyncUpdate()
+{
+    // Someone may have started again since
+    if (clients.isEmpty())
+        vblankAttachment.reset();
+}
@@ -0,0 +1,62 @@
+/*
+    AnimationClock.h
+    ================
+    
+    One frame callback for every animation in the editor, driven by the
+    display's refresh (juce::VBlankAttachment) instead of a timer per
+    component.
+    
+    WHY NOT A TIMER PER PAD?
+    ------------------------
+    Sixteen pads with a 60 Hz timer each meant 960 callbacks a second
+    per open editor, even with every pad at rest. Here a client only
+    asks for frames while it actually animates (a pad while its glow
+    fades), and nothing runs at all once the last one has finished:
+    the vblank attachment is only there while someone needs it. Frames
+    also line up with the display, so a fade never draws twice between
+    two refreshes or skips one.
+    
+    Each frame says how long it has been since the previous one, so
+    animations run at the same speed on a 60 Hz and a 144 Hz display.
+*/
+
+#pragma once
+
+#include "../JuceHeader.h"
+
+class AnimationClock : private juce::AsyncUpdater
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+        
+        // One display frame - return false once the animation has finished
+        virtual bool animationFrame(double elapsedSeconds) = 0;
+    };
+    
+    // Frames follow the display the host component is on
+    explicit AnimationClock(juce::Component& host);
+    ~AnimationClock() override;
+    
+    // Send the client frames until it says it has finished (or stops itself)
+    void startAnimating(Client& client);
+    void stopAnimating(Client& client);
+
+private:
+    void frame();
+    
+    // Detaches from the display once nobody is animating (not from inside frame())
+    void handleAsyncUpdate() override;
+    
+    juce::Component& hostComponent;
+    juce::Array<Client*> clients;
+    std::unique_ptr<juce::VBlankAttachment> vblankAttachment;
+    double lastFrameMs = 0.0;
+    
+    // Longest step a single frame may take (after the window was hidden, say)
+    static constexpr double maxFrameSeconds = 0.1;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnimationClock)
+};
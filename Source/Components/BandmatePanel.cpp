@@ -13,6 +13,8 @@ BandmatePanel::BandmatePanel()
     : matchesListBox(*this),
       matchesListModel(*this)
 {
+    // Files analyzed offline are looked up instead of analyzed again
+    audioAnalyzer.setAnalysisIndex(&analysisIndex);
     
     // Title
     titleLabel.setText("GROOVE MATCHER", juce::dontSendNotification);
@@ -75,6 +77,7 @@ BandmatePanel::BandmatePanel()
     clearButton.setColour(juce::TextButton::textColourOffId, textColour);
     clearButton.onClick = [this]() {
         stopPlayback();
+        detachPreviewClip();
         audioAnalyzer.clear();
         matchResults.clear();
         matchesListBox.updateContent();
@@ -169,6 +172,18 @@ BandmatePanel::BandmatePanel()
     allGroovesTabButton.onClick = [this]() { showSubTab(1); };
     addAndMakeVisible(allGroovesTabButton);
     
+    // Live input toggle (matches the sidechain input as it plays)
+    liveInputButton.setButtonText("Live Input");
+    liveInputButton.setClickingTogglesState(true);
+    liveInputButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF333333));
+    liveInputButton.setColour(juce::TextButton::buttonOnColourId, juce::Colour(0xFF5A2A2A));
+    liveInputButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xFFAAAAAA));
+    liveInputButton.setColour(juce::TextButton::textColourOnId, juce::Colour(0xFFFFFFFF));
+    liveInputButton.setTooltip("Match grooves to the audio on the plugin's sidechain input, live.\n"
+                               "Enable the Sidechain input bus in your DAW and route the band to it.");
+    liveInputButton.onClick = [this]() { setLiveInput(liveInputButton.getToggleState()); };
+    addAndMakeVisible(liveInputButton);
+    
     // Matches label
     matchesLabel.setText("MATCHING GROOVES", juce::dontSendNotification);
     matchesLabel.setFont(juce::Font(12.0f, juce::Font::bold));
@@ -276,6 +291,14 @@ BandmatePanel::~BandmatePanel()
 {
     stopTimer();
     stopPlayback();
+    
+    // Nobody is left to show live results
+    if (audioProcessor != nullptr)
+    {
+        auto& liveBandmate = audioProcessor->getLiveBandmate();
+        liveBandmate.onResultChanged = nullptr;
+        liveBandmate.setEnabled(false);
+    }
 }
 
 void BandmatePanel::paint(juce::Graphics& g)
@@ -424,6 +447,7 @@ void BandmatePanel::resized()
     matchesTabButton.setBounds(subTabRow.removeFromLeft(100));
     subTabRow.removeFromLeft(5);
     allGroovesTabButton.setBounds(subTabRow.removeFromLeft(100));
+    liveInputButton.setBounds(subTabRow.removeFromRight(100));
     
     bounds.removeFromTop(8);
     
@@ -477,6 +501,9 @@ void BandmatePanel::resized()
 void BandmatePanel::setProcessor(JdrummerAudioProcessor* processor)
 {
     audioProcessor = processor;
+    
+    if (audioProcessor != nullptr)
+        audioProcessor->getLiveBandmate().onResultChanged = [this]() { onLiveResult(); };
 }
 
 void BandmatePanel::setGrooveManager(GrooveManager* manager)
@@ -538,6 +565,7 @@ void BandmatePanel::fileDragExit(const juce::StringArray& files)
 void BandmatePanel::loadAudioFile(const juce::File& file)
 {
     stopPlayback();
+    detachPreviewClip();  // The analyzer is about to replace the clip
     
     if (audioAnalyzer.loadAudioFile(file))
     {
@@ -557,14 +585,21 @@ void BandmatePanel::loadAudioFile(const juce::File& file)
     }
 }
 
+void BandmatePanel::detachPreviewClip()
+{
+    // The processor must let go of the clip before the analyzer frees it
+    if (audioProcessor != nullptr)
+        audioProcessor->setPreviewAudio(nullptr);
+}
+
 void BandmatePanel::prepareAudioPlayback()
 {
-    // Audio buffer is already loaded in audioAnalyzer
+    // The clip is already opened by audioAnalyzer
     // We'll use the processor's preview system
     if (audioProcessor != nullptr && audioAnalyzer.hasAudio())
     {
-        // The audioAnalyzer stores the audio buffer internally
-        // We need to pass it to the processor
+        // The audioAnalyzer owns the preview clip internally
+        // It is passed to the processor when playback starts
     }
 }
 
@@ -685,6 +720,71 @@ void BandmatePanel::onAnalysisComplete()
     }
 }
 
+void BandmatePanel::setLiveInput(bool shouldListen)
+{
+    if (audioProcessor == nullptr)
+    {
+        liveInputButton.setToggleState(false, juce::dontSendNotification);
+        return;
+    }
+    
+    audioProcessor->getLiveBandmate().setEnabled(shouldListen);
+    
+    matchesLabel.setText(shouldListen ? "MATCHING GROOVES (LIVE - LISTENING...)" : "MATCHING GROOVES",
+                         juce::dontSendNotification);
+    
+    if (shouldListen)
+        showSubTab(0);
+}
+
+/*
+    LIVE RESULT
+    -----------
+    A new window of live input has been matched. Replace the list, but
+    keep the user's selection if that groove is still in it - the list
+    refreshes every few seconds, and shouldn't jump away under the mouse.
+*/
+void BandmatePanel::onLiveResult()
+{
+    if (audioProcessor == nullptr || !liveInputButton.getToggleState())
+        return;
+    
+    auto result = audioProcessor->getLiveBandmate().getLatestResult();
+    if (result.serial == lastLiveSerial)
+        return;
+    
+    lastLiveSerial = result.serial;
+    
+    int previousCategory = -1, previousGroove = -1;
+    if (selectedMatchIndex >= 0 && selectedMatchIndex < static_cast<int>(matchResults.size()))
+    {
+        previousCategory = matchResults[static_cast<size_t>(selectedMatchIndex)].categoryIndex;
+        previousGroove = matchResults[static_cast<size_t>(selectedMatchIndex)].grooveIndex;
+    }
+    
+    matchResults = std::move(result.matches);
+    selectedMatchIndex = -1;
+    
+    for (size_t i = 0; i < matchResults.size(); ++i)
+    {
+        if (matchResults[i].categoryIndex == previousCategory && matchResults[i].grooveIndex == previousGroove)
+            selectedMatchIndex = static_cast<int>(i);
+    }
+    
+    selectedBpm = result.bpm;
+    matchesLabel.setText("MATCHING GROOVES (LIVE - " + juce::String(result.bpm, 1) + " BPM)",
+                         juce::dontSendNotification);
+    
+    matchesListBox.updateContent();
+    
+    if (selectedMatchIndex >= 0)
+        matchesListBox.selectRow(selectedMatchIndex, true, true);
+    else
+        matchesListBox.deselectAllRows();
+    
+    matchesListBox.repaint();
+}
+
 void BandmatePanel::addSelectedMatchToComposer()
 {
     if (selectedMatchIndex < 0 || selectedMatchIndex >= static_cast<int>(matchResults.size()))
@@ -728,10 +828,10 @@ void BandmatePanel::playBoth()
     }
     
     // Start audio playback through processor
-    auto* audioBuffer = audioAnalyzer.getAudioBuffer();
-    if (audioBuffer != nullptr)
+    auto* clip = audioAnalyzer.getPreviewClip();
+    if (clip != nullptr)
     {
-        audioProcessor->setPreviewAudio(audioBuffer, audioAnalyzer.getAudioSampleRate());
+        audioProcessor->setPreviewAudio(clip);
         audioProcessor->startPreviewPlayback();
         isPlayingAudio = true;
     }
@@ -765,10 +865,10 @@ void BandmatePanel::playAudioOnly()
     
     stopPlayback();
     
-    auto* audioBuffer = audioAnalyzer.getAudioBuffer();
-    if (audioBuffer != nullptr)
+    auto* clip = audioAnalyzer.getPreviewClip();
+    if (clip != nullptr)
     {
-        audioProcessor->setPreviewAudio(audioBuffer, audioAnalyzer.getAudioSampleRate());
+        audioProcessor->setPreviewAudio(clip);
         audioProcessor->startPreviewPlayback();
         isPlayingAudio = true;
         startTimerHz(30);
@@ -11,12 +11,17 @@
     4. Preview both audio and groove together
     5. Add matched grooves to the composer
     6. Drag and drop to DAW
+    
+    Or, with "Live Input" on, match against whatever arrives at the plugin's
+    sidechain input - the match list keeps updating as the band plays
+    (see LiveBandmate.h).
 */
 
 #pragma once
 
 #include "../JuceHeader.h"
 #include "../AudioAnalyzer.h"
+#include "../AudioAnalysisIndex.h"
 #include "../GrooveManager.h"
 #include "GrooveComposer.h"
 #include "GrooveBrowser.h"
@@ -80,6 +85,7 @@ public:
 private:
     JdrummerAudioProcessor* audioProcessor = nullptr;
     GrooveManager* grooveManager = nullptr;
+    AudioAnalysisIndex analysisIndex;  // Precomputed by jdrummer_analyze (declared before the analyzer using it)
     AudioAnalyzer audioAnalyzer;
     
     // UI Components
@@ -117,6 +123,10 @@ private:
     juce::TextButton allGroovesTabButton;
     int currentSubTab = 0;  // 0 = Matches, 1 = All Grooves
     
+    // Live input matching (toggles the processor's LiveBandmate)
+    juce::TextButton liveInputButton;
+    juce::uint32 lastLiveSerial = 0;
+    
     // Match results list (shown when currentSubTab == 0)
     juce::Label matchesLabel;
     DraggableMatchesListBox matchesListBox;
@@ -177,6 +187,8 @@ private:
     void showSubTab(int index);
     void startMatchExternalDrag();
     void startGrooveBrowserDrag(int categoryIndex, int grooveIndex);
+    void setLiveInput(bool shouldListen);
+    void onLiveResult();
     
     // Playback methods
     void playBoth();
@@ -184,6 +196,7 @@ private:
     void playGrooveOnly();
     void stopPlayback();
     void prepareAudioPlayback();
+    void detachPreviewClip();  // Before the analyzer's clip is freed
     
     // Colors
     juce::Colour backgroundColour{0xFF1A1A2E};
@@ -0,0 +1,419 @@
+/*
+    DiagnosticsPanel.cpp
+    ====================
+    
+    Implementation of the hidden diagnostics tab.
+*/
+
+#include "DiagnosticsPanel.h"
+
+DiagnosticsPanel::DiagnosticsPanel()
+{
+    titleLabel.setText("DIAGNOSTICS", juce::dontSendNotification);
+    titleLabel.setFont(juce::Font(18.0f, juce::Font::bold));
+    titleLabel.setColour(juce::Label::textColourId, accentColour);
+    titleLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(titleLabel);
+    
+    clearButton.setButtonText("Clear");
+    clearButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF5A2A2A));
+    clearButton.setColour(juce::TextButton::textColourOffId, textColour);
+    clearButton.onClick = [this]() { clearHistory(); };
+    addAndMakeVisible(clearButton);
+    
+    exportButton.setButtonText("Export CSV...");
+    exportButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF3A5A6A));
+    exportButton.setColour(juce::TextButton::textColourOffId, textColour);
+    exportButton.setTooltip("Write every recorded block to a CSV file");
+    exportButton.onClick = [this]() { exportCsv(); };
+    addAndMakeVisible(exportButton);
+    
+    parallelToggle.setButtonText("Parallel multi-out");
+    parallelToggle.setColour(juce::ToggleButton::textColourId, textColour);
+    parallelToggle.setColour(juce::ToggleButton::tickColourId, accentColour);
+    parallelToggle.setTooltip("Render the output groups that have their own bus on worker threads");
+    parallelToggle.onClick = [this]()
+    {
+        if (onParallelRenderingChanged)
+            onParallelRenderingChanged(parallelToggle.getToggleState());
+    };
+    addAndMakeVisible(parallelToggle);
+    
+    statusLabel.setFont(juce::Font(12.0f));
+    statusLabel.setColour(juce::Label::textColourId, dimTextColour);
+    statusLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(statusLabel);
+}
+
+DiagnosticsPanel::~DiagnosticsPanel()
+{
+    stopTimer();
+    
+    // Nobody is looking any more - the audio thread goes back to one atomic load per block
+    if (performanceMonitor != nullptr)
+        performanceMonitor->setEnabled(false);
+}
+
+void DiagnosticsPanel::setMonitor(PerformanceMonitor* monitor)
+{
+    performanceMonitor = monitor;
+    updateMonitorState();
+}
+
+void DiagnosticsPanel::setParallelRendering(bool enabled)
+{
+    parallelToggle.setToggleState(enabled, juce::dontSendNotification);
+}
+
+void DiagnosticsPanel::visibilityChanged()
+{
+    updateMonitorState();
+}
+
+void DiagnosticsPanel::updateMonitorState()
+{
+    if (performanceMonitor == nullptr)
+        return;
+    
+    const bool showing = isVisible();
+    performanceMonitor->setEnabled(showing);
+    
+    if (showing)
+        startTimerHz(15);
+    else
+        stopTimer();
+}
+
+/*
+    TIMER CALLBACK
+    --------------
+    Drains the ring into the history. The ring holds a few seconds of
+    blocks, so 15 Hz keeps well ahead of it; the history is capped, so
+    leaving the tab open doesn't grow memory.
+*/
+void DiagnosticsPanel::timerCallback()
+{
+    if (performanceMonitor == nullptr)
+        return;
+    
+    PerformanceMonitor::BlockStats block;
+    bool gotBlocks = false;
+    
+    while (performanceMonitor->popBlock(block))
+    {
+        history.push_back(block);
+        gotBlocks = true;
+    }
+    
+    while (history.size() > maxHistory)
+        history.pop_front();
+    
+    if (gotBlocks)
+        repaint();
+}
+
+void DiagnosticsPanel::clearHistory()
+{
+    history.clear();
+    
+    if (performanceMonitor != nullptr)
+        droppedAtClear = performanceMonitor->getNumDroppedBlocks();
+    
+    statusLabel.setText("", juce::dontSendNotification);
+    repaint();
+}
+
+void DiagnosticsPanel::exportCsv()
+{
+    if (history.empty())
+    {
+        statusLabel.setText("Nothing recorded yet", juce::dontSendNotification);
+        return;
+    }
+    
+    // On Linux plugins, native file dialogs often fail, so we force non-native mode
+    #if JUCE_LINUX
+    constexpr bool useNativeDialog = false;
+    #else
+    constexpr bool useNativeDialog = true;
+    #endif
+    
+    fileChooser = std::make_unique<juce::FileChooser>(
+        "Export diagnostics",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("jdrummer-diagnostics.csv"),
+        "*.csv",
+        useNativeDialog);
+    
+    auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+               | juce::FileBrowserComponent::warnAboutOverwriting;
+    
+    // Copied now, so the file holds exactly the blocks that were showing
+    std::vector<PerformanceMonitor::BlockStats> blocks(history.begin(), history.end());
+    
+    fileChooser->launchAsync(flags,
+        [this, blocks = std::move(blocks)](const juce::FileChooser& fc) {
+            auto file = fc.getResult();
+            if (file == juce::File())
+                return;
+            
+            file = file.withFileExtension("csv");
+            
+            if (PerformanceMonitor::writeCsv(file, blocks))
+                statusLabel.setText("Exported " + juce::String(static_cast<int>(blocks.size())) + " blocks to "
+                                        + file.getFileName(), juce::dontSendNotification);
+            else
+                statusLabel.setText("Could not write " + file.getFileName(), juce::dontSendNotification);
+        });
+}
+
+void DiagnosticsPanel::paint(juce::Graphics& g)
+{
+    // Background gradient (same as the other panels)
+    juce::ColourGradient gradient(
+        juce::Colour(0xFF1A1A2E), 0.0f, 0.0f,
+        juce::Colour(0xFF16213E), 0.0f, static_cast<float>(getHeight()),
+        false
+    );
+    g.setGradientFill(gradient);
+    g.fillAll();
+    
+    if (history.empty())
+    {
+        g.setColour(dimTextColour);
+        g.setFont(juce::Font(14.0f));
+        g.drawText("Waiting for audio blocks...", stageArea, juce::Justification::centred);
+        return;
+    }
+    
+    paintStages(g);
+    paintVoices(g);
+    paintGraph(g);
+}
+
+/*
+    STAGE TABLE
+    -----------
+    One row per stage plus the whole block and the lock wait, then the
+    deadline summary underneath. Averages and peaks cover the history.
+*/
+void DiagnosticsPanel::paintStages(juce::Graphics& g)
+{
+    constexpr int numStages = PerformanceMonitor::numStages;
+    constexpr int numRows = numStages + 2;  // Stages, total, lock wait
+    
+    std::array<double, numRows> sums {};
+    std::array<float, numRows> peaks {};
+    double deadlineSum = 0.0;
+    float deadlinePeak = 0.0f;
+    int riskBlocks = 0;
+    int overrunBlocks = 0;
+    
+    for (const auto& block : history)
+    {
+        for (int row = 0; row < numRows; ++row)
+        {
+            const float micros = (row < numStages) ? block.stageMicros[static_cast<size_t>(row)]
+                                 : (row == numStages) ? block.totalMicros
+                                                      : block.lockWaitMicros;
+            sums[static_cast<size_t>(row)] += micros;
+            peaks[static_cast<size_t>(row)] = juce::jmax(peaks[static_cast<size_t>(row)], micros);
+        }
+        
+        const float deadline = block.getDeadlinePercent();
+        deadlineSum += deadline;
+        deadlinePeak = juce::jmax(deadlinePeak, deadline);
+        
+        if (deadline >= overrunPercent)
+            ++overrunBlocks;
+        else if (deadline >= riskPercent)
+            ++riskBlocks;
+    }
+    
+    const auto& last = history.back();
+    const double count = static_cast<double>(history.size());
+    
+    auto area = stageArea;
+    constexpr int rowHeight = 20;
+    const int nameWidth = area.getWidth() * 2 / 5;
+    const int valueWidth = (area.getWidth() - nameWidth) / 3;
+    
+    auto drawRow = [&](const juce::String& name, const juce::String& a, const juce::String& b,
+                       const juce::String& c, juce::Colour colour)
+    {
+        auto row = area.removeFromTop(rowHeight);
+        g.setColour(colour);
+        g.drawText(name, row.removeFromLeft(nameWidth), juce::Justification::centredLeft);
+        g.drawText(a, row.removeFromLeft(valueWidth), juce::Justification::centredRight);
+        g.drawText(b, row.removeFromLeft(valueWidth), juce::Justification::centredRight);
+        g.drawText(c, row, juce::Justification::centredRight);
+    };
+    
+    g.setFont(juce::Font(13.0f, juce::Font::bold));
+    drawRow("Stage", "Last (us)", "Avg (us)", "Peak (us)", accentColour);
+    
+    g.setFont(juce::Font(13.0f));
+    
+    for (int row = 0; row < numRows; ++row)
+    {
+        const float lastMicros = (row < numStages) ? last.stageMicros[static_cast<size_t>(row)]
+                                 : (row == numStages) ? last.totalMicros
+                                                      : last.lockWaitMicros;
+        
+        const juce::String name = (row < numStages) ? juce::String(PerformanceMonitor::getStageName(static_cast<PerformanceMonitor::Stage>(row)))
+                                  : (row == numStages) ? juce::String("Whole block")
+                                                       : juce::String("Lock wait");
+        
+        drawRow(name,
+                juce::String(lastMicros, 1),
+                juce::String(sums[static_cast<size_t>(row)] / count, 1),
+                juce::String(peaks[static_cast<size_t>(row)], 1),
+                row == numStages ? textColour : dimTextColour.brighter(0.4f));
+    }
+    
+    area.removeFromTop(10);
+    
+    const float lastDeadline = last.getDeadlinePercent();
+    const auto deadlineColour = (deadlinePeak >= overrunPercent) ? overrunColour
+                              : (deadlinePeak >= riskPercent) ? warningColour
+                                                              : textColour;
+    
+    g.setFont(juce::Font(13.0f, juce::Font::bold));
+    drawRow("Deadline (% of budget)", juce::String(lastDeadline, 1), juce::String(deadlineSum / count, 1),
+            juce::String(deadlinePeak, 1), deadlineColour);
+    
+    g.setFont(juce::Font(13.0f));
+    g.setColour(dimTextColour.brighter(0.4f));
+    g.drawText("Budget " + juce::String(juce::roundToInt(last.budgetMicros)) + " us (" + juce::String(last.numSamples)
+                   + " samples), " + juce::String(static_cast<int>(history.size())) + " blocks recorded",
+               area.removeFromTop(rowHeight), juce::Justification::centredLeft);
+    
+    g.setColour(riskBlocks + overrunBlocks > 0 ? warningColour : dimTextColour.brighter(0.4f));
+    g.drawText("Xrun risk: " + juce::String(riskBlocks) + " blocks over " + juce::String(juce::roundToInt(riskPercent)) + "%, "
+                   + juce::String(overrunBlocks) + " over budget",
+               area.removeFromTop(rowHeight), juce::Justification::centredLeft);
+    
+    const auto dropped = performanceMonitor != nullptr ? performanceMonitor->getNumDroppedBlocks() - droppedAtClear : 0;
+    g.setColour(dropped > 0 ? warningColour : dimTextColour.brighter(0.4f));
+    g.drawText("Dropped (not recorded): " + juce::String(static_cast<juce::int64>(dropped)),
+               area.removeFromTop(rowHeight), juce::Justification::centredLeft);
+}
+
+/*
+    VOICE TABLE
+    -----------
+    The last block's voices, with the peak since the history starts.
+*/
+void DiagnosticsPanel::paintVoices(juce::Graphics& g)
+{
+    std::array<int, PerformanceMonitor::numVoiceCounts> peaks {};
+    int totalPeak = 0;
+    
+    for (const auto& block : history)
+    {
+        for (size_t i = 0; i < peaks.size(); ++i)
+            peaks[i] = juce::jmax(peaks[i], static_cast<int>(block.activeVoices[i]));
+        
+        totalPeak = juce::jmax(totalPeak, block.getTotalVoices());
+    }
+    
+    const auto& last = history.back();
+    
+    auto area = voiceArea;
+    constexpr int rowHeight = 18;
+    const int columnWidth = area.getWidth() / 3;
+    
+    auto drawRow = [&](const juce::String& name, const juce::String& current, const juce::String& peak,
+                       juce::Colour colour)
+    {
+        auto row = area.removeFromTop(rowHeight);
+        g.setColour(colour);
+        g.drawText(name, row.removeFromLeft(columnWidth), juce::Justification::centredLeft);
+        g.drawText(current, row.removeFromLeft(columnWidth), juce::Justification::centredRight);
+        g.drawText(peak, row, juce::Justification::centredRight);
+    };
+    
+    g.setFont(juce::Font(13.0f, juce::Font::bold));
+    drawRow("Voices", "Now", "Peak", accentColour);
+    
+    g.setFont(juce::Font(13.0f));
+    drawRow("All", juce::String(last.getTotalVoices()), juce::String(totalPeak), textColour);
+    
+    for (size_t i = 0; i < peaks.size(); ++i)
+    {
+        // Skip groups that never played, so the table stays short
+        if (peaks[i] == 0 && i > 0)
+            continue;
+        
+        drawRow(i == 0 ? juce::String("Main") : "Group " + juce::String(static_cast<int>(i)),
+                juce::String(static_cast<int>(last.activeVoices[i])), juce::String(peaks[i]),
+                dimTextColour.brighter(0.4f));
+    }
+}
+
+/*
+    DEADLINE GRAPH
+    --------------
+    One bar per block, scaled so 100% of the budget is the top line.
+    Bars past the risk line turn orange, overruns red.
+*/
+void DiagnosticsPanel::paintGraph(juce::Graphics& g)
+{
+    auto area = graphArea.toFloat();
+    
+    g.setColour(juce::Colour(0xFF10101E));
+    g.fillRoundedRectangle(area, 4.0f);
+    g.setColour(dimTextColour.withAlpha(0.4f));
+    g.drawRoundedRectangle(area, 4.0f, 1.0f);
+    
+    area = area.reduced(4.0f);
+    
+    // Risk line
+    const float riskY = area.getBottom() - area.getHeight() * riskPercent / overrunPercent;
+    g.setColour(warningColour.withAlpha(0.5f));
+    g.drawHorizontalLine(static_cast<int>(riskY), area.getX(), area.getRight());
+    
+    const int numBlocks = juce::jmin(graphBlocks, static_cast<int>(history.size()));
+    const float barWidth = area.getWidth() / static_cast<float>(graphBlocks);
+    float x = area.getRight() - barWidth * static_cast<float>(numBlocks);
+    
+    for (auto block = history.end() - numBlocks; block != history.end(); ++block)
+    {
+        const float deadline = block->getDeadlinePercent();
+        const float height = area.getHeight() * juce::jmin(1.0f, deadline / overrunPercent);
+        
+        g.setColour(deadline >= overrunPercent ? overrunColour
+                    : deadline >= riskPercent ? warningColour
+                                              : accentColour.withAlpha(0.8f));
+        g.fillRect(x, area.getBottom() - height, juce::jmax(1.0f, barWidth), height);
+        x += barWidth;
+    }
+    
+    g.setColour(dimTextColour);
+    g.setFont(juce::Font(11.0f));
+    g.drawText("Deadline, last " + juce::String(graphBlocks) + " blocks (top = 100%)",
+               area.toNearestInt().removeFromTop(14), juce::Justification::centredLeft);
+}
+
+void DiagnosticsPanel::resized()
+{
+    auto bounds = getLocalBounds().reduced(15);
+    
+    auto topRow = bounds.removeFromTop(30);
+    titleLabel.setBounds(topRow.removeFromLeft(200));
+    exportButton.setBounds(topRow.removeFromRight(110));
+    topRow.removeFromRight(10);
+    clearButton.setBounds(topRow.removeFromRight(70));
+    topRow.removeFromRight(10);
+    parallelToggle.setBounds(topRow.removeFromRight(150));
+    topRow.removeFromRight(10);
+    statusLabel.setBounds(topRow);
+    
+    bounds.removeFromTop(10);
+    
+    graphArea = bounds.removeFromBottom(juce::jmax(80, bounds.getHeight() / 4));
+    bounds.removeFromBottom(10);
+    
+    voiceArea = bounds.removeFromRight(bounds.getWidth() / 3);
+    bounds.removeFromRight(20);
+    stageArea = bounds;
+}
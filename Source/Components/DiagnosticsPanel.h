@@ -0,0 +1,96 @@
+/*
+    DiagnosticsPanel.h
+    ==================
+    
+    The hidden "DIAGNOSTICS" tab (Ctrl/Cmd+Shift+D in the editor): live
+    numbers from the audio thread profiler (see PerformanceMonitor.h).
+    
+    Shows, for the blocks recorded since the tab was opened (or cleared):
+    - each stage of processBlock() - last, average and peak microseconds
+    - the deadline: how much of the block's time budget was used, and
+      how many blocks came close to an xrun
+    - active voices on the main instance and each output group
+    - lock wait and dropped blocks
+    - a graph of the deadline over the last few seconds
+    
+    "Export CSV" writes every recorded block, one row each. "Parallel
+    multi-out" switches group rendering on worker threads on and off, so
+    the two can be compared on the same session.
+    
+    The monitor only records while this panel is showing.
+*/
+
+#pragma once
+
+#include "../JuceHeader.h"
+#include "../PerformanceMonitor.h"
+#include <deque>
+
+class DiagnosticsPanel : public juce::Component,
+                         public juce::Timer
+{
+public:
+    DiagnosticsPanel();
+    ~DiagnosticsPanel() override;
+    
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    
+    // Switches the monitor on while the panel is showing
+    void visibilityChanged() override;
+    
+    // Set the processor's monitor (before the panel is shown)
+    void setMonitor(PerformanceMonitor* monitor);
+    
+    // Timer callback: collect the blocks recorded since the last one
+    void timerCallback() override;
+
+    // "Parallel multi-out" toggle - the editor connects it to the SoundFontManager
+    void setParallelRendering(bool enabled);
+    std::function<void(bool enabled)> onParallelRenderingChanged;
+
+private:
+    PerformanceMonitor* performanceMonitor = nullptr;
+    
+    // Recorded blocks, oldest first (about a minute and a half of 512-sample blocks at 48 kHz)
+    static constexpr size_t maxHistory = 8192;
+    std::deque<PerformanceMonitor::BlockStats> history;
+    juce::uint64 droppedAtClear = 0;
+    
+    // Blocks above these shares of their budget are counted as xrun risks
+    static constexpr float riskPercent = 70.0f;
+    static constexpr float overrunPercent = 100.0f;
+    
+    // Blocks shown in the deadline graph
+    static constexpr int graphBlocks = 512;
+    
+    // Controls
+    juce::Label titleLabel;
+    juce::TextButton clearButton;
+    juce::TextButton exportButton;
+    juce::ToggleButton parallelToggle;
+    juce::Label statusLabel;
+    std::unique_ptr<juce::FileChooser> fileChooser;
+    
+    // Where paint() draws the tables and the graph (set in resized)
+    juce::Rectangle<int> stageArea;
+    juce::Rectangle<int> voiceArea;
+    juce::Rectangle<int> graphArea;
+    
+    void updateMonitorState();
+    void clearHistory();
+    void exportCsv();
+    
+    void paintStages(juce::Graphics& g);
+    void paintVoices(juce::Graphics& g);
+    void paintGraph(juce::Graphics& g);
+    
+    // Colors (same palette as the other panels)
+    juce::Colour accentColour{0xFF00BFFF};
+    juce::Colour textColour{0xFFEEEEEE};
+    juce::Colour dimTextColour{0xFF888888};
+    juce::Colour warningColour{0xFFFFAA00};
+    juce::Colour overrunColour{0xFFFF4444};
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiagnosticsPanel)
+};
@@ -3,7 +3,7 @@
     ===========
     
     Implementation of the DrumPad component.
-    Demonstrates: custom painting, animation, mouse handling, timers.
+    Demonstrates: custom painting, animation, mouse handling.
 */
 
 #include "DrumPad.h"
@@ -26,17 +26,22 @@ DrumPad::DrumPad(int midiNote, const juce::String& name, juce::Colour padColour)
     // setOpaque(false) tells JUCE this component has transparency
     // (needed for the glow effect that extends beyond our bounds)
     setOpaque(false);
-    
-    // Start a timer that calls timerCallback() 60 times per second
-    // This creates smooth animation for the glow effect
-    startTimerHz(60);
 }
 
 DrumPad::~DrumPad()
 {
-    // Always stop the timer in the destructor!
-    // Otherwise the timer might try to call us after we're destroyed.
-    stopTimer();
+    // Always stop animating in the destructor!
+    // Otherwise the clock might try to call us after we're destroyed.
+    if (animationClock != nullptr)
+        animationClock->stopAnimating(*this);
+}
+
+void DrumPad::setAnimationClock(AnimationClock* clock)
+{
+    if (animationClock != nullptr)
+        animationClock->stopAnimating(*this);
+    
+    animationClock = clock;
 }
 
 /*
@@ -164,8 +169,7 @@ void DrumPad::mouseDown(const juce::MouseEvent& event)
     juce::ignoreUnused(event);
     
     pressed = true;
-    glowIntensity = 1.0f;  // Start the glow
-    repaint();  // Request a redraw to show the pressed state
+    triggerVisualFeedback();  // Start the glow and redraw to show the pressed state
     
     /*
         CALLING CALLBACKS
@@ -195,26 +199,26 @@ void DrumPad::mouseUp(const juce::MouseEvent& event)
 }
 
 /*
-    TIMER CALLBACK
-    --------------
-    Called periodically by the timer (60 times per second).
-    We use this to animate the glow fade-out.
+    ANIMATION FRAME
+    ---------------
+    Called by the shared AnimationClock once per display frame, only
+    while the glow is fading - a pad at rest costs nothing.
     
     ANIMATION CONCEPT:
-    Each frame, we reduce glowIntensity slightly.
+    Each frame, we reduce glowIntensity by the time that has passed.
     This creates a smooth fade from 1.0 to 0.0.
 */
-void DrumPad::timerCallback()
+bool DrumPad::animationFrame(double elapsedSeconds)
 {
-    if (glowIntensity > 0.01f)  // Still glowing?
-    {
-        glowIntensity -= glowDecay;  // Reduce glow
-        
-        if (glowIntensity < 0.0f)
-            glowIntensity = 0.0f;  // Clamp to zero
-        
-        repaint();  // Redraw with new glow level
-    }
+    glowIntensity -= glowDecayPerSecond * static_cast<float>(elapsedSeconds);  // Reduce glow
+    
+    if (glowIntensity < 0.0f)
+        glowIntensity = 0.0f;  // Clamp to zero
+    
+    repaint();  // Redraw with new glow level
+    
+    // Keep animating while still glowing
+    return glowIntensity > 0.01f;
 }
 
 /*
@@ -226,6 +230,9 @@ void DrumPad::triggerVisualFeedback()
 {
     glowIntensity = 1.0f;  // Full glow
     repaint();
+    
+    if (animationClock != nullptr)
+        animationClock->startAnimating(*this);
 }
 
 void DrumPad::setSelected(bool shouldBeSelected)
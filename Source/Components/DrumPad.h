@@ -22,19 +22,20 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "AnimationClock.h"
 
 /*
     MULTIPLE INHERITANCE
     --------------------
     This class inherits from TWO classes:
     1. juce::Component - base class for all visible UI elements
-    2. juce::Timer - allows periodic callbacks (for animation)
+    2. AnimationClock::Client - frame callbacks while the glow fades
     
     Multiple inheritance can be complex in C++, but it's common in JUCE
     for adding functionality like timers, listeners, etc.
 */
 class DrumPad : public juce::Component,
-                public juce::Timer
+                private AnimationClock::Client
 {
 public:
     /*
@@ -48,7 +49,7 @@ public:
     */
     DrumPad(int midiNote, const juce::String& name, juce::Colour padColour);
     
-    // Destructor - cleans up resources (stops the timer)
+    // Destructor - cleans up resources (stops the glow animation)
     ~DrumPad() override;
 
     /*
@@ -67,9 +68,6 @@ public:
     void mouseDown(const juce::MouseEvent& event) override;
     void mouseUp(const juce::MouseEvent& event) override;
     
-    // Called periodically by the Timer (for glow animation)
-    void timerCallback() override;
-    
     /*
         CUSTOM PUBLIC METHODS
         ---------------------
@@ -86,6 +84,9 @@ public:
     // Change selection state
     void setSelected(bool shouldBeSelected);
     
+    // The editor's shared clock that drives the glow (must outlive the pad)
+    void setAnimationClock(AnimationClock* clock);
+    
     /*
         CALLBACK FUNCTIONS (std::function)
         -----------------------------------
@@ -119,15 +120,21 @@ private:
     bool selected = false;     // Is this pad selected for editing?
     float glowIntensity = 0.0f; // Current glow brightness (0.0 to 1.0)
     
+    AnimationClock* animationClock = nullptr;
+    
+    // Called once per display frame while the glow fades
+    bool animationFrame(double elapsedSeconds) override;
+    
     /*
         STATIC CONST
         ------------
         'static' means shared by ALL instances of this class.
         'constexpr' means computed at compile time (more efficient).
         
-        This defines how fast the glow fades out per timer tick.
+        This defines how fast the glow fades out, per second - a full
+        glow is gone in about a fifth of a second, at any frame rate.
     */
-    static constexpr float glowDecay = 0.08f;
+    static constexpr float glowDecayPerSecond = 4.8f;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DrumPad)
 };
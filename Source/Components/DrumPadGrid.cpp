@@ -127,6 +127,12 @@ void DrumPadGrid::triggerPadVisual(int midiNote)
     }
 }
 
+void DrumPadGrid::setAnimationClock(AnimationClock* clock)
+{
+    for (auto* pad : pads)
+        pad->setAnimationClock(clock);
+}
+
 void DrumPadGrid::selectPad(int midiNote)
 {
     selectedNote = midiNote;
@@ -15,6 +15,9 @@ public:
     // Trigger visual feedback for a specific MIDI note (called from MIDI input)
     void triggerPadVisual(int midiNote);
     
+    // The clock that animates the pads' glow (must outlive the grid)
+    void setAnimationClock(AnimationClock* clock);
+    
     // Get the currently selected pad's MIDI note
     int getSelectedNote() const { return selectedNote; }
     
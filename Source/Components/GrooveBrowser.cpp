@@ -25,7 +25,7 @@ void GrooveBrowser::DraggableGrooveListBox::startDragFromRow(int row)
     if (!dragStarted && row >= 0)
     {
         dragStarted = true;
-        browser.selectedGrooveIndex = row;
+        browser.selectGrooveAtRow(row);
         selectRow(row);
         browser.startExternalDrag();
     }
@@ -86,6 +86,20 @@ GrooveBrowser::GrooveBrowser()
     grooveLabel.setJustificationType(juce::Justification::centredLeft);
     addAndMakeVisible(grooveLabel);
     
+    // Search box
+    searchBox.setTextToShowWhenEmpty("Search grooves...", dimTextColour);
+    searchBox.setFont(juce::Font(12.0f));
+    searchBox.setColour(juce::TextEditor::backgroundColourId, juce::Colour(0xFF2A2A2A));
+    searchBox.setColour(juce::TextEditor::textColourId, textColour);
+    searchBox.setColour(juce::TextEditor::outlineColourId, juce::Colour(0xFF444444));
+    searchBox.setColour(juce::TextEditor::focusedOutlineColourId, selectedColour);
+    searchBox.setTooltip("Search by name or style.\nAlso: 6/8 (time signature), 4bars, <4bars, >2bars (length),\nsparse or busy (density)");
+    searchBox.onTextChange = [this]() { updateSearch(); };
+    searchBox.onEscapeKey = [this]() { searchBox.setText({}, true); };
+    addAndMakeVisible(searchBox);
+    
+    search.onResults = [this](const GrooveSearch::Results& results) { showSearchResults(results); };
+    
     // Category list box
     categoryListBox.setModel(this);
     categoryListBox.setColour(juce::ListBox::backgroundColourId, backgroundColour);
@@ -175,8 +189,10 @@ void GrooveBrowser::resized()
     leftPanel.removeFromTop(5);
     categoryListBox.setBounds(leftPanel);
     
-    // Groove panel
-    grooveLabel.setBounds(rightPanel.removeFromTop(24));
+    // Groove panel, with the search box beside its title
+    auto grooveHeader = rightPanel.removeFromTop(24);
+    grooveLabel.setBounds(grooveHeader.removeFromLeft(110));
+    searchBox.setBounds(grooveHeader);
     rightPanel.removeFromTop(5);
     
     // Bottom row: bar selector and buttons
@@ -206,6 +222,14 @@ void GrooveBrowser::refresh()
 {
     selectedCategoryIndex = -1;
     selectedGrooveIndex = -1;
+    thumbnails.clear();  // Indices may mean other grooves after a rescan
+    
+    // Results from before are out of date too
+    search.cancel();
+    searching = false;
+    searchResults.clear();
+    searchBox.setText({}, false);
+    grooveLabel.setText("GROOVES", juce::dontSendNotification);
     
     categoryListBox.updateContent();
     grooveListBox.updateContent();
@@ -260,13 +284,134 @@ void GrooveBrowser::paintListBoxItem(int rowNumber, juce::Graphics& g, int width
 void GrooveBrowser::listBoxItemClicked(int row, const juce::MouseEvent& e)
 {
     juce::ignoreUnused(e);
+    
+    // Picking a style leaves the search
+    if (searchBox.getText().isNotEmpty())
+    {
+        searchBox.setText({}, false);
+        endSearch();
+    }
+    
     onCategorySelected(row);
 }
 
 void GrooveBrowser::listBoxItemDoubleClicked(int row, const juce::MouseEvent& e)
 {
-    juce::ignoreUnused(e);
-    onCategorySelected(row);
+    listBoxItemClicked(row, e);
+}
+
+/*
+    UPDATE SEARCH
+    -------------
+    Every keystroke starts a new search on the index (built once, then
+    shared); the list changes when its results come back, and a search
+    still running is given up for the new one.
+*/
+void GrooveBrowser::updateSearch()
+{
+    const auto text = searchBox.getText().trim();
+    
+    if (text.isEmpty() || grooveManager == nullptr)
+    {
+        endSearch();
+        return;
+    }
+    
+    search.search(grooveManager->getSearchIndex(), text);
+}
+
+void GrooveBrowser::showSearchResults(const GrooveSearch::Results& results)
+{
+    searching = true;
+    searchResults = results;
+    
+    grooveLabel.setText("RESULTS (" + juce::String(static_cast<int>(searchResults.size())) + ")",
+                        juce::dontSendNotification);
+    categoryListBox.deselectAllRows();
+    
+    grooveListBox.updateContent();
+    grooveListBox.deselectAllRows();
+    grooveListBox.scrollToEnsureRowIsOnscreen(0);
+    
+    // Keep the selected groove highlighted if it is among the results
+    for (size_t row = 0; row < searchResults.size(); ++row)
+    {
+        if (searchResults[row].categoryIndex == selectedCategoryIndex
+            && searchResults[row].grooveIndex == selectedGrooveIndex)
+        {
+            grooveListBox.selectRow(static_cast<int>(row), true);
+            break;
+        }
+    }
+    
+    grooveListBox.repaint();
+}
+
+/*
+    END SEARCH
+    ----------
+    Back to browsing - in the style of the groove that was selected last,
+    with that groove still selected, without previewing it again.
+*/
+void GrooveBrowser::endSearch()
+{
+    search.cancel();
+    
+    if (!searching)
+        return;
+    
+    searching = false;
+    searchResults.clear();
+    grooveLabel.setText("GROOVES", juce::dontSendNotification);
+    
+    if (selectedCategoryIndex < 0 && grooveManager != nullptr && !grooveManager->getCategories().empty())
+        selectedCategoryIndex = 0;
+    
+    categoryListBox.selectRow(selectedCategoryIndex);
+    grooveListBox.updateContent();
+    
+    if (selectedGrooveIndex >= 0)
+        grooveListBox.selectRow(selectedGrooveIndex);
+    else
+        grooveListBox.deselectAllRows();
+    
+    grooveListBox.repaint();
+}
+
+bool GrooveBrowser::getGrooveAtRow(int row, int& categoryIndex, int& grooveIndex) const
+{
+    if (grooveManager == nullptr || row < 0)
+        return false;
+    
+    if (searching)
+    {
+        if (row >= static_cast<int>(searchResults.size()))
+            return false;
+        
+        categoryIndex = searchResults[static_cast<size_t>(row)].categoryIndex;
+        grooveIndex = searchResults[static_cast<size_t>(row)].grooveIndex;
+    }
+    else
+    {
+        categoryIndex = selectedCategoryIndex;
+        grooveIndex = row;
+    }
+    
+    const auto& categories = grooveManager->getCategories();
+    return categoryIndex >= 0 && categoryIndex < static_cast<int>(categories.size())
+        && grooveIndex < static_cast<int>(categories[static_cast<size_t>(categoryIndex)].grooves.size());
+}
+
+void GrooveBrowser::selectGrooveAtRow(int row)
+{
+    int categoryIndex = -1;
+    int grooveIndex = -1;
+    
+    if (getGrooveAtRow(row, categoryIndex, grooveIndex))
+    {
+        selectedCategoryIndex = categoryIndex;
+        selectedGrooveIndex = grooveIndex;
+    }
 }
 
 void GrooveBrowser::onCategorySelected(int categoryIndex)
@@ -323,6 +468,9 @@ int GrooveBrowser::getSelectedBarCount() const
 // GrooveListModel implementation
 int GrooveBrowser::GrooveListModel::getNumRows()
 {
+    if (browser.searching)
+        return static_cast<int>(browser.searchResults.size());
+    
     if (browser.grooveManager == nullptr || browser.selectedCategoryIndex < 0)
         return 0;
     
@@ -336,16 +484,12 @@ int GrooveBrowser::GrooveListModel::getNumRows()
 void GrooveBrowser::GrooveListModel::paintListBoxItem(int rowNumber, juce::Graphics& g, 
                                                        int width, int height, bool rowIsSelected)
 {
-    if (browser.grooveManager == nullptr || browser.selectedCategoryIndex < 0)
+    int categoryIndex = -1;
+    int grooveIndex = -1;
+    if (!browser.getGrooveAtRow(rowNumber, categoryIndex, grooveIndex))
         return;
     
-    const auto& categories = browser.grooveManager->getCategories();
-    if (browser.selectedCategoryIndex >= static_cast<int>(categories.size()))
-        return;
-    
-    const auto& grooves = categories[browser.selectedCategoryIndex].grooves;
-    if (rowNumber < 0 || rowNumber >= static_cast<int>(grooves.size()))
-        return;
+    const auto& category = browser.grooveManager->getCategories()[static_cast<size_t>(categoryIndex)];
     
     // Background
     if (rowIsSelected)
@@ -367,36 +511,73 @@ void GrooveBrowser::GrooveListModel::paintListBoxItem(int rowNumber, juce::Graph
     g.fillRect(10, height / 2 - 3, 6, 2);
     g.fillRect(10, height / 2 + 1, 4, 2);
     
+    // Pattern thumbnail on the right, once the groove has been parsed
+    const auto& groove = category.grooves[static_cast<size_t>(grooveIndex)];
+    int textWidth = width - 28;
+    
+    if (groove.isLoaded && width > 160)
+    {
+        const int thumbnailWidth = 64;
+        const int thumbnailHeight = juce::jmax(1, height - 6);
+        const double beatsPerBar = static_cast<double>(juce::jmax(1, groove.numerator));
+        const auto thumbnail = browser.thumbnails.get(groove, categoryIndex, grooveIndex,
+                                                      juce::jmin(groove.lengthInBeats, 4.0 * beatsPerBar),
+                                                      thumbnailWidth, thumbnailHeight);
+        
+        if (thumbnail.isValid())
+        {
+            g.setOpacity(rowIsSelected ? 1.0f : 0.75f);
+            g.drawImageAt(thumbnail, width - thumbnailWidth - 6, 3);
+            g.setOpacity(1.0f);
+            textWidth -= thumbnailWidth + 8;
+        }
+    }
+    
+    // Search results come from every style - say which
+    if (browser.searching)
+    {
+        const int categoryWidth = textWidth / 3;
+        textWidth -= categoryWidth;
+        
+        g.setColour(browser.dimTextColour);
+        g.setFont(juce::Font(10.0f));
+        g.drawText(category.name, 24 + textWidth, 0, categoryWidth, height, juce::Justification::centredRight, true);
+    }
+    
     // Text
     g.setColour(rowIsSelected ? browser.textColour : browser.dimTextColour);
     g.setFont(juce::Font(12.0f));
-    g.drawText(grooves[rowNumber].name, 24, 0, width - 28, height, juce::Justification::centredLeft);
+    g.drawText(groove.name, 24, 0, textWidth, height, juce::Justification::centredLeft, true);
 }
 
 void GrooveBrowser::GrooveListModel::listBoxItemClicked(int row, const juce::MouseEvent& e)
 {
     juce::ignoreUnused(e);
     
-    if (browser.grooveManager == nullptr || browser.selectedCategoryIndex < 0)
+    int categoryIndex = -1;
+    int grooveIndex = -1;
+    if (!browser.getGrooveAtRow(row, categoryIndex, grooveIndex))
         return;
     
-    browser.selectedGrooveIndex = row;
+    browser.selectGrooveAtRow(row);
     
     if (browser.onGrooveSelected)
-        browser.onGrooveSelected(browser.selectedCategoryIndex, row);
+        browser.onGrooveSelected(categoryIndex, grooveIndex);
 }
 
 void GrooveBrowser::GrooveListModel::listBoxItemDoubleClicked(int row, const juce::MouseEvent& e)
 {
     juce::ignoreUnused(e);
     
-    if (browser.grooveManager == nullptr || browser.selectedCategoryIndex < 0)
+    int categoryIndex = -1;
+    int grooveIndex = -1;
+    if (!browser.getGrooveAtRow(row, categoryIndex, grooveIndex))
         return;
     
-    browser.selectedGrooveIndex = row;
+    browser.selectGrooveAtRow(row);
     
     if (browser.onGrooveDoubleClicked)
-        browser.onGrooveDoubleClicked(browser.selectedCategoryIndex, row);
+        browser.onGrooveDoubleClicked(categoryIndex, grooveIndex);
 }
 
 juce::var GrooveBrowser::GrooveListModel::getDragSourceDescription(const juce::SparseSet<int>& selectedRows)
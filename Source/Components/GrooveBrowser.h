@@ -8,6 +8,8 @@
     Features:
     - Category list (left panel) showing groove folders
     - Groove list (right panel) showing grooves in selected category
+    - Search box: typing lists matching grooves from every category
+      instead (see GrooveSearch.h for what a query can say)
     - Double-click to preview a groove
     - Drag & drop support for dragging grooves to DAW
 */
@@ -16,6 +18,8 @@
 
 #include "../JuceHeader.h"
 #include "../GrooveManager.h"
+#include "../GrooveSearch.h"
+#include "GrooveThumbnails.h"
 
 class GrooveBrowser : public juce::Component,
                       public juce::ListBoxModel,
@@ -122,6 +126,33 @@ private:
     
     GrooveListModel grooveListModel;
     
+    // Pattern pictures for the groove rows (drawn once per groove)
+    GrooveThumbnails thumbnails;
+    
+    /*
+        SEARCH
+        ------
+        While the search box has text, the groove list shows searchResults
+        - grooves from any category - instead of the selected category.
+        The list box only asks for the rows on screen, so ten thousand
+        results cost no more to show than ten.
+    */
+    juce::TextEditor searchBox;
+    GrooveSearch search;
+    GrooveSearch::Results searchResults;
+    bool searching = false;
+    
+    // The search box changed: search again, or go back to the category
+    void updateSearch();
+    void showSearchResults(const GrooveSearch::Results& results);
+    void endSearch();
+    
+    // The groove a row of the groove list shows (a category's or a search result)
+    bool getGrooveAtRow(int row, int& categoryIndex, int& grooveIndex) const;
+    
+    // Make the row's groove the selected one
+    void selectGrooveAtRow(int row);
+    
     // Start external file drag for DAW integration
     void startExternalDrag();
     
@@ -78,6 +78,16 @@ GrooveComposer::GrooveComposer()
         }
     };
     addAndMakeVisible(exportButton);
+    
+    // Bounce button - renders the composition to audio files
+    bounceButton.setButtonText("Bounce Audio");
+    bounceButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF3A5A6A));
+    bounceButton.setColour(juce::TextButton::textColourOffId, textColour);
+    bounceButton.onClick = [this]() { showBounceMenu(); };
+    addAndMakeVisible(bounceButton);
+    
+    // The timeline only changes on edits and selection - keep it as an image in between
+    setBufferedToImage(true);
 }
 
 GrooveComposer::~GrooveComposer()
@@ -112,59 +122,64 @@ void GrooveComposer::paint(juce::Graphics& g)
     g.fillRoundedRectangle(bounds.toFloat(), 4.0f);
     
     // Draw composer items
-    if (grooveManager != nullptr)
+    if (grooveManager == nullptr)
+        return;
+    
+    const auto& items = grooveManager->getComposerItems();
+    
+    for (size_t i = 0; i < itemRects.size(); ++i)
     {
-        const auto& items = grooveManager->getComposerItems();
+        const auto& rect = itemRects[i];
         
-        if (items.empty())
+        // Only the blocks inside the area being repainted
+        if (!g.clipRegionIntersects(rect.bounds))
+            continue;
+        
+        if (rect.composerIndex < 0 || rect.composerIndex >= static_cast<int>(items.size()))
+            continue;
+        
+        const auto& item = items[rect.composerIndex];
+        const Groove* groove = grooveManager->getGroove(item.grooveCategoryIndex, item.grooveIndex);
+        
+        if (groove == nullptr)
+            continue;
+        
+        // Item background
+        juce::Colour itemBg = itemColour;
+        if (static_cast<int>(i) == selectedItemIndex)
+            itemBg = selectedItemColour;
+        else if (static_cast<int>(i) == hoveredItemIndex)
+            itemBg = itemColour.brighter(0.2f);
+        
+        g.setColour(itemBg);
+        g.fillRoundedRectangle(rect.bounds.toFloat(), 3.0f);
+        
+        // Item border
+        g.setColour(itemBg.brighter(0.3f));
+        g.drawRoundedRectangle(rect.bounds.toFloat(), 3.0f, 1.0f);
+        
+        auto contentArea = rect.bounds.reduced(4, 2);
+        
+        // Pattern under the name, when the block is tall enough for both
+        if (contentArea.getHeight() >= 30 && groove->isLoaded)
         {
-            // Show hint when empty
-            hintLabel.setVisible(true);
+            auto patternArea = contentArea.removeFromBottom(contentArea.getHeight() - 14);
+            const auto thumbnail = thumbnails.get(*groove, item.grooveCategoryIndex, item.grooveIndex,
+                                                  item.lengthInBeats, patternArea.getWidth(), patternArea.getHeight());
+            
+            if (thumbnail.isValid())
+                g.drawImageAt(thumbnail, patternArea.getX(), patternArea.getY());
         }
-        else
-        {
-            hintLabel.setVisible(false);
             
-            // Draw each item
-            for (size_t i = 0; i < itemRects.size(); ++i)
-            {
-                const auto& rect = itemRects[i];
-                
-                if (rect.composerIndex < 0 || rect.composerIndex >= static_cast<int>(items.size()))
-                    continue;
-                
-                const auto& item = items[rect.composerIndex];
-                const Groove* groove = grooveManager->getGroove(item.grooveCategoryIndex, item.grooveIndex);
-                
-                if (groove == nullptr)
-                    continue;
-                
-                // Item background
-                juce::Colour itemBg = itemColour;
-                if (static_cast<int>(i) == selectedItemIndex)
-                    itemBg = selectedItemColour;
-                else if (static_cast<int>(i) == hoveredItemIndex)
-                    itemBg = itemColour.brighter(0.2f);
-                
-                g.setColour(itemBg);
-                g.fillRoundedRectangle(rect.bounds.toFloat(), 3.0f);
-                
-                // Item border
-                g.setColour(itemBg.brighter(0.3f));
-                g.drawRoundedRectangle(rect.bounds.toFloat(), 3.0f, 1.0f);
+        // Item text
+        g.setColour(textColour);
+        g.setFont(juce::Font(10.0f));
                 
-                // Item text
-                g.setColour(textColour);
-                g.setFont(juce::Font(10.0f));
+        juce::String displayName = groove->name;
+        if (rect.bounds.getWidth() < 60)
+            displayName = displayName.substring(0, 6) + "...";
                 
-                juce::String displayName = groove->name;
-                if (rect.bounds.getWidth() < 60)
-                    displayName = displayName.substring(0, 6) + "...";
-                
-                g.drawText(displayName, rect.bounds.reduced(4, 2), 
-                          juce::Justification::centred, true);
-            }
-        }
+        g.drawText(displayName, contentArea, juce::Justification::centred, true);
     }
 }
 
@@ -180,6 +195,10 @@ void GrooveComposer::resized()
     topRow.removeFromLeft(5);
     exportButton.setBounds(topRow.removeFromLeft(80));
     
+    // Bounce Audio button
+    topRow.removeFromLeft(5);
+    bounceButton.setBounds(topRow.removeFromLeft(90));
+    
     // Play button on the left
     auto leftArea = bounds.removeFromLeft(35);
     playButton.setBounds(leftArea.withSizeKeepingCentre(30, 30));
@@ -205,6 +224,10 @@ void GrooveComposer::setGrooveManager(GrooveManager* manager)
 void GrooveComposer::refresh()
 {
     updateItemRects();
+    
+    // Shown while there is nothing to draw (set here rather than from paint())
+    hintLabel.setVisible(grooveManager == nullptr || grooveManager->getComposerItems().empty());
+    
     repaint();
 }
 
@@ -216,6 +239,42 @@ void GrooveComposer::setPlaying(bool playing)
                          playing ? juce::Colour(0xFF5A5A2A) : juce::Colour(0xFF2A5A2A));
 }
 
+void GrooveComposer::setBounceProgress(float progress)
+{
+    const bool bouncing = progress >= 0.0f;
+    bounceButton.setEnabled(!bouncing);
+    bounceButton.setButtonText(bouncing ? "Bouncing " + juce::String(juce::roundToInt(progress * 100.0f)) + "%"
+                                        : juce::String("Bounce Audio"));
+}
+
+void GrooveComposer::showBounceMenu()
+{
+    if (grooveManager == nullptr || grooveManager->getComposerItems().empty())
+    {
+        DBG("GrooveComposer: No items to bounce");
+        return;
+    }
+    
+    using Format = OfflineRenderer::Format;
+    using Stems = OfflineRenderer::Stems;
+    
+    juce::PopupMenu menu;
+    menu.addItem(1, "Main Mix (WAV)");
+    menu.addItem(2, "Main Mix + Stems (WAV)");
+    menu.addItem(3, "Main Mix (FLAC)");
+    menu.addItem(4, "Main Mix + Stems (FLAC)");
+    
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&bounceButton),
+                       [safeThis = juce::Component::SafePointer<GrooveComposer>(this)](int choice)
+    {
+        if (safeThis == nullptr || choice == 0 || !safeThis->onBounceClicked)
+            return;
+        
+        safeThis->onBounceClicked(choice <= 2 ? Format::wav : Format::flac,
+                                  (choice % 2) == 0 ? Stems::perGroup : Stems::mainOnly);
+    });
+}
+
 void GrooveComposer::updateItemRects()
 {
     itemRects.clear();
@@ -270,6 +329,12 @@ int GrooveComposer::getItemAtPosition(juce::Point<int> pos)
     return -1;
 }
 
+void GrooveComposer::repaintItem(int itemIndex)
+{
+    if (itemIndex >= 0 && itemIndex < static_cast<int>(itemRects.size()))
+        repaint(itemRects[static_cast<size_t>(itemIndex)].bounds.expanded(1));
+}
+
 void GrooveComposer::mouseDown(const juce::MouseEvent& e)
 {
     int clickedItem = getItemAtPosition(e.getPosition());
@@ -287,10 +352,12 @@ void GrooveComposer::mouseDown(const juce::MouseEvent& e)
                 onCompositionChanged();
         }
     }
-    else
+    else if (clickedItem != selectedItemIndex)
     {
+        // Only the blocks that change colour
+        repaintItem(selectedItemIndex);
         selectedItemIndex = clickedItem;
-        repaint();
+        repaintItem(selectedItemIndex);
     }
 }
 
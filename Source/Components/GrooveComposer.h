@@ -13,6 +13,8 @@
 
 #include "../JuceHeader.h"
 #include "../GrooveManager.h"
+#include "../OfflineRenderer.h"
+#include "GrooveThumbnails.h"
 
 class GrooveComposer : public juce::Component,
                        public juce::DragAndDropTarget,
@@ -47,8 +49,14 @@ public:
     std::function<void()> onClearClicked;
     std::function<void()> onCompositionChanged;
     
+    // "Bounce Audio" menu choice: render the composition to audio files
+    std::function<void(OfflineRenderer::Format, OfflineRenderer::Stems)> onBounceClicked;
+    
     // Set playing state (for button appearance)
     void setPlaying(bool isPlaying);
+    
+    // Show bounce progress on the button (progress < 0 = not bouncing)
+    void setBounceProgress(float progress);
 
 private:
     GrooveManager* grooveManager = nullptr;
@@ -62,6 +70,7 @@ private:
     juce::TextButton playButton;
     juce::TextButton clearButton;
     juce::TextButton exportButton;  // Export and show in folder
+    juce::TextButton bounceButton;  // Render to audio and show in folder
     
     // Composer item display
     struct ItemRect
@@ -84,9 +93,18 @@ private:
     // Get item at position
     int getItemAtPosition(juce::Point<int> pos);
     
+    // Repaint just one item's block (-1 = none)
+    void repaintItem(int itemIndex);
+    
+    // Pattern pictures for the item blocks (drawn once per groove and size)
+    GrooveThumbnails thumbnails;
+    
     // Start external drag for DAW
     void startExternalDrag();
     
+    // Pick the bounce format and stems
+    void showBounceMenu();
+    
     // Colors
     juce::Colour backgroundColour{0xFF1A1A1A};
     juce::Colour itemColour{0xFF3A5A7A};
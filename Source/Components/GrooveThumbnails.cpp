@@ -0,0 +1,79 @@
+/*
+    GrooveThumbnails.cpp
+    ====================
+    
+    Implementation of the cached groove pattern pictures.
+*/
+
+#include "GrooveThumbnails.h"
+
+namespace
+{
+    enum Lane { cymbalLane = 0, snareLane, kickLane, numLanes };
+    
+    // GM drum notes to the thumbnail's three lanes
+    Lane getLaneForNote(int note)
+    {
+        if (note == 35 || note == 36)
+            return kickLane;
+        
+        switch (note)
+        {
+            case 42: case 44: case 46:                      // Hi-hats
+            case 49: case 51: case 52: case 53: case 55:    // Crashes, rides, china, splash
+            case 57: case 59:
+                return cymbalLane;
+            default:
+                return snareLane;
+        }
+    }
+}
+
+juce::Image GrooveThumbnails::get(const Groove& groove, int categoryIndex, int grooveIndex,
+                                  double lengthInBeats, int width, int height)
+{
+    if (width <= 0 || height <= 0 || lengthInBeats <= 0.0)
+        return {};
+    
+    const Key key { categoryIndex, grooveIndex, GrooveEventList::beatsToTicks(lengthInBeats), width, height };
+    
+    auto found = thumbnails.find(key);
+    if (found != thumbnails.end())
+        return found->second;
+    
+    if (thumbnails.size() >= maxThumbnails)
+        thumbnails.clear();
+    
+    auto image = draw(groove, lengthInBeats, width, height);
+    thumbnails.emplace(key, image);
+    return image;
+}
+
+juce::Image GrooveThumbnails::draw(const Groove& groove, double lengthInBeats, int width, int height) const
+{
+    juce::Image image(juce::Image::ARGB, width, height, true);
+    juce::Graphics g(image);
+    
+    const auto& events = groove.events;
+    const float laneHeight = static_cast<float>(height) / static_cast<float>(numLanes);
+    const float pixelsPerBeat = static_cast<float>(width / lengthInBeats);
+    const juce::Colour laneColours[numLanes] = { cymbalColour, snareColour, kickColour };
+    
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (!events.isNoteOn(i))
+            continue;
+        
+        const double beat = events.getBeat(i);
+        if (beat >= lengthInBeats)
+            break;  // Sorted by time - the rest is past the end
+        
+        const auto lane = getLaneForNote(events.getNote(i));
+        const float x = static_cast<float>(beat) * pixelsPerBeat;
+        
+        g.setColour(laneColours[lane].withAlpha(0.35f + 0.65f * events.getFloatVelocity(i)));
+        g.fillRect(x, laneHeight * static_cast<float>(lane) + 1.0f, 1.5f, laneHeight - 2.0f);
+    }
+    
+    return image;
+}
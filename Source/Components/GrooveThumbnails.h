@@ -0,0 +1,46 @@
+/*
+    GrooveThumbnails.h
+    ==================
+    
+    Small pictures of a groove's pattern - cymbals on top, snare and toms
+    in the middle, kick at the bottom, one tick per hit (brighter = harder)
+    - for the browser rows and the composer's blocks.
+    
+    Drawing a groove's notes means walking every event, so each picture
+    is drawn once into a juce::Image and reused: a repaint (scrolling the
+    browser, selecting a block in the composer) just blits it. Pictures
+    are keyed by groove, length and size; the cache is dropped when the
+    library is rescanned (the indices change) and once it has grown past
+    maxThumbnails.
+*/
+
+#pragma once
+
+#include "../JuceHeader.h"
+#include "../GrooveManager.h"
+#include <map>
+#include <tuple>
+
+class GrooveThumbnails
+{
+public:
+    // The groove's first lengthInBeats as a width x height picture (message thread)
+    juce::Image get(const Groove& groove, int categoryIndex, int grooveIndex,
+                    double lengthInBeats, int width, int height);
+    
+    // Forget every picture (after a rescan)
+    void clear() { thumbnails.clear(); }
+    
+    static constexpr size_t maxThumbnails = 512;
+    
+    juce::Colour cymbalColour { 0xFFD4C055 };
+    juce::Colour snareColour { 0xFF00BFFF };
+    juce::Colour kickColour { 0xFFFF7755 };
+
+private:
+    juce::Image draw(const Groove& groove, double lengthInBeats, int width, int height) const;
+    
+    // Category, groove, length (in ticks), width, height
+    using Key = std::tuple<int, int, juce::uint32, int, int>;
+    std::map<Key, juce::Image> thumbnails;
+};
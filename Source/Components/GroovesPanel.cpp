@@ -41,9 +41,36 @@ GroovesPanel::GroovesPanel()
     loopToggle.onClick = [this]() {
         if (grooveManager != nullptr)
             grooveManager->setLooping(loopToggle.getToggleState());
+        if (audioProcessor != nullptr)
+            audioProcessor->getGroovePreviewCache().setLooping(loopToggle.getToggleState());
     };
     addAndMakeVisible(loopToggle);
     
+    // Swing and humanize, applied to whatever plays (nothing in the grooves is changed)
+    auto setupFeelControl = [this](juce::Label& label, juce::Slider& slider, const juce::String& name,
+                                   const juce::String& tooltip)
+    {
+        label.setText(name, juce::dontSendNotification);
+        label.setFont(juce::Font(12.0f));
+        label.setColour(juce::Label::textColourId, textColour);
+        label.setJustificationType(juce::Justification::centredRight);
+        addAndMakeVisible(label);
+        
+        slider.setSliderStyle(juce::Slider::LinearHorizontal);
+        slider.setRange(0.0, 100.0, 1.0);
+        slider.setTextValueSuffix("%");
+        slider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 40, 20);
+        slider.setColour(juce::Slider::trackColourId, juce::Colour(0xFF00BFFF));
+        slider.setColour(juce::Slider::thumbColourId, juce::Colour(0xFFFFFFFF));
+        slider.setTooltip(tooltip);
+        slider.onValueChange = [this]() { applyFeelControls(); };
+        addAndMakeVisible(slider);
+    };
+    
+    setupFeelControl(swingLabel, swingSlider, "Swing", "Swing the off-beat 8th notes (100% = triplet feel)");
+    setupFeelControl(humanizeLabel, humanizeSlider, "Humanize",
+                     "Play each hit a little early or late, softer or harder");
+    
     // BPM label (will be updated from DAW)
     bpmLabel.setText("BPM: ---", juce::dontSendNotification);
     bpmLabel.setFont(juce::Font(12.0f));
@@ -60,6 +87,10 @@ GroovesPanel::GroovesPanel()
 GroovesPanel::~GroovesPanel()
 {
     stopTimer();
+    
+    // The renderer belongs to the processor and may finish after the editor has closed
+    if (audioProcessor != nullptr)
+        audioProcessor->getOfflineRenderer().onFinished = nullptr;
 }
 
 void GroovesPanel::paint(juce::Graphics& g)
@@ -95,6 +126,14 @@ void GroovesPanel::resized()
     
     bpmLabel.setBounds(topBar.removeFromRight(100));
     
+    // Feel controls in between
+    topBar.removeFromLeft(10);
+    swingLabel.setBounds(topBar.removeFromLeft(45));
+    swingSlider.setBounds(topBar.removeFromLeft(140).reduced(0, 6));
+    topBar.removeFromLeft(10);
+    humanizeLabel.setBounds(topBar.removeFromLeft(65));
+    humanizeSlider.setBounds(topBar.removeFromLeft(140).reduced(0, 6));
+    
     bounds.removeFromTop(10);
     
     // Composer at the bottom
@@ -110,6 +149,9 @@ void GroovesPanel::resized()
 void GroovesPanel::setProcessor(JdrummerAudioProcessor* processor)
 {
     audioProcessor = processor;
+    
+    if (processor != nullptr)
+        processor->getGroovePreviewCache().setLooping(loopToggle.getToggleState());
 }
 
 void GroovesPanel::setGrooveManager(GrooveManager* manager)
@@ -122,12 +164,41 @@ void GroovesPanel::setGrooveManager(GrooveManager* manager)
     {
         manager->setLooping(loopToggle.getToggleState());
     }
+    
+    updateFeelControls();
 }
 
 void GroovesPanel::refresh()
 {
     grooveBrowser.refresh();
     grooveComposer.refresh();
+    updateFeelControls();
+}
+
+void GroovesPanel::applyFeelControls()
+{
+    if (grooveManager == nullptr)
+        return;
+    
+    // Keeps whatever else the transform holds (velocity curve, note map, seed)
+    auto transform = grooveManager->getTransform();
+    const double humanize = humanizeSlider.getValue() / 100.0;
+    
+    transform.swing = static_cast<float>(swingSlider.getValue() / 100.0);
+    transform.humanizeBeats = humanize * maxHumanizeBeats;
+    transform.velocityHumanize = static_cast<float>(humanize) * maxVelocityHumanize;
+    
+    grooveManager->setTransform(transform);
+}
+
+void GroovesPanel::updateFeelControls()
+{
+    if (grooveManager == nullptr)
+        return;
+    
+    const auto transform = grooveManager->getTransform();
+    swingSlider.setValue(transform.swing * 100.0, juce::dontSendNotification);
+    humanizeSlider.setValue(transform.humanizeBeats / maxHumanizeBeats * 100.0, juce::dontSendNotification);
 }
 
 void GroovesPanel::setupCallbacks()
@@ -165,6 +236,9 @@ void GroovesPanel::setupCallbacks()
                 }
             }
             
+            if (audioProcessor != nullptr)
+                audioProcessor->getGroovePreviewCache().stop();
+            
             grooveManager->startComposerPlayback();
             grooveComposer.setPlaying(true);
         }
@@ -187,28 +261,103 @@ void GroovesPanel::setupCallbacks()
             grooveComposer.refresh();
         }
     };
+    
+    // Composer bounce menu
+    grooveComposer.onBounceClicked = [this](OfflineRenderer::Format format, OfflineRenderer::Stems stems) {
+        bounceComposition(format, stems);
+    };
 }
 
+/*
+    BOUNCE COMPOSITION
+    ------------------
+    Renders at the DAW's tempo and sample rate, with one stem per output
+    bus name, then shows the files - like Export MIDI does.
+*/
+void GroovesPanel::bounceComposition(OfflineRenderer::Format format, OfflineRenderer::Stems stems)
+{
+    if (audioProcessor == nullptr || grooveManager == nullptr)
+        return;
+    
+    auto& renderer = audioProcessor->getOfflineRenderer();
+    
+    OfflineRenderer::Settings settings;
+    settings.timeline = grooveManager->getCompositionTimeline();
+    settings.format = format;
+    settings.stems = stems;
+    settings.outputDirectory = grooveManager->getExportDirectory().getChildFile("Bounces");
+    
+    const double dawBpm = audioProcessor->getCurrentBPM();
+    if (dawBpm > 0)
+        settings.bpm = dawBpm;
+    
+    const double sampleRate = audioProcessor->getSampleRate();
+    if (sampleRate > 0)
+        settings.sampleRate = sampleRate;
+    
+    // Buses 1-16 are the output groups
+    for (int group = 0; group < SoundFontManager::NUM_OUTPUT_GROUPS; ++group)
+    {
+        const auto* bus = audioProcessor->getBus(false, group + 1);
+        settings.groupNames.add(bus != nullptr ? bus->getName() : "Group " + juce::String(group + 1));
+    }
+    
+    renderer.onFinished = [this](const OfflineRenderer::Result& result) {
+        grooveComposer.setBounceProgress(-1.0f);
+        
+        if (result.success && !result.files.isEmpty())
+            result.files.getFirst().revealToUser();
+        else
+            DBG("GroovesPanel: Bounce failed: " + result.error);
+    };
+    
+    if (renderer.start(std::move(settings)))
+        grooveComposer.setBounceProgress(0.0f);
+}
+
+/*
+    PREVIEW GROOVE
+    --------------
+    Auditions the groove's first bars as audio pre-rendered with the
+    current kit (see GroovePreviewCache.h), at the DAW's tempo. Only
+    without a processor does it fall back to playing the groove live.
+*/
 void GroovesPanel::previewGroove(int categoryIndex, int grooveIndex)
 {
-    if (grooveManager != nullptr)
+    if (grooveManager == nullptr)
+        return;
+    
+    if (audioProcessor != nullptr)
     {
-        // Sync to DAW tempo if available
-        if (audioProcessor != nullptr)
+        double bpm = audioProcessor->getCurrentBPM();
+        if (bpm <= 0)
+            bpm = grooveManager->getPreviewBPM();
+        
+        const double sampleRate = audioProcessor->getSampleRate();
+        
+        if (sampleRate > 0)
         {
-            double dawBpm = audioProcessor->getCurrentBPM();
-            if (dawBpm > 0)
-            {
-                grooveManager->setPreviewBPM(dawBpm);
-            }
+            grooveManager->stopPlayback();
+            grooveManager->stopComposerPlayback();
+            grooveComposer.setPlaying(false);
+            
+            audioProcessor->getGroovePreviewCache().audition(categoryIndex, grooveIndex, bpm, sampleRate);
+            return;
         }
         
-        grooveManager->startPlayback(categoryIndex, grooveIndex);
+        // Sync to DAW tempo if available
+        if (audioProcessor->getCurrentBPM() > 0)
+            grooveManager->setPreviewBPM(audioProcessor->getCurrentBPM());
     }
+    
+    grooveManager->startPlayback(categoryIndex, grooveIndex);
 }
 
 void GroovesPanel::stopPreview()
 {
+    if (audioProcessor != nullptr)
+        audioProcessor->getGroovePreviewCache().stop();
+    
     if (grooveManager != nullptr)
     {
         grooveManager->stopPlayback();
@@ -230,15 +379,22 @@ void GroovesPanel::timerCallback()
     // Update BPM display from DAW
     if (audioProcessor != nullptr)
     {
-        double bpm = audioProcessor->getCurrentBPM();
-        if (bpm > 0)
+        // Rounded as displayed, so a drifting host tempo doesn't rebuild the text every tick
+        const double bpm = std::round(audioProcessor->getCurrentBPM() * 10.0) / 10.0;
+        if (bpm != displayedBpm)
         {
-            bpmLabel.setText("BPM: " + juce::String(bpm, 1), juce::dontSendNotification);
-        }
-        else
-        {
-            bpmLabel.setText("BPM: ---", juce::dontSendNotification);
+            displayedBpm = bpm;
+            
+            if (bpm > 0)
+                bpmLabel.setText("BPM: " + juce::String(bpm, 1), juce::dontSendNotification);
+            else
+                bpmLabel.setText("BPM: ---", juce::dontSendNotification);
         }
+        
+        // Bounce progress (onFinished resets the button)
+        const auto& renderer = audioProcessor->getOfflineRenderer();
+        if (renderer.isRendering())
+            grooveComposer.setBounceProgress(renderer.getProgress());
     }
 }
 
@@ -53,6 +53,21 @@ private:
     juce::TextButton stopButton;
     juce::ToggleButton loopToggle;
     juce::Label bpmLabel;
+    double displayedBpm = -1.0;  // What bpmLabel shows (-1 = nothing yet)
+    
+    // Groove feel (GrooveManager's transform): swing, and timing/velocity humanize
+    juce::Label swingLabel;
+    juce::Slider swingSlider;
+    juce::Label humanizeLabel;
+    juce::Slider humanizeSlider;
+    
+    // Full humanize: up to this far early or late, and this much louder or softer
+    static constexpr double maxHumanizeBeats = 0.05;
+    static constexpr float maxVelocityHumanize = 0.25f;
+    
+    // Sliders -> transform, and back (e.g. after a project was loaded)
+    void applyFeelControls();
+    void updateFeelControls();
     
     // Setup callbacks between components
     void setupCallbacks();
@@ -63,6 +78,9 @@ private:
     // Stop preview
     void stopPreview();
     
+    // Render the composition to audio files in the background
+    void bounceComposition(OfflineRenderer::Format format, OfflineRenderer::Stems stems);
+    
     // Handle external drag from groove browser
     void startGrooveDrag(int categoryIndex, int grooveIndex);
     bool isDragging = false;
@@ -2,7 +2,7 @@
     PadControls.cpp
     ===============
     
-    Implementation of per-pad volume, pan, and mute controls.
+    Implementation of per-pad volume, pan, mute and round-robin controls.
 */
 
 #include "PadControls.h"
@@ -66,6 +66,17 @@ PadControls::PadControls()
     };
     updateMuteButtonAppearance();
     addAndMakeVisible(muteButton);
+    
+    // Round-robin toggle (only makes a difference on kits with velocity layers)
+    roundRobinButton.setButtonText("Round-robin");
+    roundRobinButton.setTooltip("Repeated hits alternate between neighbouring velocity layers");
+    roundRobinButton.setColour(juce::ToggleButton::textColourId, textColour);
+    roundRobinButton.setColour(juce::ToggleButton::tickColourId, accentColour);
+    roundRobinButton.onClick = [this]() {
+        if (onRoundRobinChanged)
+            onRoundRobinChanged(selectedNote, roundRobinButton.getToggleState());
+    };
+    addAndMakeVisible(roundRobinButton);
 }
 
 PadControls::~PadControls()
@@ -103,9 +114,12 @@ void PadControls::resized()
     
     bounds.removeFromTop(10);
     
-    // Mute button - large and prominent
+    // Mute button - large and prominent, with the round-robin toggle beside it
     auto muteRow = bounds.removeFromTop(50);
-    muteButton.setBounds(muteRow.withSizeKeepingCentre(200, 40));
+    auto buttonArea = muteRow.withSizeKeepingCentre(410, 40);
+    muteButton.setBounds(buttonArea.removeFromLeft(200));
+    buttonArea.removeFromLeft(10);
+    roundRobinButton.setBounds(buttonArea);
 }
 
 void PadControls::setSelectedPad(int midiNote, const juce::String& padName)
@@ -146,6 +160,16 @@ bool PadControls::getMute() const
     return muteButton.getToggleState();
 }
 
+void PadControls::setRoundRobin(bool enabled)
+{
+    roundRobinButton.setToggleState(enabled, juce::dontSendNotification);
+}
+
+bool PadControls::getRoundRobin() const
+{
+    return roundRobinButton.getToggleState();
+}
+
 void PadControls::updateMuteButtonAppearance()
 {
     if (muteButton.getToggleState())
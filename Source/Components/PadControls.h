@@ -2,7 +2,7 @@
     PadControls.h
     =============
     
-    UI component for per-pad volume, pan, and mute controls.
+    UI component for per-pad volume, pan, mute and round-robin controls.
     Displayed at the bottom of the Drum Kit tab.
 */
 
@@ -34,10 +34,15 @@ public:
     void setMute(bool muted);
     bool getMute() const;
     
+    // Get/set round-robin (repeated hits alternate velocity layers)
+    void setRoundRobin(bool enabled);
+    bool getRoundRobin() const;
+    
     // Callbacks for when values change
     std::function<void(int note, float volume)> onVolumeChanged;
     std::function<void(int note, float pan)> onPanChanged;
     std::function<void(int note, bool muted)> onMuteChanged;
+    std::function<void(int note, bool enabled)> onRoundRobinChanged;
 
 private:
     int selectedNote = 36;  // Default to kick drum
@@ -50,6 +55,7 @@ private:
     juce::Label panLabel;
     juce::Slider panSlider;
     juce::TextButton muteButton;
+    juce::ToggleButton roundRobinButton;
     
     // Update mute button appearance based on state
     void updateMuteButtonAppearance();
@@ -0,0 +1,240 @@
+/*
+    DrumVoiceManager.cpp
+    ====================
+    
+    Implementation of drum voice allocation (see DrumVoiceManager.h).
+*/
+
+#include "DrumVoiceManager.h"
+#include "tsf.h"
+
+namespace
+{
+    /*
+        DEFAULT BUDGETS
+        ---------------
+        Sized for how much each instrument overlaps itself: cymbals and
+        hi-hats ring on under fast repeated hits, a kick barely does.
+        Layered kits start two or more voices per hit, so no budget is
+        smaller than a few hits.
+    */
+    constexpr int defaultMainBudget = 64;
+    
+    constexpr std::array<int, DrumVoiceManager::numGroups> defaultGroupBudgets
+    {
+        8,   // Kick
+        12,  // Snare
+        24,  // HiHat Closed
+        12,  // HiHat Open
+        8,   // Tom Low
+        8,   // Tom Mid
+        8,   // Tom High
+        16,  // Crash
+        24,  // Ride
+        8,   // Rim
+        8,   // Clap
+        12,  // Tambourine
+        8,   // Cowbell
+        8,   // Perc 1
+        8,   // Perc 2
+        12   // Perc 3 (everything else)
+    };
+    
+    constexpr float defaultAudibilityFloorDb = -70.0f;
+}
+
+DrumVoiceManager::DrumVoiceManager()
+{
+    voiceBudgets[0] = defaultMainBudget;
+    for (int group = 0; group < numGroups; ++group)
+        voiceBudgets[static_cast<size_t>(group + 1)] = defaultGroupBudgets[static_cast<size_t>(group)];
+    
+    clearChokes();
+    
+    // Closed and pedal hi-hat choke the open hi-hat
+    setChoke(42, 46, true);
+    setChoke(44, 46, true);
+    
+    setAudibilityFloorDb(defaultAudibilityFloorDb);
+}
+
+void DrumVoiceManager::setVoiceBudget(int group, int numVoices)
+{
+    if (group >= -1 && group < numGroups)
+        voiceBudgets[static_cast<size_t>(group + 1)] = juce::jlimit(1, 256, numVoices);
+}
+
+int DrumVoiceManager::getVoiceBudget(int group) const
+{
+    if (group >= -1 && group < numGroups)
+        return voiceBudgets[static_cast<size_t>(group + 1)].load();
+    
+    return defaultMainBudget;
+}
+
+void DrumVoiceManager::setChoke(int note, int chokedNote, bool shouldChoke)
+{
+    if (!isValidNote(note) || !isValidNote(chokedNote) || note == chokedNote)
+        return;
+    
+    auto& word = chokeMasks[static_cast<size_t>(note * chokeWords + chokedNote / 32)];
+    const auto bit = static_cast<juce::uint32>(1u << (chokedNote % 32));
+    
+    if (shouldChoke)
+        word.fetch_or(bit);
+    else
+        word.fetch_and(~bit);
+}
+
+bool DrumVoiceManager::chokes(int note, int chokedNote) const
+{
+    if (!isValidNote(note) || !isValidNote(chokedNote))
+        return false;
+    
+    const auto bits = chokeMasks[static_cast<size_t>(note * chokeWords + chokedNote / 32)].load();
+    return (bits & (1u << (chokedNote % 32))) != 0;
+}
+
+void DrumVoiceManager::clearChokes()
+{
+    for (auto& word : chokeMasks)
+        word = 0;
+}
+
+void DrumVoiceManager::setAudibilityFloorDb(float floorDb)
+{
+    audibilityFloorGain = juce::Decibels::decibelsToGain(floorDb, -200.0f);
+}
+
+int DrumVoiceManager::countTrailingZeros(juce::uint32 bits)
+{
+    int count = 0;
+    while ((bits & 1u) == 0 && count < 32)
+    {
+        bits >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+/*
+    MAKE ROOM FOR NOTE
+    ------------------
+    The caller knows how many voices the note will start (one per region
+    it plays - layered kits often use two or more, see SampleSelector);
+    voices are stolen until they fit. The budget can't exceed the slots
+    the instance was built with.
+*/
+void DrumVoiceManager::makeRoomForNote(tsf* instance, int budget, int voicesNeeded) const
+{
+    if (instance == nullptr)
+        return;
+    
+    const int numSlots = tsf_voice_slot_count(instance);
+    const int maxVoices = juce::jmin(budget, numSlots);
+    voicesNeeded = juce::jmin(maxVoices, voicesNeeded);
+    
+    int numActive = tsf_active_voice_count(instance);
+    
+    while (numActive > maxVoices - voicesNeeded)
+    {
+        const int slot = findVoiceToSteal(instance);
+        if (slot < 0)
+            break;
+        
+        tsf_voice_stop(instance, slot);
+        --numActive;
+    }
+}
+
+/*
+    FIND VOICE TO STEAL
+    -------------------
+    A voice that is already releasing is the cheapest loss, quietest
+    first. If every voice is still sounding, the steal mode decides:
+    the oldest hit (lowest play index), or the quietest one right now.
+    Voices still in their attack only look quiet, so they come last
+    (oldest first) whatever the mode.
+*/
+int DrumVoiceManager::findVoiceToSteal(tsf* instance) const
+{
+    const bool stealQuietest = (stealMode.load() == StealMode::quietest);
+    const int numSlots = tsf_voice_slot_count(instance);
+    
+    int bestSlot = -1;
+    int bestTier = 0;
+    float bestGain = 0.0f;
+    unsigned int bestPlayIndex = 0;
+    
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        tsf_voice_info info;
+        if (!tsf_voice_get_info(instance, slot, &info))
+            continue;
+        
+        // 0 = releasing, 1 = sounding, 2 = attacking
+        const int tier = info.released ? 0 : (info.attacking ? 2 : 1);
+        const bool byGain = (tier == 0 || (tier == 1 && stealQuietest));
+        const bool isOlder = static_cast<int>(info.playIndex - bestPlayIndex) < 0;  // Wrap-safe
+        
+        const bool better = bestSlot < 0
+                         || tier < bestTier
+                         || (tier == bestTier && (byGain ? info.gain < bestGain : isOlder));
+        
+        if (better)
+        {
+            bestSlot = slot;
+            bestTier = tier;
+            bestGain = info.gain;
+            bestPlayIndex = info.playIndex;
+        }
+    }
+    
+    return bestSlot;
+}
+
+void DrumVoiceManager::chokeNote(tsf* instance, int note)
+{
+    if (instance == nullptr)
+        return;
+    
+    const int numSlots = tsf_voice_slot_count(instance);
+    
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        tsf_voice_info info;
+        // Voices already releasing are cut short too - a long release is ringing on
+        if (tsf_voice_get_info(instance, slot, &info) && info.key == note)
+            tsf_voice_release(instance, slot, chokeReleaseSeconds);
+    }
+}
+
+/*
+    CULL INAUDIBLE VOICES
+    ---------------------
+    The level checked is the envelope times the note's gain - the most
+    the voice can still contribute, since samples are at most full
+    scale. Voices still in their attack are left alone: they start
+    quiet but are about to get loud.
+*/
+int DrumVoiceManager::cullInaudibleVoices(tsf* instance) const
+{
+    const float floorGain = audibilityFloorGain.load();
+    if (instance == nullptr || floorGain <= 0.0f)
+        return 0;
+    
+    const int numSlots = tsf_voice_slot_count(instance);
+    int numCulled = 0;
+    
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        tsf_voice_info info;
+        if (tsf_voice_get_info(instance, slot, &info) && !info.attacking && info.gain < floorGain)
+        {
+            tsf_voice_stop(instance, slot);
+            ++numCulled;
+        }
+    }
+    
+    return numCulled;
+}
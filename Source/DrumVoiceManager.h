@@ -0,0 +1,131 @@
+/*
+    DrumVoiceManager.h
+    ==================
+    
+    Voice allocation tuned for drums, on top of TinySoundFont.
+    
+    WHY?
+    ----
+    TSF's own allocation is built for melodic instruments: with a fixed
+    voice count it only steals voices that are already releasing, and
+    simply drops the note when there are none - which is exactly what
+    happens in a fast hi-hat or ride roll, where every hit is still
+    ringing. And nothing stops an open hi-hat ringing over the closed
+    one that follows it.
+    
+    WHAT IT DOES
+    ------------
+    - VOICE BUDGETS: every output group (one TSF instance each) gets its
+      own voice count, sized for the instrument - a ride needs many more
+      overlapping hits than a kick.
+    - STEALING: before a note starts, voices are freed until it fits in
+      the budget. Released voices go first; after that the oldest or the
+      quietest, depending on the steal mode. A new hit is never dropped.
+    - CHOKE GROUPS: a note can choke others (by default closed and pedal
+      hi-hat, 42/44, choke the open hi-hat, 46). The choked voices are
+      released over a few milliseconds instead of ringing on.
+    - CULLING: voices whose level has decayed below the audibility floor
+      are stopped, so long cymbal tails don't cost CPU after they can
+      no longer be heard.
+    
+    Together these bound the CPU of a dense groove: never more than the
+    sum of the budgets, and in practice far fewer.
+    
+    THREADING
+    ---------
+    Settings are atomics (any thread). Budgets size an instance's voice
+    slots when a kit is built, so a change applies from the next kit
+    load. The voice operations are AUDIO THREAD (or offline render)
+    only, on instances nobody else is rendering.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+#include <atomic>
+
+// Forward declaration - tsf is defined in tsf.h
+struct tsf;
+
+class DrumVoiceManager
+{
+public:
+    // Output groups, in the order of the plugin's output buses
+    // (see JdrummerAudioProcessor::getOutputGroupForNote)
+    static constexpr int numGroups = 16;
+    static constexpr int numNotes = 128;
+    
+    DrumVoiceManager();
+    
+    // ===== SETTINGS (any thread) =====
+    
+    // Voices for one output group's instance, or for the main instance (group -1)
+    void setVoiceBudget(int group, int numVoices);
+    int getVoiceBudget(int group) const;
+    
+    enum class StealMode { oldest, quietest };
+    void setStealMode(StealMode mode) { stealMode = mode; }
+    StealMode getStealMode() const { return stealMode.load(); }
+    
+    // Playing `note` releases every voice of `chokedNote`
+    void setChoke(int note, int chokedNote, bool shouldChoke);
+    bool chokes(int note, int chokedNote) const;
+    void clearChokes();
+    
+    // Voices past their attack and quieter than this are stopped (dB, -inf = never)
+    void setAudibilityFloorDb(float floorDb);
+    float getAudibilityFloorDb() const { return juce::Decibels::gainToDecibels(audibilityFloorGain.load(), -200.0f); }
+    
+    // ===== VOICE OPERATIONS (audio thread) =====
+    
+    // Free voices on an instance until a hit starting `voicesNeeded` voices (one per
+    // region it plays) would fit in `budget` - never mind TSF's own allocation,
+    // which would drop the note
+    void makeRoomForNote(tsf* instance, int budget, int voicesNeeded) const;
+    
+    // Release every voice of `note` on the instance, over chokeReleaseSeconds
+    static void chokeNote(tsf* instance, int note);
+    
+    // Stop voices that can no longer be heard; returns how many were stopped
+    int cullInaudibleVoices(tsf* instance) const;
+    
+    // Calls noteToInstance(chokedNote) for each note that `note` chokes
+    template <typename Function>
+    void forEachChokedNote(int note, Function&& noteToInstance) const
+    {
+        if (!isValidNote(note))
+            return;
+        
+        for (int word = 0; word < chokeWords; ++word)
+        {
+            for (auto bits = chokeMasks[static_cast<size_t>(note * chokeWords + word)].load(std::memory_order_relaxed);
+                 bits != 0; bits &= bits - 1)
+            {
+                noteToInstance(word * 32 + countTrailingZeros(bits));
+            }
+        }
+    }
+    
+    // How quickly a choked voice falls silent (short, but long enough not to click)
+    static constexpr float chokeReleaseSeconds = 0.03f;
+
+private:
+    static bool isValidNote(int note) { return note >= 0 && note < numNotes; }
+    static int countTrailingZeros(juce::uint32 bits);
+    
+    // Slot of the voice to steal on an instance (-1 if nothing is playing)
+    int findVoiceToSteal(tsf* instance) const;
+    
+    // Budgets: main instance first, then the groups
+    std::array<std::atomic<int>, numGroups + 1> voiceBudgets;
+    
+    std::atomic<StealMode> stealMode { StealMode::quietest };
+    std::atomic<float> audibilityFloorGain { 0.0f };
+    
+    // One bit per choked note for every note (128 bits each, in 32-bit words)
+    static constexpr int chokeWords = numNotes / 32;
+    std::array<std::atomic<juce::uint32>, numNotes * chokeWords> chokeMasks;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DrumVoiceManager)
+};
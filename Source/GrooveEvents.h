@@ -0,0 +1,223 @@
+/*
+    GrooveEvents.h
+    ==============
+    
+    The compact, compiled form of a groove's notes.
+    
+    WHY NOT A VECTOR OF juce::MidiMessage?
+    --------------------------------------
+    A MidiMessage plus a double timestamp is around 40 bytes per event,
+    can own heap memory (for long messages), and has to be decoded again
+    (isNoteOn(), getNoteNumber()...) every time it is looked at. A drum
+    groove only ever needs four things per hit, so we store exactly those:
+    
+    - position: fixed-point ticks (ticksPerBeat per quarter note)
+    - note number
+    - MIDI velocity
+    - flags: note on/off, and the MIDI channel
+    
+    STRUCT OF ARRAYS
+    ----------------
+    Each field lives in its own contiguous array, so a time scan only
+    walks the (4-byte) tick array and stays in cache, and the whole event
+    costs 7 bytes instead of ~40. MidiMessage objects are only built at the
+    output edge, e.g. when a composition is exported as a MIDI file.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+class GrooveEventList
+{
+public:
+    // Fixed-point resolution of event positions (a common MIDI PPQ, fine enough for any groove)
+    static constexpr int ticksPerBeat = 960;
+    
+    // Flag bits; the upper four bits hold the MIDI channel (0-15)
+    static constexpr juce::uint8 noteOnFlag = 0x01;
+    
+    GrooveEventList() = default;
+    
+    void clear()
+    {
+        ticks.clear();
+        notes.clear();
+        velocities.clear();
+        flags.clear();
+    }
+    
+    void reserve(size_t numEvents)
+    {
+        ticks.reserve(numEvents);
+        notes.reserve(numEvents);
+        velocities.reserve(numEvents);
+        flags.reserve(numEvents);
+    }
+    
+    /*
+        ADD MESSAGE
+        -----------
+        Compiles a note on/off at a position in beats. Any other message is
+        ignored, so callers can pass everything a MIDI track contains.
+    */
+    void addMessage(double timeInBeats, const juce::MidiMessage& message)
+    {
+        if (!message.isNoteOnOrOff())
+            return;
+        
+        auto eventFlags = static_cast<juce::uint8>(((message.getChannel() - 1) & 0x0f) << 4);
+        if (message.isNoteOn())
+            eventFlags |= noteOnFlag;
+        
+        ticks.push_back(beatsToTicks(timeInBeats));
+        notes.push_back(static_cast<juce::uint8>(message.getNoteNumber() & 0x7f));
+        velocities.push_back(static_cast<juce::uint8>(message.getVelocity() & 0x7f));
+        flags.push_back(eventFlags);
+    }
+    
+    /*
+        APPEND
+        ------
+        Adds the events of another (sorted) list that lie before endTick,
+        shifted by tickOffset. Used to flatten a composition into one
+        timeline: appending the items in order keeps the result sorted.
+    */
+    void append(const GrooveEventList& source, juce::uint32 tickOffset, juce::uint32 endTick)
+    {
+        for (size_t i = 0; i < source.size() && source.ticks[i] < endTick; ++i)
+        {
+            ticks.push_back(source.ticks[i] + tickOffset);
+            notes.push_back(source.notes[i]);
+            velocities.push_back(source.velocities[i]);
+            flags.push_back(source.flags[i]);
+        }
+    }
+    
+    bool isSortedByTime() const noexcept { return std::is_sorted(ticks.begin(), ticks.end()); }
+    
+    /*
+        SORT BY TIME
+        ------------
+        A stable sort keeps note on/off pairs at the same tick in file order.
+        We sort an index permutation and then reorder every array with it.
+    */
+    void sortByTime()
+    {
+        std::vector<size_t> order(size());
+        std::iota(order.begin(), order.end(), size_t { 0 });
+        std::stable_sort(order.begin(), order.end(),
+                         [this](size_t a, size_t b) { return ticks[a] < ticks[b]; });
+        
+        applyOrder(ticks, order);
+        applyOrder(notes, order);
+        applyOrder(velocities, order);
+        applyOrder(flags, order);
+    }
+    
+    size_t size() const noexcept { return ticks.size(); }
+    bool empty() const noexcept { return ticks.empty(); }
+    
+    // Per-event accessors (index < size())
+    juce::uint32 getTick(size_t index) const noexcept { return ticks[index]; }
+    double getBeat(size_t index) const noexcept { return ticksToBeats(ticks[index]); }
+    int getNote(size_t index) const noexcept { return notes[index]; }
+    int getVelocity(size_t index) const noexcept { return velocities[index]; }
+    float getFloatVelocity(size_t index) const noexcept { return static_cast<float>(velocities[index]) / 127.0f; }
+    bool isNoteOn(size_t index) const noexcept { return (flags[index] & noteOnFlag) != 0; }
+    int getChannel(size_t index) const noexcept { return (flags[index] >> 4) + 1; }
+    
+    // The contiguous tick array, for scanning/searching by time
+    const std::vector<juce::uint32>& getTicks() const noexcept { return ticks; }
+    
+    // Build the MidiMessage for one event (output edge only - e.g. MIDI export)
+    juce::MidiMessage toMidiMessage(size_t index) const
+    {
+        if (isNoteOn(index))
+            return juce::MidiMessage::noteOn(getChannel(index), getNote(index), static_cast<juce::uint8>(velocities[index]));
+        
+        return juce::MidiMessage::noteOff(getChannel(index), getNote(index), static_cast<juce::uint8>(velocities[index]));
+    }
+    
+    /*
+        SERIALIZATION
+        -------------
+        Used by the groove library index (GrooveLibraryIndex) to cache
+        compiled grooves on disk. Ticks are written little-endian, the byte
+        arrays as they are. readFrom() returns false (and leaves the list
+        empty) if the data is truncated or implausible.
+    */
+    void writeTo(juce::OutputStream& out) const
+    {
+        out.writeInt(static_cast<int>(size()));
+        
+        for (auto tick : ticks)
+            out.writeInt(static_cast<int>(tick));
+        
+        out.write(notes.data(), notes.size());
+        out.write(velocities.data(), velocities.size());
+        out.write(flags.data(), flags.size());
+    }
+    
+    bool readFrom(juce::InputStream& in)
+    {
+        clear();
+        
+        // No groove comes near this - anything bigger is a corrupt file
+        constexpr int maxEvents = 1 << 20;
+        const int numEvents = in.readInt();
+        if (numEvents < 0 || numEvents > maxEvents)
+            return false;
+        
+        const auto count = static_cast<size_t>(numEvents);
+        ticks.resize(count);
+        notes.resize(count);
+        velocities.resize(count);
+        flags.resize(count);
+        
+        for (auto& tick : ticks)
+            tick = static_cast<juce::uint32>(in.readInt());
+        
+        if (in.read(notes.data(), numEvents) != numEvents
+            || in.read(velocities.data(), numEvents) != numEvents
+            || in.read(flags.data(), numEvents) != numEvents)
+        {
+            clear();
+            return false;
+        }
+        
+        return true;
+    }
+    
+    static juce::uint32 beatsToTicks(double beats) noexcept
+    {
+        return static_cast<juce::uint32>(std::llround(juce::jmax(0.0, beats) * ticksPerBeat));
+    }
+    
+    static double ticksToBeats(juce::uint32 tick) noexcept
+    {
+        return static_cast<double>(tick) / static_cast<double>(ticksPerBeat);
+    }
+
+private:
+    template <typename ValueType>
+    static void applyOrder(std::vector<ValueType>& values, const std::vector<size_t>& order)
+    {
+        std::vector<ValueType> sorted;
+        sorted.reserve(values.size());
+        
+        for (size_t index : order)
+            sorted.push_back(values[index]);
+        
+        values.swap(sorted);
+    }
+    
+    std::vector<juce::uint32> ticks;
+    std::vector<juce::uint8> notes;
+    std::vector<juce::uint8> velocities;
+    std::vector<juce::uint8> flags;
+};
@@ -0,0 +1,202 @@
+/*
+    GrooveLibraryIndex.cpp
+    ======================
+    
+    Reading and writing the groove library index (see GrooveLibraryIndex.h).
+*/
+
+#include "GrooveLibraryIndex.h"
+#include "GrooveManager.h"
+#include <map>
+
+GrooveLibraryIndex::GrooveLibraryIndex()
+    : indexFile(getDefaultIndexFile())
+{
+}
+
+juce::File GrooveLibraryIndex::getDefaultIndexFile()
+{
+    // Same user data folder the soundfonts and grooves are installed to
+#if JUCE_MAC || JUCE_WINDOWS
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("jdrummer/groove_index.bin");
+#else
+    return juce::File::getSpecialLocation(juce::File::userHomeDirectory)
+        .getChildFile(".local/share/jdrummer/groove_index.bin");
+#endif
+}
+
+bool GrooveLibraryIndex::getFileStamp(const juce::File& file, juce::int64& modificationTime, juce::int64& fileSize)
+{
+    if (!file.existsAsFile())
+        return false;
+    
+    modificationTime = file.getLastModificationTime().toMilliseconds();
+    fileSize = file.getSize();
+    return true;
+}
+
+int GrooveLibraryIndex::restore(std::vector<GrooveCategory>& categories)
+{
+    // Look grooves up by path while reading the index
+    std::map<juce::String, Groove*> groovesByPath;
+    for (auto& category : categories)
+    {
+        for (auto& groove : category.grooves)
+            groovesByPath[groove.file.getFullPathName()] = &groove;
+    }
+    
+    dirty = true;  // Until proven otherwise, the index doesn't match the library
+    
+    if (!indexFile.existsAsFile())
+        return 0;
+    
+    juce::FileInputStream stream(indexFile);
+    if (!stream.openedOk())
+        return 0;
+    
+    juce::BufferedInputStream in(stream, 1 << 16);
+    
+    if (in.readInt() != magicNumber || in.readInt() != formatVersion)
+    {
+        DBG("GrooveLibraryIndex: Ignoring index with unknown format: " + indexFile.getFullPathName());
+        return 0;
+    }
+    
+    const int numEntries = in.readInt();
+    int numRestored = 0;
+    
+    Groove entry;
+    
+    for (int i = 0; i < numEntries; ++i)
+    {
+        juce::String path;
+        juce::int64 modificationTime = 0, fileSize = 0;
+        
+        if (!readEntry(in, path, modificationTime, fileSize, entry))
+        {
+            DBG("GrooveLibraryIndex: Index is corrupt, ignoring the rest of it");
+            return numRestored;
+        }
+        
+        auto found = groovesByPath.find(path);
+        if (found == groovesByPath.end())
+            continue;  // File was removed from the library
+        
+        Groove& groove = *found->second;
+        juce::int64 currentTime = 0, currentSize = 0;
+        
+        if (groove.isLoaded
+            || !getFileStamp(groove.file, currentTime, currentSize)
+            || currentTime != modificationTime || currentSize != fileSize)
+        {
+            continue;  // Changed since it was indexed - it will be parsed again
+        }
+        
+        groove.lengthInBeats = entry.lengthInBeats;
+        groove.numerator = entry.numerator;
+        groove.denominator = entry.denominator;
+        groove.events = std::move(entry.events);
+        groove.onsetHistogram = entry.onsetHistogram;
+        groove.numNoteOns = entry.numNoteOns;
+        groove.parsedModificationTime = modificationTime;
+        groove.parsedFileSize = fileSize;
+        groove.isLoaded = true;
+        
+        ++numRestored;
+    }
+    
+    // The index is exactly the library: nothing to write back
+    if (numRestored == numEntries && numRestored == static_cast<int>(groovesByPath.size()))
+        dirty = false;
+    
+    DBG("GrooveLibraryIndex: Restored " + juce::String(numRestored) + " of "
+        + juce::String(groovesByPath.size()) + " grooves from the index");
+    
+    return numRestored;
+}
+
+bool GrooveLibraryIndex::readEntry(juce::InputStream& in, juce::String& path, juce::int64& modificationTime,
+                                   juce::int64& fileSize, Groove& groove)
+{
+    if (in.isExhausted())
+        return false;
+    
+    path = in.readString();
+    modificationTime = in.readInt64();
+    fileSize = in.readInt64();
+    
+    groove.lengthInBeats = in.readDouble();
+    groove.numerator = in.readInt();
+    groove.denominator = in.readInt();
+    groove.numNoteOns = in.readInt();
+    
+    for (auto& count : groove.onsetHistogram)
+        count = static_cast<juce::uint16>(in.readShort());
+    
+    return groove.events.readFrom(in);
+}
+
+bool GrooveLibraryIndex::write(const juce::File& indexFile, const std::vector<GrooveCategory>& categories)
+{
+    int numEntries = 0;
+    for (const auto& category : categories)
+    {
+        for (const auto& groove : category.grooves)
+        {
+            if (groove.isLoaded)
+                ++numEntries;
+        }
+    }
+    
+    if (!indexFile.getParentDirectory().createDirectory())
+        return false;
+    
+    // Write to a temporary file and swap it in, so a crash never leaves half an index
+    juce::TemporaryFile temp(indexFile);
+    
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+        
+        out.writeInt(magicNumber);
+        out.writeInt(formatVersion);
+        out.writeInt(numEntries);
+        
+        for (const auto& category : categories)
+        {
+            for (const auto& groove : category.grooves)
+            {
+                if (!groove.isLoaded)
+                    continue;
+                
+                // The stamp the events were parsed under, not the file's stamp now: a
+                // file changed since then must not be cached as if it had been parsed
+                out.writeString(groove.file.getFullPathName());
+                out.writeInt64(groove.parsedModificationTime);
+                out.writeInt64(groove.parsedFileSize);
+                
+                out.writeDouble(groove.lengthInBeats);
+                out.writeInt(groove.numerator);
+                out.writeInt(groove.denominator);
+                out.writeInt(groove.numNoteOns);
+                
+                for (auto count : groove.onsetHistogram)
+                    out.writeShort(static_cast<short>(count));
+                
+                groove.events.writeTo(out);
+            }
+        }
+        
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+    
+    if (!temp.overwriteTargetFileWithTemporary())
+        return false;
+    
+    DBG("GrooveLibraryIndex: Saved " + juce::String(numEntries) + " grooves to " + indexFile.getFullPathName());
+    return true;
+}
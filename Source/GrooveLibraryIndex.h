@@ -0,0 +1,87 @@
+/*
+    GrooveLibraryIndex.h
+    ====================
+    
+    A persistent, on-disk index of the compiled groove library.
+    
+    WHY?
+    ----
+    Parsing a MIDI file with juce::MidiFile::readFrom() is cheap once, but
+    a library of several thousand grooves parsed on every startup (or on
+    the first Bandmate search, which needs every groove) adds up to a
+    noticeable wait. The index stores what parsing produces - the compact
+    events, length, time signature and onset histogram - so a cold start
+    only re-parses files that were added or changed.
+    
+    CACHE KEY
+    ---------
+    Each entry is keyed by the file's full path and is only used if the
+    file's modification time AND size still match, so editing or
+    replacing a groove invalidates its entry automatically.
+    
+    FILE FORMAT
+    -----------
+    A small binary file (magic, format version, entry count, entries).
+    A different version or any sign of corruption just discards the index;
+    it gets rebuilt as grooves are parsed again.
+    
+    The index holds no groove data itself: restore() moves entries straight
+    into the library, and write() writes the library out again. The
+    only second copy of the compiled grooves is the one GrooveManager
+    takes to save without holding its lock, for as long as the save.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <vector>
+
+struct Groove;
+struct GrooveCategory;
+
+class GrooveLibraryIndex
+{
+public:
+    GrooveLibraryIndex();
+    
+    // Where the index is read from and written to
+    void setIndexFile(const juce::File& file) { indexFile = file; }
+    juce::File getIndexFile() const { return indexFile; }
+    
+    // The default location: jdrummer's folder in the user data directory
+    static juce::File getDefaultIndexFile();
+    
+    /*
+        RESTORE
+        -------
+        Reads the index and fills in (and marks loaded) every groove whose
+        file is unchanged. Returns the number of grooves restored.
+    */
+    int restore(std::vector<GrooveCategory>& categories);
+    
+    // A groove was parsed from its MIDI file - the index is out of date
+    void markDirty() { dirty = true; }
+    bool isDirty() const { return dirty; }
+    
+    // The library is being written (see write()) - mark it dirty again if that fails
+    void markSaved() { dirty = false; }
+    
+    // Write every loaded groove to indexFile, each under the stamp its file had when
+    // it was parsed (see Groove::parsedModificationTime) - touches no index's state
+    static bool write(const juce::File& indexFile, const std::vector<GrooveCategory>& categories);
+    
+    // The part of a file's identity the cache is keyed on
+    static bool getFileStamp(const juce::File& file, juce::int64& modificationTime, juce::int64& fileSize);
+
+private:
+    bool readEntry(juce::InputStream& in, juce::String& path, juce::int64& modificationTime,
+                   juce::int64& fileSize, Groove& groove);
+    
+    static constexpr int magicNumber = 0x4a444749;  // "JDGI"
+    static constexpr int formatVersion = 1;
+    
+    juce::File indexFile;
+    bool dirty = false;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrooveLibraryIndex)
+};
@@ -6,39 +6,93 @@
 */
 
 #include "GrooveManager.h"
+#include "GrooveSearch.h"
 
 GrooveManager::GrooveManager()
 {
-    // Create a persistent directory for exported MIDI files
+    // Clean up old export files on startup (files older than 1 hour)
+    // This prevents the exports folder from growing indefinitely
+    // while ensuring DAWs have plenty of time to read dropped files
+    exportCache.removeOldFiles(juce::RelativeTime::hours(1));
+}
+
+juce::File GrooveManager::getDefaultExportDirectory()
+{
+    // A persistent directory for exported MIDI files
     // On Linux, use /tmp for better compatibility with Flatpak sandboxed DAWs
     #if JUCE_LINUX
-    tempDir = juce::File("/tmp/jdrummer_exports");
+    return juce::File("/tmp/jdrummer_exports");
     #else
-    tempDir = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
-                  .getChildFile("JDrummer_Exports");
+    return juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+               .getChildFile("JDrummer_Exports");
     #endif
-    tempDir.createDirectory();
-    
-    // Clean up old export files on startup (files older than 1 hour)
-    cleanupOldExports();
 }
 
 GrooveManager::~GrooveManager()
 {
     // Don't delete the export directory on shutdown - DAWs like Bitwig
     // may still be reading the files asynchronously after the drag operation
+    
+    // Keep what was parsed this session for the next startup
+    saveLibraryIndex();
+    
+    // Audio has stopped by now, so the patterns can be freed directly
+    delete groovePattern.exchange(nullptr);
+    delete composerPattern.exchange(nullptr);
+    delete scheduledTransform.exchange(nullptr);
 }
 
 void GrooveManager::setGroovesPath(const juce::File& path)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     groovesPath = path;
 }
 
+void GrooveManager::setLibraryIndexFile(const juce::File& file)
+{
+    const CheckedCriticalSection::ScopedLockType sl(lock);
+    libraryIndex.setIndexFile(file);
+}
+
+/*
+    SAVE LIBRARY INDEX
+    ------------------
+    Writing the whole library out takes a while, so it's written from a
+    copy taken under the lock and the lock is released for the write
+    itself. Saves are serialized, so an older copy can never replace a
+    newer one on disk.
+*/
+void GrooveManager::saveLibraryIndex()
+{
+    const CheckedCriticalSection::ScopedLockType saving(indexSaveLock);
+    
+    std::vector<GrooveCategory> library;
+    juce::File indexFile;
+    
+    {
+        const CheckedCriticalSection::ScopedLockType sl(lock);
+        if (!libraryIndex.isDirty())
+            return;
+        
+        library = categories;
+        indexFile = libraryIndex.getIndexFile();
+        libraryIndex.markSaved();
+    }
+    
+    if (!GrooveLibraryIndex::write(indexFile, library))
+    {
+        const CheckedCriticalSection::ScopedLockType sl(lock);
+        libraryIndex.markDirty();  // Try again next time
+    }
+}
+
 void GrooveManager::scanGrooves()
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     categories.clear();
+    grooveFeatures.reset();
+    searchIndex.reset();
+    ++libraryGeneration;  // Grooves still being parsed by loadAllGrooves() are of the old library
     
     if (!groovesPath.exists() || !groovesPath.isDirectory())
     {
@@ -80,12 +134,15 @@ void GrooveManager::scanGrooves()
         }
     }
     
+    // Grooves that haven't changed since the last run don't need parsing
+    libraryIndex.restore(categories);
+    
     DBG("GrooveManager: Scan complete. Found " + juce::String(categories.size()) + " categories");
 }
 
 bool GrooveManager::loadGroove(int categoryIndex, int grooveIndex)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     if (categoryIndex < 0 || categoryIndex >= static_cast<int>(categories.size()))
         return false;
@@ -103,6 +160,18 @@ bool GrooveManager::loadGroove(int categoryIndex, int grooveIndex)
 }
 
 bool GrooveManager::parseMidiFile(Groove& groove)
+{
+    if (!compileMidiFile(groove))
+        return false;
+    
+    // Newly parsed - the index needs to be written again, and searches can
+    // now see its length and time signature
+    libraryIndex.markDirty();
+    searchIndex.reset();
+    return true;
+}
+
+bool GrooveManager::compileMidiFile(Groove& groove)
 {
     if (!groove.file.existsAsFile())
     {
@@ -110,6 +179,11 @@ bool GrooveManager::parseMidiFile(Groove& groove)
         return false;
     }
     
+    // Stamped before reading: if the file changes while (or after) it is parsed,
+    // the index entry won't match it any more and it will be parsed again
+    if (!GrooveLibraryIndex::getFileStamp(groove.file, groove.parsedModificationTime, groove.parsedFileSize))
+        return false;
+    
     juce::FileInputStream fileStream(groove.file);
     if (!fileStream.openedOk())
     {
@@ -161,30 +235,25 @@ bool GrooveManager::parseMidiFile(Groove& groove)
                 groove.numerator = num;
                 groove.denominator = denom;
             }
-            // Store note on/off events
+            // Store note on/off events (compiled - the MidiMessage isn't kept)
             else if (message.isNoteOnOrOff())
             {
                 // Convert time from seconds to beats
                 // timeInSeconds * (BPM / 60) = timeInBeats
                 double timeInBeats = message.getTimeStamp() * (tempoBpm / 60.0);
                 
-                Groove::MidiEvent evt;
-                evt.timeInBeats = timeInBeats;
-                evt.message = message;
-                groove.events.push_back(evt);
+                groove.events.addMessage(timeInBeats, message);
             }
         }
     }
     
     // Sort events by time
-    std::sort(groove.events.begin(), groove.events.end(),
-              [](const Groove::MidiEvent& a, const Groove::MidiEvent& b) {
-                  return a.timeInBeats < b.timeInBeats;
-              });
+    groove.events.sortByTime();
     
     // Calculate groove length
     groove.lengthInBeats = calculateGrooveLength(groove);
     
+    groove.updateOnsetHistogram();
     groove.isLoaded = true;
     
     DBG("GrooveManager: Loaded groove '" + groove.name + "' with " 
@@ -199,12 +268,8 @@ double GrooveManager::calculateGrooveLength(const Groove& groove)
     if (groove.events.empty())
         return 4.0;  // Default to 1 bar in 4/4
     
-    // Find the last event time
-    double maxTime = 0.0;
-    for (const auto& evt : groove.events)
-    {
-        maxTime = std::max(maxTime, evt.timeInBeats);
-    }
+    // Events are sorted, so the last one is the latest
+    double maxTime = groove.events.getBeat(groove.events.size() - 1);
     
     // Round up to the nearest bar
     double beatsPerBar = static_cast<double>(groove.numerator);
@@ -217,9 +282,253 @@ double GrooveManager::calculateGrooveLength(const Groove& groove)
     return bars * beatsPerBar;
 }
 
+/*
+    ONSET HISTOGRAM
+    ---------------
+    Folds every note-on into one 4/4 bar and counts hits per 16th note.
+    Ticks are exact integers, so this is plain integer arithmetic.
+*/
+void Groove::updateOnsetHistogram()
+{
+    constexpr juce::uint32 barTicks = 4 * GrooveEventList::ticksPerBeat;
+    constexpr juce::uint32 slotTicks = barTicks / numHistogramSlots;
+    
+    onsetHistogram.fill(0);
+    numNoteOns = 0;
+    
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (!events.isNoteOn(i))
+            continue;
+        
+        const auto slot = static_cast<size_t>((events.getTick(i) % barTicks) / slotTicks);
+        onsetHistogram[slot] = static_cast<juce::uint16>(juce::jmin(onsetHistogram[slot] + 1, 0xffff));
+        ++numNoteOns;
+    }
+}
+
+/*
+    FEATURES FROM A HISTOGRAM
+    -------------------------
+    Scaling to unit length keeps the cosine similarity unchanged (it
+    doesn't care about overall density) but lets scoring skip the norms.
+*/
+GrooveFeatures GrooveFeatures::fromHistogram(const std::array<int, numSlots>& counts)
+{
+    GrooveFeatures features;
+    double sumOfSquares = 0.0;
+    
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        const int count = counts[static_cast<size_t>(slot)];
+        if (count > 0)
+            features.hitSlots |= 1u << slot;
+        
+        sumOfSquares += static_cast<double>(count) * count;
+    }
+    
+    if (sumOfSquares > 0.0)
+    {
+        const double scale = 1.0 / std::sqrt(sumOfSquares);
+        for (size_t slot = 0; slot < features.unitHistogram.size(); ++slot)
+            features.unitHistogram[slot] = static_cast<float>(counts[slot] * scale);
+    }
+    
+    constexpr juce::uint32 allSlots = (1u << numSlots) - 1;
+    features.nearbySlots = (features.hitSlots | (features.hitSlots << 1) | (features.hitSlots >> 1)) & allSlots;
+    
+    return features;
+}
+
+/*
+    LOAD ALL GROOVES
+    ----------------
+    Parses every groove the index couldn't restore, one thread pool job
+    per file, without holding the lock: the grooves to parse are copied
+    out under it, each job compiles its own copy and touches nothing
+    else, and the parsed copies are moved into the library under the
+    lock again once they have all finished. A copy is dropped if its
+    groove was loaded meanwhile (loadGroove()), and all of them if the
+    library was rescanned. One batch runs at a time - a second caller
+    waits, then finds the first one's grooves loaded.
+*/
+int GrooveManager::loadAllGrooves(juce::ThreadPool& pool, const GrooveParsedCallback& onGrooveParsed)
+{
+    const CheckedCriticalSection::ScopedLockType parsing(parseLock);
+    
+    struct PendingGroove
+    {
+        size_t categoryIndex;
+        size_t grooveIndex;
+        Groove groove;
+    };
+    
+    std::vector<PendingGroove> pending;
+    int generation = 0;
+    
+    {
+        const CheckedCriticalSection::ScopedLockType sl(lock);
+        generation = libraryGeneration;
+        
+        for (size_t categoryIndex = 0; categoryIndex < categories.size(); ++categoryIndex)
+        {
+            const auto& grooves = categories[categoryIndex].grooves;
+            
+            for (size_t grooveIndex = 0; grooveIndex < grooves.size(); ++grooveIndex)
+            {
+                if (!grooves[grooveIndex].isLoaded)
+                    pending.push_back({ categoryIndex, grooveIndex, grooves[grooveIndex] });
+            }
+        }
+    }
+    
+    if (pending.empty())
+        return 0;
+    
+    std::atomic<size_t> jobsRemaining { pending.size() };
+    juce::WaitableEvent allJobsDone;
+    
+    for (auto& entry : pending)
+    {
+        Groove* groove = &entry.groove;
+        
+        pool.addJob([&, groove]
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            const bool parsed = compileMidiFile(*groove);
+            const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            
+            if (onGrooveParsed)
+                onGrooveParsed(*groove, parsed, seconds);
+            
+            if (--jobsRemaining == 0)
+                allJobsDone.signal();
+        });
+    }
+    
+    allJobsDone.wait();
+    
+    const CheckedCriticalSection::ScopedLockType sl(lock);
+    
+    if (libraryGeneration != generation)
+        return 0;  // Rescanned meanwhile - these grooves may not be in the library any more
+    
+    int numParsed = 0;
+    for (auto& entry : pending)
+    {
+        auto& groove = categories[entry.categoryIndex].grooves[entry.grooveIndex];
+        
+        if (!entry.groove.isLoaded || groove.isLoaded)
+            continue;
+        
+        groove = std::move(entry.groove);
+        ++numParsed;
+    }
+    
+    if (numParsed > 0)
+    {
+        libraryIndex.markDirty();
+        grooveFeatures.reset();  // Rebuilt with the new grooves on next use
+        searchIndex.reset();
+    }
+    
+    return numParsed;
+}
+
+/*
+    MATCH FEATURES
+    --------------
+    On a cold library the grooves are parsed first, in parallel and
+    without the lock (loadAllGrooves()), so the message thread can go on
+    browsing meanwhile. The lock is then only held to read the parsed
+    histograms into the table, and the index is saved after that, again
+    outside it.
+*/
+std::shared_ptr<const GrooveFeatureTable> GrooveManager::getGrooveFeatures()
+{
+    int generation = 0;
+    bool needsParsing = false;
+    
+    {
+        const CheckedCriticalSection::ScopedLockType sl(lock);
+    
+        if (grooveFeatures != nullptr)
+            return grooveFeatures;
+    
+        generation = libraryGeneration;
+        
+        for (const auto& category : categories)
+        {
+            for (const auto& groove : category.grooves)
+                needsParsing = needsParsing || !groove.isLoaded;
+        }
+    }
+    
+    if (needsParsing)
+    {
+        juce::ThreadPool pool(juce::jmax(1, juce::SystemStats::getNumCpus()));
+        loadAllGrooves(pool);
+    }
+    
+    std::shared_ptr<const GrooveFeatureTable> features;
+    
+    {
+        const CheckedCriticalSection::ScopedLockType sl(lock);
+        
+        if (grooveFeatures == nullptr)
+        {
+            auto table = std::make_shared<GrooveFeatureTable>();
+            
+            // Grooves that didn't parse are left out
+            for (size_t categoryIndex = 0; categoryIndex < categories.size(); ++categoryIndex)
+            {
+                const auto& category = categories[categoryIndex];
+                
+                for (size_t grooveIndex = 0; grooveIndex < category.grooves.size(); ++grooveIndex)
+                {
+                    const auto& groove = category.grooves[grooveIndex];
+                    if (!groove.isLoaded)
+                        continue;
+                    
+                    std::array<int, GrooveFeatures::numSlots> counts {};
+                    std::copy(groove.onsetHistogram.begin(), groove.onsetHistogram.end(), counts.begin());
+                    
+                    auto entry = GrooveFeatures::fromHistogram(counts);
+                    entry.categoryIndex = static_cast<int>(categoryIndex);
+                    entry.grooveIndex = static_cast<int>(grooveIndex);
+                    table->push_back(entry);
+                }
+            }
+            
+            // A library rescanned while it was parsed isn't all parsed - don't keep the table
+            if (libraryGeneration != generation)
+                return table;
+            
+            grooveFeatures = std::move(table);
+        }
+        
+        features = grooveFeatures;
+    }
+    
+    // Every groove is parsed now - persist them so the next start is warm
+    saveLibraryIndex();
+    
+    return features;
+}
+
+std::shared_ptr<const GrooveSearchIndex> GrooveManager::getSearchIndex()
+{
+    const CheckedCriticalSection::ScopedLockType sl(lock);
+    
+    if (searchIndex == nullptr)
+        searchIndex = GrooveSearchIndex::build(categories);
+    
+    return searchIndex;
+}
+
 Groove* GrooveManager::getGroove(int categoryIndex, int grooveIndex)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     if (categoryIndex < 0 || categoryIndex >= static_cast<int>(categories.size()))
         return nullptr;
@@ -245,18 +554,26 @@ const Groove* GrooveManager::getGroove(int categoryIndex, int grooveIndex) const
 
 void GrooveManager::startPlayback(int categoryIndex, int grooveIndex)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     // Make sure groove is loaded
     if (!loadGroove(categoryIndex, grooveIndex))
         return;
     
+    const Groove* groove = getGroove(categoryIndex, grooveIndex);
+    if (groove == nullptr)
+        return;
+    
+    // Hand the audio thread its own copy of the groove's events
+    auto pattern = std::make_unique<PlaybackPattern>();
+    pattern->lengthInBeats = groove->lengthInBeats;
+    pattern->events.append(groove->events, 0, GrooveEventList::beatsToTicks(groove->lengthInBeats));
+    publishPattern(groovePattern, pattern.release());
+    
     currentCategoryIndex = categoryIndex;
     currentGrooveIndex = grooveIndex;
+    positionResetRequested = true;  // Position restarts on the next processBlock
     playing = true;
-    playbackStartPpq = -1.0;  // Will be set on first processBlock
-    lastProcessedPpq = -1.0;
-    internalPositionBeats = 0.0;  // Reset internal clock
     
     DBG("GrooveManager: Started playback of groove " + juce::String(grooveIndex) 
         + " in category " + juce::String(categoryIndex));
@@ -264,7 +581,7 @@ void GrooveManager::startPlayback(int categoryIndex, int grooveIndex)
 
 void GrooveManager::stopPlayback()
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     playing = false;
     currentCategoryIndex = -1;
     currentGrooveIndex = -1;
@@ -272,239 +589,361 @@ void GrooveManager::stopPlayback()
     DBG("GrooveManager: Stopped playback");
 }
 
+/*
+    PROCESS BLOCK - SAMPLE-ACCURATE SCHEDULING
+    ------------------------------------------
+    Each block covers the half-open beat window [blockStart, blockStart + beatsThisBlock).
+    Every event inside that window is added to eventsOut at its exact sample
+    offset within the block, so timing no longer depends on the host's
+    buffer size. If the loop end falls inside the block, the window is
+    split in two and the events after the wrap land later in the block.
+*/
 void GrooveManager::processBlock(double bpm, double ppqPosition, bool hostIsPlaying,
-                                  int numSamples, std::vector<juce::MidiMessage>& midiOut)
+                                  int numSamples, NoteEventBuffer& eventsOut)
 {
-    juce::ScopedLock sl(lock);
+    // No lock here: everything we read is either atomic or an immutable
+    // pattern that can't be deleted until this block has finished
+    const AudioBlockFence::ScopedBlock blockScope(audioFence);
+    
+    const bool composerActive = composerPlaying.load();
+    if ((!playing.load() && !composerActive) || numSamples <= 0)
+        return;
+    
+    // Composer playback takes priority over single groove playback
+    const PlaybackPattern* pattern = composerActive ? composerPattern.load() : groovePattern.load();
+    if (pattern == nullptr || pattern->lengthInBeats <= 0.0)
+        return;
+    
+    const double patternLength = pattern->lengthInBeats;
+    const bool loop = looping.load();
+    
+    // startPlayback() & co. ask for a restart; the position itself is ours
+    if (positionResetRequested.exchange(false))
+    {
+        patternStartPpq = -1.0;
+        internalPositionBeats = 0.0;
+    }
     
     // Determine if we should use internal timing or DAW timing
     // Use internal timing if:
     // 1. Host is not playing, OR
     // 2. We're in standalone preview mode (useInternalClock is set)
-    bool useInternal = !hostIsPlaying || useInternalClock;
+    const bool previewClock = useInternalClock.load();
+    bool useInternal = !hostIsPlaying || previewClock;
     
     // Use internal BPM when in preview mode, otherwise use DAW BPM
     double effectiveBpm;
-    if (useInternalClock)
+    if (previewClock)
     {
         // Preview mode - always use the internal BPM (set by Groove Matcher)
-        effectiveBpm = internalBpm;
+        effectiveBpm = internalBpm.load();
     }
     else
     {
         // Normal mode - use DAW BPM if available
-        effectiveBpm = (bpm > 0) ? bpm : internalBpm;
+        effectiveBpm = (bpm > 0) ? bpm : internalBpm.load();
     }
     
     // Calculate how many beats this block represents
     double beatsPerSecond = effectiveBpm / 60.0;
-    double secondsPerBlock = static_cast<double>(numSamples) / currentSampleRate;
-    double beatsThisBlock = beatsPerSecond * secondsPerBlock;
-    
-    double currentPosition;
-    double previousPosition;
+    double samplesPerBeat = currentSampleRate.load() / beatsPerSecond;
+    double beatsThisBlock = static_cast<double>(numSamples) / samplesPerBeat;
     
-    if (useInternal && (playing || composerPlaying))
+    // Position of the start of this block, relative to the pattern start
+    double blockStart;
+    if (useInternal)
     {
-        // Use internal clock - advance by calculated beats
-        previousPosition = internalPositionBeats;
+        // Initialize playback position on first block
+        if (patternStartPpq < 0.0)
+        {
+            patternStartPpq = 0.0;
+            internalPositionBeats = 0.0;
+        }
+        
+        blockStart = internalPositionBeats;
         internalPositionBeats += beatsThisBlock;
-        currentPosition = internalPositionBeats;
     }
     else
     {
-        // Use DAW position
-        currentPosition = ppqPosition;
-        previousPosition = lastProcessedPpq;
+        // Initialize playback position on first block
+        if (patternStartPpq < 0.0)
+            patternStartPpq = ppqPosition;
+        
+        blockStart = ppqPosition - patternStartPpq;
     }
     
-    // Handle single groove playback
-    if (playing && !composerPlaying)
+    if (loop)
     {
-        const Groove* groove = getGroove(currentCategoryIndex, currentGrooveIndex);
-        if (groove == nullptr || !groove->isLoaded)
+        // Wrap into [0, patternLength) - also handles the DAW jumping backwards
+        double wraps = std::floor(blockStart / patternLength);
+        if (wraps != 0.0)
         {
-            playing = false;
-            return;
+            blockStart -= wraps * patternLength;
+            if (!useInternal)
+                patternStartPpq += wraps * patternLength;
+            else
+                internalPositionBeats -= wraps * patternLength;
         }
-        
-        // Initialize playback position on first block
-        if (playbackStartPpq < 0.0)
+    }
+    else if (blockStart >= patternLength)
+    {
+        // Stop at end if not looping
+        if (composerActive)
+            composerPlaying = false;
+        else
+            playing = false;
+        return;
+    }
+    
+    double blockEnd = blockStart + beatsThisBlock;
+    
+    // Swing, humanize & co. are applied to the events as they are emitted
+    const ScheduledTransform* transformToApply = scheduledTransform.load();
+    
+    addPatternEventsInRange(*pattern, transformToApply, blockStart, juce::jmin(blockEnd, patternLength), 0.0,
+                            samplesPerBeat, numSamples, eventsOut);
+    
+    // Loop wrapped inside this block: continue from the top of the pattern -
+    // as often as it takes, as a short pattern (or a big block) can wrap
+    // more than once before the block is over
+    if (loop)
+    {
+        for (double passStart = patternLength - blockStart; passStart < beatsThisBlock; passStart += patternLength)
         {
-            playbackStartPpq = currentPosition;
-            previousPosition = currentPosition;
-            internalPositionBeats = 0.0;
+            addPatternEventsInRange(*pattern, transformToApply, 0.0, juce::jmin(patternLength, beatsThisBlock - passStart),
+                                    passStart, samplesPerBeat, numSamples, eventsOut);
         }
-        
-        // Calculate position within the groove (with looping)
-        double groovePosition = currentPosition - playbackStartPpq;
-        
-        // For internal clock, use direct position
-        if (useInternal)
+    }
+}
+
+/*
+    ADD PATTERN EVENTS IN RANGE
+    ---------------------------
+    Adds every event in [rangeStart, rangeEnd) beats of the pattern to eventsOut.
+    beatsIntoBlock is how far into the current block rangeStart lies.
+    
+    CURSOR-BASED LOOKUP
+    -------------------
+    The pattern is one sorted timeline, so we simply continue from the
+    cursor the previous block left behind. Only if the range doesn't start
+    where the cursor stands (loop, transport jump, new pattern) do we
+    re-seek - a binary search, not a scan.
+    
+    WITH A TRANSFORM
+    ----------------
+    Humanize and swing move events off their ticks, by at most the
+    transform's max shift either way. So the scan reaches that far past
+    the range, and the cursor stays that far behind its end: each event
+    is looked at by the blocks around it, and played by the one block
+    its moved position falls into. As the transform is a pure function
+    of the event, that is always exactly one block. A new transform is
+    picked up with a re-seek; a hit right at that moment may be missed
+    or repeated once.
+*/
+void GrooveManager::addPatternEventsInRange(const PlaybackPattern& pattern, const ScheduledTransform* transform,
+                                            double rangeStart, double rangeEnd, double beatsIntoBlock,
+                                            double samplesPerBeat, int numSamples,
+                                            NoteEventBuffer& eventsOut)
+{
+    // Continuous playback lands within rounding error of the cursor; allow one tick
+    const double maxCursorDrift = 1.0 / GrooveEventList::ticksPerBeat;
+    
+    const juce::uint32 transformSerial = transform != nullptr ? transform->serial : 0;
+    const double maxShift = transform != nullptr ? transform->settings.getMaxShiftBeats() : 0.0;
+    
+    if (cursor.patternSerial != pattern.serial
+        || cursor.transformSerial != transformSerial
+        || std::abs(rangeStart - cursor.positionBeats) > maxCursorDrift)
+    {
+        seekCursor(pattern, rangeStart, maxShift);
+        cursor.transformSerial = transformSerial;
+    }
+    
+    const auto& events = pattern.events;
+    const auto& ticks = events.getTicks();
+    
+    if (transform == nullptr)
+    {
+        // Events before this tick belong to the range
+        const double endTick = rangeEnd * GrooveEventList::ticksPerBeat;
+    
+        for (; cursor.eventIndex < ticks.size(); ++cursor.eventIndex)
         {
-            groovePosition = internalPositionBeats;
-        }
+            const size_t i = cursor.eventIndex;
+            if (static_cast<double>(ticks[i]) >= endTick)
+                break;
         
-        if (looping)
-        {
-            // Wrap around for looping
-            while (groovePosition >= groove->lengthInBeats)
-            {
-                groovePosition -= groove->lengthInBeats;
-                if (!useInternal)
-                    playbackStartPpq += groove->lengthInBeats;
-                else
-                    internalPositionBeats -= groove->lengthInBeats;
-            }
-        }
-        else if (groovePosition >= groove->lengthInBeats)
-        {
-            // Stop at end if not looping
-            playing = false;
-            return;
-        }
+            double beatsFromBlockStart = events.getBeat(i) - rangeStart + beatsIntoBlock;
+            int sampleOffset = static_cast<int>(beatsFromBlockStart * samplesPerBeat);
         
-        // Find events that should trigger in this block
-        double lastPosition;
-        if (useInternal)
-        {
-            lastPosition = groovePosition - beatsThisBlock;
-            if (lastPosition < 0 && looping)
-                lastPosition += groove->lengthInBeats;
-            if (lastPosition < 0)
-                lastPosition = 0;
-        }
-        else
-        {
-            lastPosition = previousPosition - playbackStartPpq;
-            if (looping)
-            {
-                while (lastPosition >= groove->lengthInBeats)
-                    lastPosition -= groove->lengthInBeats;
-                if (lastPosition < 0)
-                    lastPosition = 0;
-            }
-        }
+            sampleOffset = juce::jlimit(0, numSamples - 1, sampleOffset);
         
-        for (const auto& evt : groove->events)
-        {
-            // Check if this event falls within the current block
-            bool shouldTrigger = false;
-            
-            if (groovePosition >= lastPosition)
-            {
-                // Normal case: no loop wrap in this block
-                shouldTrigger = (evt.timeInBeats > lastPosition && evt.timeInBeats <= groovePosition);
-            }
+            if (events.isNoteOn(i))
+                eventsOut.addNoteOn(sampleOffset, events.getNote(i), events.getFloatVelocity(i));
             else
-            {
-                // Loop wrapped: check both ends
-                shouldTrigger = (evt.timeInBeats > lastPosition || evt.timeInBeats <= groovePosition);
-            }
-            
-            if (shouldTrigger)
-            {
-                midiOut.push_back(evt.message);
-            }
+                eventsOut.addNoteOff(sampleOffset, events.getNote(i));
         }
         
-        lastProcessedPpq = currentPosition;
+        cursor.positionBeats = rangeEnd;
+        return;
     }
     
-    // Handle composer playback
-    if (composerPlaying)
+    // Events that could still move into this range, and where the next block's scan starts
+    const double scanEndTick = (rangeEnd + maxShift) * GrooveEventList::ticksPerBeat;
+    const double nextStartTick = (rangeEnd - maxShift) * GrooveEventList::ticksPerBeat;
+    
+    size_t i = cursor.eventIndex;
+    size_t nextEventIndex = ticks.size();
+    
+    for (; i < ticks.size() && static_cast<double>(ticks[i]) < scanEndTick; ++i)
     {
-        if (composerStartPpq < 0.0)
-        {
-            composerStartPpq = currentPosition;
-            previousPosition = currentPosition;
-            internalPositionBeats = 0.0;
-        }
+        if (nextEventIndex == ticks.size() && static_cast<double>(ticks[i]) >= nextStartTick)
+            nextEventIndex = i;
         
-        double composerPosition;
-        if (useInternal)
-        {
-            composerPosition = internalPositionBeats;
-        }
-        else
-        {
-            composerPosition = currentPosition - composerStartPpq;
-        }
+        GrooveTransform::Event event;
+        if (!transform->settings.apply(events, i, pattern.lengthInBeats, event))
+            continue;
         
-        double composerLength = getComposerLengthInBeats();
+        if (event.beat < rangeStart || event.beat >= rangeEnd)
+            continue;
         
-        if (looping)
-        {
-            while (composerPosition >= composerLength && composerLength > 0)
-            {
-                composerPosition -= composerLength;
-                if (!useInternal)
-                    composerStartPpq += composerLength;
-                else
-                    internalPositionBeats -= composerLength;
-            }
-        }
-        else if (composerPosition >= composerLength)
-        {
-            composerPlaying = false;
-            return;
-        }
+        const double beatsFromBlockStart = event.beat - rangeStart + beatsIntoBlock;
+        const int sampleOffset = juce::jlimit(0, numSamples - 1, static_cast<int>(beatsFromBlockStart * samplesPerBeat));
         
-        // Calculate last position for this block
-        double lastPositionInComposer;
-        if (useInternal)
-        {
-            lastPositionInComposer = composerPosition - beatsThisBlock;
-            if (lastPositionInComposer < 0 && looping && composerLength > 0)
-                lastPositionInComposer += composerLength;
-            if (lastPositionInComposer < 0)
-                lastPositionInComposer = 0;
-        }
+        if (event.isNoteOn)
+            eventsOut.addNoteOn(sampleOffset, event.note, event.velocity);
         else
-        {
-            lastPositionInComposer = previousPosition - composerStartPpq;
-            if (looping && lastPositionInComposer >= composerLength && composerLength > 0)
-                lastPositionInComposer = 0;
-        }
+            eventsOut.addNoteOff(sampleOffset, event.note);
+    }
+    
+    cursor.eventIndex = juce::jmin(nextEventIndex, i);
+    cursor.positionBeats = rangeEnd;
+}
+
+/*
+    SEEK CURSOR
+    -----------
+    lower_bound on the timeline's tick array finds the first event at or
+    after the position (less the look-behind).
+*/
+void GrooveManager::seekCursor(const PlaybackPattern& pattern, double positionBeats, double lookBehindBeats)
+{
+    const double startTick = juce::jmax(0.0, positionBeats - lookBehindBeats) * GrooveEventList::ticksPerBeat;
+    const auto& ticks = pattern.events.getTicks();
+    
+    auto firstEvent = std::lower_bound(ticks.begin(), ticks.end(), startTick,
+                                       [](juce::uint32 tick, double value)
+                                       {
+                                           return static_cast<double>(tick) < value;
+                                       });
+    
+    cursor.patternSerial = pattern.serial;
+    cursor.eventIndex = static_cast<size_t>(std::distance(ticks.begin(), firstEvent));
+    cursor.positionBeats = positionBeats;
+}
+
+/*
+    PUBLISH PATTERN
+    ---------------
+    Swaps in a new pattern for the audio thread and frees the old one
+    once the audio thread can no longer be reading it (caller holds lock).
+*/
+void GrooveManager::publishPattern(std::atomic<PlaybackPattern*>& slot, PlaybackPattern* newPattern)
+{
+    // A fresh serial makes the audio thread re-seek its cursor (0 is reserved for "none")
+    if (newPattern != nullptr)
+    {
+        if (++lastPatternSerial == 0)
+            ++lastPatternSerial;
         
-        // Process each composer item
-        for (const auto& item : composerItems)
-        {
-            const Groove* groove = getGroove(item.grooveCategoryIndex, item.grooveIndex);
-            if (groove == nullptr || !groove->isLoaded)
-                continue;
-            
-            // Check if current position is within this item
-            if (composerPosition >= item.startBeat && 
-                composerPosition < item.startBeat + item.lengthInBeats)
-            {
-                double positionInGroove = composerPosition - item.startBeat;
-                double lastPosInGroove = lastPositionInComposer - item.startBeat;
-                
-                if (lastPosInGroove < 0)
-                    lastPosInGroove = 0;
-                
-                for (const auto& evt : groove->events)
-                {
-                    // Only trigger events within the item's length (respects bar count)
-                    if (evt.timeInBeats < item.lengthInBeats &&
-                        evt.timeInBeats > lastPosInGroove && 
-                        evt.timeInBeats <= positionInGroove)
-                    {
-                        midiOut.push_back(evt.message);
-                    }
-                }
-            }
-        }
+        newPattern->serial = lastPatternSerial;
+    }
+    
+    PlaybackPattern* oldPattern = slot.exchange(newPattern);
+    audioFence.waitForBlockToFinish();
+    delete oldPattern;
+}
+
+/*
+    SET TRANSFORM
+    -------------
+    Published for the audio thread the way patterns are: the new one is
+    swapped in, and the old one is freed once no block can be using it.
+*/
+void GrooveManager::setTransform(const GrooveTransform& newTransform)
+{
+    const CheckedCriticalSection::ScopedLockType sl(lock);
+    
+    if (newTransform == transform)
+        return;
+    
+    transform = newTransform;
+    ++transformRevision;
+    compositionSnapshot.reset();
+    
+    ScheduledTransform* scheduled = nullptr;
+    if (!transform.isIdentity())
+    {
+        scheduled = new ScheduledTransform { transform, 0 };
+        
+        // Shares the pattern serials, so 0 stays "none"
+        if (++lastPatternSerial == 0)
+            ++lastPatternSerial;
         
-        lastProcessedPpq = currentPosition;
+        scheduled->serial = lastPatternSerial;
     }
+    
+    ScheduledTransform* oldTransform = scheduledTransform.exchange(scheduled);
+    audioFence.waitForBlockToFinish();
+    delete oldTransform;
+}
+
+GrooveTransform GrooveManager::getTransform() const
+{
+    const CheckedCriticalSection::ScopedLockType sl(lock);
+    return transform;
+}
+
+/*
+    REBUILD COMPOSER PATTERN
+    ------------------------
+    Compiles composerItems into one flat timeline: each item's events
+    (up to its length) shifted to its start beat. The audio thread never
+    touches composerItems or the groove library (caller holds lock).
+*/
+void GrooveManager::rebuildComposerPattern()
+{
+    auto pattern = std::make_unique<PlaybackPattern>();
+    double length = 0.0;
+    
+    for (const auto& item : composerItems)
+    {
+        length += item.lengthInBeats;
+        
+        const Groove* groove = getGroove(item.grooveCategoryIndex, item.grooveIndex);
+        if (groove == nullptr || !groove->isLoaded)
+            continue;
+        
+        pattern->events.append(groove->events,
+                               GrooveEventList::beatsToTicks(item.startBeat),
+                               GrooveEventList::beatsToTicks(item.lengthInBeats));
+    }
+    
+    // Items are appended in order, so this only triggers on tick rounding at a seam
+    if (!pattern->events.isSortedByTime())
+        pattern->events.sortByTime();
+    
+    pattern->lengthInBeats = length;
+    composerLengthInBeats = length;
+    compositionSnapshot.reset();
+    
+    publishPattern(composerPattern, pattern.release());
 }
 
 // Composer functions
 void GrooveManager::addToComposer(int categoryIndex, int grooveIndex, int barCount)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     // Load the groove if not already loaded
     if (!loadGroove(categoryIndex, grooveIndex))
@@ -537,6 +976,7 @@ void GrooveManager::addToComposer(int categoryIndex, int grooveIndex, int barCou
     }
     
     composerItems.push_back(item);
+    rebuildComposerPattern();
     
     DBG("GrooveManager: Added " + juce::String(barCount) + " bars of groove to composer. "
         + "Length: " + juce::String(item.lengthInBeats) + " beats. "
@@ -545,7 +985,7 @@ void GrooveManager::addToComposer(int categoryIndex, int grooveIndex, int barCou
 
 void GrooveManager::removeFromComposer(int index)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     if (index < 0 || index >= static_cast<int>(composerItems.size()))
         return;
@@ -558,18 +998,21 @@ void GrooveManager::removeFromComposer(int index)
     {
         composerItems[i].startBeat -= removedLength;
     }
+    
+    rebuildComposerPattern();
 }
 
 void GrooveManager::clearComposer()
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     composerItems.clear();
     composerPlaying = false;
+    rebuildComposerPattern();
 }
 
 void GrooveManager::moveComposerItem(int fromIndex, int toIndex)
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     if (fromIndex < 0 || fromIndex >= static_cast<int>(composerItems.size()))
         return;
@@ -589,43 +1032,42 @@ void GrooveManager::moveComposerItem(int fromIndex, int toIndex)
         ci.startBeat = currentBeat;
         currentBeat += ci.lengthInBeats;
     }
-}
-
-double GrooveManager::getComposerLengthInBeats() const
-{
-    double length = 0.0;
-    for (const auto& item : composerItems)
-    {
-        length += item.lengthInBeats;
-    }
-    return length;
+    
+    rebuildComposerPattern();
 }
 
 void GrooveManager::startComposerPlayback()
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
     if (composerItems.empty())
         return;
     
-    // Make sure all grooves are loaded
+    // Make sure all grooves are loaded (recompiles only if one wasn't)
+    bool allLoaded = true;
     for (const auto& item : composerItems)
     {
-        loadGroove(item.grooveCategoryIndex, item.grooveIndex);
+        const Groove* groove = getGroove(item.grooveCategoryIndex, item.grooveIndex);
+        if (groove == nullptr || !groove->isLoaded)
+        {
+            loadGroove(item.grooveCategoryIndex, item.grooveIndex);
+            allLoaded = false;
+        }
     }
     
+    if (!allLoaded)
+        rebuildComposerPattern();
+    
+    positionResetRequested = true;  // Position restarts on the next processBlock
     composerPlaying = true;
     playing = false;  // Stop single groove playback
-    composerStartPpq = -1.0;
-    lastProcessedPpq = -1.0;
-    internalPositionBeats = 0.0;  // Reset internal clock
     
     DBG("GrooveManager: Started composer playback");
 }
 
 void GrooveManager::stopComposerPlayback()
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     composerPlaying = false;
     
     DBG("GrooveManager: Stopped composer playback");
@@ -633,169 +1075,91 @@ void GrooveManager::stopComposerPlayback()
 
 juce::File GrooveManager::exportGrooveToTempFile(int categoryIndex, int grooveIndex)
 {
-    juce::ScopedLock sl(lock);
-    
-    const Groove* groove = getGroove(categoryIndex, grooveIndex);
-    if (groove == nullptr || !groove->file.existsAsFile())
-        return juce::File();
+    juce::File grooveFile;
+    juce::String grooveName;
     
-    // Copy the groove file to temp directory for DAW access
-    // (Original file may be inside VST3 bundle with restricted access)
-    if (!tempDir.exists())
     {
-        tempDir.createDirectory();
-    }
-    
-    // Create a unique filename based on category and groove name
-    juce::String safeName = groove->name.replaceCharacters(" /\\:*?\"<>|", "_________");
-    juce::File destFile = tempDir.getChildFile(safeName + ".mid");
+        const CheckedCriticalSection::ScopedLockType sl(lock);
     
-    // Copy the original MIDI file to temp location
-    if (groove->file.copyFileTo(destFile))
-    {
-        DBG("GrooveManager: Copied groove to: " + destFile.getFullPathName());
-        return destFile;
-    }
-    else
-    {
-        DBG("GrooveManager: Failed to copy groove file");
-        return groove->file;  // Fallback to original
+        const Groove* groove = getGroove(categoryIndex, grooveIndex);
+        if (groove == nullptr)
+            return juce::File();
+        
+        grooveFile = groove->file;
+        grooveName = groove->name;
     }
+    
+    // The original where the host can read it, otherwise a copy
+    // (the original may be inside the VST3 bundle, with restricted access)
+    return exportCache.getFileForGroove(grooveFile, grooveName);
 }
 
 juce::File GrooveManager::exportCompositionToTempFile()
 {
-    juce::ScopedLock sl(lock);
-    
-    if (composerItems.empty())
+    // Export serializes the same compiled timeline the audio thread plays,
+    // with swing & co. baked in, as it is heard - from the shared snapshot,
+    // so nothing below holds the lock
+    const auto snapshot = getCompositionSnapshot();
+    if (snapshot->isEmpty())
         return juce::File();
     
-    // Calculate total length first
-    double totalLengthInBeats = 0.0;
-    for (const auto& item : composerItems)
-    {
-        totalLengthInBeats += item.lengthInBeats;
-    }
-    
-    // Create a new MIDI file - Format Type 0 (single track) for maximum compatibility
-    juce::MidiFile midiFile;
-    midiFile.setTicksPerQuarterNote(480);  // Standard resolution
-    
-    juce::MidiMessageSequence sequence;
-    
-    // Add track name meta event (helps some DAWs identify the track)
-    juce::MidiMessage trackName = juce::MidiMessage::textMetaEvent(3, "JDrummer Composition");
-    trackName.setTimeStamp(0);
-    sequence.addEvent(trackName);
-    
-    // Add tempo (120 BPM = 500000 microseconds per beat)
-    auto tempoEvent = juce::MidiMessage::tempoMetaEvent(500000);
-    tempoEvent.setTimeStamp(0);
-    sequence.addEvent(tempoEvent);
-    
-    // Add time signature (4/4)
-    auto timeSigEvent = juce::MidiMessage::timeSignatureMetaEvent(4, 4);
-    timeSigEvent.setTimeStamp(0);
-    sequence.addEvent(timeSigEvent);
-    
-    // Add all groove events with adjusted timing
-    for (const auto& item : composerItems)
-    {
-        const Groove* groove = getGroove(item.grooveCategoryIndex, item.grooveIndex);
-        if (groove == nullptr || !groove->isLoaded)
-            continue;
-        
-        for (const auto& evt : groove->events)
-        {
-            // Only include events within the ITEM's length (respects bar count)
-            if (evt.timeInBeats < item.lengthInBeats)
-            {
-                juce::MidiMessage msg = evt.message;
-                // Convert beats to ticks (480 ticks per beat)
-                double ticks = (item.startBeat + evt.timeInBeats) * 480.0;
-                msg.setTimeStamp(ticks);
-                sequence.addEvent(msg);
-            }
-        }
-    }
-    
-    // Ensure all note-on events have matching note-off events
-    sequence.updateMatchedPairs();
-    
-    // Sort events by timestamp
-    sequence.sort();
-    
-    // Add end-of-track meta event at the very end
-    // This is REQUIRED by MIDI spec and some DAWs (like Bitwig) are strict about it
-    auto endOfTrack = juce::MidiMessage::endOfTrack();
-    endOfTrack.setTimeStamp(totalLengthInBeats * 480.0);
-    sequence.addEvent(endOfTrack);
-    
-    midiFile.addTrack(sequence);
+    return exportCache.getFileForEvents("jdrummer_composition", snapshot->name,
+                                        snapshot->events, snapshot->lengthInBeats);
+}
+
+/*
+    RENDER TIMELINES
+    ----------------
+    The same compiled events playback uses, copied so a bounce can take
+    as long as it likes without holding the lock.
+*/
+GrooveManager::RenderTimeline GrooveManager::getCompositionTimeline()
+{
+    return *getCompositionSnapshot();
+}
+
+std::shared_ptr<const GrooveManager::RenderTimeline> GrooveManager::getCompositionSnapshot()
+{
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
-    // Write to export file (persistent directory for DAW compatibility)
-    juce::File outFile = tempDir.getChildFile("jdrummer_composition_" 
-        + juce::String(juce::Time::currentTimeMillis()) + ".mid");
+    if (compositionSnapshot != nullptr)
+        return compositionSnapshot;
     
-    // Delete any existing file first
-    if (outFile.existsAsFile())
-        outFile.deleteFile();
+    auto snapshot = std::make_shared<RenderTimeline>();
     
+    // Only the message thread replaces the pattern, and we hold the lock
+    const PlaybackPattern* pattern = composerPattern.load();
+    if (!composerItems.empty() && pattern != nullptr)
     {
-        juce::FileOutputStream stream(outFile);
-        if (stream.openedOk())
-        {
-            bool writeSuccess = midiFile.writeTo(stream);
-            stream.flush();
-            
-            if (writeSuccess)
-            {
-                DBG("GrooveManager: Exported composition to " + outFile.getFullPathName() 
-                    + " (" + juce::String(outFile.getSize()) + " bytes)");
-            }
-            else
-            {
-                DBG("GrooveManager: Failed to write MIDI data");
-                return juce::File();
-            }
-        }
-        else
-        {
-            DBG("GrooveManager: Failed to open output file");
-            return juce::File();
-        }
-    }  // FileOutputStream closes here, ensuring file is fully written
-    
-    // Verify the file was written correctly
-    if (outFile.existsAsFile() && outFile.getSize() > 0)
-    {
-        return outFile;
+        snapshot->name = "JDrummer Composition";
+        snapshot->events = transform.isIdentity() ? pattern->events : transform.applyTo(pattern->events, pattern->lengthInBeats);
+        snapshot->lengthInBeats = pattern->lengthInBeats;
     }
     
-    DBG("GrooveManager: Export verification failed");
-    return juce::File();
+    compositionSnapshot = std::move(snapshot);
+    return compositionSnapshot;
 }
 
-void GrooveManager::cleanupOldExports()
+GrooveManager::RenderTimeline GrooveManager::getGrooveTimeline(int categoryIndex, int grooveIndex)
 {
-    // Remove exported MIDI files older than 1 hour
-    // This prevents the exports folder from growing indefinitely
-    // while ensuring DAWs have plenty of time to read dropped files
+    const CheckedCriticalSection::ScopedLockType sl(lock);
     
-    if (!tempDir.exists())
-        return;
+    RenderTimeline timeline;
+    
+    if (!loadGroove(categoryIndex, grooveIndex))
+        return timeline;
     
-    auto now = juce::Time::getCurrentTime();
-    auto oneHourAgo = now - juce::RelativeTime::hours(1);
+    const Groove* groove = getGroove(categoryIndex, grooveIndex);
+    if (groove == nullptr)
+        return timeline;
     
-    for (auto& file : tempDir.findChildFiles(juce::File::findFiles, false, "*.mid"))
-    {
-        if (file.getLastModificationTime() < oneHourAgo)
-        {
-            file.deleteFile();
-            DBG("GrooveManager: Cleaned up old export: " + file.getFileName());
-        }
-    }
+    timeline.name = groove->name;
+    
+    if (transform.isIdentity())
+        timeline.events.append(groove->events, 0, GrooveEventList::beatsToTicks(groove->lengthInBeats));
+    else
+        timeline.events = transform.applyTo(groove->events, groove->lengthInBeats);
+    
+    timeline.lengthInBeats = groove->lengthInBeats;
+    return timeline;
 }
-
-
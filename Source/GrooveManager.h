@@ -6,17 +6,38 @@
     
     This class handles:
     - Scanning the Grooves directory for MIDI files organized by category
+      (with a persistent index, so unchanged files are never parsed twice)
     - Loading and parsing MIDI files
     - Tempo-synced playback of grooves
     - Exporting grooves/compositions as MIDI files for drag & drop
+    
+    THREADING
+    ---------
+    The groove library and the composer are edited on the message thread
+    under a lock. The audio thread never takes that lock: when playback
+    starts (or the playing composition changes) we copy the events it
+    needs into an immutable PlaybackPattern and publish it through an
+    atomic pointer. Transport settings (playing, looping, BPM) are atomics.
 */
 
 #pragma once
 
 #include "JuceHeader.h"
+#include "RealtimeSafety.h"
+#include "NoteEventBuffer.h"
+#include "GrooveEvents.h"
+#include "GrooveLibraryIndex.h"
+#include "GrooveTransform.h"
+#include "MidiExportCache.h"
+#include <array>
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
 #include <vector>
 
+class GrooveSearchIndex;
+
 /*
     GROOVE DATA STRUCTURE
     ---------------------
@@ -31,17 +52,60 @@ struct Groove
     int numerator = 4;              // Time signature numerator
     int denominator = 4;            // Time signature denominator
     
-    // MIDI events sorted by time (in beats/quarter notes)
-    struct MidiEvent
-    {
-        double timeInBeats;         // When the event occurs (in quarter notes)
-        juce::MidiMessage message;  // The MIDI message
-    };
-    std::vector<MidiEvent> events;
+    // Note events sorted by time, in compact compiled form (see GrooveEvents.h)
+    GrooveEventList events;
+    
+    /*
+        ONSET HISTOGRAM
+        ---------------
+        Note-ons per 16th-note slot of a 4/4 bar, accumulated over the whole
+        groove. This is the groove's fingerprint for Bandmate matching;
+        it is computed once when the groove is compiled (and cached with it).
+    */
+    static constexpr int numHistogramSlots = 16;
+    std::array<juce::uint16, numHistogramSlots> onsetHistogram {};
+    int numNoteOns = 0;
+    
+    void updateOnsetHistogram();
     
     bool isLoaded = false;          // Whether MIDI data has been parsed
+    
+    // The file's stamp as it was when the events were parsed (what the library index is keyed on)
+    juce::int64 parsedModificationTime = 0;
+    juce::int64 parsedFileSize = 0;
 };
 
+/*
+    GROOVE FEATURES
+    ---------------
+    A groove's onset histogram, prepared for fast Bandmate matching:
+    
+    - unitHistogram: the histogram scaled to length 1, so cosine
+      similarity is a plain 16-float dot product (SIMD-friendly)
+    - hitSlots: one bit per slot with at least one hit
+    - nearbySlots: hitSlots widened by one slot either side, for the
+      fuzzy position match
+    
+    The same struct describes the audio being matched (see AudioAnalyzer),
+    so both sides go through fromHistogram().
+*/
+struct GrooveFeatures
+{
+    static constexpr int numSlots = Groove::numHistogramSlots;
+    
+    alignas(16) std::array<float, numSlots> unitHistogram {};
+    juce::uint32 hitSlots = 0;
+    juce::uint32 nearbySlots = 0;
+    
+    int categoryIndex = -1;
+    int grooveIndex = -1;
+    
+    static GrooveFeatures fromHistogram(const std::array<int, numSlots>& counts);
+};
+
+// Every groove's features in one contiguous array, in library order
+using GrooveFeatureTable = std::vector<GrooveFeatures>;
+
 /*
     GROOVE CATEGORY
     ---------------
@@ -79,12 +143,54 @@ public:
     // Scan the grooves directory and populate categories
     void scanGrooves();
     
+    // Write the library index to disk if anything was parsed since the last save
+    // (also done on destruction; see GrooveLibraryIndex.h)
+    void saveLibraryIndex();
+    
+    // Where the library index lives (defaults to the user data dir)
+    void setLibraryIndexFile(const juce::File& file);
+    
     // Get all categories
     const std::vector<GrooveCategory>& getCategories() const { return categories; }
     
     // Load a specific groove's MIDI data (lazy loading)
     bool loadGroove(int categoryIndex, int grooveIndex);
     
+    /*
+        LOAD ALL GROOVES (BATCH)
+        ------------------------
+        Parses every groove that isn't loaded yet, in parallel on the given
+        pool and without holding the library's lock, and returns how many
+        were parsed. Used by the offline analysis tool to build the library
+        index up front, and by getGrooveFeatures() on a cold library.
+        onGrooveParsed (optional) is called for each file, from the pool's
+        threads, with whether it parsed and how long it took.
+    */
+    using GrooveParsedCallback = std::function<void(const Groove&, bool parsed, double seconds)>;
+    int loadAllGrooves(juce::ThreadPool& pool, const GrooveParsedCallback& onGrooveParsed = {});
+    
+    /*
+        MATCH FEATURES
+        --------------
+        The features of every groove in the library, built once (parsing
+        any groove that isn't loaded yet, see loadAllGrooves()) and then
+        shared by every search until the library is rescanned. Safe from any non-audio thread:
+        the table is immutable, and callers keep it alive by holding the
+        shared_ptr, so no lock is held while they score it.
+    */
+    std::shared_ptr<const GrooveFeatureTable> getGrooveFeatures();
+    
+    /*
+        SEARCH INDEX
+        ------------
+        The library's names and details packed for searching (see
+        GrooveSearch.h). Built on first use from the grooves as they are -
+        nothing is parsed for it - and built again after a rescan or once
+        more grooves have been parsed. Shared and immutable like the
+        features above.
+    */
+    std::shared_ptr<const GrooveSearchIndex> getSearchIndex();
+    
     // Get a groove by index
     Groove* getGroove(int categoryIndex, int grooveIndex);
     const Groove* getGroove(int categoryIndex, int grooveIndex) const;
@@ -97,9 +203,11 @@ public:
     bool isLooping() const { return looping; }
     
     // Called from processBlock to get MIDI events for current position
-    // Returns events that should be triggered at the current DAW position
+    // Adds events that fall inside this block to eventsOut at their exact
+    // sample offset within the block (sample-accurate scheduling)
+    // Audio thread - takes no locks and never allocates
     void processBlock(double bpm, double ppqPosition, bool isPlaying,
-                      int numSamples, std::vector<juce::MidiMessage>& midiOut);
+                      int numSamples, NoteEventBuffer& eventsOut);
     
     // Composer functions
     // barCount: number of bars to add (0 = use full groove length)
@@ -108,17 +216,57 @@ public:
     void clearComposer();
     void moveComposerItem(int fromIndex, int toIndex);
     const std::vector<ComposerItem>& getComposerItems() const { return composerItems; }
-    double getComposerLengthInBeats() const;
+    double getComposerLengthInBeats() const { return composerLengthInBeats; }
     
     // Start/stop playing the composed sequence
     void startComposerPlayback();
     void stopComposerPlayback();
     bool isComposerPlaying() const { return composerPlaying; }
     
-    // Export functions - create MIDI file for drag & drop
+    /*
+        EXPORT
+        ------
+        MIDI files for drag & drop (message thread). The lock is held only
+        long enough to find the groove or take the composition's snapshot;
+        hashing and any writing happen without it, and a drag of something
+        already exported reuses its file (see MidiExportCache.h).
+    */
     juce::File exportGrooveToTempFile(int categoryIndex, int grooveIndex);
     juce::File exportCompositionToTempFile();
     
+    // Folder exported files are written to
+    juce::File getExportDirectory() const { return tempDir; }
+    
+    /*
+        RENDER TIMELINE
+        ---------------
+        A copy of what a groove or the composition plays - the compiled
+        events at absolute positions, cut to length - for rendering to
+        audio away from the audio thread (see OfflineRenderer.h).
+        Empty if there is nothing to render.
+    */
+    struct RenderTimeline
+    {
+        juce::String name;
+        GrooveEventList events;
+        double lengthInBeats = 0.0;
+        
+        bool isEmpty() const { return events.empty() || lengthInBeats <= 0.0; }
+    };
+    
+    RenderTimeline getCompositionTimeline();
+    
+    /*
+        COMPOSITION SNAPSHOT
+        --------------------
+        The composition's render timeline, built once per edit of the
+        arrangement (or of the transform) and shared, immutable, by every
+        export until the next one - so an export or bounce copies nothing
+        under the lock. Never nullptr; empty if there is nothing to play.
+    */
+    std::shared_ptr<const RenderTimeline> getCompositionSnapshot();
+    RenderTimeline getGrooveTimeline(int categoryIndex, int grooveIndex);
+    
     // Set sample rate for timing calculations
     void setSampleRate(double sampleRate) { currentSampleRate = sampleRate; }
     
@@ -129,46 +277,178 @@ public:
     // Reset to use DAW timing (for normal Grooves tab playback)
     void useDAWTiming() { useInternalClock = false; }
     
+    /*
+        GROOVE TRANSFORM
+        ----------------
+        Swing, humanize, velocity curve and instrument mute/replace for
+        whatever plays - single grooves and the composition - applied as
+        the events are scheduled, and baked into render timelines and the
+        composition's MIDI export (see GrooveTransform.h). Message thread.
+    */
+    void setTransform(const GrooveTransform& newTransform);
+    GrooveTransform getTransform() const;
+    
+    // Moves on with every change of transform (for caches of rendered grooves)
+    juce::uint32 getTransformRevision() const noexcept { return transformRevision.load(); }
+    
     // Reset playback position to start (for syncing with audio loop)
-    void resetPlaybackPosition() { internalPositionBeats = 0.0; playbackStartPpq = -1.0; }
+    // Safe from any thread - applied at the start of the next processBlock
+    void resetPlaybackPosition() { positionResetRequested = true; }
 
 private:
-    // Parse a MIDI file and populate the Groove structure
+    // Parse a MIDI file and populate the Groove structure (marks the index dirty)
     bool parseMidiFile(Groove& groove);
     
+    // The parsing itself: touches only the groove, so grooves can be compiled in parallel
+    static bool compileMidiFile(Groove& groove);
+    
+    /*
+        PLAYBACK PATTERN - THE COMPILED TIMELINE
+        ----------------------------------------
+        Everything the audio thread needs to play a groove or a composition,
+        flattened into ONE sorted event list with absolute positions: each
+        item's events are shifted to its start beat, and events past the
+        item's length (bar count) are left out. The composer's timeline is
+        recompiled whenever the arrangement is edited, so playback is a
+        single cursor walk and export just serializes the same list -
+        however many items the arrangement has.
+        Never modified after it has been published.
+    */
+    struct PlaybackPattern
+    {
+        GrooveEventList events;   // Absolute ticks from the start of the pattern
+        double lengthInBeats = 0.0;
+        juce::uint32 serial = 0;  // Unique per published pattern (tells cursors it changed)
+    };
+    
+    /*
+        PLAYBACK CURSOR
+        ---------------
+        Where the previous block stopped: the next event to play. While
+        playback runs on, each block just carries on from here, so it costs
+        O(events in the block) however long the pattern is. After a loop,
+        a transport jump or a new pattern, seekCursor() finds the spot
+        again with a binary search (lower_bound).
+        Audio thread only.
+    */
+    struct PlaybackCursor
+    {
+        juce::uint32 patternSerial = 0;  // 0 = not positioned yet
+        juce::uint32 transformSerial = 0;
+        size_t eventIndex = 0;
+        double positionBeats = 0.0;      // Pattern position the cursor stands at
+    };
+    
+    /*
+        SCHEDULED TRANSFORM
+        -------------------
+        The transform as the audio thread sees it: published like a
+        pattern, and never modified after that. None is published while
+        the transform leaves everything as it is.
+    */
+    struct ScheduledTransform
+    {
+        GrooveTransform settings;
+        juce::uint32 serial = 0;         // Unique per published transform (0 = none)
+    };
+    
+    // Position the cursor at the first event at or after positionBeats - lookBehindBeats
+    void seekCursor(const PlaybackPattern& pattern, double positionBeats, double lookBehindBeats = 0.0);
+    
+    // Add the pattern's events in [rangeStart, rangeEnd) beats to eventsOut
+    // beatsIntoBlock: how far into the current block rangeStart lies
+    // transform: applied to each event (nullptr = none)
+    // Advances the playback cursor (audio thread only)
+    void addPatternEventsInRange(const PlaybackPattern& pattern, const ScheduledTransform* transform,
+                                 double rangeStart, double rangeEnd, double beatsIntoBlock,
+                                 double samplesPerBeat, int numSamples,
+                                 NoteEventBuffer& eventsOut);
+    
+    // Swap in a pattern for the audio thread, freeing the old one safely (caller holds lock)
+    void publishPattern(std::atomic<PlaybackPattern*>& slot, PlaybackPattern* newPattern);
+    
+    // Recompile the composer's timeline from composerItems (caller holds lock)
+    // Called after every edit of the arrangement
+    void rebuildComposerPattern();
+    
     // Calculate the length of a groove in beats from its MIDI events
-    double calculateGrooveLength(const Groove& groove);
+    static double calculateGrooveLength(const Groove& groove);
     
-    // Clean up old exported MIDI files (called on startup)
-    void cleanupOldExports();
+    // Where exported MIDI files go
+    static juce::File getDefaultExportDirectory();
     
     juce::File groovesPath;
     std::vector<GrooveCategory> categories;
     
-    // Playback state
-    bool playing = false;
-    bool looping = true;
+    // On-disk cache of compiled grooves (under lock)
+    GrooveLibraryIndex libraryIndex;
+    
+    // Moves on whenever scanGrooves() replaces the library (under lock)
+    int libraryGeneration = 0;
+    
+    // Built on first use by getGrooveFeatures(), dropped by scanGrooves() (under lock)
+    std::shared_ptr<const GrooveFeatureTable> grooveFeatures;
+    
+    // Built on first use by getSearchIndex(), dropped when grooves are scanned or parsed (under lock)
+    std::shared_ptr<const GrooveSearchIndex> searchIndex;
+    
+    // Built on first use by getCompositionSnapshot(), dropped by rebuildComposerPattern() and setTransform() (under lock)
+    std::shared_ptr<const RenderTimeline> compositionSnapshot;
+    
+    // Playback state (shared with the audio thread)
+    std::atomic<bool> playing { false };
+    std::atomic<bool> looping { true };
     int currentCategoryIndex = -1;
     int currentGrooveIndex = -1;
-    double playbackStartPpq = 0.0;
-    double lastProcessedPpq = -1.0;
     
-    // Internal timing for standalone preview (when DAW isn't playing)
-    double internalBpm = 120.0;
+    // Patterns the audio thread plays (published by the message thread)
+    std::atomic<PlaybackPattern*> groovePattern { nullptr };
+    std::atomic<PlaybackPattern*> composerPattern { nullptr };
+    
+    // Transform the audio thread applies (published by the message thread, nullptr = none)
+    std::atomic<ScheduledTransform*> scheduledTransform { nullptr };
+    
+    // The transform as last set, and what its render timelines use (under lock)
+    GrooveTransform transform;
+    std::atomic<juce::uint32> transformRevision { 0 };
+    
+    // Tells publishPattern() when the audio thread has let go of an old pattern (or transform)
+    AudioBlockFence audioFence;
+    
+    // Set by other threads, consumed by processBlock to restart the position
+    std::atomic<bool> positionResetRequested { false };
+    
+    // Playback position - owned by the audio thread
+    double patternStartPpq = -1.0;
     double internalPositionBeats = 0.0;
-    bool useInternalClock = true;  // Use internal clock when DAW isn't playing
+    PlaybackCursor cursor;
+    
+    // Source of PlaybackPattern::serial (message thread, under lock)
+    juce::uint32 lastPatternSerial = 0;
+    
+    // Internal timing for standalone preview (when DAW isn't playing)
+    std::atomic<double> internalBpm { 120.0 };
+    std::atomic<bool> useInternalClock { true };  // Use internal clock when DAW isn't playing
     
     // Composer state
     std::vector<ComposerItem> composerItems;
-    bool composerPlaying = false;
-    double composerStartPpq = 0.0;
+    double composerLengthInBeats = 0.0;  // Updated by rebuildComposerPattern()
+    std::atomic<bool> composerPlaying { false };
     
-    double currentSampleRate = 44100.0;
+    std::atomic<double> currentSampleRate { 44100.0 };
     
     // Temporary directory for exported MIDI files
-    juce::File tempDir;
+    juce::File tempDir { getDefaultExportDirectory() };
+    
+    // The files in it (message thread, not under lock)
+    MidiExportCache exportCache { tempDir };
+    
+    // Protects the library and composer (never taken on the audio thread)
+    CheckedCriticalSection lock;
     
-    juce::CriticalSection lock;
+    // Held for a whole loadAllGrooves() batch / saveLibraryIndex() write, neither under lock
+    CheckedCriticalSection parseLock;
+    CheckedCriticalSection indexSaveLock;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrooveManager)
 };
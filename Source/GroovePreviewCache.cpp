@@ -0,0 +1,387 @@
+/*
+    GroovePreviewCache.cpp
+    ======================
+    
+    Implementation of the pre-rendered groove auditions (see
+    GroovePreviewCache.h).
+*/
+
+#include "GroovePreviewCache.h"
+#include <algorithm>
+
+GroovePreviewCache::GroovePreviewCache(SoundFontManager& soundFonts, GrooveManager& grooves)
+    : soundFontManager(soundFonts),
+      grooveManager(grooves)
+{
+}
+
+GroovePreviewCache::~GroovePreviewCache()
+{
+    stopTimer();
+    cancelPendingUpdate();
+    
+    // Give up a render in progress and wait for the worker
+    ++latestRequest;
+    renderPool.removeAllJobs(true, 10000);
+}
+
+/*
+    AUDITION
+    --------
+    A cached render plays at once. Otherwise whatever was playing stops,
+    and the groove is heard as soon as its render is ready - normally a
+    few tens of milliseconds, as the bounce runs much faster than real
+    time.
+*/
+void GroovePreviewCache::audition(int categoryIndex, int grooveIndex, double bpm, double sampleRate)
+{
+    wantedKey = { categoryIndex, grooveIndex, bpm, sampleRate,
+                  soundFontManager.getSoundRevision(), grooveManager.getTransformRevision() };
+    wanted = true;
+    dropStaleEntries();
+    
+    if (auto cached = findEntry(wantedKey))
+    {
+        ++latestRequest;  // Whatever is still rendering isn't wanted any more
+        play(std::move(cached), true);
+    }
+    else
+    {
+        play(nullptr, true);
+        requestRender();
+    }
+    
+    // Watch for kit and mix changes while auditioning
+    startTimerHz(5);
+}
+
+void GroovePreviewCache::stop()
+{
+    wanted = false;
+    ++latestRequest;
+    stopTimer();
+    
+    play(nullptr, false);
+}
+
+bool GroovePreviewCache::isAuditioning() const
+{
+    return wanted && !playedOut.load();
+}
+
+void GroovePreviewCache::clear()
+{
+    entries.clear();
+}
+
+GroovePreviewCache::AuditionPtr GroovePreviewCache::findEntry(const Key& key)
+{
+    auto found = std::find_if(entries.begin(), entries.end(),
+                              [&key](const AuditionPtr& entry) { return entry->key == key; });
+    
+    if (found == entries.end())
+        return nullptr;
+    
+    // Most recently used last
+    auto entry = *found;
+    entries.erase(found);
+    entries.push_back(entry);
+    return entry;
+}
+
+void GroovePreviewCache::addEntry(AuditionPtr entry)
+{
+    if (findEntry(entry->key) != nullptr)
+        return;
+    
+    entries.push_back(std::move(entry));
+    
+    // Evict the least recently used (one that is playing stays alive through playingAudition)
+    while (static_cast<int>(entries.size()) > maxEntries)
+        entries.erase(entries.begin());
+}
+
+void GroovePreviewCache::dropStaleEntries()
+{
+    const auto soundRevision = soundFontManager.getSoundRevision();
+    const auto transformRevision = grooveManager.getTransformRevision();
+    
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const AuditionPtr& entry) { return !entry->key.isCurrent(soundRevision, transformRevision); }),
+                  entries.end());
+}
+
+/*
+    REQUEST RENDER
+    --------------
+    The groove's events are copied here, on the message thread (loading
+    the groove if needed), so the worker never touches the GrooveManager.
+    The loop is the groove's length or maxBars, whichever is shorter.
+*/
+void GroovePreviewCache::requestRender()
+{
+    auto timeline = grooveManager.getGrooveTimeline(wantedKey.categoryIndex, wantedKey.grooveIndex);
+    const auto* groove = grooveManager.getGroove(wantedKey.categoryIndex, wantedKey.grooveIndex);
+    
+    if (timeline.isEmpty() || groove == nullptr || wantedKey.bpm <= 0.0 || wantedKey.sampleRate <= 0.0)
+    {
+        DBG("GroovePreviewCache: Nothing to audition");
+        stop();
+        return;
+    }
+    
+    const double beatsPerBar = static_cast<double>(juce::jmax(1, groove->numerator));
+    const double loopBeats = juce::jmin(timeline.lengthInBeats, maxBars * beatsPerBar);
+    
+    const int requestId = ++latestRequest;
+    
+    renderPool.addJob([this, key = wantedKey, timeline, loopBeats, requestId]()
+    {
+        auto rendered = render(key, timeline, loopBeats, requestId);
+        if (rendered == nullptr)
+            return;
+        
+        {
+            const CheckedCriticalSection::ScopedLockType sl(finishedLock);
+            finishedRenders.push_back(AuditionPtr(std::move(rendered)));
+        }
+        
+        triggerAsyncUpdate();
+    });
+}
+
+void GroovePreviewCache::handleAsyncUpdate()
+{
+    std::vector<AuditionPtr> finished;
+    {
+        const CheckedCriticalSection::ScopedLockType sl(finishedLock);
+        finished.swap(finishedRenders);
+    }
+    
+    const auto soundRevision = soundFontManager.getSoundRevision();
+    const auto transformRevision = grooveManager.getTransformRevision();
+    
+    for (auto& audition : finished)
+    {
+        // The kit, mix or transform changed while it was rendering
+        if (!audition->key.isCurrent(soundRevision, transformRevision))
+            continue;
+        
+        addEntry(audition);
+        
+        if (wanted && audition->key == wantedKey)
+        {
+            // Rendered again for a new kit or mix - carry on where the old one was
+            const bool restart = playingAudition == nullptr || !playingAudition->key.isSameGrooveAs(audition->key);
+            play(audition, restart);
+        }
+    }
+}
+
+void GroovePreviewCache::timerCallback()
+{
+    if (!isAuditioning())
+    {
+        stop();
+        return;
+    }
+    
+    const auto soundRevision = soundFontManager.getSoundRevision();
+    const auto transformRevision = grooveManager.getTransformRevision();
+    if (wantedKey.isCurrent(soundRevision, transformRevision))
+        return;
+    
+    wantedKey.soundRevision = soundRevision;
+    wantedKey.transformRevision = transformRevision;
+    dropStaleEntries();
+    
+    // The old render keeps playing until the new one is ready
+    requestRender();
+}
+
+/*
+    PLAY
+    ----
+    The audio thread plays whatever activeAudition points to; the fence
+    tells us when it has let go of the previous one, which playingAudition
+    kept alive until then.
+    
+    For a restart the pointer is cleared first, so the audio thread can't
+    apply the restart to the old audition: once it sees the new pointer,
+    it also sees the restart flag that was set before it.
+*/
+void GroovePreviewCache::play(AuditionPtr audition, bool restart)
+{
+    if (restart)
+    {
+        activeAudition = nullptr;
+        fence.waitForBlockToFinish();
+        restartRequested = true;
+    }
+    
+    playedOut = false;
+    activeAudition = audition.get();
+    fence.waitForBlockToFinish();
+    
+    playingAudition = std::move(audition);
+}
+
+/*
+    RENDER
+    ------
+    The loop's events, played at their exact sample by a private offline
+    engine (every group into the main mix), followed by the ring-out -
+    cut short as soon as the last voice has stopped. The tail is never
+    longer than the loop, as the audio thread lays it over a single pass.
+    
+    Runs on the render thread while the processor goes on as usual: the
+    engine routes notes with the group table it was built with, and of
+    the manager it reads only atomics (per-note settings, voice budgets,
+    chokes), so nothing here races with prepareToPlay() or the message
+    thread.
+*/
+std::unique_ptr<GroovePreviewCache::Audition> GroovePreviewCache::render(const Key& key,
+                                                                         const GrooveManager::RenderTimeline& timeline,
+                                                                         double loopBeats, int requestId) const
+{
+    if (isSuperseded(requestId))
+        return nullptr;
+    
+    auto engine = soundFontManager.createOfflineEngine(key.sampleRate);
+    if (engine == nullptr || isSuperseded(requestId))
+        return nullptr;
+    
+    const auto& events = timeline.events;
+    const double samplesPerBeat = key.sampleRate * 60.0 / key.bpm;
+    const int loopSamples = juce::jmax(1, static_cast<int>(std::llround(loopBeats * samplesPerBeat)));
+    const int endSamples = loopSamples + juce::jmin(loopSamples, static_cast<int>(maxTailSeconds * key.sampleRate));
+    
+    auto getEventSample = [&](size_t index)
+    {
+        return static_cast<int>(std::llround(events.getBeat(index) * samplesPerBeat));
+    };
+    
+    // Events from the bar after the loop on are left out
+    size_t numEvents = 0;
+    while (numEvents < events.size() && getEventSample(numEvents) < loopSamples)
+        ++numEvents;
+    
+    auto audition = std::make_unique<Audition>();
+    audition->key = key;
+    audition->loopSamples = loopSamples;
+    audition->samples.setSize(2, endSamples);
+    audition->samples.clear();
+    
+    const std::array<SoundFontManager::StereoBuffer, SoundFontManager::NUM_OUTPUT_GROUPS> noGroupBuses {};
+    int position = 0;
+    size_t nextEvent = 0;
+    
+    while (position < endSamples)
+    {
+        if (isSuperseded(requestId))
+            return nullptr;
+        
+        if (position >= loopSamples && engine->getNumActiveVoices() == 0)
+            break;
+        
+        for (; nextEvent < numEvents && getEventSample(nextEvent) <= position; ++nextEvent)
+        {
+            if (events.isNoteOn(nextEvent))
+                engine->noteOn(events.getNote(nextEvent), events.getFloatVelocity(nextEvent));
+            else
+                engine->noteOff(events.getNote(nextEvent));
+        }
+        
+        int blockEnd = juce::jmin(position + renderBlockSize, endSamples);
+        if (nextEvent < numEvents)
+            blockEnd = juce::jmin(blockEnd, getEventSample(nextEvent));
+        if (position < loopSamples)
+            blockEnd = juce::jmin(blockEnd, loopSamples);
+        
+        const SoundFontManager::StereoBuffer output { audition->samples.getWritePointer(0, position),
+                                                      audition->samples.getWritePointer(1, position) };
+        engine->render(output, noGroupBuses, blockEnd - position);
+        position = blockEnd;
+    }
+    
+    // Keep only the tail that actually rings
+    if (position < endSamples)
+        audition->samples.setSize(2, position, true, false, true);
+    
+    return audition;
+}
+
+/*
+    MIX INTO
+    --------
+    A plain add of the rendered samples. After the first pass of a loop,
+    the previous pass's tail is added over the start as well.
+*/
+void GroovePreviewCache::mixInto(juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    const AudioBlockFence::ScopedBlock scope(fence);
+    
+    // The pointer first: a new one comes with its restart flag already set (see play)
+    const auto* audition = activeAudition.load();
+    if (audition == nullptr)
+        return;
+    
+    if (restartRequested.exchange(false))
+    {
+        playPosition = 0;
+        hasWrapped = false;
+    }
+    else if (audition != lastAudition)
+    {
+        playPosition = juce::jmin(playPosition, audition->getNumSamples());
+    }
+    
+    lastAudition = audition;
+    
+    const bool loop = looping.load();
+    const int loopSamples = audition->loopSamples;
+    const int tailSamples = audition->getTailSamples();
+    const int endSamples = loop ? loopSamples : audition->getNumSamples();
+    
+    if (!loop && playPosition >= endSamples)
+    {
+        playedOut = true;
+        return;
+    }
+    
+    // Only now is the main bus written (see SILENCE FLAG in processBlock)
+    auto* left = buffer.getWritePointer(0);
+    auto* right = buffer.getWritePointer(1);
+    const float* sourceLeft = audition->samples.getReadPointer(0);
+    const float* sourceRight = audition->samples.getReadPointer(1);
+    
+    int done = 0;
+    while (done < numSamples)
+    {
+        if (playPosition >= endSamples)
+        {
+            if (!loop)
+            {
+                playedOut = true;
+                return;
+            }
+            
+            playPosition = 0;
+            hasWrapped = true;
+        }
+        
+        const int count = juce::jmin(numSamples - done, endSamples - playPosition);
+        juce::FloatVectorOperations::add(left + done, sourceLeft + playPosition, count);
+        juce::FloatVectorOperations::add(right + done, sourceRight + playPosition, count);
+        
+        if (hasWrapped && playPosition < tailSamples)
+        {
+            const int tailCount = juce::jmin(count, tailSamples - playPosition);
+            juce::FloatVectorOperations::add(left + done, sourceLeft + loopSamples + playPosition, tailCount);
+            juce::FloatVectorOperations::add(right + done, sourceRight + loopSamples + playPosition, tailCount);
+        }
+        
+        playPosition += count;
+        done += count;
+    }
+}
@@ -0,0 +1,178 @@
+/*
+    GroovePreviewCache.h
+    ====================
+    
+    Auditions grooves from the browser as pre-rendered audio. The first
+    bars of a groove (up to maxBars) are bounced in the background with
+    the current kit - the same offline engine as OfflineRenderer - and
+    the audio thread then just adds the buffer to the main bus: no
+    synthesis, no groove scheduling, no competing with the DAW's own
+    playback on the live voices.
+    
+    THE CACHE
+    ---------
+    The last maxEntries auditions are kept, so flicking back and forth
+    through a category costs nothing but a copy. An entry belongs to one
+    groove at one tempo and sample rate, with one kit and mix: when
+    SoundFontManager::getSoundRevision() moves on (a new kit, a pad's
+    volume, pan, mute or round-robin), every entry is stale. What is
+    playing at that moment is rendered again and swapped in at the same
+    position, so tweaking a pad is heard within a moment. The same goes
+    for GrooveManager's transform (swing, humanize...).
+    
+    Rendering is superseded like kit loads are: a request that hasn't
+    finished when a newer one arrives is given up.
+    
+    LOOPING
+    -------
+    A render is the loop plus up to maxTailSeconds of ring-out after it.
+    When the audition loops, that tail is played over the start of the
+    next pass - what the live engine would do - and at the end of a
+    one-shot it simply plays out.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "GrooveManager.h"
+#include "SoundFontManager.h"
+#include "RealtimeSafety.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class GroovePreviewCache : private juce::AsyncUpdater,
+                           private juce::Timer
+{
+public:
+    GroovePreviewCache(SoundFontManager& soundFontManager, GrooveManager& grooveManager);
+    ~GroovePreviewCache() override;
+    
+    // ===== MESSAGE THREAD =====
+    
+    // Play a groove's first bars at this tempo and rate - right away if they are
+    // cached, otherwise as soon as they have been rendered
+    void audition(int categoryIndex, int grooveIndex, double bpm, double sampleRate);
+    
+    // Stop (and forget a render that hasn't finished)
+    void stop();
+    
+    // Requested, playing, or playing out its last pass
+    bool isAuditioning() const;
+    
+    // Loop the audition (the default) or play it once
+    void setLooping(bool shouldLoop) { looping = shouldLoop; }
+    
+    // Drop every cached render (one that is playing keeps playing)
+    void clear();
+    
+    static constexpr int maxBars = 4;
+    static constexpr int maxEntries = 8;
+    static constexpr double maxTailSeconds = 2.0;
+    
+    // ===== AUDIO THREAD =====
+    
+    // Add the audition to the main bus (left untouched if nothing is playing)
+    void mixInto(juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+private:
+    // Everything a render depends on
+    struct Key
+    {
+        int categoryIndex = -1;
+        int grooveIndex = -1;
+        double bpm = 0.0;
+        double sampleRate = 0.0;
+        juce::uint32 soundRevision = 0;
+        juce::uint32 transformRevision = 0;  // GrooveManager::getTransformRevision()
+        
+        // The same audition, perhaps with another kit, mix or swing
+        bool isSameGrooveAs(const Key& other) const noexcept
+        {
+            return categoryIndex == other.categoryIndex && grooveIndex == other.grooveIndex
+                   && bpm == other.bpm && sampleRate == other.sampleRate;
+        }
+        
+        bool operator==(const Key& other) const noexcept
+        {
+            return isSameGrooveAs(other) && soundRevision == other.soundRevision
+                   && transformRevision == other.transformRevision;
+        }
+        
+        bool isCurrent(juce::uint32 currentSoundRevision, juce::uint32 currentTransformRevision) const noexcept
+        {
+            return soundRevision == currentSoundRevision && transformRevision == currentTransformRevision;
+        }
+    };
+    
+    // One rendered audition - never modified once it is in the cache
+    struct Audition
+    {
+        Key key;
+        juce::AudioBuffer<float> samples;  // Stereo: the loop, then its tail
+        int loopSamples = 0;
+        
+        int getNumSamples() const noexcept { return samples.getNumSamples(); }
+        int getTailSamples() const noexcept { return getNumSamples() - loopSamples; }
+    };
+    using AuditionPtr = std::shared_ptr<const Audition>;
+    
+    // Finished renders arrive here (after the worker has handed them over)
+    void handleAsyncUpdate() override;
+    
+    // While auditioning: render again when the kit, mix or groove transform has changed
+    void timerCallback() override;
+    
+    // The cached entry for a key (moved to the most recent end), or nullptr
+    AuditionPtr findEntry(const Key& key);
+    void addEntry(AuditionPtr entry);
+    void dropStaleEntries();
+    
+    // Queue a render of wantedKey, superseding any that hasn't finished
+    void requestRender();
+    
+    // Swap in what the audio thread plays (nullptr = silence)
+    // restart: from the top; otherwise carry on at the same position
+    void play(AuditionPtr audition, bool restart);
+    
+    // The bounce itself (worker thread) - nullptr if superseded or there's no kit
+    std::unique_ptr<Audition> render(const Key& key, const GrooveManager::RenderTimeline& timeline,
+                                     double loopBeats, int requestId) const;
+    
+    bool isSuperseded(int requestId) const noexcept { return requestId != latestRequest.load(); }
+    
+    SoundFontManager& soundFontManager;
+    GrooveManager& grooveManager;
+    
+    // Message thread state
+    std::vector<AuditionPtr> entries;  // Least recently used first
+    Key wantedKey;
+    bool wanted = false;
+    AuditionPtr playingAudition;       // Keeps the audio thread's audition alive
+    
+    // Shared with the audio thread
+    std::atomic<const Audition*> activeAudition { nullptr };
+    std::atomic<bool> restartRequested { false };
+    std::atomic<bool> looping { true };
+    std::atomic<bool> playedOut { false };
+    AudioBlockFence fence;
+    
+    // Audio thread only
+    const Audition* lastAudition = nullptr;
+    int playPosition = 0;
+    bool hasWrapped = false;  // The previous pass's tail rings over this one's start
+    
+    // Handed from the worker to the message thread
+    CheckedCriticalSection finishedLock;
+    std::vector<AuditionPtr> finishedRenders;
+    
+    std::atomic<int> latestRequest { 0 };
+    
+    // Frames rendered per step
+    static constexpr int renderBlockSize = 512;
+    
+    // Declared last so the worker stops before anything it uses is destroyed
+    juce::ThreadPool renderPool { 1 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GroovePreviewCache)
+};
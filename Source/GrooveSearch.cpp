@@ -0,0 +1,349 @@
+/*
+    GrooveSearch.cpp
+    ================
+    
+    Implementation of the groove search index and the background search
+    (see GrooveSearch.h).
+*/
+
+#include "GrooveSearch.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+    bool isWordStart(const char* text, size_t position)
+    {
+        if (position == 0)
+            return true;
+        
+        const auto previous = static_cast<unsigned char>(text[position - 1]);
+        return !(std::isalnum(previous) || previous >= 0x80);
+    }
+    
+    // "4bars", "<4bar", ">2b" -> the number and its comparison, or false
+    bool parseBarsWord(const juce::String& word, char& comparison, float& bars)
+    {
+        auto text = word;
+        comparison = '=';
+        
+        if (text.startsWithChar('<') || text.startsWithChar('>'))
+        {
+            comparison = static_cast<char>(text[0]);
+            text = text.substring(1);
+        }
+        
+        for (auto* suffix : { "bars", "bar", "b" })
+        {
+            if (text.endsWith(suffix))
+            {
+                const auto number = text.dropLastCharacters(static_cast<int>(std::strlen(suffix)));
+                if (number.isEmpty() || !number.containsOnly("0123456789."))
+                    return false;
+                
+                bars = number.getFloatValue();
+                return bars > 0.0f;
+            }
+        }
+        
+        return false;
+    }
+}
+
+/*
+    QUERY PARSE
+    -----------
+    Splits the text into words; the ones that read as a filter set it,
+    the rest are matched against the names.
+*/
+GrooveSearchIndex::Query GrooveSearchIndex::Query::parse(const juce::String& text)
+{
+    Query query;
+    
+    for (const auto& token : juce::StringArray::fromTokens(text.toLowerCase(), " \t", "\""))
+    {
+        const auto word = token.trim();
+        if (word.isEmpty())
+            continue;
+        
+        // Time signature
+        if (word.containsChar('/'))
+        {
+            const auto top = word.upToFirstOccurrenceOf("/", false, false);
+            const auto bottom = word.fromFirstOccurrenceOf("/", false, false);
+            
+            if (top.containsOnly("0123456789") && bottom.containsOnly("0123456789")
+                && top.isNotEmpty() && bottom.isNotEmpty())
+            {
+                query.numerator = top.getIntValue();
+                query.denominator = bottom.getIntValue();
+                continue;
+            }
+        }
+        
+        // Length
+        char comparison = '=';
+        float bars = 0.0f;
+        if (parseBarsWord(word, comparison, bars))
+        {
+            if (comparison != '>')
+                query.maxBars = bars;
+            if (comparison != '<')
+                query.minBars = bars;
+            continue;
+        }
+        
+        // Density
+        if (word == "sparse")
+        {
+            query.density = Density::sparse;
+            continue;
+        }
+        if (word == "busy")
+        {
+            query.density = Density::busy;
+            continue;
+        }
+        
+        query.words.push_back(word.toStdString());
+    }
+    
+    return query;
+}
+
+std::shared_ptr<const GrooveSearchIndex> GrooveSearchIndex::build(const std::vector<GrooveCategory>& categories)
+{
+    auto index = std::make_shared<GrooveSearchIndex>();
+    
+    size_t numGrooves = 0;
+    for (const auto& category : categories)
+        numGrooves += category.grooves.size();
+    
+    index->entries.reserve(numGrooves);
+    index->names.reserve(numGrooves * 24);
+    index->categoryNames.reserve(categories.size());
+    
+    for (size_t categoryIndex = 0; categoryIndex < categories.size(); ++categoryIndex)
+    {
+        const auto& category = categories[categoryIndex];
+        const auto categoryId = static_cast<juce::uint32>(index->categoryNames.size());
+        index->categoryNames.push_back(category.name.toLowerCase().toStdString());
+        
+        for (size_t grooveIndex = 0; grooveIndex < category.grooves.size(); ++grooveIndex)
+        {
+            const auto& groove = category.grooves[grooveIndex];
+            const auto name = groove.name.toLowerCase().toStdString();
+            
+            Entry entry;
+            entry.categoryIndex = static_cast<int>(categoryIndex);
+            entry.grooveIndex = static_cast<int>(grooveIndex);
+            entry.nameStart = static_cast<juce::uint32>(index->names.size());
+            entry.nameLength = static_cast<juce::uint32>(name.size());
+            entry.categoryId = categoryId;
+            
+            if (groove.isLoaded && groove.lengthInBeats > 0.0 && groove.numerator > 0 && groove.denominator > 0)
+            {
+                const double beatsPerBar = groove.numerator * 4.0 / groove.denominator;
+                
+                entry.hasDetails = true;
+                entry.numerator = static_cast<juce::uint8>(juce::jlimit(1, 255, groove.numerator));
+                entry.denominator = static_cast<juce::uint8>(juce::jlimit(1, 255, groove.denominator));
+                entry.lengthInBars = static_cast<float>(groove.lengthInBeats / beatsPerBar);
+                entry.hitsPerBeat = static_cast<float>(groove.numNoteOns / groove.lengthInBeats);
+            }
+            
+            index->names += name;
+            index->entries.push_back(entry);
+        }
+    }
+    
+    return index;
+}
+
+/*
+    FUZZY SCORE
+    -----------
+    A word found as-is scores highest - more at the start of the text or
+    of a word in it, and the whole name more still. Otherwise its letters
+    must appear in order ("bsc" finds "basic"), with a bonus for runs of
+    letters and for letters that start a word. 0 = no match.
+*/
+int GrooveSearchIndex::fuzzyScore(const std::string& word, const char* text, size_t textLength)
+{
+    if (word.empty() || word.size() > textLength)
+        return 0;
+    
+    const auto* found = std::search(text, text + textLength, word.begin(), word.end());
+    if (found != text + textLength)
+    {
+        const auto position = static_cast<size_t>(found - text);
+        int score = 100 - static_cast<int>(juce::jmin(position, static_cast<size_t>(20)));
+        
+        if (position == 0)
+            score += 50;
+        else if (isWordStart(text, position))
+            score += 25;
+        
+        if (word.size() == textLength)
+            score += 50;
+        
+        return score;
+    }
+    
+    int score = 0;
+    size_t wordPosition = 0;
+    size_t lastMatch = textLength;
+    
+    for (size_t i = 0; i < textLength && wordPosition < word.size(); ++i)
+    {
+        if (text[i] != word[wordPosition])
+            continue;
+        
+        score += 1;
+        if (lastMatch != textLength && lastMatch + 1 == i)
+            score += 3;
+        if (isWordStart(text, i))
+            score += 5;
+        
+        lastMatch = i;
+        ++wordPosition;
+    }
+    
+    return wordPosition == word.size() ? juce::jlimit(1, 99, score) : 0;
+}
+
+bool GrooveSearchIndex::matchesFilters(const Entry& entry, const Query& query) const
+{
+    if (!query.hasFilters())
+        return true;
+    
+    if (!entry.hasDetails)
+        return false;
+    
+    if (query.numerator > 0 && (entry.numerator != query.numerator || entry.denominator != query.denominator))
+        return false;
+    
+    // A little slack: lengths come from MIDI ticks, not from whole bars
+    constexpr float tolerance = 0.05f;
+    if (query.minBars > 0.0f && entry.lengthInBars < query.minBars - tolerance)
+        return false;
+    if (query.maxBars > 0.0f && entry.lengthInBars > query.maxBars + tolerance)
+        return false;
+    
+    if (query.density == Query::Density::sparse && entry.hitsPerBeat >= sparseHitsPerBeat)
+        return false;
+    if (query.density == Query::Density::busy && entry.hitsPerBeat <= busyHitsPerBeat)
+        return false;
+    
+    return true;
+}
+
+std::vector<GrooveSearchIndex::Result> GrooveSearchIndex::search(const Query& query,
+                                                                 const std::function<bool()>& shouldStop) const
+{
+    std::vector<Result> results;
+    
+    if (query.isEmpty())
+        return results;
+    
+    constexpr size_t stopCheckInterval = 1024;
+    
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (shouldStop && (i % stopCheckInterval) == 0 && shouldStop())
+            return {};
+        
+        const auto& entry = entries[i];
+        if (!matchesFilters(entry, query))
+            continue;
+        
+        const char* name = names.data() + entry.nameStart;
+        const auto& category = categoryNames[entry.categoryId];
+        
+        int total = 0;
+        for (const auto& word : query.words)
+        {
+            // A hit in the category counts for less than one in the name
+            const int nameScore = fuzzyScore(word, name, entry.nameLength);
+            const int categoryScore = fuzzyScore(word, category.data(), category.size());
+            const int score = juce::jmax(nameScore, categoryScore > 0 ? juce::jmax(1, categoryScore / 2) : 0);
+            
+            if (score == 0)
+            {
+                total = 0;
+                break;
+            }
+            
+            total += score;
+        }
+        
+        // Filters alone: everything that passes, in library order
+        if (query.words.empty())
+            total = 1;
+        
+        if (total > 0)
+            results.push_back({ entry.categoryIndex, entry.grooveIndex, total });
+    }
+    
+    std::stable_sort(results.begin(), results.end(),
+                     [](const Result& a, const Result& b) { return a.score > b.score; });
+    
+    return results;
+}
+
+GrooveSearch::~GrooveSearch()
+{
+    cancelPendingUpdate();
+    
+    // Give up a search in progress and wait for the worker
+    ++latestRequest;
+    searchPool.removeAllJobs(true, 10000);
+}
+
+void GrooveSearch::search(std::shared_ptr<const GrooveSearchIndex> index, const juce::String& queryText)
+{
+    const int requestId = ++latestRequest;
+    
+    if (index == nullptr)
+        return;
+    
+    // Queued searches are all out of date now
+    searchPool.removeAllJobs(false, 0);
+    
+    searchPool.addJob([this, index = std::move(index), query = GrooveSearchIndex::Query::parse(queryText), requestId]()
+    {
+        auto results = index->search(query, [this, requestId]() { return isSuperseded(requestId); });
+        if (isSuperseded(requestId))
+            return;
+        
+        {
+            const CheckedCriticalSection::ScopedLockType sl(finishedLock);
+            finishedResults = std::move(results);
+            finishedRequest = requestId;
+        }
+        
+        triggerAsyncUpdate();
+    });
+}
+
+void GrooveSearch::cancel()
+{
+    ++latestRequest;
+}
+
+void GrooveSearch::handleAsyncUpdate()
+{
+    Results results;
+    int requestId = 0;
+    {
+        const CheckedCriticalSection::ScopedLockType sl(finishedLock);
+        results.swap(finishedResults);
+        requestId = finishedRequest;
+    }
+    
+    if (isSuperseded(requestId) || !onResults)
+        return;
+    
+    onResults(results);
+}
@@ -0,0 +1,170 @@
+/*
+    GrooveSearch.h
+    ==============
+    
+    Instant search over the groove library: by name and category (fuzzy),
+    time signature, length and density.
+    
+    THE INDEX
+    ---------
+    Searching the library itself would mean walking every category's
+    std::vector<Groove> - each groove a juce::File, a couple of
+    juce::Strings and its event list - and lower-casing names for every
+    keystroke. GrooveSearchIndex is built once from the library and
+    holds only what a search reads, packed together:
+    
+    - every groove name, lower-cased, back to back in one std::string
+    - each category name once (interned), referred to by number
+    - one small Entry per groove: its indices, where its name is, and
+      its time signature, length in bars and hits per beat
+    
+    The index is immutable, so it is shared (std::shared_ptr) with the
+    search thread and no lock is held while it is scanned. GrooveManager
+    builds it on first use and drops it when grooves are scanned or parsed
+    (see GrooveManager::getSearchIndex()).
+    
+    Grooves that haven't been parsed yet (not in the library index) have
+    no length, time signature or density: they are found by name, but
+    not by the filters.
+    
+    QUERIES
+    -------
+    Words are matched fuzzily against the groove and category names. A
+    few words are filters instead:
+    
+        6/8         time signature
+        4bars       length in bars (also <4bars, >2bars; "bar", "b")
+        sparse      under sparseHitsPerBeat hits per beat
+        busy        over busyHitsPerBeat hits per beat
+    
+    e.g. "funk 4/4 busy <8bars".
+    
+    GrooveSearch runs queries on a background thread; a query that
+    hasn't finished when the next keystroke arrives is given up, so
+    typing over a library of tens of thousands of grooves never waits.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "GrooveManager.h"
+#include "RealtimeSafety.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class GrooveSearchIndex
+{
+public:
+    struct Entry
+    {
+        int categoryIndex = -1;
+        int grooveIndex = -1;
+        juce::uint32 nameStart = 0;     // Into names
+        juce::uint32 nameLength = 0;
+        juce::uint32 categoryId = 0;    // Into categoryNames
+        
+        // Known once the groove has been parsed
+        bool hasDetails = false;
+        juce::uint8 numerator = 0;
+        juce::uint8 denominator = 0;
+        float lengthInBars = 0.0f;
+        float hitsPerBeat = 0.0f;
+    };
+    
+    struct Query
+    {
+        std::vector<std::string> words;  // Lower-cased, fuzzy matched
+        
+        int numerator = 0;               // 0 = any time signature
+        int denominator = 0;
+        float minBars = 0.0f;            // Inclusive; maxBars <= 0 = no upper limit
+        float maxBars = 0.0f;
+        
+        enum class Density { any, sparse, busy };
+        Density density = Density::any;
+        
+        bool hasFilters() const { return numerator > 0 || minBars > 0.0f || maxBars > 0.0f || density != Density::any; }
+        bool isEmpty() const { return words.empty() && !hasFilters(); }
+        
+        static Query parse(const juce::String& text);
+    };
+    
+    struct Result
+    {
+        int categoryIndex = -1;
+        int grooveIndex = -1;
+        int score = 0;
+    };
+    
+    // Index the library as it is now (caller holds whatever lock guards it)
+    static std::shared_ptr<const GrooveSearchIndex> build(const std::vector<GrooveCategory>& categories);
+    
+    /*
+        SEARCH
+        ------
+        Every groove that matches all the filters and all the words, best
+        match first (library order among equal scores). An empty query
+        matches nothing. shouldStop is asked now and then; once it says
+        yes, the search is abandoned and returns early.
+    */
+    std::vector<Result> search(const Query& query, const std::function<bool()>& shouldStop = {}) const;
+    
+    size_t size() const { return entries.size(); }
+    
+    static constexpr float sparseHitsPerBeat = 2.5f;
+    static constexpr float busyHitsPerBeat = 4.5f;
+
+private:
+    // 0 if the word doesn't occur in text (as a substring or a subsequence)
+    static int fuzzyScore(const std::string& word, const char* text, size_t textLength);
+    
+    bool matchesFilters(const Entry& entry, const Query& query) const;
+    
+    std::vector<Entry> entries;
+    std::string names;
+    std::vector<std::string> categoryNames;
+};
+
+/*
+    GROOVE SEARCH
+    -------------
+    Runs queries against an index on one background thread and hands the
+    results back on the message thread. Only the latest query's results
+    are ever delivered.
+*/
+class GrooveSearch : private juce::AsyncUpdater
+{
+public:
+    using Results = std::vector<GrooveSearchIndex::Result>;
+    
+    GrooveSearch() = default;
+    ~GrooveSearch() override;
+    
+    // Start a search (message thread); onResults follows once it has run
+    void search(std::shared_ptr<const GrooveSearchIndex> index, const juce::String& queryText);
+    
+    // Forget the search in progress - onResults won't be called for it
+    void cancel();
+    
+    // Called on the message thread with the latest query's results
+    std::function<void(const Results&)> onResults;
+
+private:
+    void handleAsyncUpdate() override;
+    
+    bool isSuperseded(int requestId) const noexcept { return requestId != latestRequest.load(); }
+    
+    std::atomic<int> latestRequest { 0 };
+    
+    // Results handed from the search thread to handleAsyncUpdate()
+    CheckedCriticalSection finishedLock;
+    Results finishedResults;
+    int finishedRequest = 0;
+    
+    juce::ThreadPool searchPool { 1 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrooveSearch)
+};
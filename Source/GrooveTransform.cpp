@@ -0,0 +1,121 @@
+/*
+    GrooveTransform.cpp
+    ===================
+    
+    Implementation of the groove transform's message-thread side: baking
+    it into an event list, comparing, and saving it with the project.
+*/
+
+#include "GrooveTransform.h"
+
+const juce::Identifier GrooveTransform::stateType { "GrooveTransform" };
+
+bool GrooveTransform::isIdentity() const noexcept
+{
+    if (swing > 0.0f || humanizeBeats > 0.0 || velocityHumanize > 0.0f || velocityCurve != 0.0f)
+        return false;
+    
+    for (size_t note = 0; note < noteMap.size(); ++note)
+        if (noteMap[note] != note)
+            return false;
+    
+    return true;
+}
+
+bool GrooveTransform::operator==(const GrooveTransform& other) const noexcept
+{
+    return swing == other.swing
+        && swingSubdivision == other.swingSubdivision
+        && humanizeBeats == other.humanizeBeats
+        && velocityHumanize == other.velocityHumanize
+        && velocityCurve == other.velocityCurve
+        && seed == other.seed
+        && noteMap == other.noteMap;
+}
+
+/*
+    APPLY TO
+    --------
+    For bounces and MIDI export: every event passed through apply(),
+    written back in compiled form and sorted again (humanize can swap
+    two neighbouring hits).
+*/
+GrooveEventList GrooveTransform::applyTo(const GrooveEventList& events, double patternLength) const
+{
+    GrooveEventList transformed;
+    transformed.reserve(events.size());
+    
+    const auto endTick = GrooveEventList::beatsToTicks(patternLength);
+    
+    for (size_t i = 0; i < events.size() && events.getTick(i) < endTick; ++i)
+    {
+        Event event;
+        if (!apply(events, i, patternLength, event))
+            continue;
+        
+        const int channel = events.getChannel(i);
+        const auto message = event.isNoteOn
+                           ? juce::MidiMessage::noteOn(channel, event.note, event.velocity)
+                           : juce::MidiMessage::noteOff(channel, event.note, static_cast<juce::uint8>(events.getVelocity(i)));
+        
+        transformed.addMessage(event.beat, message);
+    }
+    
+    transformed.sortByTime();
+    return transformed;
+}
+
+/*
+    STATE
+    -----
+    Only the note map entries that differ from "as played" are written,
+    as "from:to" pairs (to = -1 for muted).
+*/
+juce::ValueTree GrooveTransform::toValueTree() const
+{
+    juce::ValueTree tree(stateType);
+    tree.setProperty("swing", swing, nullptr);
+    tree.setProperty("swingSubdivision", swingSubdivision, nullptr);
+    tree.setProperty("humanizeBeats", humanizeBeats, nullptr);
+    tree.setProperty("velocityHumanize", velocityHumanize, nullptr);
+    tree.setProperty("velocityCurve", velocityCurve, nullptr);
+    tree.setProperty("seed", static_cast<juce::int64>(seed), nullptr);
+    
+    juce::StringArray mappings;
+    for (size_t note = 0; note < noteMap.size(); ++note)
+    {
+        if (noteMap[note] != note)
+            mappings.add(juce::String(static_cast<int>(note)) + ":"
+                         + juce::String(noteMap[note] == mutedNote ? -1 : static_cast<int>(noteMap[note])));
+    }
+    
+    tree.setProperty("noteMap", mappings.joinIntoString(","), nullptr);
+    return tree;
+}
+
+GrooveTransform GrooveTransform::fromValueTree(const juce::ValueTree& tree)
+{
+    GrooveTransform transform;
+    
+    if (!tree.hasType(stateType))
+        return transform;
+    
+    transform.swing = juce::jlimit(0.0f, 1.0f, static_cast<float>(tree.getProperty("swing", 0.0f)));
+    transform.swingSubdivision = static_cast<int>(tree.getProperty("swingSubdivision", 8)) >= 16 ? 16 : 8;
+    transform.humanizeBeats = juce::jlimit(0.0, 0.25, static_cast<double>(tree.getProperty("humanizeBeats", 0.0)));
+    transform.velocityHumanize = juce::jlimit(0.0f, 1.0f, static_cast<float>(tree.getProperty("velocityHumanize", 0.0f)));
+    transform.velocityCurve = juce::jlimit(-1.0f, 1.0f, static_cast<float>(tree.getProperty("velocityCurve", 0.0f)));
+    transform.seed = static_cast<juce::uint32>(static_cast<juce::int64>(tree.getProperty("seed", 1)));
+    
+    juce::StringArray mappings;
+    mappings.addTokens(tree.getProperty("noteMap", "").toString(), ",", "");
+    
+    for (const auto& mapping : mappings)
+    {
+        if (mapping.containsChar(':'))
+            transform.setNoteMapping(mapping.upToFirstOccurrenceOf(":", false, false).getIntValue(),
+                                     mapping.fromFirstOccurrenceOf(":", false, false).getIntValue());
+    }
+    
+    return transform;
+}
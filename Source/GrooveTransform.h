@@ -0,0 +1,190 @@
+/*
+    GrooveTransform.h
+    =================
+    
+    Non-destructive variations of a groove: swing, timing and velocity
+    humanize, a velocity curve, and muting or replacing instruments.
+    
+    APPLIED AT SCHEDULE TIME
+    ------------------------
+    Nothing is rewritten: the compiled events stay exactly as they were
+    loaded, and GrooveManager::processBlock() passes each event through
+    apply() as it is emitted. Changing the swing or trying another seed
+    costs no parsing, no copy of the groove and no memory per variation
+    - a variation IS its handful of settings.
+    
+    Bounces and the composition's MIDI export go through the same apply()
+    (see applyTo()), so what is rendered is what was heard.
+    
+    SEEDED HUMANIZE
+    ---------------
+    The random offsets are not drawn from a generator that runs along
+    with playback; they are a hash of the seed, the event's tick and its
+    note. So every pass of a loop, every bounce and every reload of the
+    project plays exactly the same take, and another seed is another take.
+    
+    TIMING
+    ------
+    Swing warps time within each pair of grid steps (8ths or 16ths): the
+    off-beat moves later, by up to a third of a step at full swing - the
+    triplet feel - and everything in between moves in proportion, so
+    swing never changes the order of hits. Humanize then moves each hit
+    up to humanizeBeats early or late. Note offs only ever move later
+    (by the most a note on can), so a note never ends before it starts.
+    Nothing moves outside the pattern: hits are kept within
+    [0, patternLength).
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "GrooveEvents.h"
+#include <array>
+#include <cmath>
+
+struct GrooveTransform
+{
+    GrooveTransform() { resetNoteMap(); }
+    
+    // ===== SETTINGS =====
+    
+    float swing = 0.0f;                 // 0 = straight, 1 = full triplet swing
+    int swingSubdivision = 8;           // 8 = swing 8th notes, 16 = swing 16ths
+    
+    double humanizeBeats = 0.0;         // Up to this far early or late (0.02 is ~10 ms at 120 BPM)
+    float velocityHumanize = 0.0f;      // Up to this fraction louder or softer (0 to 1)
+    float velocityCurve = 0.0f;         // -1 (softer) to 1 (harder), 0 = as played
+    juce::uint32 seed = 1;              // Which take the humanize plays
+    
+    // What each note plays as (mutedNote = not at all)
+    static constexpr juce::uint8 mutedNote = 0xff;
+    std::array<juce::uint8, 128> noteMap {};
+    
+    void resetNoteMap() noexcept
+    {
+        for (size_t note = 0; note < noteMap.size(); ++note)
+            noteMap[note] = static_cast<juce::uint8>(note);
+    }
+    
+    void muteNote(int note) noexcept { setNoteMapping(note, -1); }
+    void replaceNote(int note, int replacement) noexcept { setNoteMapping(note, replacement); }
+    
+    // replacement < 0 mutes the note
+    void setNoteMapping(int note, int replacement) noexcept
+    {
+        if (note >= 0 && note < 128)
+            noteMap[static_cast<size_t>(note)] = replacement < 0 ? mutedNote : static_cast<juce::uint8>(replacement & 0x7f);
+    }
+    
+    // True if apply() would leave every event as it is
+    bool isIdentity() const noexcept;
+    
+    bool operator==(const GrooveTransform& other) const noexcept;
+    bool operator!=(const GrooveTransform& other) const noexcept { return !(*this == other); }
+    
+    // The furthest any event (on or off) can move from its tick, in beats
+    double getMaxShiftBeats() const noexcept
+    {
+        return getSwingShiftBeats() + 2.0 * juce::jmax(0.0, humanizeBeats);
+    }
+    
+    // ===== APPLYING =====
+    
+    struct Event
+    {
+        double beat = 0.0;
+        int note = 0;
+        float velocity = 0.0f;  // 0 for a note off
+        bool isNoteOn = false;
+    };
+    
+    /*
+        APPLY
+        -----
+        The transformed event at index - or false if its note is muted.
+        Pure and allocation-free: safe on the audio thread.
+    */
+    bool apply(const GrooveEventList& events, size_t index, double patternLength, Event& out) const noexcept
+    {
+        const int sourceNote = events.getNote(index);
+        const auto mapped = noteMap[static_cast<size_t>(sourceNote & 0x7f)];
+        if (mapped == mutedNote)
+            return false;
+        
+        const auto tick = events.getTick(index);
+        double beat = applySwing(events.getBeat(index));
+        
+        out.note = mapped;
+        out.isNoteOn = events.isNoteOn(index);
+        
+        if (out.isNoteOn)
+        {
+            beat += humanizeBeats * getRandom(tick, sourceNote, 0);
+            out.velocity = applyVelocity(events.getFloatVelocity(index), getRandom(tick, sourceNote, 1));
+        }
+        else
+        {
+            beat += 2.0 * humanizeBeats;  // Never before its note on (see TIMING)
+            out.velocity = 0.0f;
+        }
+        
+        // Kept inside the pattern, so loops and cut items never lose a hit
+        const double lastBeat = juce::jmax(0.0, patternLength - 1.0 / GrooveEventList::ticksPerBeat);
+        out.beat = juce::jlimit(0.0, lastBeat, beat);
+        return true;
+    }
+    
+    // The events of [0, patternLength) with the transform baked in, sorted (message thread)
+    GrooveEventList applyTo(const GrooveEventList& events, double patternLength) const;
+    
+    // ===== STATE =====
+    
+    juce::ValueTree toValueTree() const;
+    static GrooveTransform fromValueTree(const juce::ValueTree& tree);
+    
+    static const juce::Identifier stateType;
+
+private:
+    double getStepBeats() const noexcept { return swingSubdivision >= 16 ? 0.25 : 0.5; }
+    double getSwingShiftBeats() const noexcept { return juce::jlimit(0.0f, 1.0f, swing) * getStepBeats() / 3.0; }
+    
+    // Piecewise-linear warp of each pair of grid steps (see TIMING)
+    double applySwing(double beat) const noexcept
+    {
+        const double shift = getSwingShiftBeats();
+        if (shift <= 0.0)
+            return beat;
+        
+        const double step = getStepBeats();
+        const double pairStart = std::floor(beat / (2.0 * step)) * 2.0 * step;
+        const double inPair = beat - pairStart;
+        
+        if (inPair < step)
+            return pairStart + inPair * (step + shift) / step;
+        
+        return pairStart + step + shift + (inPair - step) * (step - shift) / step;
+    }
+    
+    float applyVelocity(float velocity, float random) const noexcept
+    {
+        if (velocityCurve != 0.0f)
+            velocity = std::pow(velocity, std::pow(4.0f, -juce::jlimit(-1.0f, 1.0f, velocityCurve)));
+        
+        velocity *= 1.0f + velocityHumanize * random;
+        return juce::jlimit(1.0f / 127.0f, 1.0f, velocity);
+    }
+    
+    // -1 to 1, the same for the same seed, tick, note and purpose
+    float getRandom(juce::uint32 tick, int note, juce::uint32 purpose) const noexcept
+    {
+        juce::uint32 x = seed * 0x9E3779B1u ^ tick * 0x85EBCA77u ^ static_cast<juce::uint32>(note) * 0xC2B2AE3Du
+                       ^ purpose * 0x27D4EB2Fu;
+        x ^= x >> 16;
+        x *= 0x7FEB352Du;
+        x ^= x >> 15;
+        x *= 0x846CA68Bu;
+        x ^= x >> 16;
+        
+        return static_cast<float>(x & 0xFFFFFFu) / static_cast<float>(0xFFFFFFu) * 2.0f - 1.0f;
+    }
+};
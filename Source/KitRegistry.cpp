@@ -0,0 +1,269 @@
+/*
+    KitRegistry.cpp
+    ===============
+    
+    Implementation of the process-wide kit registry (see KitRegistry.h).
+*/
+
+#include "KitRegistry.h"
+#include "Resampler.h"
+#include "tsf.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+/*
+    DESTRUCTOR
+    ----------
+    The last instance has gone, and took its engines with it - the
+    registry holds the only reference left on each pool.
+*/
+KitRegistry::~KitRegistry()
+{
+    for (auto& kit : kits)
+    {
+        if (kit.pool != nullptr)
+            tsf_close(kit.pool);
+    }
+}
+
+/*
+    OPEN POOL
+    ---------
+    1. A loaded kit with the same file, date and rate: copy its pool
+    2. Another instance is parsing it right now: wait for it, look again
+    3. Nobody has it: leave a placeholder (so others wait for us), parse
+       it without the lock, then fill the placeholder in
+*/
+tsf* KitRegistry::openPool(const juce::File& kitFile, double sampleRate)
+{
+    const auto lastModified = kitFile.getLastModificationTime();
+    const double convertedRate = juce::jmax(0.0, sampleRate);
+    std::shared_ptr<juce::WaitableEvent> parsed;
+    
+    for (;;)
+    {
+        std::shared_ptr<juce::WaitableEvent> parsing;
+        {
+            const CheckedCriticalSection::ScopedLockType sl(referenceLock);
+            
+            auto it = std::find_if(kits.begin(), kits.end(), [&](const Kit& kit)
+            {
+                return kit.file == kitFile && kit.lastModified == lastModified
+                    && (sampleRate < 0.0 || kit.sampleRate == convertedRate);
+            });
+            
+            if (it == kits.end())
+            {
+                parsed = std::make_shared<juce::WaitableEvent>(true);
+                kits.insert(kits.begin(), { kitFile, lastModified, convertedRate, nullptr, parsed });
+                break;
+            }
+            
+            if (it->pool != nullptr)
+            {
+                // Move to the front (most recently used)
+                std::rotate(kits.begin(), it, it + 1);
+                return tsf_copy(kits.front().pool);
+            }
+            
+            parsing = it->parsed;
+        }
+        
+        parsing->wait();
+    }
+    
+    // Parse the SF2 file once - every instance shares this sample data
+    tsf* pool = loadPool(kitFile);
+    
+    if (pool == nullptr)
+        DBG("Failed to load soundfont: " + kitFile.getFullPathName());
+    
+    // Still the only reference, so the sample data can grow
+    if (pool != nullptr && convertedRate > 0.0 && !convertToSampleRate(pool, convertedRate))
+        DBG("Out of memory converting samples - some notes will be resampled while playing");
+    
+    tsf* reference = nullptr;
+    {
+        const CheckedCriticalSection::ScopedLockType sl(referenceLock);
+        
+        auto it = std::find_if(kits.begin(), kits.end(), [&](const Kit& kit) { return kit.parsed == parsed; });
+        jassert(it != kits.end());
+        
+        if (pool != nullptr)
+        {
+            it->pool = pool;
+            reference = tsf_copy(pool);
+        }
+        else
+        {
+            kits.erase(it);
+        }
+        
+        parsed->signal();
+        closeUnusedPools();
+    }
+    
+    return reference;
+}
+
+/*
+    CLOSE UNUSED POOLS
+    ------------------
+    A pool with a reference count of 1 only has the registry's own
+    reference left - no engine in any instance is using it.
+*/
+void KitRegistry::closeUnusedPools()
+{
+    int numUnused = 0;
+    
+    for (auto it = kits.begin(); it != kits.end();)
+    {
+        if (it->pool != nullptr && tsf_get_refcount(it->pool) <= 1 && ++numUnused > maxUnusedKits)
+        {
+            tsf_close(it->pool);
+            it = kits.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/*
+    LOAD POOL - Loader thread
+    -------------------------
+    The file is memory-mapped rather than read into memory: TSF parses
+    the preset tables straight from the mapping and converts only the
+    samples the drum preset plays, so those are the only pages the OS
+    ever loads - a General MIDI bank's other presets are never touched,
+    and don't take up memory in the pool either. The mapping is closed
+    as soon as the pool has its own float copy.
+    
+    Files that can't be mapped (or SF3s, which are decoded whole) are
+    loaded the ordinary way.
+*/
+tsf* KitRegistry::loadPool(const juce::File& kitFile)
+{
+    {
+        const juce::MemoryMappedFile mappedFile(kitFile, juce::MemoryMappedFile::readOnly);
+        
+        if (mappedFile.getData() != nullptr
+            && mappedFile.getSize() <= static_cast<size_t>(std::numeric_limits<int>::max()))
+        {
+            if (tsf* pool = tsf_load_memory_preset(mappedFile.getData(), static_cast<int>(mappedFile.getSize()),
+                                                   drumPresetIndex))
+                return pool;
+        }
+    }
+    
+    return tsf_load_filename(kitFile.getFullPathName().toRawUTF8());
+}
+
+/*
+    CONVERT TO SAMPLE RATE - Loader thread
+    --------------------------------------
+    Each distinct sample span a drum note plays is converted once (kits
+    reuse one sample across several regions) and appended to the pool's
+    sample data; the regions are pointed at the copy at the new rate,
+    with their loop points scaled to match. Regions outside the GM drum
+    range, or already at the rate, are left as they are.
+    
+    The rate is rounded to whole Hz - TSF keeps sample rates as integers,
+    and an exact match is what lets a root-pitch hit skip interpolation.
+*/
+bool KitRegistry::convertToSampleRate(tsf* pool, double sampleRate)
+{
+    constexpr int presetIndex = drumPresetIndex;
+    constexpr int firstDrumNote = 35;
+    constexpr int lastDrumNote = 81;
+    
+    const auto targetRate = static_cast<unsigned int>(std::lround(sampleRate));
+    if (targetRate == 0)
+        return false;
+    
+    struct ConvertedSpan
+    {
+        unsigned int offset, end, sampleRate;  // In the file's samples
+        unsigned int newOffset, newEnd;        // The converted copy
+    };
+    std::vector<ConvertedSpan> convertedSpans;
+    
+    // One resampler per source rate - building the tables is the expensive part
+    std::map<unsigned int, std::unique_ptr<Resampler>> resamplers;
+    std::vector<float> converted;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    const int numRegions = tsf_get_regioncount(pool, presetIndex);
+    
+    for (int regionIndex = 0; regionIndex < numRegions; ++regionIndex)
+    {
+        tsf_region_sample region;
+        if (!tsf_region_get_sample(pool, presetIndex, regionIndex, &region))
+            continue;
+        
+        if (region.hikey < firstDrumNote || region.lokey > lastDrumNote
+            || region.sample_rate == targetRate || region.end <= region.offset)
+            continue;
+        
+        auto span = std::find_if(convertedSpans.begin(), convertedSpans.end(), [&](const ConvertedSpan& s)
+        {
+            return s.offset == region.offset && s.end == region.end && s.sampleRate == region.sample_rate;
+        });
+        
+        if (span == convertedSpans.end())
+        {
+            auto& resampler = resamplers[region.sample_rate];
+            if (resampler == nullptr)
+                resampler = std::make_unique<Resampler>(static_cast<double>(region.sample_rate),
+                                                        static_cast<double>(targetRate));
+            
+            // The span on its own - silence either side, not the neighbouring samples
+            const juce::int64 length = region.end - region.offset;
+            const float* samples = tsf_get_samples(pool, nullptr) + region.offset;  // Moves when samples are appended
+            
+            converted.resize(static_cast<size_t>(resampler->getOutputLength(length)));
+            resampler->convert([samples, length](float* dest, juce::int64 start, int numSamples)
+            {
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const juce::int64 index = start + i;
+                    dest[i] = (index >= 0 && index < length) ? samples[index] : 0.0f;
+                }
+            }, length, converted.data());
+            
+            unsigned int newOffset = 0;
+            if (!tsf_append_samples(pool, converted.data(), static_cast<unsigned int>(converted.size()), &newOffset))
+                return false;
+            
+            span = convertedSpans.insert(convertedSpans.end(),
+                                         { region.offset, region.end, region.sample_rate,
+                                           newOffset, newOffset + static_cast<unsigned int>(converted.size()) });
+        }
+        
+        // Same place in the converted copy (loop points too - they're within the span)
+        const double scale = static_cast<double>(targetRate) / static_cast<double>(region.sample_rate);
+        auto toConverted = [&](unsigned int position)
+        {
+            const auto fromStart = static_cast<double>(juce::jlimit(region.offset, region.end, position) - region.offset);
+            const auto newPosition = span->newOffset + static_cast<unsigned int>(std::lround(fromStart * scale));
+            return juce::jmin(span->newEnd, newPosition);
+        };
+        
+        tsf_region_sample newRegion = region;
+        newRegion.offset = span->newOffset;
+        newRegion.end = span->newEnd;
+        newRegion.loop_start = toConverted(region.loop_start);
+        newRegion.loop_end = toConverted(region.loop_end);
+        newRegion.sample_rate = targetRate;
+        tsf_region_set_sample(pool, presetIndex, regionIndex, &newRegion);
+    }
+    
+    DBG("Converted " + juce::String(static_cast<int>(convertedSpans.size())) + " samples to "
+        + juce::String(static_cast<int>(targetRate)) + " Hz in "
+        + juce::String(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks), 2) + " s");
+    
+    return true;
+}
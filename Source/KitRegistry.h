@@ -0,0 +1,100 @@
+/*
+    KitRegistry.h
+    =============
+    
+    Parsed kits shared by every jdrummer instance in the process.
+    
+    WHY?
+    ----
+    A DAW template easily has 8-12 jdrummer instances, often several on
+    the same kit. If each one parsed its own copy of the SF2, memory and
+    load time would grow with the number of INSTANCES; with the registry
+    they grow with the number of distinct KITS.
+    
+    HOW IT WORKS
+    ------------
+    There is one registry per process: every SoundFontManager holds a
+    juce::SharedResourcePointer to it, so it is created with the first
+    instance and deleted with the last. A kit is keyed by its file, the
+    file's modification time and the rate its drum samples were converted
+    to (see HOST-RATE SAMPLES in SoundFontManager.h).
+    
+    openPool() hands out a tsf_copy() of the registry's parsed pool. The
+    presets and samples behind it never change once parsed, so any
+    number of instances can render from them at once; voices and
+    channels belong to each copy.
+    
+    Pools no engine uses any more are kept for the few most recently
+    used kits, so switching back to one is still instant.
+    
+    THREADING
+    ---------
+    TSF's reference count is a plain int shared by a pool and every copy
+    of it - in every instance. So EVERY tsf_copy()/tsf_close() of a pool
+    from the registry happens with getReferenceLock() held. That's only
+    ever on loader threads (or in destructors), never the audio thread.
+    
+    Parsing happens outside the lock, so instances loading different
+    kits don't wait for each other; two loading the same kit at once
+    share the one parse.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "RealtimeSafety.h"
+#include <memory>
+#include <vector>
+
+// Forward declaration - tsf is defined in tsf.h
+struct tsf;
+
+class KitRegistry
+{
+public:
+    KitRegistry() = default;
+    ~KitRegistry();
+    
+    // The preset every instance plays - the only one whose samples are loaded
+    static constexpr int drumPresetIndex = 0;
+    
+    /*
+        OPEN POOL
+        ---------
+        A new reference on the shared pool for a kit file, parsing it if
+        no instance has it yet (nullptr if it can't be loaded). Blocks the
+        calling thread while the kit is parsed - loader threads only.
+        sampleRate: the rate to convert the drum samples to
+                    (0 = the file's own, -1 = whichever is already loaded)
+        Close the reference with tsf_close(), holding getReferenceLock().
+    */
+    tsf* openPool(const juce::File& kitFile, double sampleRate);
+    
+    // Hold this around every tsf_copy()/tsf_close() of a pool from openPool()
+    CheckedCriticalSection& getReferenceLock() noexcept { return referenceLock; }
+
+private:
+    // Parse a kit file from a memory mapping, keeping only the drum preset's samples
+    static tsf* loadPool(const juce::File& kitFile);
+    
+    // Convert the drum notes' samples in a freshly parsed pool (before any tsf_copy)
+    static bool convertToSampleRate(tsf* pool, double sampleRate);
+    
+    // Close pools nobody uses, beyond the most recently used few (lock held)
+    void closeUnusedPools();
+    
+    struct Kit
+    {
+        juce::File file;
+        juce::Time lastModified;
+        double sampleRate = 0.0;   // Rate the drum samples were converted to (0 = as in the file)
+        tsf* pool = nullptr;       // nullptr while it is being parsed
+        std::shared_ptr<juce::WaitableEvent> parsed;  // Signalled once that's done (either way)
+    };
+    std::vector<Kit> kits;  // Most recently used first (protected by referenceLock)
+    static constexpr int maxUnusedKits = 3;
+    
+    CheckedCriticalSection referenceLock;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KitRegistry)
+};
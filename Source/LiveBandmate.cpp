@@ -0,0 +1,211 @@
+/*
+    LiveBandmate.cpp
+    ================
+    
+    Implementation of live-input groove matching.
+*/
+
+#include "LiveBandmate.h"
+#include "MiniBpm.h"
+#include <cmath>
+#include <cstring>
+
+LiveBandmate::LiveBandmate(GrooveManager& manager)
+    : juce::Thread("Live Bandmate"),
+      grooveManager(manager)
+{
+    workerChunk.resize(static_cast<size_t>(workerChunkSize));
+}
+
+LiveBandmate::~LiveBandmate()
+{
+    cancelPendingUpdate();
+    stopThread(2000);
+}
+
+void LiveBandmate::prepare(double newSampleRate)
+{
+    // The worker reads the ring - it must not run while the ring changes
+    stopThread(2000);
+    
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    windowLengthSamples = static_cast<juce::int64>(analysisWindowSeconds * sampleRate);
+    
+    const int ringSize = static_cast<int>(ringSeconds * sampleRate);
+    ring.assign(static_cast<size_t>(ringSize), 0.0f);
+    fifo.setTotalSize(ringSize);
+    numDroppedBlocks = 0;
+    
+    if (enabled)
+        startThread(juce::Thread::Priority::low);
+}
+
+void LiveBandmate::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == enabled.load())
+        return;
+    
+    if (!shouldBeEnabled)
+    {
+        enabled = false;
+        stopThread(2000);
+        return;
+    }
+    
+    {
+        const juce::ScopedLock sl(resultLock);
+        latestResult = Result { 0.0, 0, {}, latestResult.serial };
+    }
+    
+    enabled = true;
+    
+    if (!ring.empty())
+        startThread(juce::Thread::Priority::low);
+}
+
+void LiveBandmate::pushAudio(const float* samples, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    
+    // Never wait for the worker - a partial block would leave a gap in the
+    // middle of the window anyway, so drop the whole block
+    if (size1 + size2 < numSamples)
+    {
+        ++numDroppedBlocks;
+        return;
+    }
+    
+    std::memcpy(ring.data() + start1, samples, sizeof(float) * static_cast<size_t>(size1));
+    if (size2 > 0)
+        std::memcpy(ring.data() + start2, samples + size1, sizeof(float) * static_cast<size_t>(size2));
+    
+    fifo.finishedWrite(size1 + size2);
+}
+
+LiveBandmate::Result LiveBandmate::getLatestResult() const
+{
+    const juce::ScopedLock sl(resultLock);
+    return latestResult;
+}
+
+void LiveBandmate::run()
+{
+    // Whatever is still in the ring is from before live mode started (only
+    // the reader may discard it - the audio thread could be writing)
+    fifo.finishedRead(fifo.getNumReady());
+    
+    // Fresh windows for every run; the second starts half a window later
+    for (auto& window : windows)
+        resetWindow(window);
+    
+    windows[1].samplesToSkip = windowLengthSamples / 2;
+    
+    while (!threadShouldExit())
+    {
+        // Polling (rather than being woken) keeps pushAudio() down to the copy
+        wait(pollIntervalMs);
+        
+        while (!threadShouldExit() && fifo.getNumReady() > 0)
+        {
+            int start1, size1, start2, size2;
+            fifo.prepareToRead(workerChunkSize, start1, size1, start2, size2);
+            
+            std::memcpy(workerChunk.data(), ring.data() + start1, sizeof(float) * static_cast<size_t>(size1));
+            if (size2 > 0)
+                std::memcpy(workerChunk.data() + size1, ring.data() + start2, sizeof(float) * static_cast<size_t>(size2));
+            
+            const int numRead = size1 + size2;
+            fifo.finishedRead(numRead);
+            
+            for (auto& window : windows)
+                feedWindow(window, workerChunk.data(), numRead);
+        }
+    }
+}
+
+void LiveBandmate::resetWindow(AnalysisWindow& window)
+{
+    if (window.tempoTracker == nullptr)
+    {
+        // Same range as the offline analysis (see AudioAnalyzer::analyzeAudio)
+        window.tempoTracker = std::make_unique<breakfastquay::MiniBPM>(static_cast<float>(sampleRate));
+        window.tempoTracker->setBPMRange(55.0, 190.0);
+    }
+    else
+    {
+        window.tempoTracker->reset();
+    }
+    
+    window.onsetDetector = std::make_unique<OnsetDetector>(matcher.getOnsetFunction(), windowSize, hopSize, workerChunkSize);
+    window.onsetDetector->reserveForLength(windowLengthSamples);
+    window.numSamples = 0;
+    window.samplesToSkip = 0;
+}
+
+void LiveBandmate::feedWindow(AnalysisWindow& window, const float* samples, int numSamples)
+{
+    const int numToSkip = static_cast<int>(juce::jmin(static_cast<juce::int64>(numSamples), window.samplesToSkip));
+    window.samplesToSkip -= numToSkip;
+    samples += numToSkip;
+    numSamples -= numToSkip;
+    
+    while (numSamples > 0)
+    {
+        const int numToProcess = static_cast<int>(juce::jmin(static_cast<juce::int64>(numSamples),
+                                                             windowLengthSamples - window.numSamples));
+        
+        window.tempoTracker->process(samples, numToProcess);
+        window.onsetDetector->process(samples, numToProcess);
+        window.numSamples += numToProcess;
+        samples += numToProcess;
+        numSamples -= numToProcess;
+        
+        if (window.numSamples >= windowLengthSamples)
+        {
+            analyzeWindow(window);
+            resetWindow(window);
+        }
+    }
+}
+
+void LiveBandmate::analyzeWindow(AnalysisWindow& window)
+{
+    const double bpm = window.tempoTracker->estimateTempo();
+    if (bpm <= 0)
+        return;
+    
+    const auto onsets = window.onsetDetector->findOnsets(sampleRate);
+    if (static_cast<int>(onsets.size()) < minOnsetsPerWindow)
+        return;
+    
+    // Same conversion as the offline analysis: the window's start is beat 0
+    const double beatsPerSecond = bpm / 60.0;
+    
+    RhythmPattern pattern;
+    pattern.bpm = bpm;
+    pattern.lengthInBeats = analysisWindowSeconds * beatsPerSecond;
+    pattern.onsetTimesBeats.reserve(onsets.size());
+    
+    for (double onsetTime : onsets)
+        pattern.onsetTimesBeats.push_back(onsetTime * beatsPerSecond);
+    
+    matcher.setDetectedPattern(pattern);
+    auto matches = matcher.findMatchingGrooves(grooveManager, maxMatches);
+    
+    {
+        const juce::ScopedLock sl(resultLock);
+        latestResult.bpm = bpm;
+        latestResult.numOnsets = static_cast<int>(onsets.size());
+        latestResult.matches = std::move(matches);
+        ++latestResult.serial;
+    }
+    
+    triggerAsyncUpdate();
+}
+
+void LiveBandmate::handleAsyncUpdate()
+{
+    if (onResultChanged)
+        onResultChanged();
+}
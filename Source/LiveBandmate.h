@@ -0,0 +1,144 @@
+/*
+    LiveBandmate.h
+    ==============
+    
+    The "live" side of the Bandmate feature: instead of analyzing a clip
+    that was dropped in, it listens to the plugin's sidechain input while
+    the band plays, and keeps the list of matching grooves up to date.
+    
+    THREADING
+    ---------
+    - Audio thread: pushAudio() copies the block's sidechain samples into
+      a preallocated ring buffer (juce::AbstractFifo) - one memcpy, no
+      locks, no allocation, no signalling. If the worker has fallen behind
+      and the ring is full, the block is dropped (and counted).
+    - Worker thread (low priority): drains the ring and does all the real
+      work - tempo tracking (MiniBPM::process), onset detection and groove
+      matching.
+    - Message thread: enabling/disabling, and reading the latest result
+      when onResultChanged fires.
+    
+    SLIDING ANALYSIS
+    ----------------
+    MiniBPM and the OnsetDetector accumulate everything they are fed, so
+    the worker runs two of each over windows of analysisWindowSeconds,
+    started half a window apart. Every time one of them fills up, its
+    tempo and onsets are matched against the library and it starts over -
+    so the match list reflects the last few bars and refreshes twice per
+    window, however long the band keeps playing.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "AudioAnalyzer.h"
+#include "GrooveManager.h"
+#include "OnsetDetector.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace breakfastquay { class MiniBPM; }
+
+class LiveBandmate : private juce::Thread,
+                     private juce::AsyncUpdater
+{
+public:
+    explicit LiveBandmate(GrooveManager& grooveManager);
+    ~LiveBandmate() override;
+    
+    // Size the ring for the host's sample rate (from prepareToPlay - never
+    // concurrent with pushAudio). Restarts the worker if live mode is on.
+    void prepare(double sampleRate);
+    
+    // Start/stop listening (message thread)
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+    
+    // Audio thread: hand over this block's sidechain samples (one memcpy)
+    void pushAudio(const float* samples, int numSamples) noexcept;
+    
+    // Blocks dropped because the ring was full (since the last prepare())
+    int getNumDroppedBlocks() const noexcept { return numDroppedBlocks.load(); }
+    
+    /*
+        LIVE RESULT
+        -----------
+        What the last completed window found. serial goes up by one with
+        every new result, so the UI can tell when the list has changed.
+    */
+    struct Result
+    {
+        double bpm = 0.0;
+        int numOnsets = 0;
+        std::vector<GrooveMatch> matches;
+        juce::uint32 serial = 0;
+    };
+    
+    // Copy of the latest result (message thread)
+    Result getLatestResult() const;
+    
+    // Called on the message thread whenever a new result is available
+    std::function<void()> onResultChanged;
+    
+    // How much of the live input each analysis looks at
+    static constexpr double analysisWindowSeconds = 8.0;
+    
+    // How many matches each result keeps
+    static constexpr int maxMatches = 15;
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+    
+    // One of the two staggered analyses
+    struct AnalysisWindow
+    {
+        std::unique_ptr<breakfastquay::MiniBPM> tempoTracker;
+        std::unique_ptr<OnsetDetector> onsetDetector;
+        juce::int64 numSamples = 0;
+        juce::int64 samplesToSkip = 0;  // Stagger: input to ignore before this window starts
+    };
+    
+    void resetWindow(AnalysisWindow& window);
+    void feedWindow(AnalysisWindow& window, const float* samples, int numSamples);
+    void analyzeWindow(AnalysisWindow& window);
+    
+    GrooveManager& grooveManager;
+    
+    // Only used for matching (see AudioAnalyzer::setDetectedPattern) - worker thread
+    AudioAnalyzer matcher;
+    
+    // Audio thread -> worker (sized by prepare())
+    juce::AbstractFifo fifo { 1 };
+    std::vector<float> ring;
+    std::atomic<int> numDroppedBlocks { 0 };
+    
+    std::atomic<bool> enabled { false };
+    double sampleRate = 44100.0;
+    juce::int64 windowLengthSamples = 0;
+    
+    // Worker thread state
+    std::array<AnalysisWindow, 2> windows;
+    std::vector<float> workerChunk;
+    
+    // Latest result, handed from the worker to the message thread
+    mutable juce::CriticalSection resultLock;
+    Result latestResult;
+    
+    // Ring capacity, and how much the worker drains per step
+    static constexpr double ringSeconds = 4.0;
+    static constexpr int workerChunkSize = 4096;
+    static constexpr int pollIntervalMs = 20;
+    
+    // Onset detection parameters (as in AudioAnalyzer)
+    static constexpr int hopSize = 512;
+    static constexpr int windowSize = 1024;
+    
+    // Fewer onsets than this in a window is silence or noise - keep the old list
+    static constexpr int minOnsetsPerWindow = 8;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LiveBandmate)
+};
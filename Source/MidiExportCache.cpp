@@ -0,0 +1,234 @@
+/*
+    MidiExportCache.cpp
+    ===================
+    
+    Implementation of the content-keyed MIDI export files.
+*/
+
+#include "MidiExportCache.h"
+
+namespace
+{
+    /*
+        CONTENT HASH
+        ------------
+        64-bit FNV-1a of whatever is written to it. Writing the events to
+        this instead of to a MidiFile is how a drag finds out whether its
+        file exists without serializing anything.
+    */
+    class HashingOutputStream : public juce::OutputStream
+    {
+    public:
+        void flush() override {}
+        bool setPosition(juce::int64) override { return false; }
+        juce::int64 getPosition() override { return position; }
+        
+        bool write(const void* data, size_t numBytes) override
+        {
+            const auto* bytes = static_cast<const juce::uint8*>(data);
+            
+            for (size_t i = 0; i < numBytes; ++i)
+                hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+            
+            position += static_cast<juce::int64>(numBytes);
+            return true;
+        }
+        
+        juce::uint64 hash = 0xCBF29CE484222325ull;
+    
+    private:
+        juce::int64 position = 0;
+    };
+    
+    // Changes whenever what the files are made of changes, so old ones aren't reused
+    constexpr int formatVersion = 1;
+    
+    constexpr int ticksPerQuarterNote = 480;
+}
+
+MidiExportCache::MidiExportCache(const juce::File& directoryToUse)
+    : directory(directoryToUse)
+{
+    directory.createDirectory();
+}
+
+juce::File MidiExportCache::getFileForEvents(const juce::String& fileName, const juce::String& trackName,
+                                             const GrooveEventList& events, double lengthInBeats)
+{
+    HashingOutputStream hasher;
+    hasher.writeInt(formatVersion);
+    hasher.writeString(trackName);
+    hasher.writeDouble(lengthInBeats);
+    events.writeTo(hasher);
+    
+    const auto file = getCachedFile(hasher.hash, fileName);
+    if (file.existsAsFile())
+        return file;
+    
+    // Format type 0 (single track) for maximum compatibility
+    juce::MidiMessageSequence sequence;
+    
+    // Track name helps some DAWs identify the track
+    juce::MidiMessage trackNameEvent = juce::MidiMessage::textMetaEvent(3, trackName);
+    trackNameEvent.setTimeStamp(0);
+    sequence.addEvent(trackNameEvent);
+    
+    // 120 BPM = 500000 microseconds per beat, and 4/4
+    auto tempoEvent = juce::MidiMessage::tempoMetaEvent(500000);
+    tempoEvent.setTimeStamp(0);
+    sequence.addEvent(tempoEvent);
+    
+    auto timeSigEvent = juce::MidiMessage::timeSignatureMetaEvent(4, 4);
+    timeSigEvent.setTimeStamp(0);
+    sequence.addEvent(timeSigEvent);
+    
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        // MidiMessages are only built here, at the output edge
+        juce::MidiMessage message = events.toMidiMessage(i);
+        message.setTimeStamp(events.getBeat(i) * ticksPerQuarterNote);
+        sequence.addEvent(message);
+    }
+    
+    sequence.updateMatchedPairs();
+    sequence.sort();
+    
+    // End of track is REQUIRED by the MIDI spec, and some DAWs (like Bitwig) are strict about it
+    auto endOfTrack = juce::MidiMessage::endOfTrack();
+    endOfTrack.setTimeStamp(lengthInBeats * ticksPerQuarterNote);
+    sequence.addEvent(endOfTrack);
+    
+    juce::MidiFile midiFile;
+    midiFile.setTicksPerQuarterNote(ticksPerQuarterNote);
+    midiFile.addTrack(sequence);
+    
+    const bool written = writeAtomically(file, [&midiFile](const juce::File& temporary)
+    {
+        juce::FileOutputStream stream(temporary);
+        return stream.openedOk() && midiFile.writeTo(stream);
+    });
+    
+    if (!written)
+    {
+        DBG("MidiExportCache: Failed to write " + file.getFullPathName());
+        return juce::File();
+    }
+    
+    DBG("MidiExportCache: Wrote " + file.getFullPathName() + " (" + juce::String(file.getSize()) + " bytes)");
+    return file;
+}
+
+juce::File MidiExportCache::getFileForGroove(const juce::File& original, const juce::String& fileName)
+{
+    if (!original.existsAsFile())
+        return juce::File();
+    
+    if (canBeDraggedDirectly(original))
+        return original;
+    
+    // The file is only small - hashing it costs less than copying it again
+    HashingOutputStream hasher;
+    hasher.writeInt(formatVersion);
+    {
+        juce::FileInputStream in(original);
+        if (!in.openedOk())
+            return original;
+        
+        char buffer[4096];
+        for (int numRead; (numRead = in.read(buffer, static_cast<int>(sizeof(buffer)))) > 0;)
+            hasher.write(buffer, static_cast<size_t>(numRead));
+    }
+    
+    const auto file = getCachedFile(hasher.hash, fileName);
+    if (file.existsAsFile())
+        return file;
+    
+    if (!writeAtomically(file, [&original](const juce::File& temporary) { return original.copyFileTo(temporary); }))
+    {
+        DBG("MidiExportCache: Failed to copy groove file");
+        return original;  // Fallback to original
+    }
+    
+    DBG("MidiExportCache: Copied groove to: " + file.getFullPathName());
+    return file;
+}
+
+juce::File MidiExportCache::getCachedFile(juce::uint64 contentHash, const juce::String& fileName) const
+{
+    const auto folder = directory.getChildFile(juce::String::toHexString(static_cast<juce::int64>(contentHash)).paddedLeft('0', 16));
+    const auto file = folder.getChildFile(makeSafeFileName(fileName) + ".mid");
+    
+    if (file.existsAsFile() && file.getSize() > 0)
+        markAsUsed(file);
+    else
+        folder.createDirectory();
+    
+    return file;
+}
+
+bool MidiExportCache::writeAtomically(const juce::File& target, const std::function<bool(const juce::File&)>& write)
+{
+    juce::TemporaryFile temporary(target);
+    
+    if (!write(temporary.getFile()) || temporary.getFile().getSize() <= 0)
+        return false;
+    
+    return temporary.overwriteTargetFileWithTemporary();
+}
+
+// A reused file counts as new, so removeOldFiles() leaves it for the host that was just given it
+void MidiExportCache::markAsUsed(const juce::File& file)
+{
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+}
+
+void MidiExportCache::removeOldFiles(juce::RelativeTime maxAge)
+{
+    // DAWs like Bitwig may still be reading a dropped file for a while,
+    // so only files nobody has been given for maxAge go
+    if (!directory.exists())
+        return;
+    
+    const auto cutoff = juce::Time::getCurrentTime() - maxAge;
+    
+    for (const auto& file : directory.findChildFiles(juce::File::findFiles, true, "*.mid"))
+    {
+        if (file.getLastModificationTime() < cutoff)
+        {
+            file.deleteFile();
+            DBG("MidiExportCache: Cleaned up old export: " + file.getFileName());
+        }
+    }
+    
+    for (const auto& folder : directory.findChildFiles(juce::File::findDirectories, false))
+    {
+        if (folder.findChildFiles(juce::File::findFilesAndDirectories, false).isEmpty())
+            folder.deleteFile();
+    }
+}
+
+bool MidiExportCache::canBeDraggedDirectly(const juce::File& file)
+{
+    #if JUCE_LINUX
+    // Sandboxed (Flatpak) DAWs only see /tmp
+    juce::ignoreUnused(file);
+    return false;
+    #else
+    // Files inside a plugin or app bundle may be out of the host's reach
+    for (auto folder = file.getParentDirectory(); !folder.isRoot(); folder = folder.getParentDirectory())
+    {
+        if (folder.hasFileExtension("vst3;component;app;clap;lv2"))
+            return false;
+        
+        if (folder.getParentDirectory() == folder)
+            break;
+    }
+    
+    return file.hasReadAccess();
+    #endif
+}
+
+juce::String MidiExportCache::makeSafeFileName(const juce::String& fileName)
+{
+    return fileName.replaceCharacters(" /\\:*?\"<>|", "_________");
+}
@@ -0,0 +1,90 @@
+/*
+    MidiExportCache.h
+    =================
+    
+    The MIDI files handed to the host when a groove or the composition is
+    dragged out (or exported to a folder).
+    
+    KEYED BY CONTENT
+    ----------------
+    A file is written once for what it contains, not once per drag: its
+    folder is named after a hash of the content (the compiled events, or
+    the bytes of the groove's own file), so dragging the same groove or
+    the same arrangement again hands the host the file it already has -
+    no copy, no MIDI serialization. Only the hash is worked out per drag,
+    and it is streamed straight from the events, without building a
+    MidiFile. Any edit (an item moved, swing changed) is other content
+    and gets a file of its own.
+    
+        JDrummer_Exports/1f3a9c07e25d6b48/Funk_Groove_1.mid
+    
+    The file keeps its plain name inside its folder, as the clip the host
+    creates is named after it. Files are written to a temporary file and
+    moved into place, so a host never reads one half written.
+    
+    THE ORIGINAL FILE
+    -----------------
+    Where the host can read it, a groove's own file is handed over as it
+    is (see canBeDraggedDirectly()). It can't when the file lives inside
+    the plugin's bundle, and on Linux, where DAWs are often sandboxed
+    (Flatpak) and only see /tmp - there a cached copy is used.
+    
+    Used from the message thread only; nothing here is shared with the
+    audio thread or takes GrooveManager's lock.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "GrooveEvents.h"
+#include <functional>
+
+class MidiExportCache
+{
+public:
+    explicit MidiExportCache(const juce::File& directory);
+    
+    const juce::File& getDirectory() const noexcept { return directory; }
+    
+    /*
+        FILE FOR EVENTS
+        ---------------
+        A type 0 MIDI file of the events (in beats, at 120 BPM - the host
+        plays it at its own tempo), with trackName as its track name and
+        its end of track at lengthInBeats. Written only if this content
+        hasn't been before. An empty File if it can't be written.
+    */
+    juce::File getFileForEvents(const juce::String& fileName, const juce::String& trackName,
+                                const GrooveEventList& events, double lengthInBeats);
+    
+    /*
+        FILE FOR GROOVE
+        ---------------
+        The groove's original file if the host can read it directly,
+        otherwise a cached copy of it named fileName. Falls back to the
+        original if the copy fails.
+    */
+    juce::File getFileForGroove(const juce::File& original, const juce::String& fileName);
+    
+    // Delete files not handed out for maxAge, and the folders they leave empty
+    void removeOldFiles(juce::RelativeTime maxAge);
+    
+    // True if a host can be given this file as it is
+    static bool canBeDraggedDirectly(const juce::File& file);
+    
+    // fileName with the characters file systems or hosts reject replaced
+    static juce::String makeSafeFileName(const juce::String& fileName);
+
+private:
+    // Where content with this hash is kept, and reused if it is already there
+    juce::File getCachedFile(juce::uint64 contentHash, const juce::String& fileName) const;
+    
+    // Writes the file next to target and moves it into place
+    static bool writeAtomically(const juce::File& target, const std::function<bool(const juce::File&)>& write);
+    
+    static void markAsUsed(const juce::File& file);
+    
+    juce::File directory;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiExportCache)
+};
@@ -0,0 +1,126 @@
+/*
+    NoteEventBuffer.h
+    =================
+    
+    A fixed-capacity list of note events for one audio block, kept sorted
+    by sample position.
+    
+    WHY NOT juce::MidiBuffer?
+    -------------------------
+    MidiBuffer stores raw MIDI bytes in a growable array, so adding events
+    can reallocate, and reading them back builds juce::MidiMessage objects.
+    The audio thread must never allocate, and a drum machine only needs
+    note on/off anyway - so the block's schedule is a plain std::array of
+    small structs, sized once at compile time. When it is full, further
+    events are dropped (and counted) instead of growing the buffer.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+
+/*
+    SCHEDULED NOTE
+    --------------
+    One note on or off at a sample offset within the current block.
+*/
+struct ScheduledNote
+{
+    int samplePosition = 0;  // Offset within the block
+    int note = 0;            // MIDI note number
+    float velocity = 0.0f;   // 0.0 to 1.0 (0 = note off)
+    
+    bool isNoteOn() const noexcept { return velocity > 0.0f; }
+};
+
+class NoteEventBuffer
+{
+public:
+    // Far more than any real block needs (a dense groove has a few dozen)
+    static constexpr int capacity = 1024;
+    
+    NoteEventBuffer() = default;
+    
+    void clear() noexcept
+    {
+        numEvents = 0;
+        numDropped = 0;
+    }
+    
+    /*
+        ADD - sorted insert
+        -------------------
+        Events almost always arrive in time order, so we search backwards
+        from the end: appending is O(1), and events at the same position
+        keep the order they were added in.
+    */
+    bool add(int samplePosition, int note, float velocity) noexcept
+    {
+        if (numEvents >= capacity)
+        {
+            ++numDropped;
+            return false;
+        }
+        
+        int insertAt = numEvents;
+        while (insertAt > 0 && events[static_cast<size_t>(insertAt - 1)].samplePosition > samplePosition)
+        {
+            events[static_cast<size_t>(insertAt)] = events[static_cast<size_t>(insertAt - 1)];
+            --insertAt;
+        }
+        
+        events[static_cast<size_t>(insertAt)] = { samplePosition, note, velocity };
+        ++numEvents;
+        return true;
+    }
+    
+    bool addNoteOn(int samplePosition, int note, float velocity) noexcept
+    {
+        // A note on needs a velocity above zero - zero is our note off
+        return add(samplePosition, note, juce::jmax(velocity, 0.001f));
+    }
+    
+    bool addNoteOff(int samplePosition, int note) noexcept
+    {
+        return add(samplePosition, note, 0.0f);
+    }
+    
+    /*
+        ADD RAW MIDI
+        ------------
+        Reads note on/off straight from MIDI bytes (e.g. a host MidiBuffer's
+        MidiMessageMetadata) without building a juce::MidiMessage.
+        A note on with velocity 0 counts as a note off, as in MIDI.
+    */
+    void addRawMidi(const juce::uint8* data, int numBytes, int samplePosition) noexcept
+    {
+        if (data == nullptr || numBytes < 3)
+            return;
+        
+        const int status = data[0] & 0xf0;
+        const int note = data[1] & 0x7f;
+        const int velocity = data[2] & 0x7f;
+        
+        if (status == 0x90 && velocity > 0)
+            add(samplePosition, note, static_cast<float>(velocity) / 127.0f);
+        else if (status == 0x80 || status == 0x90)
+            add(samplePosition, note, 0.0f);
+    }
+    
+    int size() const noexcept { return numEvents; }
+    bool isEmpty() const noexcept { return numEvents == 0; }
+    
+    // Events that didn't fit since the last clear()
+    int getNumDropped() const noexcept { return numDropped; }
+    
+    const ScheduledNote* begin() const noexcept { return events.data(); }
+    const ScheduledNote* end() const noexcept { return events.data() + numEvents; }
+
+private:
+    std::array<ScheduledNote, static_cast<size_t>(capacity)> events {};
+    int numEvents = 0;
+    int numDropped = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE(NoteEventBuffer)
+};
@@ -0,0 +1,283 @@
+/*
+    OfflineRenderer.cpp
+    ===================
+    
+    Implementation of the offline bounce (see OfflineRenderer.h).
+*/
+
+#include "OfflineRenderer.h"
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+OfflineRenderer::OfflineRenderer(SoundFontManager& manager)
+    : juce::Thread("Offline Renderer"),
+      soundFontManager(manager)
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    cancelPendingUpdate();
+    stopThread(10000);
+}
+
+bool OfflineRenderer::start(Settings newSettings)
+{
+    if (isThreadRunning() || newSettings.timeline.isEmpty()
+        || newSettings.bpm <= 0.0 || newSettings.sampleRate <= 0.0)
+        return false;
+    
+    settings = std::move(newSettings);
+    progress = 0.0f;
+    
+    startThread();
+    return true;
+}
+
+void OfflineRenderer::cancel()
+{
+    stopThread(10000);
+}
+
+void OfflineRenderer::run()
+{
+    auto result = render();
+    
+    {
+        const juce::ScopedLock sl(resultLock);
+        lastResult = std::move(result);
+    }
+    
+    triggerAsyncUpdate();
+}
+
+void OfflineRenderer::handleAsyncUpdate()
+{
+    Result result;
+    {
+        const juce::ScopedLock sl(resultLock);
+        result = lastResult;
+    }
+    
+    if (onFinished)
+        onFinished(result);
+}
+
+/*
+    RENDER - Worker thread
+    ----------------------
+    One pass over the timeline. Between two events the engine renders in
+    blocks of up to blockSize frames; at an event the block is cut short,
+    so every hit starts on its exact sample (as in processBlock, only
+    without a host deciding the block sizes). Each block is written to
+    every file before the next one is rendered.
+*/
+OfflineRenderer::Result OfflineRenderer::render()
+{
+    constexpr int numGroups = SoundFontManager::NUM_OUTPUT_GROUPS;
+    
+    Result result;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    
+    auto engine = soundFontManager.createOfflineEngine(settings.sampleRate);
+    if (engine == nullptr)
+    {
+        result.error = "No kit loaded";
+        return result;
+    }
+    
+    const auto& events = settings.timeline.events;
+    const double samplesPerBeat = settings.sampleRate * 60.0 / settings.bpm;
+    const auto lengthSamples = static_cast<juce::int64>(std::llround(settings.timeline.lengthInBeats * samplesPerBeat));
+    const auto tailSamples = settings.includeTail ? static_cast<juce::int64>(maxTailSeconds * settings.sampleRate) : 0;
+    
+    auto getEventSample = [&](size_t index)
+    {
+        return static_cast<juce::int64>(std::llround(events.getBeat(index) * samplesPerBeat));
+    };
+    
+    // Only groups the timeline actually plays get a stem
+    std::array<bool, numGroups> groupIsPlayed {};
+    if (settings.stems == Stems::perGroup)
+    {
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            const int group = engine->getGroupForNote(events.getNote(i));
+            if (events.isNoteOn(i) && group >= 0)
+                groupIsPlayed[static_cast<size_t>(group)] = true;
+        }
+    }
+    
+    /*
+        OUTPUT FILES
+        ------------
+        One writer per file; the main mix is always written. A failure
+        part way through removes everything this bounce has written.
+    */
+    auto outputDirectory = settings.outputDirectory;
+    if (outputDirectory == juce::File())
+        outputDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("JDrummer_Bounces");
+    
+    const auto baseName = juce::File::createLegalFileName(settings.timeline.name.isNotEmpty() ? settings.timeline.name
+                                                                                               : juce::String("JDrummer Bounce"));
+    outputDirectory = outputDirectory.getChildFile(baseName + "_" + juce::String(juce::Time::currentTimeMillis()));
+    
+    if (!outputDirectory.createDirectory())
+    {
+        result.error = "Can't create " + outputDirectory.getFullPathName();
+        return result;
+    }
+    
+    std::unique_ptr<juce::AudioFormat> audioFormat;
+    if (settings.format == Format::flac)
+        audioFormat = std::make_unique<juce::FlacAudioFormat>();
+    else
+        audioFormat = std::make_unique<juce::WavAudioFormat>();
+    
+    // Each file's block is rendered into directly (planar, like the writers take it)
+    struct OutputFile
+    {
+        int group = -1;  // -1 = main mix
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        juce::AudioBuffer<float> block;
+    };
+    std::vector<OutputFile> outputs;
+    
+    auto discardOutputs = [&]()
+    {
+        outputs.clear();  // Closes the files
+        outputDirectory.deleteRecursively();
+        result.files.clear();
+    };
+    
+    auto addOutput = [&](int group, const juce::String& fileName)
+    {
+        const auto file = outputDirectory.getChildFile(juce::File::createLegalFileName(fileName)
+                                                       + audioFormat->getFileExtensions()[0]);
+        
+        auto stream = std::make_unique<juce::FileOutputStream>(file);
+        if (!stream->openedOk())
+            return false;
+        
+        std::unique_ptr<juce::AudioFormatWriter> writer(audioFormat->createWriterFor(stream.get(), settings.sampleRate, 2,
+                                                                                     settings.bitsPerSample, {}, 0));
+        if (writer == nullptr)
+            return false;
+        
+        stream.release();  // The writer owns it now
+        outputs.push_back({ group, std::move(writer), juce::AudioBuffer<float>(2, blockSize) });
+        result.files.add(file);
+        return true;
+    };
+    
+    bool opened = addOutput(-1, baseName);
+    
+    for (int group = 0; group < numGroups && opened; ++group)
+    {
+        if (!groupIsPlayed[static_cast<size_t>(group)])
+            continue;
+        
+        const auto groupName = group < settings.groupNames.size() ? settings.groupNames[group]
+                                                                  : "Group " + juce::String(group + 1);
+        opened = addOutput(group, baseName + " - " + groupName);
+    }
+    
+    if (!opened)
+    {
+        discardOutputs();
+        result.error = "Can't write " + audioFormat->getFormatName() + " files to " + outputDirectory.getFullPathName();
+        return result;
+    }
+    
+    // The engine renders straight into the files' blocks (groups without a stem go into the main mix)
+    SoundFontManager::StereoBuffer mainOutput;
+    std::array<SoundFontManager::StereoBuffer, numGroups> groupOutputs {};
+    
+    for (auto& output : outputs)
+    {
+        const SoundFontManager::StereoBuffer channels { output.block.getWritePointer(0), output.block.getWritePointer(1) };
+        
+        if (output.group < 0)
+            mainOutput = channels;
+        else
+            groupOutputs[static_cast<size_t>(output.group)] = channels;
+    }
+    
+    /*
+        THE RENDER LOOP
+        ---------------
+        Play the events due at this position, render up to the next event
+        (or the end, or blockSize frames), write it, repeat. Past the end
+        of the timeline we carry on only while voices are still sounding.
+    */
+    const juce::int64 endSamples = lengthSamples + tailSamples;
+    const double progressScale = 1.0 / static_cast<double>(juce::jmax(static_cast<juce::int64>(1), lengthSamples));
+    juce::int64 position = 0;
+    size_t nextEvent = 0;
+    
+    while (position < endSamples)
+    {
+        if (threadShouldExit())
+        {
+            discardOutputs();
+            result.error = "Cancelled";
+            return result;
+        }
+        
+        if (position >= lengthSamples && engine->getNumActiveVoices() == 0)
+            break;
+        
+        for (; nextEvent < events.size() && getEventSample(nextEvent) <= position; ++nextEvent)
+        {
+            if (events.isNoteOn(nextEvent))
+                engine->noteOn(events.getNote(nextEvent), events.getFloatVelocity(nextEvent));
+            else
+                engine->noteOff(events.getNote(nextEvent));
+        }
+        
+        juce::int64 blockEnd = juce::jmin(position + blockSize, endSamples);
+        if (nextEvent < events.size())
+            blockEnd = juce::jmin(blockEnd, getEventSample(nextEvent));
+        if (position < lengthSamples)
+            blockEnd = juce::jmin(blockEnd, lengthSamples);
+        
+        const int numFrames = static_cast<int>(blockEnd - position);
+        
+        // The engine adds into the blocks (cleared through the raw channels, which
+        // AudioBuffer's own cleared flag wouldn't know have been written)
+        for (auto& output : outputs)
+        {
+            juce::FloatVectorOperations::clear(output.block.getWritePointer(0), numFrames);
+            juce::FloatVectorOperations::clear(output.block.getWritePointer(1), numFrames);
+        }
+        
+        engine->render(mainOutput, groupOutputs, numFrames);
+        
+        for (auto& output : outputs)
+        {
+            if (!output.writer->writeFromAudioSampleBuffer(output.block, 0, numFrames))
+            {
+                discardOutputs();
+                result.error = "Write failed";
+                return result;
+            }
+        }
+        
+        position = blockEnd;
+        progress = static_cast<float>(juce::jmin(1.0, static_cast<double>(position) * progressScale));
+    }
+    
+    outputs.clear();  // Writers finish their headers and close the files
+    
+    progress = 1.0f;
+    result.success = true;
+    result.audioSeconds = static_cast<double>(position) / settings.sampleRate;
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    
+    DBG("OfflineRenderer: Bounced " + juce::String(result.audioSeconds, 2) + " s to "
+        + juce::String(result.files.size()) + " files in " + juce::String(result.renderSeconds, 2) + " s");
+    
+    return result;
+}
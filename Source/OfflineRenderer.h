@@ -0,0 +1,113 @@
+/*
+    OfflineRenderer.h
+    =================
+    
+    Bounces a groove or the composition to audio files, faster than real
+    time, so it can be dragged into the DAW as audio instead of MIDI -
+    no more recording the plugin through the DAW in real time.
+    
+    HOW IT WORKS
+    ------------
+    - The message thread takes a copy of the timeline (see
+      GrooveManager::getCompositionTimeline()) and starts the bounce.
+    - A worker thread gets its own voices for the current kit
+      (SoundFontManager::createOfflineEngine()), walks the timeline
+      playing every event at its exact sample, and streams each rendered
+      block straight to the file writers. Only one block is ever held in
+      memory, and the live audio engine is never touched.
+    - onFinished is called on the message thread with the files written.
+    
+    STEMS
+    -----
+    Either the main mix only, or the main mix plus one file per output
+    group - the same grouping as the plugin's multi-out buses. Groups the
+    timeline never plays get no file.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "GrooveManager.h"
+#include "SoundFontManager.h"
+#include <atomic>
+#include <functional>
+
+class OfflineRenderer : private juce::Thread,
+                        private juce::AsyncUpdater
+{
+public:
+    explicit OfflineRenderer(SoundFontManager& soundFontManager);
+    ~OfflineRenderer() override;
+    
+    enum class Format { wav, flac };
+    enum class Stems { mainOnly, perGroup };
+    
+    struct Settings
+    {
+        GrooveManager::RenderTimeline timeline;
+        double bpm = 120.0;
+        double sampleRate = 44100.0;
+        int bitsPerSample = 24;
+        Format format = Format::wav;
+        Stems stems = Stems::mainOnly;
+        
+        // Let the last hits ring out past the end (up to maxTailSeconds)
+        bool includeTail = true;
+        
+        // File name suffix for each group's stem (default "Group 1"...)
+        juce::StringArray groupNames;
+        
+        // Where the files go (default: a new folder in the temp directory)
+        juce::File outputDirectory;
+    };
+    
+    // Start a bounce (message thread). False if one is already running
+    // or the timeline is empty.
+    bool start(Settings newSettings);
+    
+    // Stop a running bounce; its files are deleted (message thread)
+    void cancel();
+    
+    bool isRendering() const { return isThreadRunning(); }
+    
+    // How far the running bounce has got (0 to 1, any thread)
+    float getProgress() const noexcept { return progress.load(); }
+    
+    struct Result
+    {
+        bool success = false;
+        juce::Array<juce::File> files;  // Main mix first, then the stems
+        double audioSeconds = 0.0;      // Length of the bounce
+        double renderSeconds = 0.0;     // How long it took
+        juce::String error;
+    };
+    
+    // Called on the message thread when a bounce has finished (or failed)
+    std::function<void(const Result&)> onFinished;
+    
+    // Longest tail after the end of the timeline
+    static constexpr double maxTailSeconds = 4.0;
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+    
+    // The bounce itself (worker thread)
+    Result render();
+    
+    SoundFontManager& soundFontManager;
+    
+    // Written by start() while the worker isn't running, then read by it
+    Settings settings;
+    
+    // Handed from the worker to the message thread
+    juce::CriticalSection resultLock;
+    Result lastResult;
+    
+    std::atomic<float> progress { 0.0f };
+    
+    // Frames rendered (and written) per step
+    static constexpr int blockSize = 512;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
@@ -0,0 +1,223 @@
+/*
+    OnsetDetector.cpp
+    =================
+    
+    Energy and spectral-flux onset detection (see OnsetDetector.h).
+*/
+
+#include "OnsetDetector.h"
+#include <algorithm>
+#include <cmath>
+
+OnsetDetector::OnsetDetector(Function functionToUse, int windowSizeToUse, int hopSizeToUse, int maxChunkSize)
+    : function(functionToUse),
+      windowSize(static_cast<size_t>(windowSizeToUse)),
+      hopSize(static_cast<size_t>(hopSizeToUse)),
+      hopsPerWindow(static_cast<size_t>(juce::jmax(1, windowSizeToUse / hopSizeToUse)))
+{
+    jassert(windowSizeToUse % hopSizeToUse == 0);
+    
+    if (function == Function::energy)
+    {
+        hopSums.assign(hopsPerWindow, 0.0f);
+        return;
+    }
+    
+    // Spectral flux needs the whole window of samples for its FFT
+    jassert(juce::isPowerOfTwo(windowSizeToUse));
+    
+    pending.reserve(static_cast<size_t>(maxChunkSize) + windowSize + hopSize);
+    fft = std::make_unique<juce::dsp::FFT>(static_cast<int>(std::log2(windowSizeToUse)));
+    
+    hannWindow.resize(windowSize);
+    for (size_t i = 0; i < windowSize; ++i)
+        hannWindow[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * static_cast<float>(i)
+                                                / static_cast<float>(windowSize));
+    
+    // The frequency-only transform works in place on twice the frame size
+    fftBuffer.assign(windowSize * 2, 0.0f);
+    previousMagnitudes.assign(windowSize / 2 + 1, 0.0f);
+}
+
+OnsetDetector::~OnsetDetector()
+{
+}
+
+void OnsetDetector::reserveForLength(juce::int64 totalSamples)
+{
+    detectionFunction.reserve(static_cast<size_t>(juce::jmax(juce::int64 { 0 }, totalSamples)) / hopSize + 1);
+}
+
+float OnsetDetector::sumOfSquares(const float* samples, int numSamples) noexcept
+{
+    // Independent partial sums don't depend on each other, so they fit one SIMD register
+    constexpr int lanes = 8;
+    float partial[lanes] = {};
+    
+    int i = 0;
+    for (; i + lanes <= numSamples; i += lanes)
+    {
+        for (int lane = 0; lane < lanes; ++lane)
+            partial[lane] += samples[i + lane] * samples[i + lane];
+    }
+    
+    float sum = 0.0f;
+    for (; i < numSamples; ++i)
+        sum += samples[i] * samples[i];
+    
+    for (float value : partial)
+        sum += value;
+    
+    return sum;
+}
+
+void OnsetDetector::process(const float* samples, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+    
+    if (function == Function::energy)
+        processEnergy(samples, numSamples);
+    else
+        processSpectralFlux(samples, numSamples);
+}
+
+void OnsetDetector::addFrameValue(float value)
+{
+    // Only positive changes (attacks) - for flux the value is already a rise
+    if (numFrames > 0)
+    {
+        const float rise = function == Function::energy ? value - previousFrameValue : value;
+        detectionFunction.push_back(std::max(0.0f, rise));
+    }
+    
+    previousFrameValue = value;
+    ++numFrames;
+}
+
+/*
+    ENERGY - RUNNING HOP SUMS
+    -------------------------
+    Samples are summed a hop at a time; each finished hop completes the
+    window that ends with it. A window is only counted once a sample after
+    it has arrived - exactly the windows a single pass over the whole clip
+    would have produced.
+*/
+void OnsetDetector::processEnergy(const float* samples, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        if (windowPending)
+        {
+            addFrameValue(pendingEnergy);
+            windowPending = false;
+        }
+        
+        const int take = static_cast<int>(juce::jmin(static_cast<size_t>(numSamples), hopSize - samplesInCurrentHop));
+        currentHopSum += sumOfSquares(samples, take);
+        samplesInCurrentHop += static_cast<size_t>(take);
+        samples += take;
+        numSamples -= take;
+        
+        if (samplesInCurrentHop < hopSize)
+            continue;
+        
+        hopSums[numCompletedHops % hopsPerWindow] = currentHopSum;
+        ++numCompletedHops;
+        currentHopSum = 0.0f;
+        samplesInCurrentHop = 0;
+        
+        if (numCompletedHops >= hopsPerWindow)
+        {
+            float windowSum = 0.0f;
+            for (float hopSum : hopSums)
+                windowSum += hopSum;
+            
+            pendingEnergy = std::sqrt(windowSum / static_cast<float>(windowSize));
+            windowPending = true;
+        }
+    }
+}
+
+/*
+    SPECTRAL FLUX
+    -------------
+    Every hop, the window starting there is Hann-windowed and transformed;
+    the flux is how much the magnitude rose, summed over all bins.
+*/
+void OnsetDetector::processSpectralFlux(const float* samples, int numSamples)
+{
+    pending.insert(pending.end(), samples, samples + numSamples);
+    
+    const size_t numBins = previousMagnitudes.size();
+    size_t start = 0;
+    
+    for (; start + windowSize < pending.size(); start += hopSize)
+    {
+        std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+        juce::FloatVectorOperations::multiply(fftBuffer.data(), pending.data() + start, hannWindow.data(),
+                                              static_cast<int>(windowSize));
+        
+        fft->performFrequencyOnlyForwardTransform(fftBuffer.data(), true);
+        
+        float flux = 0.0f;
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            flux += std::max(0.0f, fftBuffer[bin] - previousMagnitudes[bin]);
+            previousMagnitudes[bin] = fftBuffer[bin];
+        }
+        
+        addFrameValue(flux);
+    }
+    
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(start));
+}
+
+std::vector<double> OnsetDetector::findOnsets(double sampleRate) const
+{
+    std::vector<double> onsets;
+    
+    if (numFrames < 3)
+        return onsets;
+    
+    const auto& energyDiff = detectionFunction;
+    
+    // Find global statistics for adaptive threshold
+    float maxDiff = 0.0f;
+    float sumDiff = 0.0f;
+    for (float d : energyDiff)
+    {
+        maxDiff = std::max(maxDiff, d);
+        sumDiff += d;
+    }
+    float meanDiff = sumDiff / static_cast<float>(energyDiff.size());
+    
+    // Use a lower threshold - percentage of max energy change
+    float adaptiveThreshold = std::max(meanDiff * 1.5f, maxDiff * 0.1f);
+    
+    DBG("OnsetDetector: Detection function stats - max: " + juce::String(maxDiff) 
+        + ", mean: " + juce::String(meanDiff)
+        + ", threshold: " + juce::String(adaptiveThreshold));
+    
+    // Find peaks in the detection function
+    for (size_t i = 1; i < energyDiff.size() - 1; ++i)
+    {
+        if (energyDiff[i] > adaptiveThreshold &&
+            energyDiff[i] >= energyDiff[i - 1] &&
+            energyDiff[i] >= energyDiff[i + 1])
+        {
+            // Convert frame index to time in seconds
+            double timeSeconds = static_cast<double>((i + 1) * hopSize) / sampleRate;
+            
+            // Avoid detecting onsets too close together (minimum 80ms apart)
+            if (onsets.empty() || (timeSeconds - onsets.back()) > 0.08)
+            {
+                onsets.push_back(timeSeconds);
+            }
+        }
+    }
+    
+    DBG("OnsetDetector: Detected " + juce::String(onsets.size()) + " onsets");
+    
+    return onsets;
+}
@@ -0,0 +1,97 @@
+/*
+    OnsetDetector.h
+    ===============
+    
+    Incremental onset (drum hit) detection for the Bandmate analyzer.
+    
+    The clip is fed in one chunk at a time (see AudioAnalyzer::analyzeAudio),
+    and the detector turns it into a detection function - one value per
+    hop that jumps when something is hit. findOnsets() then picks the
+    peaks that stand out against the whole clip.
+    
+    TWO DETECTION FUNCTIONS
+    -----------------------
+    - energy: the rise in RMS energy from one window to the next. Cheap,
+      and good at loud, percussive material.
+    - spectralFlux: the rise in each frequency bin's magnitude (FFT of a
+      Hann-windowed frame), summed. Also catches hits that don't add much
+      overall energy, e.g. a hi-hat over a sustained pad.
+    
+    O(n) ENERGY
+    -----------
+    Windows overlap (windowSize is a whole number of hops), so a window's
+    sum of squares is just the sum of its hops' sums. Every sample is
+    squared exactly once, in a tight loop the compiler can vectorize,
+    instead of windowSize / hopSize times.
+    
+    The detection function is the only thing that grows with the clip
+    (one float per hop); reserveForLength() allocates it up front.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <memory>
+#include <vector>
+
+class OnsetDetector
+{
+public:
+    enum class Function
+    {
+        energy,
+        spectralFlux
+    };
+    
+    // windowSize must be a multiple of hopSize (and a power of two for spectralFlux)
+    OnsetDetector(Function function, int windowSize, int hopSize, int maxChunkSize);
+    ~OnsetDetector();
+    
+    // Preallocate for a clip of this many samples (optional)
+    void reserveForLength(juce::int64 totalSamples);
+    
+    // Feed the next chunk of the clip
+    void process(const float* samples, int numSamples);
+    
+    // Onset times in seconds, picked from the detection function against an adaptive threshold
+    std::vector<double> findOnsets(double sampleRate) const;
+    
+    // One value per hop, starting with the second frame
+    const std::vector<float>& getDetectionFunction() const { return detectionFunction; }
+    
+    // Sum of x^2, written so it vectorizes (eight independent partial sums)
+    static float sumOfSquares(const float* samples, int numSamples) noexcept;
+
+private:
+    void processEnergy(const float* samples, int numSamples);
+    void processSpectralFlux(const float* samples, int numSamples);
+    
+    // A frame's value arrived: turn it into the next detection function entry
+    void addFrameValue(float value);
+    
+    const Function function;
+    const size_t windowSize;
+    const size_t hopSize;
+    const size_t hopsPerWindow;
+    
+    std::vector<float> detectionFunction;
+    size_t numFrames = 0;
+    float previousFrameValue = 0.0f;
+    
+    // Energy: running sums of squares, one per hop (ring of the last hopsPerWindow)
+    std::vector<float> hopSums;
+    size_t numCompletedHops = 0;
+    float currentHopSum = 0.0f;
+    size_t samplesInCurrentHop = 0;
+    bool windowPending = false;  // A full window waits for one more sample (as in a single pass)
+    float pendingEnergy = 0.0f;
+    
+    // Spectral flux: samples not yet covered by every window, plus FFT state
+    std::vector<float> pending;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> hannWindow;
+    std::vector<float> fftBuffer;
+    std::vector<float> previousMagnitudes;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OnsetDetector)
+};
@@ -0,0 +1,147 @@
+/*
+    PerformanceMonitor.cpp
+    ======================
+    
+    Implementation of the audio thread profiler (see PerformanceMonitor.h).
+*/
+
+#include "PerformanceMonitor.h"
+
+const char* PerformanceMonitor::getStageName(Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::busSetup:         return "Bus setup";
+        case Stage::grooveScheduling: return "Groove scheduling";
+        case Stage::noteDispatch:     return "Note dispatch";
+        case Stage::render:           return "Render";
+        case Stage::previewMix:       return "Preview mix";
+        case Stage::numStages:        break;
+    }
+    
+    return "";
+}
+
+int PerformanceMonitor::BlockStats::getTotalVoices() const noexcept
+{
+    int total = 0;
+    for (auto count : activeVoices)
+        total += count;
+    
+    return total;
+}
+
+void PerformanceMonitor::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled && !isEnabled())
+        enabledAtTicks = juce::Time::getHighResolutionTicks();
+    
+    enabled = shouldBeEnabled;
+}
+
+/*
+    WRITE CSV
+    ---------
+    Times in microseconds, one column per stage and per voice count, so
+    the file opens straight into a spreadsheet for plotting.
+*/
+bool PerformanceMonitor::writeCsv(const juce::File& file, const std::vector<BlockStats>& history)
+{
+    juce::TemporaryFile temp(file);
+    
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+        
+        out << "time_s,samples,events,budget_us,total_us,deadline_percent";
+        for (int stage = 0; stage < numStages; ++stage)
+            out << "," << juce::String(getStageName(static_cast<Stage>(stage))).toLowerCase().replaceCharacters(" ", "_") << "_us";
+        
+        out << ",lock_wait_us,voices_total,voices_main";
+        for (int group = 0; group < numGroups; ++group)
+            out << ",voices_group" << (group + 1);
+        
+        out << "\n";
+        
+        for (const auto& block : history)
+        {
+            out << juce::String(block.timeSeconds, 6) << "," << block.numSamples << "," << block.numEvents << ","
+                << juce::String(block.budgetMicros, 1) << "," << juce::String(block.totalMicros, 1) << ","
+                << juce::String(block.getDeadlinePercent(), 2);
+            
+            for (auto micros : block.stageMicros)
+                out << "," << juce::String(micros, 1);
+            
+            out << "," << juce::String(block.lockWaitMicros, 1) << "," << block.getTotalVoices();
+            
+            for (auto count : block.activeVoices)
+                out << "," << static_cast<int>(count);
+            
+            out << "\n";
+        }
+        
+        out.flush();
+        if (!out.getStatus().wasOk())
+            return false;
+    }
+    
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+/*
+    BLOCK PROBE
+    -----------
+    Whether a block is recorded is decided once, when the probe is made,
+    so a block is never half-measured when the monitor is switched on
+    or off.
+*/
+PerformanceMonitor::BlockProbe::BlockProbe(PerformanceMonitor& monitor, int numSamples, double sampleRate) noexcept
+    : owner(monitor),
+      active(monitor.isEnabled())
+{
+    if (!active)
+        return;
+    
+    startTicks = lastTicks = juce::Time::getHighResolutionTicks();
+    
+    const auto session = owner.enabledAtTicks.load();
+    stats.timeSeconds = juce::Time::highResolutionTicksToSeconds(startTicks - session);
+    
+    if (session != owner.lockWaitSession)
+    {
+        owner.lockWaitSession = session;
+        owner.lastLockWaitTicks = RealtimeSafety::getLockWaitTicks();
+    }
+    stats.numSamples = numSamples;
+    stats.budgetMicros = sampleRate > 0.0 ? static_cast<float>(1.0e6 * numSamples / sampleRate) : 0.0f;
+}
+
+PerformanceMonitor::BlockProbe::~BlockProbe() noexcept
+{
+    if (!active)
+        return;
+    
+    const auto endTicks = juce::Time::getHighResolutionTicks();
+    auto toMicros = [](juce::int64 ticks)
+    {
+        return static_cast<float>(1.0e6 * juce::Time::highResolutionTicksToSeconds(ticks));
+    };
+    
+    stats.totalMicros = toMicros(endTicks - startTicks);
+    for (int stage = 0; stage < numStages; ++stage)
+        stats.stageMicros[static_cast<size_t>(stage)] = toMicros(stageTicks[static_cast<size_t>(stage)]);
+    
+    const auto lockWaitTicks = RealtimeSafety::getLockWaitTicks();
+    stats.lockWaitMicros = toMicros(lockWaitTicks - owner.lastLockWaitTicks);
+    owner.lastLockWaitTicks = lockWaitTicks;
+    
+    if (!owner.blocks.push(stats))
+        owner.droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PerformanceMonitor::BlockProbe::setActiveVoices(const std::array<int, numVoiceCounts>& counts) noexcept
+{
+    for (size_t i = 0; i < counts.size(); ++i)
+        stats.activeVoices[i] = static_cast<juce::uint16>(juce::jlimit(0, 65535, counts[i]));
+}
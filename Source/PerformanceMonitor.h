@@ -0,0 +1,164 @@
+/*
+    PerformanceMonitor.h
+    ====================
+    
+    A built-in profiler for the audio thread: how long each stage of
+    processBlock() took, how close every block came to its deadline, and
+    how many voices each output group was playing.
+    
+    WHY?
+    ----
+    A drum instance that spikes once every few seconds is hard to pin
+    down from the outside - a host's CPU meter only shows the total, and
+    a debugger changes the timing. This records every block as it
+    happens, with the numbers needed to tell a dense groove (many voices,
+    long render) from a slow groove scheduler or a late preview mix.
+    
+    WHAT A BLOCK RECORDS
+    --------------------
+    - STAGE TIMES: bus setup, groove scheduling, note dispatch, render
+      (renderAudioMultiOut), preview mix - in microseconds
+    - DEADLINE: the whole block as a percentage of the time the host
+      allows for it (numSamples / sampleRate). Anything near 100% risks
+      an xrun.
+    - VOICES: active voices on the main instance and every group
+    - LOCK WAIT: time threads of this process spent waiting on a
+      contended CheckedCriticalSection since the previous block. The
+      audio thread itself never takes a lock (see RealtimeSafety.h), so
+      this shows loader/UI contention, not audio thread stalls.
+    
+    THREADING
+    ---------
+    The audio thread fills a BlockProbe on its stack and pushes the
+    result into a lock-free ring (SpscQueue); the UI pops the results on
+    the message thread. If the UI falls behind, blocks are dropped (and
+    counted), never waited for. Disabled, a probe costs one atomic load
+    per block - the monitor is only switched on while the diagnostics
+    tab is open.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "RealtimeSafety.h"
+#include <array>
+#include <atomic>
+#include <vector>
+
+class PerformanceMonitor
+{
+public:
+    // One voice count for the main instance plus one per output group
+    static constexpr int numGroups = 16;
+    static constexpr int numVoiceCounts = numGroups + 1;
+    
+    // The parts of processBlock() that are timed, in the order they run
+    enum class Stage
+    {
+        busSetup,          // Clearing, tempo, finding the enabled buses, pad parameters
+        grooveScheduling,  // GrooveManager::processBlock and collecting host/UI notes
+        noteDispatch,      // noteOn/noteOff (chokes, voice stealing, sample selection)
+        render,            // renderAudioMultiOut, segment by segment
+        previewMix,        // Mixing in the groove matcher's preview audio
+        numStages
+    };
+    static constexpr int numStages = static_cast<int>(Stage::numStages);
+    
+    static const char* getStageName(Stage stage) noexcept;
+    
+    // Everything recorded about one audio block
+    struct BlockStats
+    {
+        double timeSeconds = 0.0;   // When the block started, since the monitor was enabled
+        int numSamples = 0;
+        int numEvents = 0;          // Notes dispatched in the block
+        float budgetMicros = 0.0f;  // Time the host allows: numSamples / sampleRate
+        float totalMicros = 0.0f;
+        std::array<float, numStages> stageMicros {};
+        float lockWaitMicros = 0.0f;
+        std::array<juce::uint16, numVoiceCounts> activeVoices {};  // [0] = main instance, then groups
+        
+        float getDeadlinePercent() const noexcept { return budgetMicros > 0.0f ? 100.0f * totalMicros / budgetMicros : 0.0f; }
+        int getTotalVoices() const noexcept;
+    };
+    
+    PerformanceMonitor() = default;
+    
+    // ===== SETTINGS (any thread) =====
+    
+    // Off by default - switch on while someone is looking
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+    
+    // ===== MESSAGE THREAD =====
+    
+    // Next recorded block, oldest first (false when there is none)
+    bool popBlock(BlockStats& stats) noexcept { return blocks.pop(stats); }
+    
+    // Blocks that were dropped because the ring was full
+    juce::uint64 getNumDroppedBlocks() const noexcept { return droppedBlocks.load(); }
+    
+    // Write blocks as CSV (one row per block, with a header row)
+    static bool writeCsv(const juce::File& file, const std::vector<BlockStats>& history);
+    
+    /*
+        BLOCK PROBE - Audio thread
+        --------------------------
+        Lives on the stack for one processBlock(). Each lap() charges the
+        time since the previous one (or since the probe was made) to a
+        stage, so stages that interleave - note dispatch and render
+        alternate through the block - add up without nesting. The block
+        is pushed when the probe is destroyed.
+    */
+    class BlockProbe
+    {
+    public:
+        BlockProbe(PerformanceMonitor& monitor, int numSamples, double sampleRate) noexcept;
+        ~BlockProbe() noexcept;
+        
+        // Is this block being recorded? (Skip work that only feeds the probe)
+        bool isActive() const noexcept { return active; }
+        
+        void lap(Stage stage) noexcept
+        {
+            if (!active)
+                return;
+            
+            const auto now = juce::Time::getHighResolutionTicks();
+            stageTicks[static_cast<size_t>(stage)] += now - lastTicks;
+            lastTicks = now;
+        }
+        
+        void addEvents(int count) noexcept { stats.numEvents += count; }
+        
+        // Voice counts, main instance first (see SoundFontManager::getActiveVoiceCounts)
+        void setActiveVoices(const std::array<int, numVoiceCounts>& counts) noexcept;
+    
+    private:
+        PerformanceMonitor& owner;
+        const bool active;
+        juce::int64 startTicks = 0;
+        juce::int64 lastTicks = 0;
+        std::array<juce::int64, numStages> stageTicks {};
+        BlockStats stats;
+        
+        JUCE_DECLARE_NON_COPYABLE(BlockProbe)
+    };
+
+private:
+    std::atomic<bool> enabled { false };
+    
+    // Set by setEnabled(), read by the audio thread
+    std::atomic<juce::int64> enabledAtTicks { 0 };
+    
+    // Audio thread only: lock wait total at the previous block, and the
+    // enabledAtTicks it belongs to (a new session starts from zero)
+    juce::int64 lastLockWaitTicks = 0;
+    juce::int64 lockWaitSession = -1;
+    
+    // About 20 seconds of 512-sample blocks at 48 kHz
+    SpscQueue<BlockStats, 2048> blocks;
+    std::atomic<juce::uint64> droppedBlocks { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceMonitor)
+};
@@ -131,6 +131,15 @@ JdrummerAudioProcessorEditor::JdrummerAudioProcessorEditor(JdrummerAudioProcesso
     bandmateTabButton.onClick = [this]() { showTab(2); };
     addAndMakeVisible(bandmateTabButton);
     
+    // Only for tracking down performance problems - revealed with Ctrl/Cmd+Shift+D
+    diagnosticsTabButton.setButtonText("DIAGNOSTICS");
+    diagnosticsTabButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF333333));
+    diagnosticsTabButton.setColour(juce::TextButton::buttonOnColourId, juce::Colour(0xFF00BFFF));
+    diagnosticsTabButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xFFAAAAAA));
+    diagnosticsTabButton.setColour(juce::TextButton::textColourOnId, juce::Colour(0xFFFFFFFF));
+    diagnosticsTabButton.onClick = [this]() { showTab(3); };
+    addChildComponent(diagnosticsTabButton);  // Hidden initially
+    
     /*
         ADD CHILD COMPONENTS
         --------------------
@@ -140,6 +149,7 @@ JdrummerAudioProcessorEditor::JdrummerAudioProcessorEditor(JdrummerAudioProcesso
         They're declared as member variables, so they exist as long
         as the editor exists.
     */
+    drumPadGrid.setAnimationClock(&animationClock);
     addAndMakeVisible(drumPadGrid);
     addAndMakeVisible(padControls);
     
@@ -153,6 +163,22 @@ JdrummerAudioProcessorEditor::JdrummerAudioProcessorEditor(JdrummerAudioProcesso
     bandmatePanel.setGrooveManager(&audioProcessor.getGrooveManager());
     addChildComponent(bandmatePanel);  // Hidden initially
     
+    // Setup the diagnostics panel (records only while it is showing)
+    diagnosticsPanel.setMonitor(&audioProcessor.getPerformanceMonitor());
+    diagnosticsPanel.setParallelRendering(audioProcessor.getSoundFontManager().isParallelRenderingEnabled());
+    diagnosticsPanel.onParallelRenderingChanged = [this](bool enabled)
+    {
+        auto& soundFontManager = audioProcessor.getSoundFontManager();
+        soundFontManager.setParallelRenderingEnabled(enabled);
+        
+        // Not every machine has a core to spare
+        diagnosticsPanel.setParallelRendering(soundFontManager.isParallelRenderingEnabled());
+    };
+    addChildComponent(diagnosticsPanel);  // Hidden initially
+    
+    // So the diagnostics shortcut reaches keyPressed()
+    setWantsKeyboardFocus(true);
+    
     // Connect all the callbacks between components
     setupCallbacks();
     
@@ -226,8 +252,9 @@ void JdrummerAudioProcessorEditor::onKitComboBoxChanged()
     auto kitName = kitComboBox.getText();
     if (kitName.isNotEmpty())
     {
-        // Tell the processor to load the new kit
-        audioProcessor.getSoundFontManager().loadKit(kitName);
+        // Tell the processor to load the new kit (in the background -
+        // the combo box is refreshed through onKitLoaded when it's ready)
+        audioProcessor.loadKitAsync(kitName);
     }
 }
 
@@ -281,18 +308,23 @@ void JdrummerAudioProcessorEditor::setupCallbacks()
     /*
         VOLUME/PAN CALLBACKS
         --------------------
-        When user adjusts the sliders, update the processor.
+        When user adjusts the sliders, update the processor (which passes
+        the change on to the host as a parameter change).
     */
     padControls.onVolumeChanged = [this](int note, float volume) {
-        audioProcessor.getSoundFontManager().setNoteVolume(note, volume);
+        audioProcessor.setNoteVolume(note, volume);
     };
     
     padControls.onPanChanged = [this](int note, float pan) {
-        audioProcessor.getSoundFontManager().setNotePan(note, pan);
+        audioProcessor.setNotePan(note, pan);
     };
     
     padControls.onMuteChanged = [this](int note, bool muted) {
-        audioProcessor.getSoundFontManager().setNoteMute(note, muted);
+        audioProcessor.setNoteMute(note, muted);
+    };
+    
+    padControls.onRoundRobinChanged = [this](int note, bool enabled) {
+        audioProcessor.setNoteRoundRobin(note, enabled);
     };
     
     /*
@@ -332,9 +364,10 @@ void JdrummerAudioProcessorEditor::updatePadControlsForSelectedPad()
     padControls.setSelectedPad(note, padName);
     
     // Get current values from the processor
-    padControls.setVolume(audioProcessor.getSoundFontManager().getNoteVolume(note));
-    padControls.setPan(audioProcessor.getSoundFontManager().getNotePan(note));
-    padControls.setMute(audioProcessor.getSoundFontManager().getNoteMute(note));
+    padControls.setVolume(audioProcessor.getNoteVolume(note));
+    padControls.setPan(audioProcessor.getNotePan(note));
+    padControls.setMute(audioProcessor.getNoteMute(note));
+    padControls.setRoundRobin(audioProcessor.getNoteRoundRobin(note));
 }
 
 /*
@@ -395,6 +428,13 @@ void JdrummerAudioProcessorEditor::timerCallback()
     {
         drumPadGrid.triggerPadVisual(note);
     }
+    
+    // Follow host automation of the selected pad (no-op while nothing changes)
+    const int selectedNote = drumPadGrid.getSelectedNote();
+    padControls.setVolume(audioProcessor.getNoteVolume(selectedNote));
+    padControls.setPan(audioProcessor.getNotePan(selectedNote));
+    padControls.setMute(audioProcessor.getNoteMute(selectedNote));
+    padControls.setRoundRobin(audioProcessor.getNoteRoundRobin(selectedNote));
 }
 
 /*
@@ -478,12 +518,14 @@ void JdrummerAudioProcessorEditor::resized()
     headerBounds.removeFromLeft(20);  // Spacing
     
     // Tab buttons in the center
-    auto tabArea = headerBounds.removeFromLeft(340);
+    auto tabArea = headerBounds.removeFromLeft(450);
     drumKitTabButton.setBounds(tabArea.removeFromLeft(100));
     tabArea.removeFromLeft(10);
     groovesTabButton.setBounds(tabArea.removeFromLeft(100));
     tabArea.removeFromLeft(10);
     bandmateTabButton.setBounds(tabArea.removeFromLeft(100));
+    tabArea.removeFromLeft(10);
+    diagnosticsTabButton.setBounds(tabArea.removeFromLeft(110));
     
     headerBounds.removeFromLeft(20);  // Spacing
     
@@ -517,12 +559,15 @@ void JdrummerAudioProcessorEditor::resized()
     
     // Bandmate panel takes the same area as grooves panel
     bandmatePanel.setBounds(groovesBounds);
+    
+    // So does the diagnostics panel
+    diagnosticsPanel.setBounds(groovesBounds);
 }
 
 /*
     SHOW TAB
     --------
-    Switches between Drum Kit, Grooves, and Bandmate views.
+    Switches between Drum Kit, Grooves, Bandmate and (hidden) Diagnostics views.
 */
 void JdrummerAudioProcessorEditor::showTab(int tabIndex)
 {
@@ -535,6 +580,8 @@ void JdrummerAudioProcessorEditor::showTab(int tabIndex)
     groovesTabButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xFFAAAAAA));
     bandmateTabButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF333333));
     bandmateTabButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xFFAAAAAA));
+    diagnosticsTabButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF333333));
+    diagnosticsTabButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xFFAAAAAA));
     
     // Hide all panels
     drumPadGrid.setVisible(false);
@@ -543,6 +590,7 @@ void JdrummerAudioProcessorEditor::showTab(int tabIndex)
     kitComboBox.setVisible(false);
     groovesPanel.setVisible(false);
     bandmatePanel.setVisible(false);
+    diagnosticsPanel.setVisible(false);
     
     if (tabIndex == 0)
     {
@@ -572,6 +620,45 @@ void JdrummerAudioProcessorEditor::showTab(int tabIndex)
         
         bandmatePanel.setVisible(true);
     }
+    else if (tabIndex == 3)
+    {
+        // Diagnostics tab
+        diagnosticsTabButton.setColour(juce::TextButton::buttonColourId, juce::Colour(0xFF00BFFF));
+        diagnosticsTabButton.setColour(juce::TextButton::textColourOffId, juce::Colour(0xFFFFFFFF));
+        
+        diagnosticsPanel.setVisible(true);
+    }
     
     repaint();
 }
+
+/*
+    KEY PRESSED - Hidden diagnostics tab
+    ------------------------------------
+    Ctrl+Shift+D (Cmd+Shift+D on macOS) shows the diagnostics tab and
+    switches to it; pressed again, it hides the tab. Keys the children
+    don't use bubble up to here.
+*/
+bool JdrummerAudioProcessorEditor::keyPressed(const juce::KeyPress& key)
+{
+    const bool isDiagnosticsShortcut = key.getModifiers().isCommandDown() && key.getModifiers().isShiftDown()
+                                       && (key.getKeyCode() == 'D' || key.getKeyCode() == 'd');
+    
+    if (!isDiagnosticsShortcut)
+        return false;
+    
+    if (diagnosticsTabButton.isVisible())
+    {
+        diagnosticsTabButton.setVisible(false);
+        
+        if (currentTab == 3)
+            showTab(0);
+    }
+    else
+    {
+        diagnosticsTabButton.setVisible(true);
+        showTab(3);
+    }
+    
+    return true;
+}
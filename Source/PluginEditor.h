@@ -30,6 +30,7 @@
 #include "Components/PadControls.h"
 #include "Components/GroovesPanel.h"
 #include "Components/BandmatePanel.h"
+#include "Components/DiagnosticsPanel.h"
 
 /*
     INHERITANCE FROM MULTIPLE CLASSES
@@ -69,6 +70,9 @@ public:
     
     // Called periodically to check for MIDI triggers
     void timerCallback() override;
+    
+    // Ctrl/Cmd+Shift+D shows or hides the diagnostics tab
+    bool keyPressed(const juce::KeyPress& key) override;
 
 private:
     /*
@@ -126,10 +130,14 @@ private:
     juce::TextButton drumKitTabButton;
     juce::TextButton groovesTabButton;
     juce::TextButton bandmateTabButton;
+    juce::TextButton diagnosticsTabButton;  // Hidden until Ctrl/Cmd+Shift+D
     
-    // Track which tab is active (0 = Drum Kit, 1 = Grooves, 2 = Bandmate)
+    // Track which tab is active (0 = Drum Kit, 1 = Grooves, 2 = Bandmate, 3 = Diagnostics)
     int currentTab = 0;
     
+    // Drives every animation in the editor (declared before the components it animates)
+    AnimationClock animationClock { *this };
+    
     // Main area - the drum pad grid (shown when Drum Kit tab is selected)
     DrumPadGrid drumPadGrid;
     
@@ -142,6 +150,9 @@ private:
     // Bandmate panel (shown when Bandmate tab is selected)
     BandmatePanel bandmatePanel;
     
+    // Audio thread profiler (shown when the hidden Diagnostics tab is selected)
+    DiagnosticsPanel diagnosticsPanel;
+    
     // Switch between tabs
     void showTab(int tabIndex);
 
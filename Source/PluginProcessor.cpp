@@ -33,10 +33,14 @@
     2. Initialize member variables
     
     BusesProperties() is JUCE's way of defining audio input/output configuration.
-    We're saying: "This plugin has stereo output, no input"
+    We're saying: "This plugin has stereo output, plus an optional stereo
+    sidechain input" - the band's audio for live groove matching
+    (see LiveBandmate.h). It is never mixed into the output.
 */
 JdrummerAudioProcessor::JdrummerAudioProcessor()
     : AudioProcessor(BusesProperties()
+                     // Sidechain input for live Bandmate (disabled by default)
+                     .withInput("Sidechain", juce::AudioChannelSet::stereo(), false)
                      // Main stereo output (always enabled)
                      .withOutput("Main", juce::AudioChannelSet::stereo(), true)
                      // Individual pad outputs (16 stereo buses, disabled by default for compatibility)
@@ -56,8 +60,26 @@ JdrummerAudioProcessor::JdrummerAudioProcessor()
                      .withOutput("Cowbell", juce::AudioChannelSet::stereo(), false)
                      .withOutput("Perc 1", juce::AudioChannelSet::stereo(), false)
                      .withOutput("Perc 2", juce::AudioChannelSet::stereo(), false)
-                     .withOutput("Perc 3", juce::AudioChannelSet::stereo(), false))
+                     .withOutput("Perc 3", juce::AudioChannelSet::stereo(), false)),
+      parameters(*this, nullptr, "Parameters", createParameterLayout())
 {
+    // The audio thread reads the pad parameters through these pointers only
+    for (int note = firstPadNote; note <= lastPadNote; ++note)
+    {
+        auto& values = noteParameters[static_cast<size_t>(note - firstPadNote)];
+        values.volume = parameters.getRawParameterValue(getNoteParameterID(note, "volume"));
+        values.pan = parameters.getRawParameterValue(getNoteParameterID(note, "pan"));
+        values.mute = parameters.getRawParameterValue(getNoteParameterID(note, "mute"));
+        values.roundRobin = parameters.getRawParameterValue(getNoteParameterID(note, "roundrobin"));
+    }
+    
+    applyNoteParameters();
+    
+    // Note-to-group routing for multi-out - set once, before any kit (and so any engine) exists
+    soundFontManager.setNoteToGroupMapper([](int note) {
+        return getOutputGroupForNote(note);
+    });
+    
     /*
         FINDING SOUNDFONTS
         ------------------
@@ -165,7 +187,10 @@ JdrummerAudioProcessor::JdrummerAudioProcessor()
         if (defaultIndex < 0)  // indexOf returns -1 if not found
             defaultIndex = 0;
         
-        soundFontManager.loadKit(kits[defaultIndex]);
+        // Only requested: when a host opens a project it restores the
+        // project's kit straight after constructing us, and that request
+        // replaces this one before the default has cost any loading
+        requestKit(kits[defaultIndex]);
     }
     
     /*
@@ -232,12 +257,112 @@ JdrummerAudioProcessor::JdrummerAudioProcessor()
     DESTRUCTOR
     ----------
     Called when the object is destroyed.
-    Empty here because our member variables (soundFontManager, renderBuffer)
+    Empty here because our member variables (soundFontManager, grooveManager)
     clean themselves up automatically - this is called RAII
     (Resource Acquisition Is Initialization).
 */
 JdrummerAudioProcessor::~JdrummerAudioProcessor()
 {
+    cancelPendingUpdate();
+    cancelPreviewResampling();
+}
+
+/*
+    BACKGROUND KIT LOADING
+    ----------------------
+    The SoundFontManager parses the kit on its loader thread and calls
+    us back there. triggerAsyncUpdate() is safe to call from any thread
+    and turns that into a handleAsyncUpdate() call on the message thread,
+    where the editor can safely update itself.
+*/
+void JdrummerAudioProcessor::loadKitAsync(const juce::String& kitName)
+{
+    {
+        // Chosen now - a request still waiting is out of date
+        const CheckedCriticalSection::ScopedLockType sl(requestLock);
+        requestedKitName.clear();
+    }
+    
+    soundFontManager.loadKitAsync(kitName, [this](bool)
+    {
+        triggerAsyncUpdate();
+    });
+}
+
+/*
+    DEFERRED KIT LOAD
+    -----------------
+    requestKit() only records the kit; handleAsyncUpdate() hands it to
+    the loader on the message thread. So restoring a project returns to
+    the host at once, whatever thread it restores on, and of several
+    requests in a row (the default kit, then the project's) only the
+    last is ever loaded.
+    
+    The rest of what a restore can't do cheaply or on any thread goes the
+    same way: setStateInformation() keeps the state, and handleAsyncUpdate()
+    applies its pad parameters (a parameter tree replaced, every listener
+    told), its render setting (which may start worker threads) and its
+    groove transform (which waits out the audio block in progress) just
+    before the kit is loaded. Until then getStateInformation() saves the
+    kept state's, so a project saved straight after it was opened keeps
+    what it had.
+*/
+void JdrummerAudioProcessor::requestKit(const juce::String& kitName)
+{
+    {
+        const CheckedCriticalSection::ScopedLockType sl(requestLock);
+        requestedKitName = kitName;
+    }
+    
+    triggerAsyncUpdate();
+}
+
+juce::ValueTree JdrummerAudioProcessor::getRestoredState() const
+{
+    const CheckedCriticalSection::ScopedLockType sl(requestLock);
+    return restoredState;
+}
+
+juce::String JdrummerAudioProcessor::getChosenKitName() const
+{
+    {
+        const CheckedCriticalSection::ScopedLockType sl(requestLock);
+        if (requestedKitName.isNotEmpty())
+            return requestedKitName;
+    }
+    
+    // A kit that is still loading in the background is the one the user chose
+    auto kitName = soundFontManager.getPendingKitName();
+    if (kitName.isEmpty())
+        kitName = soundFontManager.getCurrentKitName();
+    
+    return kitName;
+}
+
+void JdrummerAudioProcessor::handleAsyncUpdate()
+{
+    // Kept until it has been applied, so a save in between still finds it
+    if (const auto stateToApply = getRestoredState(); stateToApply.isValid())
+    {
+        applyRestoredState(stateToApply);
+        
+        const CheckedCriticalSection::ScopedLockType sl(requestLock);
+        if (restoredState == stateToApply)  // Not replaced by a newer restore meanwhile
+            restoredState = {};
+    }
+    
+    juce::String kitToLoad;
+    
+    {
+        const CheckedCriticalSection::ScopedLockType sl(requestLock);
+        std::swap(kitToLoad, requestedKitName);
+    }
+    
+    if (kitToLoad.isNotEmpty())
+        loadKitAsync(kitToLoad);
+    
+    if (onKitLoaded)
+        onKitLoaded();
 }
 
 // Returns the plugin name - JucePlugin_Name is defined by JUCE's build system
@@ -289,23 +414,25 @@ void JdrummerAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
     // Tell the groove manager about the sample rate
     grooveManager.setSampleRate(sampleRate);
     
+    // Size the live Bandmate's input ring for this rate
+    liveBandmate.prepare(sampleRate);
+    
     // Store host sample rate for audio preview resampling
+    const bool sampleRateChanged = (sampleRate != hostSampleRate);
     hostSampleRate = sampleRate;
     
-    // Pre-allocate buffer for stereo audio (2 channels)
-    // static_cast<size_t> converts int to size_t (unsigned) - required by vector
-    renderBuffer.resize(static_cast<size_t>(samplesPerBlock) * 2);
+    // A preview clip converted for the old rate needs converting again
+    if (sampleRateChanged)
+        updatePreviewForHostRate();
     
-    // Pre-allocate multi-out buffers for each output group
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
-    {
-        multiOutBuffers[i].resize(static_cast<size_t>(samplesPerBlock) * 2);
-    }
-    
-    // Setup note-to-group mapper for multi-out routing
-    soundFontManager.setNoteToGroupMapper([](int note) {
-        return getOutputGroupForNote(note);
-    });
+    /*
+        NO RENDER BUFFERS
+        -----------------
+        The soundfont renders straight into the host's channels (see
+        renderSegment), so there is nothing to allocate per block size:
+        any block the host sends is rendered in one go.
+    */
+    juce::ignoreUnused(samplesPerBlock);
 }
 
 // Called when playback stops - clean up resources here
@@ -319,6 +446,7 @@ void JdrummerAudioProcessor::releaseResources()
     ------------------
     Tells the host what audio configurations we support.
     For multi-out, we support stereo main output and stereo or disabled individual outputs.
+    The sidechain input may be mono, stereo or disabled.
 */
 bool JdrummerAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
@@ -326,6 +454,13 @@ bool JdrummerAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
     
+    // Sidechain input can be mono, stereo or disabled
+    for (const auto& bus : layouts.inputBuses)
+    {
+        if (!bus.isDisabled() && bus != juce::AudioChannelSet::mono() && bus != juce::AudioChannelSet::stereo())
+            return false;
+    }
+    
     // Individual outputs can be stereo or disabled
     for (int i = 1; i < layouts.outputBuses.size(); ++i)
     {
@@ -391,6 +526,17 @@ void JdrummerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     */
     juce::ScopedNoDenormals noDenormals;
     
+    /*
+        REAL-TIME SAFETY
+        ----------------
+        Marks this thread as the audio thread, so any CheckedCriticalSection
+        locked from here on triggers an assertion in debug builds.
+    */
+    const RealtimeSafety::ScopedAudioThread audioThreadMarker;
+    
+    // Test hook: jasserts if anything below allocates (see RealtimeSafety.h)
+    const RealtimeSafety::ScopedAllocationCheck allocationCheck;
+    
     /*
         DEFENSIVE BOUNDS CHECKING
         -------------------------
@@ -405,12 +551,39 @@ void JdrummerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     if (bufferNumChannels < 2 || bufferNumSamples <= 0)
         return;
     
+    /*
+        PROFILING
+        ---------
+        Times the stages below while the diagnostics tab is open (see
+        PerformanceMonitor.h). Declared before kitBlock, so it is destroyed
+        - and the block recorded - after the kit has been released.
+    */
+    PerformanceMonitor::BlockProbe probe(performanceMonitor, bufferNumSamples, hostSampleRate);
+    
     auto totalNumInputChannels = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
 
-    // Clear any channels we're not using (with bounds check)
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels && i < bufferNumChannels; ++i)
-        buffer.clear(i, 0, bufferNumSamples);
+    /*
+        SIDECHAIN INPUT
+        ---------------
+        The input shares its channels with the first outputs, so grab it
+        before anything is rendered: live Bandmate gets a copy of the left
+        channel (one memcpy - the analysis runs on its own thread).
+    */
+    if (totalNumInputChannels > 0 && liveBandmate.isEnabled())
+        liveBandmate.pushAudio(buffer.getReadPointer(0), bufferNumSamples);
+    
+    /*
+        SILENCE FLAG
+        ------------
+        Clear every channel - including the ones the sidechain arrived in,
+        which must never reach the output. Clearing the whole buffer also
+        marks it as cleared (AudioBuffer::hasBeenCleared()), and it stays
+        marked until a channel is written. Below, only buses that actually
+        have something playing are written, so a block in which the kit
+        is idle goes back to the host flagged as silent, and an idle drum
+        instance costs little more than this memset.
+    */
+    buffer.clear();
 
     /*
         GET DAW TEMPO AND POSITION
@@ -432,234 +605,310 @@ void JdrummerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
         }
     }
     
+    // Get number of samples to process
+    const int numSamples = bufferNumSamples;
+    
     /*
-        PROCESS GROOVE PLAYBACK
-        -----------------------
-        The GrooveManager outputs MIDI events based on the current DAW position.
-        We collect these events and trigger them on the soundfont.
+        FIND ENABLED OUTPUT BUSES
+        -------------------------
+        Only groups whose bus is enabled (and actually present in the buffer)
+        are rendered into their own bus (see renderSegment). The rest are mixed straight into the
+        main output by the SoundFontManager, with no per-bus work at all.
+        
+        NOTE: Some DAWs may not provide all channels we expect.
+        Use bufferNumChannels for bounds checking to prevent crashes.
     */
-    std::vector<juce::MidiMessage> grooveMidiEvents;
-    grooveManager.processBlock(currentBPM, currentPPQ, hostIsPlaying, buffer.getNumSamples(), grooveMidiEvents);
+    std::array<int, NUM_OUTPUT_GROUPS> groupStartChannels;
     
-    // Trigger notes from groove playback (both main and individual outputs)
-    for (const auto& msg : grooveMidiEvents)
+    for (int group = 0; group < NUM_OUTPUT_GROUPS; ++group)
     {
-        if (msg.isNoteOn())
-        {
-            int note = msg.getNoteNumber();
-            float velocity = msg.getFloatVelocity();
-            
-            // Trigger on main output
-            soundFontManager.noteOn(note, velocity);
-            
-            // Trigger on individual output group for multi-out
-            int groupIndex = getOutputGroupForNote(note);
-            if (groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS)
-            {
-                soundFontManager.noteOnToGroup(note, velocity, groupIndex);
-            }
-            
-            // Track for UI visualization
-            {
-                juce::ScopedLock sl(triggeredNotesLock);
-                recentlyTriggeredNotes.push_back(note);
-            }
-        }
-        else if (msg.isNoteOff())
+        groupStartChannels[group] = -1;
+        
+        int busIndex = group + 1;  // Bus 0 is main, buses 1-16 are individual outputs
+        
+        if (busIndex < getBusCount(false))  // Check if bus exists
         {
-            int note = msg.getNoteNumber();
-            soundFontManager.noteOff(note);
-            
-            // Also release on individual output group
-            int groupIndex = getOutputGroupForNote(note);
-            if (groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS)
+            auto* bus = getBus(false, busIndex);
+            if (bus != nullptr && bus->isEnabled())
             {
-                soundFontManager.noteOffToGroup(note, groupIndex);
+                // Get the channel indices for this bus in the main buffer
+                int startChannel = getChannelIndexInProcessBlockBuffer(false, busIndex, 0);
+                
+                // Extra bounds check: ensure channels exist in buffer before accessing
+                if (startChannel >= 0 && startChannel + 1 < bufferNumChannels)
+                    groupStartChannels[group] = startChannel;
             }
         }
     }
-
+    
+    // Pad settings (including host automation) for this block's hits
+    applyNoteParameters();
+    probe.lap(PerformanceMonitor::Stage::busSetup);
+    
     /*
-        PROCESS MIDI MESSAGES
-        ---------------------
-        MIDI messages have a timestamp within the buffer, but for simplicity
-        we process them all at the start of the buffer.
+        COLLECT SCHEDULED NOTES
+        -----------------------
+        The GrooveManager adds its events at their exact sample offset within
+        this block, and the host's MIDI already carries sample positions.
+        Everything goes into one fixed-size NoteEventBuffer, kept sorted by
+        position - a single timeline for the whole block, with no allocation
+        (host MIDI is read from its raw bytes, no MidiMessage copies).
         
-        In a more advanced implementation, you'd process them at their
-        exact sample position for sample-accurate timing.
+        Pads clicked in the UI arrive through a lock-free queue and are
+        played at the start of the block.
     */
+    scheduledNotes.clear();
+    grooveManager.processBlock(currentBPM, currentPPQ, hostIsPlaying, numSamples, scheduledNotes);
+    
     for (const auto metadata : midiMessages)
+        scheduledNotes.addRawMidi(metadata.data, metadata.numBytes, metadata.samplePosition);
+    
+    UiNoteCommand command;
+    while (uiNoteCommands.pop(command))
+    {
+        if (command.velocity > 0.0f)
+            scheduledNotes.addNoteOn(0, command.note, command.velocity);
+        else
+            scheduledNotes.addNoteOff(0, command.note);
+    }
+    
+    probe.lap(PerformanceMonitor::Stage::grooveScheduling);
+    
+    // Pick up the current kit for the whole block (no locks, see SoundFontManager)
+    const SoundFontManager::ScopedAudioBlock kitBlock(soundFontManager);
+    
+    /*
+        SUB-BLOCK RENDERING (SAMPLE-ACCURATE TIMING)
+        --------------------------------------------
+        Instead of starting every note at sample 0, we render audio UP TO
+        each event's position, apply the event, and carry on. A hit therefore
+        starts exactly where it was scheduled, whatever the buffer size.
+        
+        To keep the cost bounded, segments shorter than minSegmentSamples
+        are not split off: such an event is applied at the current segment
+        boundary instead, at most minSegmentSamples early. A block is
+        therefore never rendered in more than numSamples / minSegmentSamples + 1 pieces.
+    */
+    int renderedUpTo = 0;
+    
+    for (const auto& event : scheduledNotes)
     {
-        auto message = metadata.getMessage();
+        int eventPosition = juce::jlimit(0, numSamples, event.samplePosition);
         
-        if (message.isNoteOn())
+        if (eventPosition - renderedUpTo >= minSegmentSamples)
         {
-            float velocity = message.getFloatVelocity();  // 0.0 to 1.0
-            int note = message.getNoteNumber();           // 0 to 127
-            
-            // Trigger the drum sound on main output
-            soundFontManager.noteOn(note, velocity);
-            
-            // Trigger on individual output group for multi-out
-            int groupIndex = getOutputGroupForNote(note);
-            if (groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS)
-            {
-                soundFontManager.noteOnToGroup(note, velocity, groupIndex);
-            }
+            renderSegment(buffer, groupStartChannels, renderedUpTo, eventPosition - renderedUpTo);
+            renderedUpTo = eventPosition;
+            probe.lap(PerformanceMonitor::Stage::render);
+        }
+        
+        if (event.isNoteOn())
+        {
+            // Trigger the drum sound (rendered once, on its output group)
+            soundFontManager.noteOn(event.note, event.velocity);
             
             /*
                 THREAD-SAFE ACCESS
                 ------------------
                 We need to tell the UI which notes were triggered.
-                The UI runs on a different thread, so we need protection.
+                The UI runs on a different thread, so the notes go through
+                a lock-free ring buffer (if it's full, the UI just misses a flash).
             */
-            {
-                juce::ScopedLock sl(triggeredNotesLock);
-                recentlyTriggeredNotes.push_back(note);
-            }
+            triggeredNotes.push(event.note);
         }
-        else if (message.isNoteOff())
+        else
         {
-            int note = message.getNoteNumber();
-            soundFontManager.noteOff(note);
-            
-            // Also release on individual output group
-            int groupIndex = getOutputGroupForNote(note);
-            if (groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS)
-            {
-                soundFontManager.noteOffToGroup(note, groupIndex);
-            }
+            soundFontManager.noteOff(event.note);
         }
+        
+        probe.lap(PerformanceMonitor::Stage::noteDispatch);
     }
     
-    // Get number of samples to process
-    int numSamples = buffer.getNumSamples();
+    probe.addEvents(scheduledNotes.size());
     
-    // Ensure our render buffer is large enough
-    if (renderBuffer.size() < static_cast<size_t>(numSamples) * 2)
-        renderBuffer.resize(static_cast<size_t>(numSamples) * 2);
+    // Render whatever is left after the last event
+    if (renderedUpTo < numSamples)
+        renderSegment(buffer, groupStartChannels, renderedUpTo, numSamples - renderedUpTo);
+    
+    probe.lap(PerformanceMonitor::Stage::render);
+    
+    // Mix in preview audio if playing (with sample rate conversion)
+    mixPreviewAudio(buffer, numSamples);
     
-    // Ensure multi-out buffers are large enough
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    // And a groove audition from the browser - already rendered, just added
+    groovePreviewCache.mixInto(buffer, numSamples);
+    probe.lap(PerformanceMonitor::Stage::previewMix);
+    
+    if (probe.isActive())
     {
-        if (multiOutBuffers[i].size() < static_cast<size_t>(numSamples) * 2)
-            multiOutBuffers[i].resize(static_cast<size_t>(numSamples) * 2);
+        static_assert(PerformanceMonitor::numGroups == SoundFontManager::NUM_OUTPUT_GROUPS, "One voice count per group");
+        
+        std::array<int, PerformanceMonitor::numVoiceCounts> voiceCounts;
+        soundFontManager.getActiveVoiceCounts(voiceCounts);
+        probe.setActiveVoices(voiceCounts);
     }
+}
+
+/*
+    MIX PREVIEW AUDIO
+    -----------------
+    Plays the Groove Matcher's audio clip through our output.
     
-    /*
-        RENDER AUDIO (MULTI-OUT)
-        ------------------------
-        Render main output and all individual output groups.
-    */
-    std::array<float*, NUM_OUTPUT_GROUPS> groupBufferPtrs;
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    No lock: the clip pointer is atomic, and the fence lets
+    setPreviewAudio()/stopPreviewPlayback() wait until this block is done
+    before the clip can be replaced.
+    
+    The clip isn't one big buffer (see PreviewClip.h), so we copy the
+    source samples a stretch at a time into a fixed scratch buffer and
+    mix from there. A stretch ends at the scratch size or at the end of
+    the clip, whichever comes first.
+    
+    Normally the clip is at the host's rate (converted once, in the
+    background - see PREVIEW AT THE HOST'S RATE), and a stretch is simply
+    added to the output with FloatVectorOperations. Linear interpolation
+    only covers the moment before the converted clip is ready.
+*/
+void JdrummerAudioProcessor::mixPreviewAudio(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const AudioBlockFence::ScopedBlock previewScope(previewFence);
+    
+    if (previewRestartRequested.exchange(false))
+        previewPosition = 0.0;
+    
+    if (!previewPlaying)
+        return;
+    
+    const auto* clip = previewClip.load();
+    if (clip == nullptr || clip->getLengthInSamples() <= 0)
+        return;
+    
+    // Swapped for its resampled copy mid-playback - carry on from the same point in time
+    if (clip != lastPreviewClip)
     {
-        groupBufferPtrs[i] = multiOutBuffers[i].data();
+        if (lastPreviewClip != nullptr)
+            previewPosition *= clip->getSampleRate() / lastPreviewSampleRate;
+        
+        lastPreviewClip = clip;
+        lastPreviewSampleRate = clip->getSampleRate();
     }
     
-    soundFontManager.renderAudioMultiOut(renderBuffer.data(), groupBufferPtrs, numSamples);
-    
-    /*
-        DEINTERLEAVE - MAIN OUTPUT (Bus 0)
-        ----------------------------------
-        JUCE uses separate buffers for each channel, not interleaved.
-    */
+    // Only now is the main bus written (see SILENCE FLAG in processBlock)
     auto* leftChannel = buffer.getWritePointer(0);
     auto* rightChannel = buffer.getWritePointer(1);
     
-    for (int i = 0; i < numSamples; ++i)
-    {
-        leftChannel[i] = renderBuffer[static_cast<size_t>(i) * 2];      // Even indices
-        rightChannel[i] = renderBuffer[static_cast<size_t>(i) * 2 + 1]; // Odd indices
-    }
+    const juce::int64 previewSamples = clip->getLengthInSamples();
     
-    /*
-        COPY TO INDIVIDUAL OUTPUT BUSES (Buses 1-16)
-        --------------------------------------------
-        Each output group goes to its own stereo bus for DAW mixing.
-        
-        NOTE: Some DAWs may not provide all channels we expect.
-        Use bufferNumChannels for bounds checking to prevent crashes.
-    */
-    for (int group = 0; group < NUM_OUTPUT_GROUPS; ++group)
+    // Calculate the playback ratio for sample rate conversion
+    // If audio is 44100 Hz and DAW is 48000 Hz, we need to advance slower
+    // to maintain correct pitch
+    const double playbackRatio = clip->getSampleRate() / hostSampleRate;
+    
+    // Output samples one scratch-full of source covers (leaving room for interpolation)
+    const int scratchSize = static_cast<int>(previewScratch.size());
+    const int maxStretch = juce::jmax(1, static_cast<int>((scratchSize - 3) / playbackRatio));
+    
+    int i = 0;
+    while (i < numSamples)
     {
-        int busIndex = group + 1;  // Bus 0 is main, buses 1-16 are individual outputs
+        // Handle looping - sync groove with audio loop
+        if (previewPosition >= static_cast<double>(previewSamples))
+        {
+            previewPosition = 0.0;
         
-        if (busIndex < getBusCount(false))  // Check if bus exists
+            // Reset groove playback to stay in sync with audio
+            grooveManager.resetPlaybackPosition();
+        }
+        
+        // This stretch stops at the end of the clip, so the wrap above happens between stretches
+        const double outputToClipEnd = (static_cast<double>(previewSamples) - previewPosition) / playbackRatio;
+        const int stretch = juce::jlimit(1, juce::jmin(numSamples - i, maxStretch),
+                                         static_cast<int>(std::ceil(outputToClipEnd)));
+        
+        const auto firstSource = static_cast<juce::int64>(previewPosition);
+        const int sourceSpan = juce::jmin(scratchSize,
+            static_cast<int>(static_cast<juce::int64>(previewPosition + playbackRatio * stretch) - firstSource) + 2);
+        
+        float* source = previewScratch.data();
+        
+        // At the host's rate: the stretch is just the clip's samples
+        if (playbackRatio == 1.0)
         {
-            auto* bus = getBus(false, busIndex);
-            if (bus != nullptr && bus->isEnabled())
-            {
-                // Get the channel indices for this bus in the main buffer
-                int startChannel = getChannelIndexInProcessBlockBuffer(false, busIndex, 0);
-                
-                // Extra bounds check: ensure channels exist in buffer before accessing
-                if (startChannel >= 0 && startChannel + 1 < bufferNumChannels)
-                {
-                    auto* busLeft = buffer.getWritePointer(startChannel);
-                    auto* busRight = buffer.getWritePointer(startChannel + 1);
-                    
-                    for (int i = 0; i < numSamples; ++i)
-                    {
-                        busLeft[i] = multiOutBuffers[group][static_cast<size_t>(i) * 2];
-                        busRight[i] = multiOutBuffers[group][static_cast<size_t>(i) * 2 + 1];
-                    }
-                }
-            }
+            clip->readMono(source, firstSource, stretch);
+            juce::FloatVectorOperations::addWithMultiply(leftChannel + i, source, 0.7f, stretch);  // Mix at 70% volume
+            juce::FloatVectorOperations::addWithMultiply(rightChannel + i, source, 0.7f, stretch);
+            
+            i += stretch;
+            previewPosition += stretch;
+            continue;
         }
-    }
-    
-    // Mix in preview audio if playing (with sample rate conversion)
-    {
-        juce::ScopedLock sl(previewLock);
-        if (previewPlaying && previewBuffer != nullptr && previewBuffer->getNumSamples() > 0)
+        
+        clip->readMono(source, firstSource, sourceSpan);
+        
+        // The sample after the last one is the first one (wrap for interpolation)
+        const auto wrapIndex = previewSamples - firstSource;
+        if (wrapIndex < sourceSpan)
+            clip->readMono(source + wrapIndex, 0, 1);
+        
+        for (int k = 0; k < stretch; ++k, ++i)
         {
-            int previewSamples = previewBuffer->getNumSamples();
-            const float* previewData = previewBuffer->getReadPointer(0);
+            // Get the integer and fractional parts of the position
+            const auto pos0 = static_cast<int>(static_cast<juce::int64>(previewPosition) - firstSource);
+            const int pos1 = juce::jmin(pos0 + 1, sourceSpan - 1);
+            const double frac = previewPosition - std::floor(previewPosition);
             
-            // Calculate the playback rate ratio for sample rate conversion
-            // If audio is 44100 Hz and DAW is 48000 Hz, we need to advance slower
-            // to maintain correct pitch
-            double playbackRatio = previewSampleRate / hostSampleRate;
+            // Linear interpolation between samples for smooth resampling
+            float sample0 = source[pos0];
+            float sample1 = source[pos1];
+            float sample = static_cast<float>(sample0 + (sample1 - sample0) * frac);
             
-            for (int i = 0; i < numSamples; ++i)
-            {
-                // Get the integer and fractional parts of the position
-                int pos0 = static_cast<int>(previewPosition);
-                int pos1 = pos0 + 1;
-                double frac = previewPosition - static_cast<double>(pos0);
-                
-                // Handle looping - sync groove with audio loop
-                if (pos0 >= previewSamples)
-                {
-                    previewPosition = 0.0;
-                    pos0 = 0;
-                    pos1 = 1;
-                    frac = 0.0;
-                    
-                    // Reset groove playback to stay in sync with audio
-                    grooveManager.resetPlaybackPosition();
-                }
-                if (pos1 >= previewSamples)
-                {
-                    pos1 = 0;  // Wrap for interpolation
-                }
-                
-                // Linear interpolation between samples for smooth resampling
-                float sample0 = previewData[pos0];
-                float sample1 = previewData[pos1];
-                float sample = static_cast<float>(sample0 + (sample1 - sample0) * frac);
-                
-                leftChannel[i] += sample * 0.7f;  // Mix at 70% volume
-                rightChannel[i] += sample * 0.7f;
-                
-                // Advance position by the playback ratio
-                previewPosition += playbackRatio;
-            }
+            leftChannel[i] += sample * 0.7f;  // Mix at 70% volume
+            rightChannel[i] += sample * 0.7f;
+            
+            // Advance position by the playback ratio
+            previewPosition += playbackRatio;
         }
     }
 }
 
+/*
+    RENDER SEGMENT
+    --------------
+    Renders samples [startSample, startSample + numSamplesToRender) of the
+    current block straight into the main bus (0) and each enabled group's
+    bus (1-16). TSF renders unweaved, into the same separate left/right
+    channels the host gave us, so there is no copy and no deinterleave.
+    
+    The SoundFontManager is asked first which outputs have voices: only
+    their channels are fetched for writing, the others stay cleared (and
+    the buffer stays flagged silent if nothing plays at all).
+*/
+void JdrummerAudioProcessor::renderSegment(juce::AudioBuffer<float>& buffer,
+                                           const std::array<int, NUM_OUTPUT_GROUPS>& groupStartChannels,
+                                           int startSample, int numSamplesToRender)
+{
+    const auto sounding = soundFontManager.getSoundingOutputs();
+    
+    // Nothing playing on any bus - the output stays cleared
+    if (!sounding.main)
+        return;
+    
+    const SoundFontManager::StereoBuffer mainBus { buffer.getWritePointer(0, startSample),
+                                                   buffer.getWritePointer(1, startSample) };
+    
+    std::array<SoundFontManager::StereoBuffer, NUM_OUTPUT_GROUPS> groupBuses {};
+    for (int group = 0; group < NUM_OUTPUT_GROUPS; ++group)
+    {
+        const int startChannel = groupStartChannels[group];
+        if (startChannel < 0 || !sounding.groups[group])
+            continue;
+        
+        groupBuses[group] = { buffer.getWritePointer(startChannel, startSample),
+                              buffer.getWritePointer(startChannel + 1, startSample) };
+    }
+    
+    soundFontManager.renderAudioMultiOut(mainBus, groupBuses, numSamplesToRender);
+}
+
 // Does this plugin have a UI?
 bool JdrummerAudioProcessor::hasEditor() const
 {
@@ -696,126 +945,274 @@ void JdrummerAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
     
     // setProperty adds key-value pairs to the tree
     // nullptr is the UndoManager - we don't need undo for state saving
-    state.setProperty("currentKit", soundFontManager.getCurrentKitName(), nullptr);
+    state.setProperty("currentKit", getChosenKitName(), nullptr);
     state.setProperty("soundFontsPath", soundFontManager.getSoundFontsPath().getFullPathName(), nullptr);
     
-    // Create a child tree for per-note settings
-    juce::ValueTree noteSettings("NoteSettings");
-    for (int note = 35; note <= 81; ++note)
+    // A restored state not applied yet is what the project holds (see DEFERRED KIT LOAD)
+    const auto restored = getRestoredState();
+    
+    state.setProperty("parallelRender", restored.isValid() ? restored.getProperty("parallelRender", false)
+                                                           : juce::var(soundFontManager.isParallelRenderingEnabled()),
+                      nullptr);
+    
+    // Swing, humanize & co. of the grooves
+    if (restored.isValid())
     {
-        juce::ValueTree noteSetting("Note");
-        noteSetting.setProperty("number", note, nullptr);
-        noteSetting.setProperty("volume", soundFontManager.getNoteVolume(note), nullptr);
-        noteSetting.setProperty("pan", soundFontManager.getNotePan(note), nullptr);
-        noteSettings.appendChild(noteSetting, nullptr);
+        const auto transformState = restored.getChildWithName(GrooveTransform::stateType);
+        state.appendChild(transformState.isValid() ? transformState.createCopy() : GrooveTransform().toValueTree(), nullptr);
+    }
+    else
+    {
+        state.appendChild(grooveManager.getTransform().toValueTree(), nullptr);
     }
-    state.appendChild(noteSettings, nullptr);
     
-    /*
-        SMART POINTERS
-        --------------
-        std::unique_ptr is a "smart pointer" that automatically deletes
-        its object when it goes out of scope. No manual delete needed!
+    // Pad volume, pan, mute and round-robin live in the parameter tree
+    if (restored.isValid())
+    {
+        auto parameterState = restored.getChildWithName(parameters.state.getType());
+        if (!parameterState.isValid())
+            parameterState = restored.getChildWithName("NoteSettings");  // Kept as an older project had it
         
-        This prevents memory leaks - a common bug in C++.
-    */
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+        if (parameterState.isValid())
+            state.appendChild(parameterState.createCopy(), nullptr);
+    }
+    else
+    {
+        state.appendChild(parameters.copyState(), nullptr);
+    }
+    
+    // Compact binary, not XML (see PluginStateFormat.h)
+    PluginStateFormat::write(state, destData);
 }
 
 void JdrummerAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // Parse the binary data back into XML
-    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+    // The binary chunk, or the XML one older projects were saved with
+    juce::ValueTree state = PluginStateFormat::read(data, sizeInBytes);
     
-    if (xml != nullptr)
+    if (!state.isValid())
+        return;
+    
+    // Restore soundfonts path
+    juce::String sfPath = state.getProperty("soundFontsPath", "");
+    if (sfPath.isNotEmpty())
     {
-        // Convert XML to ValueTree
-        juce::ValueTree state = juce::ValueTree::fromXml(*xml);
-        
-        if (state.isValid())
+        juce::File path(sfPath);
+        if (path.exists() && path.isDirectory())
         {
-            // Restore soundfonts path
-            juce::String sfPath = state.getProperty("soundFontsPath", "");
-            if (sfPath.isNotEmpty())
-            {
-                juce::File path(sfPath);
-                if (path.exists() && path.isDirectory())
-                {
-                    soundFontManager.setSoundFontsPath(path);
-                }
-            }
-            
-            // Restore kit selection
-            juce::String kitName = state.getProperty("currentKit", "");
-            if (kitName.isNotEmpty())
-            {
-                soundFontManager.loadKit(kitName);
-            }
-            
-            // Restore per-note settings
-            auto noteSettings = state.getChildWithName("NoteSettings");
-            if (noteSettings.isValid())
-            {
-                for (int i = 0; i < noteSettings.getNumChildren(); ++i)
-                {
-                    auto noteSetting = noteSettings.getChild(i);
-                    int note = noteSetting.getProperty("number", 0);
-                    float volume = noteSetting.getProperty("volume", 0.5f);  // Default 50%
-                    float pan = noteSetting.getProperty("pan", 0.0f);
-                    
-                    soundFontManager.setNoteVolume(note, volume);
-                    soundFontManager.setNotePan(note, pan);
-                }
-            }
+            soundFontManager.setSoundFontsPath(path);
+        }
+    }
+    
+    // Restore kit selection - only recorded here, loaded in the background
+    // once the message thread gets to it (see DEFERRED KIT LOAD)
+    juce::String kitName = state.getProperty("currentKit", "");
+    if (kitName.isNotEmpty())
+    {
+        requestKit(kitName);
+    }
+    
+    // Pad settings, render setting and groove transform - applied on the message thread, with the kit
+    {
+        const CheckedCriticalSection::ScopedLockType sl(requestLock);
+        restoredState = state;
+    }
+    
+    // Listeners hear that state was restored on the message thread
+    triggerAsyncUpdate();
+}
+
+void JdrummerAudioProcessor::applyRestoredState(const juce::ValueTree& state)
+{
+    // Multi-out group rendering on worker threads (off in older projects)
+    soundFontManager.setParallelRenderingEnabled(state.getProperty("parallelRender", false));
+    
+    // Groove transform (none in older projects) - waits for the audio block in progress
+    grooveManager.setTransform(GrooveTransform::fromValueTree(state.getChildWithName(GrooveTransform::stateType)));
+    
+    // Restore pad settings
+    auto parameterState = state.getChildWithName(parameters.state.getType());
+    if (parameterState.isValid())
+    {
+        parameters.replaceState(parameterState);
+    }
+    else
+    {
+        // Projects saved before the pad parameters existed
+        auto noteSettings = state.getChildWithName("NoteSettings");
+        for (int i = 0; i < noteSettings.getNumChildren(); ++i)
+        {
+            auto noteSetting = noteSettings.getChild(i);
+            int note = noteSetting.getProperty("number", 0);
+            float volume = noteSetting.getProperty("volume", 0.5f);  // Default 50%
+            float pan = noteSetting.getProperty("pan", 0.0f);
             
-            // Notify listeners that state was restored
-            if (onKitLoaded)
-                onKitLoaded();
+            if (auto* parameter = parameters.getParameter(getNoteParameterID(note, "volume")))
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(volume));
+            if (auto* parameter = parameters.getParameter(getNoteParameterID(note, "pan")))
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(pan));
         }
     }
+    
+    applyNoteParameters();
 }
 
-// Trigger a note from the UI (when user clicks a pad)
-void JdrummerAudioProcessor::triggerNote(int note, float velocity)
+/*
+    PAD PARAMETER LAYOUT
+    --------------------
+    Four parameters per GM drum note, named after the GM instrument so
+    they are easy to find in a host's automation list. Defaults match the
+    SoundFontManager's (50% volume, centre, not muted, no round-robin).
+*/
+juce::AudioProcessorValueTreeState::ParameterLayout JdrummerAudioProcessor::createParameterLayout()
 {
-    // Trigger on main output
-    soundFontManager.noteOn(note, velocity);
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
     
-    // Trigger on individual output group for multi-out
-    int groupIndex = getOutputGroupForNote(note);
-    if (groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS)
+    for (int note = firstPadNote; note <= lastPadNote; ++note)
     {
-        soundFontManager.noteOnToGroup(note, velocity, groupIndex);
+        const juce::String name = juce::MidiMessage::getRhythmInstrumentName(note);
+        
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { getNoteParameterID(note, "volume"), 1 },
+                                                               name + " Volume",
+                                                               juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.5f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { getNoteParameterID(note, "pan"), 1 },
+                                                               name + " Pan",
+                                                               juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f), 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { getNoteParameterID(note, "mute"), 1 },
+                                                              name + " Mute", false));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { getNoteParameterID(note, "roundrobin"), 1 },
+                                                              name + " Round-Robin", false));
     }
+    
+    return layout;
 }
 
-void JdrummerAudioProcessor::releaseNote(int note)
+juce::String JdrummerAudioProcessor::getNoteParameterID(int note, const juce::String& setting)
+{
+    return "note" + juce::String(note) + "_" + setting;
+}
+
+const JdrummerAudioProcessor::NoteParameters* JdrummerAudioProcessor::getNoteParameters(int note) const
+{
+    if (note < firstPadNote || note > lastPadNote)
+        return nullptr;
+    
+    return &noteParameters[static_cast<size_t>(note - firstPadNote)];
+}
+
+/*
+    SET NOTE PARAMETER
+    ------------------
+    A UI change is a whole gesture, so the host records it like a knob
+    move. The SoundFontManager is updated right away as well - without
+    waiting for the next block, which might never come with the
+    transport stopped.
+*/
+bool JdrummerAudioProcessor::setNoteParameter(int note, const juce::String& setting, float value)
 {
-    // Release on main output
-    soundFontManager.noteOff(note);
+    auto* parameter = parameters.getParameter(getNoteParameterID(note, setting));
+    if (parameter == nullptr)
+        return false;
     
-    // Release on individual output group
-    int groupIndex = getOutputGroupForNote(note);
-    if (groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS)
+    parameter->beginChangeGesture();
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    parameter->endChangeGesture();
+    return true;
+}
+
+void JdrummerAudioProcessor::setNoteVolume(int note, float volume)
+{
+    setNoteParameter(note, "volume", volume);
+    soundFontManager.setNoteVolume(note, volume);
+}
+
+void JdrummerAudioProcessor::setNotePan(int note, float pan)
+{
+    setNoteParameter(note, "pan", pan);
+    soundFontManager.setNotePan(note, pan);
+}
+
+void JdrummerAudioProcessor::setNoteMute(int note, bool muted)
+{
+    setNoteParameter(note, "mute", muted ? 1.0f : 0.0f);
+    soundFontManager.setNoteMute(note, muted);
+}
+
+void JdrummerAudioProcessor::setNoteRoundRobin(int note, bool enabled)
+{
+    setNoteParameter(note, "roundrobin", enabled ? 1.0f : 0.0f);
+    soundFontManager.setNoteRoundRobin(note, enabled);
+}
+
+float JdrummerAudioProcessor::getNoteVolume(int note) const
+{
+    const auto* values = getNoteParameters(note);
+    return values != nullptr ? values->volume->load() : soundFontManager.getNoteVolume(note);
+}
+
+float JdrummerAudioProcessor::getNotePan(int note) const
+{
+    const auto* values = getNoteParameters(note);
+    return values != nullptr ? values->pan->load() : soundFontManager.getNotePan(note);
+}
+
+bool JdrummerAudioProcessor::getNoteMute(int note) const
+{
+    const auto* values = getNoteParameters(note);
+    return values != nullptr ? values->mute->load() >= 0.5f : soundFontManager.getNoteMute(note);
+}
+
+bool JdrummerAudioProcessor::getNoteRoundRobin(int note) const
+{
+    const auto* values = getNoteParameters(note);
+    return values != nullptr ? values->roundRobin->load() >= 0.5f : soundFontManager.getNoteRoundRobin(note);
+}
+
+void JdrummerAudioProcessor::applyNoteParameters() noexcept
+{
+    for (int note = firstPadNote; note <= lastPadNote; ++note)
     {
-        soundFontManager.noteOffToGroup(note, groupIndex);
+        const auto& values = noteParameters[static_cast<size_t>(note - firstPadNote)];
+        
+        soundFontManager.setNoteVolume(note, values.volume->load(std::memory_order_relaxed));
+        soundFontManager.setNotePan(note, values.pan->load(std::memory_order_relaxed));
+        soundFontManager.setNoteMute(note, values.mute->load(std::memory_order_relaxed) >= 0.5f);
+        soundFontManager.setNoteRoundRobin(note, values.roundRobin->load(std::memory_order_relaxed) >= 0.5f);
     }
 }
 
+/*
+    TRIGGER NOTE FROM THE UI
+    ------------------------
+    Called on the message thread when the user clicks a pad. The note is
+    pushed onto a lock-free queue that processBlock drains at the start
+    of the next block (velocity 0 = note off).
+*/
+void JdrummerAudioProcessor::triggerNote(int note, float velocity)
+{
+    uiNoteCommands.push({ note, juce::jmax(velocity, 0.001f) });
+}
+
+void JdrummerAudioProcessor::releaseNote(int note)
+{
+    uiNoteCommands.push({ note, 0.0f });
+}
+
 /*
     GET AND CLEAR TRIGGERED NOTES
     -----------------------------
-    Thread-safe method to get notes that were triggered since last check.
-    
-    std::move transfers ownership of the vector's contents without copying.
-    This is more efficient than copying the entire vector.
+    Drains the notes the audio thread has played since the last call.
+    Message thread only (the queue's single consumer).
 */
 std::vector<int> JdrummerAudioProcessor::getAndClearTriggeredNotes()
 {
-    juce::ScopedLock sl(triggeredNotesLock);
-    std::vector<int> notes = std::move(recentlyTriggeredNotes);
-    recentlyTriggeredNotes.clear();
+    std::vector<int> notes;
+    notes.reserve(static_cast<size_t>(triggeredNotes.getNumReady()));
+    
+    int note;
+    while (triggeredNotes.pop(note))
+        notes.push_back(note);
+    
     return notes;
 }
 
@@ -824,27 +1221,107 @@ std::vector<int> JdrummerAudioProcessor::getAndClearTriggeredNotes()
     ----------------------
     These methods allow the Groove Matcher to play audio clips
     through the plugin's audio output.
+    
+    Before the clip pointer changes (or the caller is allowed to touch the
+    clip again after stopping), we wait for the audio block that may be
+    reading it to finish.
+*/
+void JdrummerAudioProcessor::setPreviewAudio(const PreviewClip* clip)
+{
+    previewPlaying = false;
+    
+    // A conversion of the old clip may still be reading it
+    cancelPreviewResampling();
+    
+    const CheckedCriticalSection::ScopedLockType sl(previewClipLock);
+    previewFence.waitForBlockToFinish();
+    
+    previewClip = clip;
+    previewRestartRequested = true;
+    
+    previewSourceClip = clip;
+    resampledPreviewClip.reset();  // Nobody can be playing it any more
+    startPreviewResampling();
+}
+
+/*
+    PREVIEW RESAMPLING
+    ------------------
+    One worker converts the current clip to the host's rate. When it's
+    done - and the clip is still the current one - the copy is published
+    like any other clip: swap the pointer, wait for the block that may be
+    reading the old one, then free it.
 */
-void JdrummerAudioProcessor::setPreviewAudio(juce::AudioBuffer<float>* buffer, double sampleRate)
+void JdrummerAudioProcessor::startPreviewResampling()
+{
+    const auto* source = previewSourceClip;
+    const double targetSampleRate = hostSampleRate;
+    
+    if (source == nullptr || source->getSampleRate() == targetSampleRate)
+        return;
+    
+    previewResamplerPool.addJob([this, source, targetSampleRate]
+    {
+        auto resampled = PreviewClip::createResampled(*source, targetSampleRate,
+                                                      [this] { return previewResamplingCancelled.load(); });
+        if (resampled == nullptr)
+            return;
+        
+        const CheckedCriticalSection::ScopedLockType sl(previewClipLock);
+        if (previewSourceClip != source || previewResamplingCancelled)
+            return;
+        
+        auto replaced = std::move(resampledPreviewClip);
+        resampledPreviewClip = std::move(resampled);
+        previewClip = resampledPreviewClip.get();
+        
+        previewFence.waitForBlockToFinish();
+        replaced.reset();
+        
+        DBG("Preview clip resampled to " + juce::String(targetSampleRate) + " Hz");
+    });
+}
+
+void JdrummerAudioProcessor::cancelPreviewResampling()
 {
-    juce::ScopedLock sl(previewLock);
-    previewBuffer = buffer;
-    previewSampleRate = sampleRate;
-    previewPosition = 0.0;
+    previewResamplingCancelled = true;
+    previewResamplerPool.removeAllJobs(true, 10000);
+    previewResamplingCancelled = false;
+}
+
+void JdrummerAudioProcessor::updatePreviewForHostRate()
+{
+    cancelPreviewResampling();
+    
+    const CheckedCriticalSection::ScopedLockType sl(previewClipLock);
+    
+    if (previewSourceClip == nullptr)
+        return;
+    
+    // The clip itself is now at the host's rate - drop the converted copy
+    if (previewSourceClip->getSampleRate() == hostSampleRate)
+    {
+        previewClip = previewSourceClip;
+        previewFence.waitForBlockToFinish();
+        resampledPreviewClip.reset();
+        return;
+    }
+    
+    // Until the new copy is ready, whichever clip is playing is interpolated
+    startPreviewResampling();
 }
 
 void JdrummerAudioProcessor::startPreviewPlayback()
 {
-    juce::ScopedLock sl(previewLock);
-    previewPosition = 0.0;
+    previewRestartRequested = true;
     previewPlaying = true;
 }
 
 void JdrummerAudioProcessor::stopPreviewPlayback()
 {
-    juce::ScopedLock sl(previewLock);
     previewPlaying = false;
-    previewPosition = 0.0;
+    previewRestartRequested = true;
+    previewFence.waitForBlockToFinish();
 }
 
 /*
@@ -23,7 +23,16 @@
 #include "JuceHeader.h"        // JUCE framework - provides audio, UI, and utility classes
 #include "SoundFontManager.h"  // Our custom class for managing SF2 soundfonts
 #include "GrooveManager.h"     // Our custom class for managing groove MIDI files
+#include "RealtimeSafety.h"    // Lock-free helpers for talking to the audio thread
+#include "NoteEventBuffer.h"    // Fixed-size, allocation-free note schedule for one block
+#include "PreviewClip.h"       // Memory-mapped Bandmate clip for preview playback
+#include "LiveBandmate.h"      // Live groove matching from the sidechain input
+#include "OfflineRenderer.h"   // Faster-than-real-time bounce to audio files
+#include "PerformanceMonitor.h"  // Stage timings of processBlock() for the diagnostics tab
+#include "GroovePreviewCache.h"  // Pre-rendered groove auditions for the browser
+#include "PluginStateFormat.h"    // Binary state chunk for the host's project
 #include <array>
+#include <atomic>
 
 /*
     CLASS DECLARATION
@@ -43,7 +52,8 @@
     
     We must OVERRIDE certain virtual methods to customize behavior.
 */
-class JdrummerAudioProcessor : public juce::AudioProcessor
+class JdrummerAudioProcessor : public juce::AudioProcessor,
+                               private juce::AsyncUpdater
 {
 public:
     /*
@@ -129,10 +139,64 @@ public:
     // This allows external code to interact with our sound font manager
     SoundFontManager& getSoundFontManager() { return soundFontManager; }
     
+    // Load a kit in the background; onKitLoaded is called (on the message thread) when it's ready
+    void loadKitAsync(const juce::String& kitName);
+    
+    // Load a kit once the message thread gets to it (any thread; a later request replaces this one)
+    void requestKit(const juce::String& kitName);
+    
+    // Do what a restore or requestKit() left for the message thread now, instead of
+    // when its loop gets to it (message thread - for jdrummer_bench's state benchmark)
+    void finishPendingRequests() { handleUpdateNowIfNeeded(); }
+    
     // Returns a REFERENCE to our GrooveManager for groove playback
     GrooveManager& getGrooveManager() { return grooveManager; }
     
+    // Live Bandmate: groove matching from the "Sidechain" input bus
+    LiveBandmate& getLiveBandmate() { return liveBandmate; }
+    
+    // Bounces grooves/compositions to audio files on a worker thread
+    OfflineRenderer& getOfflineRenderer() { return offlineRenderer; }
+    
+    // Auditions grooves from the browser as audio rendered in the background
+    GroovePreviewCache& getGroovePreviewCache() { return groovePreviewCache; }
+    
+    // Audio thread profiler, read by the (hidden) diagnostics tab
+    PerformanceMonitor& getPerformanceMonitor() { return performanceMonitor; }
+    
+    /*
+        PAD PARAMETERS
+        --------------
+        Volume, pan, mute and round-robin of every GM drum note (35-81) are real host
+        parameters in an AudioProcessorValueTreeState, so the DAW can
+        automate them and saves them with the project. The audio thread
+        never touches the tree itself: at the start of each block it
+        copies the parameters' raw (atomic) values into the
+        SoundFontManager's per-note arrays, which every hit reads.
+    */
+    static constexpr int firstPadNote = 35;
+    static constexpr int lastPadNote = 81;
+    
+    juce::AudioProcessorValueTreeState& getParameters() { return parameters; }
+    
+    // ID of one pad setting ("volume", "pan", "mute" or "roundrobin"), e.g. "note36_volume"
+    static juce::String getNoteParameterID(int note, const juce::String& setting);
+    
+    // Change a pad setting as the user - the host is told (and can record it)
+    // Message thread; notes without parameters go straight to the SoundFontManager
+    void setNoteVolume(int note, float volume);
+    void setNotePan(int note, float pan);
+    void setNoteMute(int note, bool muted);
+    void setNoteRoundRobin(int note, bool enabled);
+    
+    // Current pad settings, including host automation (any thread)
+    float getNoteVolume(int note) const;
+    float getNotePan(int note) const;
+    bool getNoteMute(int note) const;
+    bool getNoteRoundRobin(int note) const;
+    
     // Methods to trigger sounds from the UI (when user clicks pads)
+    // Queued lock-free and played at the start of the next audio block
     void triggerNote(int note, float velocity);
     void releaseNote(int note);
     
@@ -148,13 +212,15 @@ public:
     bool isHostPlaying() const { return hostIsPlaying; }
     
     // Audio preview for Groove Matcher
-    void setPreviewAudio(juce::AudioBuffer<float>* buffer, double sampleRate);
+    // The clip must outlive its playback (the Bandmate panel's analyzer owns it)
+    // A clip at another rate than the host's is converted in the background
+    void setPreviewAudio(const PreviewClip* clip);
     void startPreviewPlayback();
     void stopPreviewPlayback();
     bool isPreviewPlaying() const { return previewPlaying; }
     
     // Returns notes that were triggered by MIDI input (for UI visualization)
-    // Returns by VALUE (copy) - safe for cross-thread access
+    // Returns by VALUE (copy) - call from the message thread only
     std::vector<int> getAndClearTriggeredNotes();
     
     /*
@@ -169,6 +235,44 @@ public:
     std::function<void()> onKitLoaded;
 
 private:
+    // Applies a restored state and starts a requested kit load, and delivers
+    // onKitLoaded on the message thread after a background kit load or a state restore
+    void handleAsyncUpdate() override;
+    
+    // What requestKit() and setStateInformation() asked for, not yet acted on (under requestLock):
+    // the kit, and the restored state whose pad parameters, render setting and transform are still to be applied
+    CheckedCriticalSection requestLock;
+    juce::String requestedKitName;
+    juce::ValueTree restoredState;
+    
+    // The kit a saved state should name: requested, loading, or loaded
+    juce::String getChosenKitName() const;
+    
+    // The restored state handleAsyncUpdate() hasn't applied yet (invalid if there is none)
+    juce::ValueTree getRestoredState() const;
+    
+    // Pad parameters, render setting and groove transform of a restored state - message thread
+    // (see DEFERRED KIT LOAD)
+    void applyRestoredState(const juce::ValueTree& state);
+    
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    
+    // Raw values of one pad's parameters (owned by the tree, never null for a pad note)
+    struct NoteParameters
+    {
+        std::atomic<float>* volume = nullptr;
+        std::atomic<float>* pan = nullptr;
+        std::atomic<float>* mute = nullptr;
+        std::atomic<float>* roundRobin = nullptr;
+    };
+    const NoteParameters* getNoteParameters(int note) const;
+    
+    // Set one parameter with a complete change gesture (false if there is no such parameter)
+    bool setNoteParameter(int note, const juce::String& setting, float value);
+    
+    // Copy every pad parameter into the SoundFontManager - no locks, no allocation
+    void applyNoteParameters() noexcept;
+    
     /*
         PRIVATE SECTION
         ---------------
@@ -189,33 +293,92 @@ private:
     // GrooveManager for handling MIDI groove playback
     GrooveManager grooveManager;
     
-    // Buffer for rendering audio from the soundfont
-    // std::vector is a dynamic array that can grow/shrink
-    std::vector<float> renderBuffer;
+    // Listens to the sidechain input (declared after grooveManager, which it uses)
+    LiveBandmate liveBandmate { grooveManager };
     
-    // Multi-out buffers for individual pad outputs
-    std::array<std::vector<float>, NUM_OUTPUT_GROUPS> multiOutBuffers;
+    // Renders with its own kit voices (declared after soundFontManager, which it uses)
+    OfflineRenderer offlineRenderer { soundFontManager };
     
-    // Track notes triggered by MIDI for UI visualization
-    std::vector<int> recentlyTriggeredNotes;
+    // Renders and plays groove auditions (declared after both managers, which it uses)
+    GroovePreviewCache groovePreviewCache { soundFontManager, grooveManager };
     
-    // THREAD SAFETY: CriticalSection is a mutex (mutual exclusion lock)
-    // Audio processing happens on a different thread than the UI
-    // We need to protect shared data from simultaneous access
-    juce::CriticalSection triggeredNotesLock;
+    // The host parameters (see PAD PARAMETERS) and their raw values, by pad
+    juce::AudioProcessorValueTreeState parameters;
+    std::array<NoteParameters, lastPadNote - firstPadNote + 1> noteParameters {};
     
-    // DAW tempo and playback state
-    double currentBPM = 120.0;
+    // Groove, host MIDI and pad notes for the current block, sorted by sample position
+    NoteEventBuffer scheduledNotes;
+    
+    // Records processBlock()'s stage timings while switched on
+    PerformanceMonitor performanceMonitor;
+    
+    // Events closer together than this are not split into separate render
+    // segments (bounds the cost of sample-accurate scheduling)
+    static constexpr int minSegmentSamples = 16;
+    
+    // Render part of the current block into the output buses
+    // (groupStartChannels: first channel of each enabled group's bus, -1 = disabled)
+    // (buses with nothing playing aren't touched)
+    void renderSegment(juce::AudioBuffer<float>& buffer,
+                       const std::array<int, NUM_OUTPUT_GROUPS>& groupStartChannels,
+                       int startSample, int numSamplesToRender);
+    
+    /*
+        LOCK-FREE QUEUES
+        ----------------
+        Audio processing happens on a different thread than the UI.
+        Instead of a mutex (which could make the audio thread wait for
+        the UI), each direction gets its own single-producer/single-consumer
+        queue: pad clicks go UI -> audio, played notes go audio -> UI.
+    */
+    struct UiNoteCommand
+    {
+        int note = 0;
+        float velocity = 0.0f;  // 0 = note off
+    };
+    SpscQueue<UiNoteCommand, 256> uiNoteCommands;
+    SpscQueue<int, 512> triggeredNotes;
+    
+    // DAW tempo and playback state (written by the audio thread, read by the UI)
+    std::atomic<double> currentBPM { 120.0 };
     double currentPPQ = 0.0;
-    bool hostIsPlaying = false;
+    std::atomic<bool> hostIsPlaying { false };
     
     // Audio preview playback
-    juce::AudioBuffer<float>* previewBuffer = nullptr;
-    double previewSampleRate = 44100.0;
-    double previewPosition = 0.0;  // Use double for fractional position (resampling)
-    bool previewPlaying = false;
+    // Mixes into the main bus (left untouched if no preview is playing)
+    void mixPreviewAudio(juce::AudioBuffer<float>& buffer, int numSamples);
+    std::atomic<const PreviewClip*> previewClip { nullptr };
+    std::atomic<bool> previewPlaying { false };
+    std::atomic<bool> previewRestartRequested { false };
+    double previewPosition = 0.0;  // Use double for fractional position (resampling) - audio thread only
     double hostSampleRate = 44100.0;  // The DAW's sample rate
-    juce::CriticalSection previewLock;
+    AudioBlockFence previewFence;
+    
+    // Source samples for one stretch of preview output (audio thread only)
+    std::array<float, 4096> previewScratch {};
+    
+    // The clip the last block played, and its rate (audio thread only)
+    const PreviewClip* lastPreviewClip = nullptr;
+    double lastPreviewSampleRate = 44100.0;
+    
+    /*
+        PREVIEW AT THE HOST'S RATE
+        --------------------------
+        A clip at another rate than the host's plays through linear
+        interpolation only until its resampled copy (PreviewClip::
+        createResampled) is ready; then the worker swaps the copy in and
+        the audio thread just copies samples. Protected by previewClipLock
+        (never taken by the audio thread).
+    */
+    void startPreviewResampling();   // previewClipLock held
+    void cancelPreviewResampling();  // previewClipLock NOT held (waits for the worker)
+    void updatePreviewForHostRate();
+    
+    CheckedCriticalSection previewClipLock;
+    const PreviewClip* previewSourceClip = nullptr;    // As handed to setPreviewAudio()
+    std::unique_ptr<PreviewClip> resampledPreviewClip; // Its copy at hostSampleRate
+    std::atomic<bool> previewResamplingCancelled { false };
+    juce::ThreadPool previewResamplerPool { 1 };
     
     /*
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR
@@ -0,0 +1,77 @@
+/*
+    PluginStateFormat.cpp
+    =====================
+    
+    Implementation of the state chunk formats.
+*/
+
+#include "PluginStateFormat.h"
+
+namespace PluginStateFormat
+{
+    namespace
+    {
+        constexpr int headerSize = 12;
+    }
+    
+    void write(const juce::ValueTree& state, juce::MemoryBlock& destData)
+    {
+        destData.reset();
+        juce::MemoryOutputStream out(destData, false);
+        
+        out.writeInt(static_cast<int>(magic));
+        out.writeInt(formatVersion);
+        out.writeInt(0);  // Size, filled in below
+        
+        state.writeToStream(out);
+        out.flush();
+        
+        const auto treeSize = static_cast<int>(out.getPosition()) - headerSize;
+        out.setPosition(8);
+        out.writeInt(treeSize);
+        out.flush();
+    }
+    
+    void writeXml(const juce::ValueTree& state, juce::MemoryBlock& destData)
+    {
+        destData.reset();
+        
+        if (auto xml = state.createXml())
+            juce::AudioProcessor::copyXmlToBinary(*xml, destData);
+    }
+    
+    juce::ValueTree read(const void* data, int sizeInBytes)
+    {
+        if (data == nullptr || sizeInBytes < headerSize)
+            return {};
+        
+        juce::MemoryInputStream in(data, static_cast<size_t>(sizeInBytes), false);
+        
+        if (static_cast<juce::uint32>(in.readInt()) != magic)
+        {
+            // Not ours - perhaps a project saved by an earlier version
+            if (auto xml = juce::AudioProcessor::getXmlFromBinary(data, sizeInBytes))
+                return juce::ValueTree::fromXml(*xml);
+            
+            return {};
+        }
+        
+        const int version = in.readInt();
+        const int treeSize = in.readInt();
+        
+        if (version != formatVersion)
+        {
+            DBG("PluginStateFormat: Unknown state version " + juce::String(version));
+            return {};
+        }
+        
+        if (treeSize <= 0 || treeSize > sizeInBytes - headerSize)
+        {
+            DBG("PluginStateFormat: Truncated state");
+            return {};
+        }
+        
+        return juce::ValueTree::readFromData(static_cast<const char*>(data) + headerSize,
+                                             static_cast<size_t>(treeSize));
+    }
+}
@@ -0,0 +1,53 @@
+/*
+    PluginStateFormat.h
+    ===================
+    
+    How the plugin's state is stored in the host's project.
+    
+    BINARY CHUNK
+    ------------
+    The state is a juce::ValueTree (see JdrummerAudioProcessor::
+    getStateInformation()). It used to be saved as XML: every pad
+    parameter a text element, every value printed and parsed again -
+    the bulk of a project's restore time, for something no one reads.
+    It is now saved in ValueTree's own binary form behind a small
+    header:
+    
+        magic     4 bytes   "JDST"
+        version   int32     formatVersion
+        size      int32     bytes of tree data that follow
+        tree      ValueTree::writeToStream()
+    
+    The version is of the chunk's layout, not of what is in the tree
+    (new properties and children need no new version - older projects
+    simply don't have them). A chunk from a newer, unknown version is
+    not guessed at: read() returns an invalid tree and the plugin keeps
+    its defaults.
+    
+    OLDER PROJECTS
+    --------------
+    read() still accepts the XML chunks earlier versions saved
+    (AudioProcessor::copyXmlToBinary()), and writeXml() can still write
+    one - for comparison (jdrummer_bench --benchmark state) or for
+    looking at a state by eye.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace PluginStateFormat
+{
+    // "JDST", little-endian - never the same as copyXmlToBinary()'s header
+    constexpr juce::uint32 magic = 0x5453444a;
+    constexpr int formatVersion = 1;
+    
+    // The state as a binary chunk (replaces destData's contents)
+    void write(const juce::ValueTree& state, juce::MemoryBlock& destData);
+    
+    // The state as the XML chunk earlier versions saved
+    void writeXml(const juce::ValueTree& state, juce::MemoryBlock& destData);
+    
+    // The state from either chunk; invalid if the data is neither (or is damaged)
+    juce::ValueTree read(const void* data, int sizeInBytes);
+}
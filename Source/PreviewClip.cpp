@@ -0,0 +1,104 @@
+/*
+    PreviewClip.cpp
+    ===============
+    
+    Memory-mapped (or decoded) playback of the Bandmate clip.
+*/
+
+#include "PreviewClip.h"
+#include "Resampler.h"
+#include <limits>
+
+std::unique_ptr<PreviewClip> PreviewClip::open(const juce::File& file, juce::AudioFormatManager& formatManager)
+{
+    std::unique_ptr<PreviewClip> clip(new PreviewClip());
+    
+    // Uncompressed formats can be played straight from a mapping of the file
+    if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+        
+        if (mapped != nullptr && mapped->lengthInSamples > 0 && mapped->mapEntireFile())
+        {
+            clip->sampleRate = mapped->sampleRate;
+            clip->lengthInSamples = mapped->lengthInSamples;
+            clip->mappedReader = std::move(mapped);
+            return clip;
+        }
+    }
+    
+    // Compressed formats: decode the left channel into memory
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0
+        || reader->lengthInSamples > std::numeric_limits<int>::max())
+    {
+        return nullptr;
+    }
+    
+    const int numSamples = static_cast<int>(reader->lengthInSamples);
+    clip->decodedSamples.setSize(1, numSamples);
+    reader->read(&clip->decodedSamples, 0, numSamples, 0, true, false);
+    
+    clip->sampleRate = reader->sampleRate;
+    clip->lengthInSamples = numSamples;
+    return clip;
+}
+
+std::unique_ptr<PreviewClip> PreviewClip::createResampled(const PreviewClip& source, double targetSampleRate,
+                                                        const std::function<bool()>& shouldStop)
+{
+    const Resampler resampler(source.sampleRate, targetSampleRate);
+    
+    const auto outputLength = resampler.getOutputLength(source.lengthInSamples);
+    if (outputLength <= 0 || outputLength > std::numeric_limits<int>::max())
+        return nullptr;
+    
+    std::unique_ptr<PreviewClip> clip(new PreviewClip());
+    clip->decodedSamples.setSize(1, static_cast<int>(outputLength));
+    
+    auto read = [&source](float* dest, juce::int64 start, int numSamples)
+    {
+        source.readMono(dest, start, numSamples);
+    };
+    
+    if (!resampler.convert(read, source.lengthInSamples, clip->decodedSamples.getWritePointer(0), shouldStop))
+        return nullptr;
+    
+    clip->sampleRate = targetSampleRate;
+    clip->lengthInSamples = outputLength;
+    return clip;
+}
+
+void PreviewClip::readMono(float* dest, juce::int64 startSample, int numSamples) const noexcept
+{
+    if (numSamples <= 0)
+        return;
+    
+    // Silence for the part outside the clip
+    const auto first = juce::jlimit(juce::int64 { 0 }, lengthInSamples, startSample);
+    const auto last = juce::jlimit(juce::int64 { 0 }, lengthInSamples, startSample + numSamples);
+    const int leading = static_cast<int>(first - startSample);
+    const int numInside = static_cast<int>(last - first);
+    
+    juce::FloatVectorOperations::clear(dest, numSamples);
+    
+    if (numInside <= 0)
+        return;
+    
+    float* insideDest = dest + leading;
+    
+    if (mappedReader != nullptr)
+    {
+        // readSamples() writes ints, or floats for float files, into the same memory
+        int* channels[] = { reinterpret_cast<int*>(insideDest) };
+        mappedReader->readSamples(channels, 1, 0, first, numInside);
+        
+        if (!mappedReader->usesFloatingPointData)
+            juce::FloatVectorOperations::convertFixedToFloat(insideDest, reinterpret_cast<const int*>(insideDest),
+                                                             1.0f / static_cast<float>(0x7fffffff), numInside);
+    }
+    else
+    {
+        juce::FloatVectorOperations::copy(insideDest, decodedSamples.getReadPointer(0, static_cast<int>(first)), numInside);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+    PreviewClip.h
+    =============
+    
+    The Bandmate audio clip, as the audio thread plays it back.
+    
+    WHY NOT ONE BIG AudioBuffer?
+    ----------------------------
+    Decoding a whole clip into memory costs 4 bytes per sample: a
+    10-minute stem at 96 kHz is over 200 MB, and reading it takes seconds.
+    Uncompressed files (WAV, AIFF) don't need decoding at all - we
+    memory-map them, so the operating system pages the file in as it is
+    played and nothing is copied up front. Compressed formats (MP3, FLAC,
+    Ogg) can't be mapped, so for those we fall back to decoding the left
+    channel into memory, as before.
+    
+    Reading is wait-free either way: readMono() just copies (and converts)
+    samples, without locks or allocation. A mapped page that isn't in
+    memory yet costs a page fault the first time it is touched.
+    
+    AT THE HOST'S RATE
+    ------------------
+    A clip recorded at another rate than the session's would have to be
+    resampled in every audio callback. createResampled() converts it
+    once instead, on a worker thread, with the windowed-sinc Resampler:
+    a decoded copy at the host's rate that plays back as a plain copy.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <functional>
+#include <memory>
+
+class PreviewClip
+{
+public:
+    // Opens a clip for playback, or returns nullptr if the file can't be read
+    static std::unique_ptr<PreviewClip> open(const juce::File& file, juce::AudioFormatManager& formatManager);
+    
+    // A decoded copy of a clip at another sample rate (worker thread - this takes a while)
+    // Returns nullptr if shouldStop() asked it to give up, or the copy would be too long.
+    static std::unique_ptr<PreviewClip> createResampled(const PreviewClip& source, double targetSampleRate,
+                                                        const std::function<bool()>& shouldStop = nullptr);
+    
+    double getSampleRate() const noexcept { return sampleRate; }
+    juce::int64 getLengthInSamples() const noexcept { return lengthInSamples; }
+    
+    // True if the file is memory-mapped rather than decoded into memory
+    bool isMemoryMapped() const noexcept { return mappedReader != nullptr; }
+    
+    /*
+        READ MONO
+        ---------
+        Copies the left channel's samples [startSample, startSample + numSamples)
+        into dest. Samples outside the clip read as silence.
+        Audio thread safe - no locks, no allocation.
+    */
+    void readMono(float* dest, juce::int64 startSample, int numSamples) const noexcept;
+
+private:
+    PreviewClip() = default;
+    
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader;  // WAV/AIFF
+    juce::AudioBuffer<float> decodedSamples;                             // Everything else
+    
+    double sampleRate = 44100.0;
+    juce::int64 lengthInSamples = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PreviewClip)
+};
@@ -0,0 +1,83 @@
+/*
+    RealtimeSafety.cpp
+    ==================
+    
+    The allocation-counting test hook and the lock wait total (see
+    RealtimeSafety.h).
+    
+    REPLACING operator new
+    ----------------------
+    C++ lets a program supply its own global operator new/delete; every
+    `new` in the program (including JUCE and the standard library) then
+    goes through them. We only count and forward to malloc/free, and only
+    when JDRUMMER_COUNT_AUDIO_ALLOCATIONS is set - release builds keep
+    the normal allocator. Aligned (C++17 align_val_t) allocations are not
+    replaced; nothing on our audio path uses them.
+*/
+
+#include "RealtimeSafety.h"
+#include <cstdlib>
+#include <new>
+
+namespace RealtimeSafety
+{
+#if JDRUMMER_COUNT_AUDIO_ALLOCATIONS
+    static std::atomic<juce::uint64> audioThreadAllocations { 0 };
+    
+    static void countAllocation() noexcept
+    {
+        if (isAudioThread())
+            audioThreadAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    juce::uint64 getAudioThreadAllocationCount() noexcept { return audioThreadAllocations.load(); }
+    
+    void* countedMalloc(size_t size) noexcept
+    {
+        countAllocation();
+        return std::malloc(size);
+    }
+    
+    void* countedRealloc(void* ptr, size_t size) noexcept
+    {
+        countAllocation();
+        return std::realloc(ptr, size);
+    }
+#else
+    juce::uint64 getAudioThreadAllocationCount() noexcept { return 0; }
+    
+    void* countedMalloc(size_t size) noexcept { return std::malloc(size); }
+    void* countedRealloc(void* ptr, size_t size) noexcept { return std::realloc(ptr, size); }
+#endif
+
+    void countedFree(void* ptr) noexcept { std::free(ptr); }
+    
+    static std::atomic<juce::int64> lockWaitTicks { 0 };
+    
+    void addLockWaitTicks(juce::int64 ticks) noexcept { lockWaitTicks.fetch_add(ticks, std::memory_order_relaxed); }
+    juce::int64 getLockWaitTicks() noexcept { return lockWaitTicks.load(std::memory_order_relaxed); }
+}
+
+#if JDRUMMER_COUNT_AUDIO_ALLOCATIONS
+
+static void* countedNew(std::size_t size)
+{
+    if (void* ptr = RealtimeSafety::countedMalloc(size == 0 ? 1 : size))
+        return ptr;
+    
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return countedNew(size); }
+void* operator new[](std::size_t size) { return countedNew(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return RealtimeSafety::countedMalloc(size == 0 ? 1 : size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return RealtimeSafety::countedMalloc(size == 0 ? 1 : size); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+#endif
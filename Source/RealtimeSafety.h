@@ -0,0 +1,256 @@
+/*
+    RealtimeSafety.h
+    ================
+    
+    Small building blocks for keeping the audio thread wait-free.
+    
+    The audio thread must never block: no locks, no waiting on other
+    threads, no memory allocation. Instead, the message thread and the
+    audio thread talk to each other through:
+    
+    - std::atomic values for simple settings (volume, pan, flags)
+    - SpscQueue for streams of commands (UI pad hits, notes for the UI)
+    - AudioBlockFence + atomic pointers for swapping whole objects
+      (a freshly loaded kit, a new playback pattern)
+    
+    CheckedCriticalSection is a drop-in for juce::CriticalSection that
+    asserts (in debug builds) when it is locked on the audio thread, so
+    any lock that sneaks back into the render path is caught right away.
+    The allocation counter does the same for heap allocations, and the
+    time spent waiting on contended locks is totalled for profiling.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+#include <atomic>
+
+// Set to 1 (CMake option JDRUMMER_COUNT_AUDIO_ALLOCATIONS) to count audio thread allocations
+#ifndef JDRUMMER_COUNT_AUDIO_ALLOCATIONS
+ #define JDRUMMER_COUNT_AUDIO_ALLOCATIONS 0
+#endif
+
+namespace RealtimeSafety
+{
+    /*
+        AUDIO THREAD MARKER
+        -------------------
+        thread_local gives every thread its own copy of the flag, so
+        marking the audio thread doesn't affect any other thread.
+    */
+    inline bool& audioThreadFlag() noexcept
+    {
+        static thread_local bool isAudio = false;
+        return isAudio;
+    }
+    
+    // True while the calling thread is inside processBlock()
+    inline bool isAudioThread() noexcept { return audioThreadFlag(); }
+    
+    // Put one of these at the top of processBlock() to mark the audio thread
+    class ScopedAudioThread
+    {
+    public:
+        ScopedAudioThread() noexcept : wasAudio(audioThreadFlag()) { audioThreadFlag() = true; }
+        ~ScopedAudioThread() noexcept { audioThreadFlag() = wasAudio; }
+    
+    private:
+        bool wasAudio;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedAudioThread)
+    };
+    
+    /*
+        ALLOCATION COUNTING (TEST HOOK)
+        -------------------------------
+        Built with JDRUMMER_COUNT_AUDIO_ALLOCATIONS=1 (CMake option of the
+        same name), RealtimeSafety.cpp replaces the global operator new and
+        TinySoundFont's malloc/realloc with versions that count every call
+        made while isAudioThread() is true. Otherwise the count stays 0 and
+        nothing is replaced.
+        
+        Put a ScopedAllocationCheck in processBlock(): it jasserts if the
+        block allocated, and tests/benchmarks can read the running total -
+        "jdrummer_bench --benchmark process" fails if it is ever above 0.
+    */
+    juce::uint64 getAudioThreadAllocationCount() noexcept;
+    
+    // Used as TSF_MALLOC / TSF_REALLOC / TSF_FREE when counting is enabled
+    void* countedMalloc(size_t size) noexcept;
+    void* countedRealloc(void* ptr, size_t size) noexcept;
+    void countedFree(void* ptr) noexcept;
+    
+    class ScopedAllocationCheck
+    {
+    public:
+        ScopedAllocationCheck() noexcept : countAtStart(getAudioThreadAllocationCount()) {}
+        
+        ~ScopedAllocationCheck() noexcept
+        {
+            // Something inside this scope allocated on the audio thread!
+            jassert(getAudioThreadAllocationCount() == countAtStart);
+        }
+    
+    private:
+        juce::uint64 countAtStart;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllocationCheck)
+    };
+    
+    /*
+        LOCK WAIT
+        ---------
+        Every CheckedCriticalSection adds the time it spent waiting for a
+        contended lock (in high-resolution ticks) to one process-wide
+        total, which the PerformanceMonitor samples once per block. An
+        uncontended lock costs nothing extra.
+    */
+    void addLockWaitTicks(juce::int64 ticks) noexcept;
+    juce::int64 getLockWaitTicks() noexcept;
+}
+
+/*
+    CHECKED CRITICAL SECTION
+    ------------------------
+    Behaves exactly like juce::CriticalSection, but jasserts if it is
+    entered from the audio thread. Use CheckedCriticalSection::ScopedLockType
+    in place of juce::ScopedLock.
+*/
+class CheckedCriticalSection
+{
+public:
+    CheckedCriticalSection() = default;
+    
+    void enter() const noexcept
+    {
+        // A lock on the audio thread can block it behind the message thread!
+        jassert(! RealtimeSafety::isAudioThread());
+        
+        if (section.tryEnter())
+            return;
+        
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        section.enter();
+        RealtimeSafety::addLockWaitTicks(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+    
+    bool tryEnter() const noexcept
+    {
+        jassert(! RealtimeSafety::isAudioThread());
+        return section.tryEnter();
+    }
+    
+    void exit() const noexcept { section.exit(); }
+    
+    using ScopedLockType = juce::GenericScopedLock<CheckedCriticalSection>;
+
+private:
+    juce::CriticalSection section;
+    
+    JUCE_DECLARE_NON_COPYABLE(CheckedCriticalSection)
+};
+
+/*
+    AUDIO BLOCK FENCE
+    -----------------
+    Lets a non-audio thread know when the audio thread can no longer be
+    using an object it has just unpublished.
+    
+    The audio thread brackets its work with enterBlock()/exitBlock(),
+    which bumps a counter (odd = inside a block). After swapping an atomic
+    pointer, the other thread calls waitForBlockToFinish(): once the block
+    that was running at the time of the swap has finished, nobody can
+    still hold the old pointer and it is safe to delete.
+    
+    Only the NON-audio thread ever waits; the audio thread just does two
+    atomic increments per block.
+*/
+class AudioBlockFence
+{
+public:
+    AudioBlockFence() = default;
+    
+    void enterBlock() noexcept { blockCounter.fetch_add(1); }
+    void exitBlock() noexcept  { blockCounter.fetch_add(1); }
+    
+    // Never call this from the audio thread
+    void waitForBlockToFinish() const noexcept
+    {
+        jassert(! RealtimeSafety::isAudioThread());
+        
+        const auto counterAtSwap = blockCounter.load();
+        if ((counterAtSwap & 1u) == 0)
+            return;  // No block in flight
+        
+        while (blockCounter.load() == counterAtSwap)
+            juce::Thread::yield();
+    }
+    
+    // RAII helper for the audio thread
+    class ScopedBlock
+    {
+    public:
+        explicit ScopedBlock(AudioBlockFence& f) noexcept : fence(f) { fence.enterBlock(); }
+        ~ScopedBlock() noexcept { fence.exitBlock(); }
+    
+    private:
+        AudioBlockFence& fence;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+    };
+
+private:
+    std::atomic<juce::uint32> blockCounter { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE(AudioBlockFence)
+};
+
+/*
+    SINGLE-PRODUCER / SINGLE-CONSUMER QUEUE
+    ---------------------------------------
+    A fixed-size ring buffer built on juce::AbstractFifo. One thread may
+    push and ONE other thread may pop, without locks or allocation.
+    When the queue is full, push() fails instead of blocking.
+*/
+template <typename ItemType, int Capacity>
+class SpscQueue
+{
+public:
+    SpscQueue() = default;
+    
+    bool push(const ItemType& item) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        
+        if (size1 + size2 < 1)
+            return false;
+        
+        items[static_cast<size_t>(size1 > 0 ? start1 : start2)] = item;
+        fifo.finishedWrite(1);
+        return true;
+    }
+    
+    bool pop(ItemType& item) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        
+        if (size1 + size2 < 1)
+            return false;
+        
+        item = items[static_cast<size_t>(size1 > 0 ? start1 : start2)];
+        fifo.finishedRead(1);
+        return true;
+    }
+    
+    int getNumReady() const noexcept { return fifo.getNumReady(); }
+
+private:
+    // AbstractFifo keeps one slot free to tell "full" from "empty"
+    juce::AbstractFifo fifo { Capacity + 1 };
+    std::array<ItemType, static_cast<size_t>(Capacity + 1)> items {};
+    
+    JUCE_DECLARE_NON_COPYABLE(SpscQueue)
+};
@@ -0,0 +1,299 @@
+/*
+    RenderWorkerPool.cpp
+    ====================
+    
+    Implementation of the render worker threads (see RenderWorkerPool.h).
+    
+    WHY THE BATCH IS SAFE TO REUSE
+    ------------------------------
+    The batch fields are plain members, written by start() before
+    `running` is set. A worker only touches them between bumping
+    workersInBatch and dropping it again, and only if it saw `running`
+    set in between. finish() clears `running` and then waits for
+    workersInBatch to drop to zero, so by the time the next start()
+    rewrites the batch, no worker can still be reading the old one - and
+    a worker that arrives late sees `running` clear and goes back to
+    waiting.
+*/
+
+#include "RenderWorkerPool.h"
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <ctime>
+ #include <semaphore.h>
+#endif
+
+namespace
+{
+    /*
+        WAKE SIGNAL
+        -----------
+        A counting semaphore of the operating system's, for waking a
+        worker from the audio thread. juce::WaitableEvent is a mutex and a
+        condition variable, so signalling it can block behind the worker
+        that holds the mutex; posting a semaphore takes no lock: an atomic
+        increment and a futex wake on Linux, dispatch_semaphore_signal()
+        on Apple platforms (a kernel call only if someone waits), one
+        ReleaseSemaphore() call on Windows.
+    */
+    class WakeSignal
+    {
+    public:
+        WakeSignal()
+        {
+           #if JUCE_WINDOWS
+            handle = CreateSemaphoreW(nullptr, 0, 0x7fffffff, nullptr);
+           #elif JUCE_MAC || JUCE_IOS
+            semaphore = dispatch_semaphore_create(0);
+           #else
+            sem_init(&semaphore, 0, 0);
+           #endif
+        }
+        
+        ~WakeSignal()
+        {
+           #if JUCE_WINDOWS
+            CloseHandle(handle);
+           #elif JUCE_MAC || JUCE_IOS
+            dispatch_release(semaphore);
+           #else
+            sem_destroy(&semaphore);
+           #endif
+        }
+        
+        // Lets one wait() through (any thread, lock-free)
+        void signal() noexcept
+        {
+           #if JUCE_WINDOWS
+            ReleaseSemaphore(handle, 1, nullptr);
+           #elif JUCE_MAC || JUCE_IOS
+            dispatch_semaphore_signal(semaphore);
+           #else
+            sem_post(&semaphore);
+           #endif
+        }
+        
+        // Waits for a signal for up to timeoutMs (-1 = forever); false if none came
+        bool wait(int timeoutMs) noexcept
+        {
+           #if JUCE_WINDOWS
+            return WaitForSingleObject(handle, timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs)) == WAIT_OBJECT_0;
+           #elif JUCE_MAC || JUCE_IOS
+            const auto timeout = timeoutMs < 0 ? DISPATCH_TIME_FOREVER
+                                               : dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(timeoutMs) * 1000000);
+            return dispatch_semaphore_wait(semaphore, timeout) == 0;
+           #else
+            if (timeoutMs < 0)
+            {
+                while (sem_wait(&semaphore) != 0)
+                {
+                    if (errno != EINTR)
+                        return false;
+                }
+                
+                return true;
+            }
+            
+            timespec deadline {};
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += timeoutMs / 1000;
+            deadline.tv_nsec += static_cast<long>(timeoutMs % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000)
+            {
+                deadline.tv_sec += 1;
+                deadline.tv_nsec -= 1000000000;
+            }
+            
+            while (sem_timedwait(&semaphore, &deadline) != 0)
+            {
+                if (errno != EINTR)
+                    return false;  // Timed out
+            }
+            
+            return true;
+           #endif
+        }
+    
+    private:
+       #if JUCE_WINDOWS
+        HANDLE handle;
+       #elif JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_t semaphore;
+       #else
+        sem_t semaphore;
+       #endif
+       
+        JUCE_DECLARE_NON_COPYABLE(WakeSignal)
+    };
+}
+
+class RenderWorkerPool::Worker : public juce::Thread
+{
+public:
+    Worker(RenderWorkerPool& owner, int index)
+        : juce::Thread("Render worker " + juce::String(index + 1)),
+          pool(owner)
+    {
+    }
+    
+    ~Worker() override
+    {
+        stop();
+    }
+    
+    void begin()
+    {
+        // Real-time priority where the system allows it (may need permissions on Linux)
+        if (!startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(9)))
+            startThread(juce::Thread::Priority::highest);
+    }
+    
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeIfSleeping();
+        stopThread(2000);
+    }
+    
+    // Audio thread: a semaphore post (no lock - see WAKE SIGNAL), only if the worker really is asleep
+    void wakeIfSleeping() noexcept
+    {
+        if (sleeping.exchange(false))
+            wakeSignal.signal();
+    }
+    
+    void run() override
+    {
+        juce::uint32 seenGeneration = pool.generation.load();
+        
+        while (!threadShouldExit())
+        {
+            if (!waitForBatch(seenGeneration))
+                continue;
+            
+            seenGeneration = pool.generation.load();
+            
+            pool.workersInBatch.fetch_add(1);
+            if (pool.running.load())
+                pool.work();
+            pool.workersInBatch.fetch_sub(1);
+        }
+    }
+
+private:
+    /*
+        WAIT FOR BATCH
+        --------------
+        Spin for a while, then sleep. Whoever clears `sleeping` (the audio
+        thread, or stop()) owes exactly one signal, so a worker that finds
+        the flag already cleared waits for that signal before moving on -
+        it never leaves one behind to wake it for no reason later.
+    */
+    bool waitForBatch(juce::uint32 seenGeneration)
+    {
+        const auto spinStart = juce::Time::getHighResolutionTicks();
+        const auto spinTicks = static_cast<juce::int64>(spinLimitMicros * 1.0e-6
+                                                        * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+        
+        while (juce::Time::getHighResolutionTicks() - spinStart < spinTicks)
+        {
+            if (pool.generation.load() != seenGeneration)
+                return true;
+            
+            if (threadShouldExit())
+                return false;
+            
+            juce::Thread::yield();
+        }
+        
+        sleeping = true;
+        
+        if (pool.generation.load() == seenGeneration && !threadShouldExit())
+        {
+            // Woken (which cleared the flag), or timed out to check threadShouldExit()
+            if (wakeSignal.wait(100))
+                return true;
+        }
+        
+        if (!sleeping.exchange(false))
+            wakeSignal.wait(-1);  // Claimed at the last moment - the signal is on its way
+        
+        return pool.generation.load() != seenGeneration;
+    }
+    
+    RenderWorkerPool& pool;
+    std::atomic<bool> sleeping { false };
+    WakeSignal wakeSignal;
+    
+    JUCE_DECLARE_NON_COPYABLE(Worker)
+};
+
+RenderWorkerPool::RenderWorkerPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i))->begin();
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    for (auto* worker : workers)
+        worker->stop();
+}
+
+int RenderWorkerPool::getDefaultNumWorkers()
+{
+    return juce::jlimit(0, 3, juce::SystemStats::getNumCpus() - 1);
+}
+
+void RenderWorkerPool::start(JobFunction function, void* context, int numJobs) noexcept
+{
+    // finish() wasn't called for the previous batch!
+    jassert(!running.load());
+    
+    batchFunction = function;
+    batchContext = context;
+    batchSize = numJobs;
+    
+    nextJob = 0;
+    jobsDone = 0;
+    running = true;
+    generation.fetch_add(1);
+    
+    // The audio thread takes jobs too, so there's no point waking more workers than jobs
+    const int numToWake = juce::jmin(numJobs, workers.size());
+    for (int i = 0; i < numToWake; ++i)
+        workers.getUnchecked(i)->wakeIfSleeping();
+}
+
+void RenderWorkerPool::finish() noexcept
+{
+    work();
+    
+    // Only jobs a worker has already claimed can still be running
+    while (jobsDone.load() < batchSize) {}
+    
+    running = false;
+    
+    while (workersInBatch.load() != 0) {}
+}
+
+void RenderWorkerPool::work() noexcept
+{
+    for (;;)
+    {
+        const int job = nextJob.fetch_add(1);
+        if (job >= batchSize)
+            return;
+        
+        batchFunction(batchContext, job);
+        jobsDone.fetch_add(1);
+    }
+}
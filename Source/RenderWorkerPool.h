@@ -0,0 +1,85 @@
+/*
+    RenderWorkerPool.h
+    ==================
+    
+    A few high-priority worker threads that help the audio thread with
+    independent pieces of one block - for multi-out, rendering the group
+    instances into their own buses at the same time.
+    
+    HOW A BATCH RUNS
+    ----------------
+    The audio thread publishes a batch (a job function, its context and
+    the number of jobs) with start() and carries on with its own work.
+    Workers - and the audio thread in finish(), once it is free - claim
+    jobs from an atomic counter one at a time, so a slow job doesn't hold
+    up the others and a worker that wakes late just finds nothing left to
+    do. finish() returns when every job has finished.
+    
+    The audio thread never waits for a worker to START: if every worker
+    is asleep or busy elsewhere, it simply runs all the jobs itself. The
+    only wait is for jobs a worker has already claimed, which are running
+    at real-time priority.
+    
+    WAKING THE WORKERS
+    ------------------
+    After a batch, a worker keeps watching for the next one for a short
+    while (spinLimitMicros) - long enough to span the gap between blocks
+    at low latency, when it matters most. After that it goes to sleep,
+    and the audio thread wakes it through an OS semaphore the next time:
+    one post, only when a worker really is asleep, and no lock - not
+    ours, nor the mutex a juce::WaitableEvent would take (see WAKE
+    SIGNAL in the .cpp).
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <atomic>
+
+class RenderWorkerPool
+{
+public:
+    // Runs job number jobIndex of a batch - called on any of the threads, concurrently
+    using JobFunction = void (*)(void* context, int jobIndex) noexcept;
+    
+    // Starts the workers (message thread)
+    explicit RenderWorkerPool(int numWorkers);
+    ~RenderWorkerPool();
+    
+    int getNumWorkers() const noexcept { return workers.size(); }
+    
+    // ===== AUDIO THREAD =====
+    
+    // Publish jobs 0 to numJobs - 1; the workers start on them right away
+    // (function and context must stay valid until finish() returns)
+    void start(JobFunction function, void* context, int numJobs) noexcept;
+    
+    // Help with the jobs that are left, and return when all of them are done
+    void finish() noexcept;
+    
+    // Workers to start on this machine: one core is left to the audio thread itself
+    static int getDefaultNumWorkers();
+
+private:
+    class Worker;
+    
+    // Claim and run jobs of the current batch until none are left
+    void work() noexcept;
+    
+    // The current batch - written before `running` is set, read after
+    JobFunction batchFunction = nullptr;
+    void* batchContext = nullptr;
+    int batchSize = 0;
+    
+    std::atomic<juce::uint32> generation { 0 };  // Bumped for every batch
+    std::atomic<bool> running { false };         // Jobs may be claimed
+    std::atomic<int> nextJob { 0 };
+    std::atomic<int> jobsDone { 0 };
+    std::atomic<int> workersInBatch { 0 };       // Workers that may still touch the batch
+    
+    static constexpr double spinLimitMicros = 2000.0;
+    
+    juce::OwnedArray<Worker> workers;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorkerPool)
+};
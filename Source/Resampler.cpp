@@ -0,0 +1,159 @@
+/*
+    Resampler.cpp
+    =============
+    
+    Implementation of the windowed-sinc resampler (see Resampler.h).
+*/
+
+#include "Resampler.h"
+#include <cmath>
+
+namespace
+{
+    // Share of the lower Nyquist frequency kept - the rest is the filter's transition band
+    constexpr double passband = 0.94;
+    
+    // Kaiser window shape: higher is more stopband attenuation, wider transition (~75 dB here)
+    constexpr double kaiserBeta = 7.5;
+    
+    // Zeroth-order modified Bessel function (power series - converges quickly)
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        
+        for (int k = 1; k < 50; ++k)
+        {
+            const double factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+            
+            if (term < sum * 1.0e-12)
+                break;
+        }
+        
+        return sum;
+    }
+}
+
+/*
+    CONSTRUCTOR - Building the tables
+    ---------------------------------
+    Row p holds the weights for an output sample p / numPhases of the
+    way from source sample i to i + 1: tap k multiplies source sample
+    i - tapsBefore + k, at distance d = k - tapsBefore - phase.
+    
+    When converting down, the cutoff moves below the new Nyquist
+    frequency (the sinc is stretched), so nothing folds back. Each row
+    is normalized to a gain of exactly 1, so DC passes unchanged.
+*/
+Resampler::Resampler(double sourceSampleRate, double targetSampleRate)
+{
+    jassert(sourceSampleRate > 0.0 && targetSampleRate > 0.0);
+    
+    ratio = sourceSampleRate / targetSampleRate;
+    
+    const double cutoff = juce::jmin(1.0, 1.0 / ratio) * passband;
+    const double halfLength = numTaps / 2;
+    const double windowNorm = 1.0 / besselI0(kaiserBeta);
+    
+    coefficients.resize(static_cast<size_t>((numPhases + 1) * numTaps));
+    
+    for (int p = 0; p <= numPhases; ++p)
+    {
+        float* row = coefficients.data() + p * numTaps;
+        const double phase = static_cast<double>(p) / numPhases;
+        double sum = 0.0;
+        
+        for (int k = 0; k < numTaps; ++k)
+        {
+            const double d = static_cast<double>(k - tapsBefore) - phase;
+            const double x = juce::MathConstants<double>::pi * cutoff * d;
+            const double sinc = (std::abs(x) < 1.0e-9) ? 1.0 : std::sin(x) / x;
+            
+            const double w = d / halfLength;
+            const double window = (std::abs(w) < 1.0) ? besselI0(kaiserBeta * std::sqrt(1.0 - w * w)) * windowNorm
+                                                      : 0.0;
+            
+            const double weight = cutoff * sinc * window;
+            row[k] = static_cast<float>(weight);
+            sum += weight;
+        }
+        
+        const auto scale = static_cast<float>(1.0 / sum);
+        for (int k = 0; k < numTaps; ++k)
+            row[k] *= scale;
+    }
+}
+
+juce::int64 Resampler::getOutputLength(juce::int64 sourceLength) const noexcept
+{
+    return static_cast<juce::int64>(std::ceil(static_cast<double>(sourceLength) / ratio));
+}
+
+void Resampler::process(const float* source, juce::int64 sourceStart, double startPosition,
+                        float* output, int numOutput) const noexcept
+{
+    const float* table = coefficients.data();
+    
+    for (int n = 0; n < numOutput; ++n)
+    {
+        const double position = startPosition + ratio * n;
+        const double whole = std::floor(position);
+        const double phase = (position - whole) * numPhases;
+        const int row = juce::jmin(numPhases - 1, static_cast<int>(phase));
+        const auto blend = static_cast<float>(phase - row);
+        
+        const float* taps = source + (static_cast<juce::int64>(whole) - tapsBefore - sourceStart);
+        const float* row0 = table + row * numTaps;
+        const float* row1 = row0 + numTaps;
+        
+        // Two dot products rather than blending the rows first - both vectorize
+        float sum0 = 0.0f;
+        float sum1 = 0.0f;
+        for (int k = 0; k < numTaps; ++k)
+        {
+            sum0 += taps[k] * row0[k];
+            sum1 += taps[k] * row1[k];
+        }
+        
+        output[n] = sum0 + (sum1 - sum0) * blend;
+    }
+}
+
+/*
+    CONVERT
+    -------
+    Output is produced a chunk at a time; each chunk reads just the
+    source span its taps reach, so memory use doesn't grow with the
+    signal (apart from the output itself).
+*/
+bool Resampler::convert(const ReadFunction& read, juce::int64 sourceLength, float* output,
+                        const std::function<bool()>& shouldStop) const
+{
+    constexpr int chunkSize = 4096;
+    
+    const auto outputLength = getOutputLength(sourceLength);
+    std::vector<float> sourceScratch;
+    
+    for (juce::int64 first = 0; first < outputLength; first += chunkSize)
+    {
+        if (shouldStop != nullptr && shouldStop())
+            return false;
+        
+        const int numOutput = static_cast<int>(juce::jmin(static_cast<juce::int64>(chunkSize), outputLength - first));
+        const double startPosition = ratio * static_cast<double>(first);
+        const double endPosition = ratio * static_cast<double>(first + numOutput - 1);
+        
+        const auto sourceStart = static_cast<juce::int64>(std::floor(startPosition)) - tapsBefore;
+        const auto sourceEnd = static_cast<juce::int64>(std::floor(endPosition)) + tapsAfter;
+        const int sourceSpan = static_cast<int>(sourceEnd - sourceStart + 1);
+        
+        sourceScratch.resize(static_cast<size_t>(sourceSpan));
+        read(sourceScratch.data(), sourceStart, sourceSpan);
+        
+        process(sourceScratch.data(), sourceStart, startPosition, output + first, numOutput);
+    }
+    
+    return true;
+}
@@ -0,0 +1,178 @@
+/*
+    SampleSelector.cpp
+    ==================
+    
+    Implementation of the velocity layer and round-robin tables (see
+    SampleSelector.h).
+*/
+
+#include "SampleSelector.h"
+#include "tsf.h"
+#include <cmath>
+
+/*
+    CONSTRUCTOR - Building the tables
+    ---------------------------------
+    For every note, walk the velocities from soft to hard and collect the
+    regions each one plays, with TSF's own test. A run of velocities
+    playing the same set of regions is one layer. A region's level is
+    measured once, however many layers share it.
+*/
+SampleSelector::SampleSelector(const tsf* font, int presetIndex)
+{
+    layerForVelocity.fill(-1);
+    
+    const int numRegions = (font != nullptr) ? tsf_get_regioncount(font, presetIndex) : 0;
+    
+    std::vector<tsf_region_sample> regions(static_cast<size_t>(numRegions));
+    std::vector<float> levels(static_cast<size_t>(numRegions), -1.0f);  // Measured when first needed
+    
+    for (int i = 0; i < numRegions; ++i)
+        tsf_region_get_sample(font, presetIndex, i, &regions[static_cast<size_t>(i)]);
+    
+    std::vector<int> noteRegions;
+    std::vector<int> current;
+    std::vector<int> previous;
+    
+    for (int note = 0; note < numNotes; ++note)
+    {
+        firstLayer[static_cast<size_t>(note)] = static_cast<int>(layers.size());
+        previous.clear();
+        
+        // Regions covering the note at any velocity (in preset order, like TSF's scan)
+        noteRegions.clear();
+        for (int i = 0; i < numRegions; ++i)
+        {
+            const auto& region = regions[static_cast<size_t>(i)];
+            if (note >= region.lokey && note <= region.hikey)
+                noteRegions.push_back(i);
+        }
+        
+        if (noteRegions.empty())
+            continue;
+        
+        for (int velocity = 0; velocity < numVelocities; ++velocity)
+        {
+            current.clear();
+            for (int i : noteRegions)
+            {
+                const auto& region = regions[static_cast<size_t>(i)];
+                if (velocity >= region.lovel && velocity <= region.hivel)
+                    current.push_back(i);
+            }
+            
+            if (current.empty())
+            {
+                previous.clear();
+                continue;
+            }
+            
+            if (current != previous)
+            {
+                Layer layer;
+                layer.firstRegion = static_cast<int>(regionIndices.size());
+                layer.numRegions = static_cast<int>(current.size());
+                
+                regionIndices.insert(regionIndices.end(), current.begin(), current.end());
+                layers.push_back(layer);
+                ++numLayers[static_cast<size_t>(note)];
+                
+                previous = current;
+            }
+            
+            layerForVelocity[static_cast<size_t>(note * numVelocities + velocity)]
+                = static_cast<juce::int16>(numLayers[static_cast<size_t>(note)] - 1);
+        }
+        
+        // Levels only matter for round-robin, so a note with one layer skips the sample scan
+        if (numLayers[static_cast<size_t>(note)] < 2)
+            continue;
+        
+        for (auto layer = layers.begin() + firstLayer[static_cast<size_t>(note)]; layer != layers.end(); ++layer)
+        {
+            for (int i = 0; i < layer->numRegions; ++i)
+            {
+                const int region = regionIndices[static_cast<size_t>(layer->firstRegion + i)];
+                auto& level = levels[static_cast<size_t>(region)];
+                if (level < 0.0f)
+                    level = measureRegionLevel(font, presetIndex, region);
+                
+                layer->level = juce::jmax(layer->level, level);
+            }
+        }
+    }
+}
+
+float SampleSelector::measureRegionLevel(const tsf* font, int presetIndex, int region)
+{
+    tsf_region_sample info;
+    unsigned int numSamples = 0;
+    const float* samples = tsf_get_samples(font, &numSamples);
+    
+    if (samples == nullptr || !tsf_region_get_sample(font, presetIndex, region, &info))
+        return 0.0f;
+    
+    const unsigned int end = juce::jmin(info.end, numSamples);
+    float peak = 0.0f;
+    
+    for (unsigned int i = info.offset; i < end; ++i)
+        peak = juce::jmax(peak, std::abs(samples[i]));
+    
+    return peak * juce::Decibels::decibelsToGain(-info.attenuation);
+}
+
+/*
+    SELECT - Audio thread
+    ---------------------
+    The velocity is turned into a MIDI velocity the way TSF does it, so
+    the layer is the one tsf_note_on() would have played. With
+    round-robin, a neighbouring layer's gain is capped so the velocity
+    passed on stays within 1 - a softer layer can't always be brought
+    all the way up at the very top of the range.
+*/
+SampleSelector::Selection SampleSelector::select(int note, float velocity, bool roundRobin,
+                                                 juce::uint32 roundRobinStep) const noexcept
+{
+    if (note < 0 || note >= numNotes || velocity <= 0.0f)
+        return {};
+    
+    const int midiVelocity = juce::jlimit(0, numVelocities - 1, static_cast<int>(velocity * 127));
+    const int layer = layerForVelocity[static_cast<size_t>(note * numVelocities + midiVelocity)];
+    if (layer < 0)
+        return {};
+    
+    const int first = firstLayer[static_cast<size_t>(note)];
+    const int count = numLayers[static_cast<size_t>(note)];
+    int chosen = layer;
+    
+    if (roundRobin && count > 1)
+    {
+        // Own layer, then the softer and the harder neighbour (where there is one)
+        std::array<int, 3> cycle { layer, 0, 0 };
+        int cycleLength = 1;
+        
+        if (layer > 0)
+            cycle[static_cast<size_t>(cycleLength++)] = layer - 1;
+        if (layer + 1 < count)
+            cycle[static_cast<size_t>(cycleLength++)] = layer + 1;
+        
+        chosen = cycle[static_cast<size_t>(roundRobinStep % static_cast<juce::uint32>(cycleLength))];
+    }
+    
+    const auto& ownLayer = layers[static_cast<size_t>(first + layer)];
+    const auto& chosenLayer = layers[static_cast<size_t>(first + chosen)];
+    
+    Selection selection;
+    selection.regions = regionIndices.data() + chosenLayer.firstRegion;
+    selection.numRegions = chosenLayer.numRegions;
+    
+    if (chosen != layer && chosenLayer.level > 0.0f && ownLayer.level > 0.0f)
+        selection.gain = juce::jmin(ownLayer.level / chosenLayer.level, 1.0f / velocity);
+    
+    return selection;
+}
+
+int SampleSelector::getNumLayers(int note) const noexcept
+{
+    return (note >= 0 && note < numNotes) ? numLayers[static_cast<size_t>(note)] : 0;
+}
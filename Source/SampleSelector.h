@@ -0,0 +1,100 @@
+/*
+    SampleSelector.h
+    ================
+    
+    Picks the regions (samples) a drum hit plays - velocity layers and
+    round-robin - from tables built when a kit is loaded.
+    
+    WHY?
+    ----
+    TSF finds a hit's samples by scanning every region of the preset for
+    a matching key and velocity range, and the voice manager scanned them
+    once more to count them - big multi-layer kits have a couple of
+    hundred regions. And a hit at the same velocity always plays the same
+    samples, so a fast snare roll sounds like a machine gun; the only way
+    to get variation was loading more kits.
+    
+    VELOCITY LAYERS
+    ---------------
+    At load time, each note's regions are sorted into LAYERS: the set of
+    regions one velocity plays - exactly the regions TSF's own scan would
+    pick, in the same order. A table maps (note, velocity) to its layer,
+    so selecting a hit's samples is two array reads.
+    
+    ROUND-ROBIN
+    -----------
+    SF2 has no notion of alternate samples, but a multi-layer kit already
+    has them: the neighbouring velocity layers are the same drum, hit a
+    little softer and a little harder. With round-robin on, repeated hits
+    of a note cycle through their own layer and its neighbours (own,
+    softer, harder), each played at the gain that brings it to the level
+    of the own layer - measured from the samples when the table is built.
+    A note with a single layer plays as before.
+    
+    Everything plays on the instances and voices the kit already has -
+    no extra TSF instances, no extra sample memory.
+    
+    THREADING
+    ---------
+    Built on the loader thread along with the kit's engine, read-only
+    after that. select() is AUDIO THREAD (or offline render) safe: no
+    locks, no allocation.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+#include <vector>
+
+// Forward declaration - tsf is defined in tsf.h
+struct tsf;
+
+class SampleSelector
+{
+public:
+    static constexpr int numNotes = 128;
+    static constexpr int numVelocities = 128;
+    
+    // Build the tables for one preset of a parsed font (loader thread)
+    SampleSelector(const tsf* font, int presetIndex);
+    
+    // The regions one hit plays, and the gain to play them at
+    struct Selection
+    {
+        const int* regions = nullptr;
+        int numRegions = 0;
+        float gain = 1.0f;
+    };
+    
+    // Regions for a hit (velocity 0.0 to 1.0)
+    // roundRobinStep counts the note's earlier hits - only used with round-robin on
+    Selection select(int note, float velocity, bool roundRobin, juce::uint32 roundRobinStep) const noexcept;
+    
+    // Velocity layers a note has (0 = the kit doesn't play it)
+    int getNumLayers(int note) const noexcept;
+
+private:
+    struct Layer
+    {
+        int firstRegion = 0;  // Into regionIndices
+        int numRegions = 0;
+        float level = 0.0f;   // Peak of the loudest region, after its attenuation
+    };
+    
+    // Peak level of a region's samples
+    static float measureRegionLevel(const tsf* font, int presetIndex, int region);
+    
+    // Every layer's regions, one after the other
+    std::vector<int> regionIndices;
+    std::vector<Layer> layers;
+    
+    // Each note's layers, softest first: layers[firstLayer] on
+    std::array<int, numNotes> firstLayer {};
+    std::array<int, numNotes> numLayers {};
+    
+    // Layer by note and MIDI velocity (counted from the note's first, -1 = nothing plays)
+    std::array<juce::int16, numNotes * numVelocities> layerForVelocity;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleSelector)
+};
@@ -15,57 +15,191 @@
     "multiple definition" linker errors.
 */
 
+#include "RealtimeSafety.h"
+
+// Route TSF's allocations through the audio thread allocation counter (test builds)
+#if JDRUMMER_COUNT_AUDIO_ALLOCATIONS
+ #define TSF_MALLOC  RealtimeSafety::countedMalloc
+ #define TSF_REALLOC RealtimeSafety::countedRealloc
+ #define TSF_FREE    RealtimeSafety::countedFree
+#endif
+
 #define TSF_IMPLEMENTATION  // Enable the implementation in this file only
 #include "tsf.h"            // TinySoundFont - a simple SF2 player library
 #include "SoundFontManager.h"
 
+/*
+    KIT ENGINE
+    ----------
+    One loaded kit: the parsed sample pool plus the main and group voice
+    engines that share it. An engine is built completely BEFORE it is
+    published to the audio thread, and is only deleted after the audio
+    thread has stopped using it, so its contents never need a lock.
+*/
+struct SoundFontManager::KitEngine
+{
+    explicit KitEngine(CheckedCriticalSection& poolReferenceLock)
+        : referenceLock(poolReferenceLock)
+    {
+        soundFontGroups.fill(nullptr);
+    }
+    
+    /*
+        DESTRUCTOR - CLEANUP
+        --------------------
+        Every instance holds a reference on the shared sample data, so the
+        order doesn't matter - whichever tsf_close() runs last frees it.
+        TSF's reference count is a plain int, shared with other plugin
+        instances' engines, so it's only changed under the registry's lock.
+    */
+    ~KitEngine()
+    {
+        const CheckedCriticalSection::ScopedLockType sl(referenceLock);
+        
+        // Close main soundfont
+        if (soundFont != nullptr)
+            tsf_close(soundFont);
+        
+        // Close all group soundfonts
+        for (auto* sfGroup : soundFontGroups)
+        {
+            if (sfGroup != nullptr)
+                tsf_close(sfGroup);
+        }
+        
+        // Drop the pool's own reference last
+        if (samplePool != nullptr)
+            tsf_close(samplePool);
+    }
+    
+    /*
+        CREATE INSTANCE FROM POOL
+        -------------------------
+        tsf_copy() shares presets and samples but leaves the copy without
+        voices or channels, so output mode and voice count are set here.
+        Touching channel 9 now also allocates TSF's channel array up front,
+        so the first note on the audio thread doesn't have to.
+        Call with the registry's reference lock held.
+    */
+    tsf* createInstanceFromPool(int maxVoices) const
+    {
+        if (samplePool == nullptr)
+            return nullptr;
+        
+        tsf* instance = tsf_copy(samplePool);
+        if (instance != nullptr)
+        {
+            tsf_set_output(instance, TSF_STEREO_UNWEAVED,
+                           static_cast<int>(sampleRate), 0.0f);
+            tsf_set_max_voices(instance, maxVoices);
+            tsf_channel_set_presetindex(instance, 9, drumPresetIndex);
+        }
+        
+        return instance;
+    }
+    
+    // Does one instance (group -1 = main) have anything to render?
+    bool isSounding(int group) const
+    {
+        tsf* instance = group >= 0 ? soundFontGroups[static_cast<size_t>(group)] : soundFont;
+        return instance != nullptr && tsf_active_voice_count(instance) > 0;
+    }
+    
+    // Voices still sounding on any instance (used to tell when a kit has rung out)
+    int countActiveVoices() const
+    {
+        int count = (soundFont != nullptr) ? tsf_active_voice_count(soundFont) : 0;
+        
+        for (auto* sfGroup : soundFontGroups)
+        {
+            if (sfGroup != nullptr)
+                count += tsf_active_voice_count(sfGroup);
+        }
+        
+        return count;
+    }
+    
+    // Change the output rate of every instance (cheap - just sets fields)
+    void setOutputSampleRate(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        
+        if (soundFont != nullptr)
+            tsf_set_output(soundFont, TSF_STEREO_UNWEAVED, static_cast<int>(newSampleRate), 0.0f);
+        
+        for (auto* sfGroup : soundFontGroups)
+        {
+            if (sfGroup != nullptr)
+                tsf_set_output(sfGroup, TSF_STEREO_UNWEAVED, static_cast<int>(newSampleRate), 0.0f);
+        }
+    }
+    
+    // Parsed SF2 data shared by all instances below (never rendered itself)
+    tsf* samplePool = nullptr;
+    
+    // Main TinySoundFont handle (plays notes no output group claims)
+    tsf* soundFont = nullptr;
+    
+    // Separate TSF instances for each output group (for multi-out)
+    std::array<tsf*, NUM_OUTPUT_GROUPS> soundFontGroups;
+    
+    // Sample rate the instances are currently set up for
+    double sampleRate = 44100.0;
+    
+    // Velocity layer and round-robin tables for the pool's drum preset
+    std::unique_ptr<SampleSelector> sampleSelector;
+    
+    // Output group of each note, copied from the manager when the engine was built
+    NoteGroupTable noteGroups;
+    
+    // Hits of each note so far, for round-robin (audio thread / offline render only)
+    std::array<juce::uint32, NUM_NOTES> roundRobinSteps {};
+    
+    // Guards the pool's reference count (see KitRegistry)
+    CheckedCriticalSection& referenceLock;
+    
+    JUCE_DECLARE_NON_COPYABLE(KitEngine)
+};
+
 SoundFontManager::SoundFontManager()
 {
     /*
         INITIALIZE PER-NOTE SETTINGS
         ----------------------------
-        GM (General MIDI) drum notes range from 35 to 81.
-        We initialize all of them with default values.
+        GM (General MIDI) drum notes range from 35 to 81, but we keep a slot
+        for every MIDI note so lookups are a plain array index - no map, no
+        lock. All of them start with default values.
     */
-    for (int note = 35; note <= 81; ++note)
+    for (int note = 0; note < NUM_NOTES; ++note)
     {
-        noteVolumes[note] = 0.5f;  // Default to 50% volume
-        notePans[note] = 0.0f;     // Center pan
-        noteMutes[note] = false;   // Not muted
+        noteSettings.volumes[static_cast<size_t>(note)] = 0.5f;  // Default to 50% volume
+        noteSettings.pans[static_cast<size_t>(note)] = 0.0f;     // Center pan
+        noteSettings.mutes[static_cast<size_t>(note)] = false;   // Not muted
+        noteSettings.roundRobins[static_cast<size_t>(note)] = false;
     }
     
-    // Initialize all group pointers to nullptr
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
-    {
-        soundFontGroups[i] = nullptr;
-    }
+    noteGroups.fill(-1);  // Everything on the main instance until a mapper is set
+    
+    startTimer(retiredEngineCheckMs);
 }
 
 /*
     DESTRUCTOR - CLEANUP
     --------------------
-    When this object is destroyed, we must free all soundfont instances.
+    The audio thread has stopped by the time the processor is destroyed.
+    Once the loader thread has finished too, nobody else can touch the
+    engines, so everything can simply be freed here (the shared pools
+    belong to the registry).
 */
 SoundFontManager::~SoundFontManager()
 {
-    juce::ScopedLock sl(lock);
-    
-    // Close main soundfont
-    if (soundFont != nullptr)
-    {
-        tsf_close(soundFont);
-        soundFont = nullptr;
-    }
+    stopTimer();
+    loaderPool.removeAllJobs(true, 10000);
     
-    // Close all group soundfonts
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
-    {
-        if (soundFontGroups[i] != nullptr)
-        {
-            tsf_close(soundFontGroups[i]);
-            soundFontGroups[i] = nullptr;
-        }
-    }
+    freeRetiredEngines();
+    delete pendingEngine.exchange(nullptr);
+    delete outgoingEngine;
+    delete currentEngine;
 }
 
 juce::StringArray SoundFontManager::getAvailableKits() const
@@ -88,302 +222,947 @@ juce::StringArray SoundFontManager::getAvailableKits() const
 
 juce::String SoundFontManager::getCurrentKitName() const
 {
-    juce::ScopedLock sl(lock);
+    const CheckedCriticalSection::ScopedLockType sl(loadLock);
     return currentKitName;
 }
 
+juce::String SoundFontManager::getPendingKitName() const
+{
+    const CheckedCriticalSection::ScopedLockType sl(loadLock);
+    return pendingKitName;
+}
+
 /*
-    LOAD KIT
-    --------
-    Loads a soundfont file for the main output AND all individual output groups.
+    CREATE ENGINE
+    -------------
+    Creates the main and group instances from an already parsed sample pool.
+    The engine keeps the registry's reference on the pool, so it stays
+    valid even if the registry later drops the kit.
+    
+    The sample selection tables are built from the pool here too - its
+    regions and samples don't change once it has been shared.
 */
-bool SoundFontManager::loadKit(const juce::String& kitName)
+SoundFontManager::KitEngine* SoundFontManager::createEngine(tsf* poolReference, double sampleRate) const
 {
-    juce::ScopedLock sl(lock);
+    std::unique_ptr<KitEngine> engine = std::make_unique<KitEngine>(kitRegistry->getReferenceLock());
+    engine->sampleRate = sampleRate;
+    engine->samplePool = poolReference;
     
-    auto kitFile = soundFontsPath.getChildFile(kitName + ".sf2");
-    
-    if (!kitFile.existsAsFile())
     {
-        DBG("SoundFont file not found: " + kitFile.getFullPathName());
-        return false;
+        const CheckedCriticalSection::ScopedLockType sl(loadLock);
+        engine->noteGroups = noteGroups;
     }
     
-    // Cleanup previous main soundfont
-    if (soundFont != nullptr)
+    const CheckedCriticalSection::ScopedLockType sl(engine->referenceLock);
+    
+    // Main soundfont
+    engine->soundFont = engine->createInstanceFromPool(voiceManager.getVoiceBudget(-1));
+    
+    if (engine->soundFont == nullptr)
     {
-        tsf_close(soundFont);
-        soundFont = nullptr;
+        DBG("Failed to create soundfont instance");
+        return nullptr;
     }
     
-    // Cleanup previous group soundfonts
+    // Group soundfonts for multi-out, each sized to its group's voice budget
     for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
     {
-        if (soundFontGroups[i] != nullptr)
-        {
-            tsf_close(soundFontGroups[i]);
-            soundFontGroups[i] = nullptr;
-        }
+        engine->soundFontGroups[static_cast<size_t>(i)] = engine->createInstanceFromPool(voiceManager.getVoiceBudget(i));
     }
     
-    // Load main soundfont
-    soundFont = tsf_load_filename(kitFile.getFullPathName().toRawUTF8());
+    engine->sampleSelector = std::make_unique<SampleSelector>(engine->samplePool, drumPresetIndex);
+    
+    return engine.release();
+}
+
+/*
+    LOAD KIT ASYNC
+    --------------
+    Queues the kit on the loader thread and returns right away, so neither
+    the UI nor a DAW restoring a session waits for the SF2 to be parsed.
+    
+    Only the newest request matters: if the user clicks through several
+    kits quickly, requests that haven't started yet are skipped.
+*/
+void SoundFontManager::loadKitAsync(const juce::String& kitName, KitLoadCallback onComplete)
+{
+    const int requestId = ++latestLoadRequest;
+    
+    // Resolve the file here - soundFontsPath belongs to the calling thread
+    auto kitFile = soundFontsPath.getChildFile(kitName + ".sf2");
     
-    if (soundFont == nullptr)
     {
-        DBG("Failed to load soundfont: " + kitFile.getFullPathName());
-        return false;
+        const CheckedCriticalSection::ScopedLockType sl(loadLock);
+        pendingKitName = kitName;
     }
     
-    // Configure main soundfont
-    tsf_set_output(soundFont, TSF_STEREO_INTERLEAVED, 
-                   static_cast<int>(currentSampleRate), 0.0f);
-    tsf_set_max_voices(soundFont, 64);
+    ++pendingLoads;
     
-    // Load and configure group soundfonts for multi-out
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    loaderPool.addJob([this, kitName, kitFile, requestId, onComplete]()
     {
-        soundFontGroups[i] = tsf_load_filename(kitFile.getFullPathName().toRawUTF8());
-        if (soundFontGroups[i] != nullptr)
+        bool success = false;
+        
+        if (requestId == latestLoadRequest.load())
+            success = runKitLoad(kitName, kitFile);
+        
         {
-            tsf_set_output(soundFontGroups[i], TSF_STEREO_INTERLEAVED,
-                           static_cast<int>(currentSampleRate), 0.0f);
-            tsf_set_max_voices(soundFontGroups[i], 8);  // Fewer voices per group
+            const CheckedCriticalSection::ScopedLockType sl(loadLock);
+            if (requestId == latestLoadRequest.load())
+                pendingKitName.clear();
         }
+        
+        --pendingLoads;
+        
+        if (onComplete)
+            onComplete(success);
+    });
+}
+
+/*
+    LOAD KIT
+    --------
+    Synchronous version for callers that need the kit before carrying on.
+    The work still happens on the loader thread (see KIT CACHE in the
+    header); this thread just waits for it.
+*/
+bool SoundFontManager::loadKit(const juce::String& kitName)
+{
+    juce::WaitableEvent finished;
+    std::atomic<bool> result { false };
+    
+    loadKitAsync(kitName, [&finished, &result](bool success)
+    {
+        result = success;
+        finished.signal();
+    });
+    
+    finished.wait();
+    return result;
+}
+
+/*
+    RUN KIT LOAD - Loader thread
+    ----------------------------
+    1. Free engines the audio thread has finished with
+    2. Get the parsed sample pool (already loaded = no disk access at all)
+    3. Build the engine's 17 instances from it
+    4. Hand it to the audio thread as the pending engine
+    
+    An older pending engine the audio thread never picked up was never
+    used, so it can be deleted right here.
+*/
+bool SoundFontManager::runKitLoad(const juce::String& kitName, const juce::File& kitFile)
+{
+    freeRetiredEngines();
+    
+    if (!kitFile.existsAsFile())
+    {
+        DBG("SoundFont file not found: " + kitFile.getFullPathName());
+        return false;
     }
     
-    currentKitName = kitName;
+    const double sampleRate = currentSampleRate.load();
+    
+    tsf* pool = kitRegistry->openPool(kitFile, hostRateSamplesEnabled.load() ? sampleRate : 0.0);
+    if (pool == nullptr)
+        return false;
+    
+    KitEngine* newEngine = createEngine(pool, sampleRate);
+    if (newEngine == nullptr)
+        return false;
+    
+    int presetCount = tsf_get_presetcount(newEngine->soundFont);
+    
+    delete pendingEngine.exchange(newEngine);
+    
+    {
+        const CheckedCriticalSection::ScopedLockType sl(loadLock);
+        currentKitName = kitName;
+        currentKitFile = kitFile;
+    }
+    
+    ++soundRevision;
     
-    int presetCount = tsf_get_presetcount(soundFont);
     DBG("Loaded soundfont: " + kitName + " with " + juce::String(presetCount) + " presets");
     
     return true;
 }
 
+/*
+    RETIRED ENGINES
+    ---------------
+    Once an old kit has rung out, the audio thread pushes its engine onto
+    retiredEngines and raises enginesWaitingToBeFreed - it can't free the
+    17 instances itself, or even queue a job. The timer notices the flag
+    and has the loader thread free them (tsf_close() runs there, like
+    every other engine's), so an outgoing kit's memory goes within a
+    fraction of a second of its ring-out rather than at the next kit load.
+*/
+void SoundFontManager::timerCallback()
+{
+    if (enginesWaitingToBeFreed.exchange(false))
+        loaderPool.addJob([this]() { freeRetiredEngines(); });
+}
+
+void SoundFontManager::freeRetiredEngines()
+{
+    KitEngine* retired = nullptr;
+    while (retiredEngines.pop(retired))
+        delete retired;
+    
+    std::vector<KitEngine*> offlineEngines;
+    {
+        const CheckedCriticalSection::ScopedLockType sl(loadLock);
+        offlineEngines.swap(retiredOfflineEngines);
+    }
+    
+    for (auto* engine : offlineEngines)
+        delete engine;
+}
+
 void SoundFontManager::setSoundFontsPath(const juce::File& path)
 {
     soundFontsPath = path;
 }
 
+/*
+    SET SAMPLE RATE
+    ---------------
+    The audio thread applies the new rate to the engine at its next block.
+    With host-rate samples, the current kit is also rebuilt from samples
+    at the new rate; until it's ready the old engine plays on, resampling
+    as it goes. A kit load that is already queued reads the new rate
+    when it runs, so there's nothing to rebuild then.
+*/
 void SoundFontManager::setSampleRate(double sampleRate)
 {
-    juce::ScopedLock sl(lock);
-    currentSampleRate = sampleRate;
+    const double previousRate = currentSampleRate.exchange(sampleRate);
     
-    // Update main soundfont
-    if (soundFont != nullptr)
+    if (previousRate == sampleRate || !hostRateSamplesEnabled.load() || isKitLoadPending())
+        return;
+    
+    juce::String kitName;
+    juce::File kitFile;
     {
-        tsf_set_output(soundFont, TSF_STEREO_INTERLEAVED, 
-                       static_cast<int>(sampleRate), 0.0f);
+        const CheckedCriticalSection::ScopedLockType sl(loadLock);
+        kitName = currentKitName;
+        kitFile = currentKitFile;
     }
     
-    // Update all group soundfonts
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    if (kitName.isEmpty())
+        return;
+    
+    // Superseded by any kit request made after this one
+    const int requestId = latestLoadRequest.load();
+    
+    loaderPool.addJob([this, kitName, kitFile, requestId]()
     {
-        if (soundFontGroups[i] != nullptr)
+        if (requestId == latestLoadRequest.load())
+            runKitLoad(kitName, kitFile);
+    });
+}
+
+/*
+    BEGIN / END AUDIO BLOCK
+    -----------------------
+    Kit changes only ever happen here, at a block boundary. A pending
+    engine is adopted once the previous old kit has finished ringing out;
+    while a kit is waiting, that ring-out is cut short (faded, not cut).
+*/
+void SoundFontManager::beginAudioBlock() noexcept
+{
+    const double sampleRate = currentSampleRate.load();
+    
+    if (outgoingEngine == nullptr)
+    {
+        if (KitEngine* newEngine = pendingEngine.exchange(nullptr))
         {
-            tsf_set_output(soundFontGroups[i], TSF_STEREO_INTERLEAVED,
-                           static_cast<int>(sampleRate), 0.0f);
+            outgoingEngine = currentEngine;
+            currentEngine = newEngine;
+            outgoingFinished = false;
+            ringOutSamplesLeft = static_cast<int>(maxRingOutSeconds * sampleRate);
+            fadeLengthSamples = juce::jmax(1, static_cast<int>(fadeOutSeconds * sampleRate));
+            fadeSamplesLeft = 0;
         }
     }
+    else if (pendingEngine.load() != nullptr)
+    {
+        ringOutSamplesLeft = 0;
+    }
+    
+    // Drop a finished engine we couldn't hand back earlier (the queue was full)
+    if (outgoingEngine != nullptr && outgoingFinished && retiredEngines.push(outgoingEngine))
+    {
+        outgoingEngine = nullptr;
+        enginesWaitingToBeFreed = true;
+    }
+    
+    // Follow a sample rate change from prepareToPlay (or an engine built at the old rate)
+    for (auto* engine : { currentEngine, outgoingEngine })
+    {
+        if (engine != nullptr && engine->sampleRate != sampleRate)
+            engine->setOutputSampleRate(sampleRate);
+    }
+    
+    blockEngine = currentEngine;
+}
+
+void SoundFontManager::endAudioBlock() noexcept
+{
+    blockEngine = nullptr;
 }
 
 /*
-    NOTE ON - Main output
-    ---------------------
-    Triggers a note on the main soundfont instance.
-    Applies per-note volume, pan, and mute settings.
+    ADVANCE RING-OUT
+    ----------------
+    The old kit plays at full level until its voices have finished or
+    maxRingOutSeconds has passed, then fades out over fadeOutSeconds.
+    After that it is handed to the loader thread to be freed (see
+    RETIRED ENGINES).
+*/
+void SoundFontManager::advanceRingOut(int numSamples) noexcept
+{
+    if (fadeSamplesLeft > 0)
+    {
+        fadeSamplesLeft = juce::jmax(0, fadeSamplesLeft - numSamples);
+        outgoingFinished = (fadeSamplesLeft == 0);
+    }
+    else
+    {
+        ringOutSamplesLeft -= numSamples;
+        
+        if (outgoingEngine->countActiveVoices() == 0)
+            outgoingFinished = true;
+        else if (ringOutSamplesLeft <= 0)
+            fadeSamplesLeft = fadeLengthSamples;
+    }
+    
+    if (outgoingFinished && retiredEngines.push(outgoingEngine))
+    {
+        outgoingEngine = nullptr;
+        enginesWaitingToBeFreed = true;
+    }
+}
+
+/*
+    NOTE ON - Voice routing
+    -----------------------
+    Each hit is started on exactly ONE instance: the output group the
+    note maps to, or the main instance if no mapper has been set.
+    The main mix is later built by summing the groups, so a hit is
+    synthesized once no matter how many buses are active.
 */
 void SoundFontManager::noteOn(int note, float velocity)
 {
-    juce::ScopedLock sl(lock);
+    // Called outside beginAudioBlock()/endAudioBlock()?
+    jassert(blockEngine != nullptr || currentEngine == nullptr);
+    
+    if (blockEngine != nullptr)
+        startNote(*blockEngine, getGroupForNote(*blockEngine, note), note, velocity);
+}
+
+/*
+    NOTE OFF
+    --------
+    Released on the current kit, and on the old one while it rings out:
+    a note held across a kit change was started on the old kit, and a
+    sustained or looping region would otherwise keep playing at full
+    level until the ring-out fade cuts it off.
+*/
+void SoundFontManager::noteOff(int note)
+{
+    // Release the note using channel 9 (GM drum channel)
+    if (tsf* instance = getInstanceForNote(note))
+        tsf_channel_note_off(instance, 9, note);
+    
+    if (outgoingEngine != nullptr && !outgoingFinished)
+    {
+        if (tsf* instance = getInstanceForNote(*outgoingEngine, note))
+            tsf_channel_note_off(instance, 9, note);
+    }
+}
+
+/*
+    GET INSTANCE FOR NOTE
+    ---------------------
+    Picks the instance of the current block's engine a note is routed to.
+*/
+tsf* SoundFontManager::getInstanceForNote(int note) const
+{
+    // Called outside beginAudioBlock()/endAudioBlock()?
+    jassert(blockEngine != nullptr || currentEngine == nullptr);
+    
+    if (blockEngine == nullptr)
+        return nullptr;
+    
+    return getInstanceForNote(*blockEngine, note);
+}
+
+tsf* SoundFontManager::getInstanceForNote(const KitEngine& engine, int note) const
+{
+    const int groupIndex = getGroupForNote(engine, note);
+    if (groupIndex >= 0)
+        return engine.soundFontGroups[static_cast<size_t>(groupIndex)];
+    
+    return engine.soundFont;
+}
+
+int SoundFontManager::getGroupForNote(const KitEngine& engine, int note)
+{
+    return isValidNote(note) ? engine.noteGroups[static_cast<size_t>(note)] : -1;
+}
+
+/*
+    START NOTE
+    ----------
+    Applies per-note volume, pan, and mute settings and starts the note
+    on the group's instance of the engine (group -1 = main instance).
+    
+    Before the note starts, every note it chokes is released (wherever
+    that note is routed), and voices are stolen until the hit fits in
+    its group's voice budget - see DrumVoiceManager.
+    
+    The engine's SampleSelector picks the regions the hit plays (its
+    velocity layer, or a neighbouring layer for round-robin), so the
+    voice count is known without scanning the preset.
+*/
+void SoundFontManager::startNote(KitEngine& engine, int group, int note, float velocity)
+{
+    tsf* instance = group >= 0 ? engine.soundFontGroups[static_cast<size_t>(group)] : engine.soundFont;
     
-    if (soundFont == nullptr)
+    if (instance == nullptr || !isValidNote(note))
         return;
     
     // Check if muted
-    if (noteMutes.count(note) && noteMutes[note])
+    if (getNoteMute(note))
         return;
     
     // Apply per-note volume
-    float vol = noteVolumes.count(note) ? noteVolumes[note] : 0.5f;
-    float adjustedVelocity = velocity * vol;
+    float adjustedVelocity = velocity * getNoteVolume(note);
     
     // Apply per-note pan
-    float pan = notePans.count(note) ? notePans[note] : 0.0f;
+    float pan = getNotePan(note);
     // TSF pan: 0.0 = left, 0.5 = center, 1.0 = right
     // Our pan: -1.0 = left, 0.0 = center, 1.0 = right
     // Invert because TSF has reversed pan direction
     float tsfPan = (1.0f - pan) / 2.0f;
     
-    int presetCount = tsf_get_presetcount(soundFont);
+    int presetCount = tsf_get_presetcount(instance);
     if (presetCount > 0)
     {
         // Use channel 9 for drums (GM standard) with channel-based note triggering
-        tsf_channel_set_presetindex(soundFont, 9, 0);  // Set preset on channel 9
-        tsf_channel_set_pan(soundFont, 9, tsfPan);
-        tsf_channel_note_on(soundFont, 9, note, adjustedVelocity);
+        tsf_channel_set_presetindex(instance, 9, drumPresetIndex);  // Set preset on channel 9
+        tsf_channel_set_pan(instance, 9, tsfPan);
+        
+        voiceManager.forEachChokedNote(note, [&](int chokedNote)
+        {
+            DrumVoiceManager::chokeNote(getInstanceForNote(engine, chokedNote), chokedNote);
+        });
+        
+        const auto selection = engine.sampleSelector->select(note, adjustedVelocity, getNoteRoundRobin(note),
+                                                             engine.roundRobinSteps[static_cast<size_t>(note)]++);
+        if (selection.numRegions == 0)
+            return;
+        
+        voiceManager.makeRoomForNote(instance, voiceManager.getVoiceBudget(group), selection.numRegions);
+        tsf_channel_note_on_regions(instance, 9, note, adjustedVelocity * selection.gain,
+                                    selection.regions, selection.numRegions);
     }
 }
 
-void SoundFontManager::noteOff(int note)
+void SoundFontManager::cullInaudibleVoices(const KitEngine& engine) const
 {
-    juce::ScopedLock sl(lock);
+    voiceManager.cullInaudibleVoices(engine.soundFont);
     
-    if (soundFont == nullptr)
+    for (tsf* instance : engine.soundFontGroups)
+        voiceManager.cullInaudibleVoices(instance);
+}
+
+/*
+    RENDER AUDIO - Main mix only
+    ----------------------------
+    Notes may live on any group instance, so the full mix is the main
+    instance plus every group mixed in place.
+*/
+void SoundFontManager::renderAudio(float* left, float* right, int numSamples)
+{
+    if (!getSoundingOutputs().main)
         return;
     
-    // Release the note using channel 9 (GM drum channel)
-    tsf_channel_note_off(soundFont, 9, note);
+    const std::array<StereoBuffer, NUM_OUTPUT_GROUPS> noGroupBuses {};
+    renderAudioMultiOut({ left, right }, noGroupBuses, numSamples);
 }
 
 /*
-    RENDER AUDIO - Main output only
+    PER-NOTE SETTINGS
+    -----------------
+    Atomic loads/stores: the processor writes (from its parameters), the
+    audio thread reads at note start. Each value stands on its own, so
+    relaxed ordering is enough. Notes outside 0-127 are ignored (getters
+    return the defaults).
 */
-void SoundFontManager::renderAudio(float* outputBuffer, int numSamples)
+/*
+    STORE NOTE SETTING
+    ------------------
+    The processor copies every pad parameter in at the start of each
+    block, so most calls change nothing: only a real change moves the
+    sound revision on (see getSoundRevision).
+*/
+template <typename Value>
+void SoundFontManager::storeNoteSetting(std::atomic<Value>& setting, Value newValue) noexcept
 {
-    juce::ScopedLock sl(lock);
-    
-    if (soundFont == nullptr)
-    {
-        std::memset(outputBuffer, 0, sizeof(float) * numSamples * 2);
+    if (setting.load(std::memory_order_relaxed) == newValue)
         return;
-    }
     
-    tsf_render_float(soundFont, outputBuffer, numSamples, 0);
+    setting.store(newValue, std::memory_order_relaxed);
+    soundRevision.fetch_add(1, std::memory_order_relaxed);
 }
 
 void SoundFontManager::setNoteVolume(int note, float volume)
 {
-    juce::ScopedLock sl(lock);
-    noteVolumes[note] = juce::jlimit(0.0f, 1.0f, volume);
+    if (isValidNote(note))
+        storeNoteSetting(noteSettings.volumes[static_cast<size_t>(note)], juce::jlimit(0.0f, 1.0f, volume));
 }
 
 void SoundFontManager::setNotePan(int note, float pan)
 {
-    juce::ScopedLock sl(lock);
-    notePans[note] = juce::jlimit(-1.0f, 1.0f, pan);
+    if (isValidNote(note))
+        storeNoteSetting(noteSettings.pans[static_cast<size_t>(note)], juce::jlimit(-1.0f, 1.0f, pan));
 }
 
 float SoundFontManager::getNoteVolume(int note) const
 {
-    auto it = noteVolumes.find(note);
-    return it != noteVolumes.end() ? it->second : 0.5f;
+    return isValidNote(note) ? noteSettings.volumes[static_cast<size_t>(note)].load(std::memory_order_relaxed) : 0.5f;
 }
 
 float SoundFontManager::getNotePan(int note) const
 {
-    auto it = notePans.find(note);
-    return it != notePans.end() ? it->second : 0.0f;
+    return isValidNote(note) ? noteSettings.pans[static_cast<size_t>(note)].load(std::memory_order_relaxed) : 0.0f;
 }
 
 void SoundFontManager::setNoteMute(int note, bool muted)
 {
-    juce::ScopedLock sl(lock);
-    noteMutes[note] = muted;
+    if (isValidNote(note))
+        storeNoteSetting(noteSettings.mutes[static_cast<size_t>(note)], muted);
 }
 
 bool SoundFontManager::getNoteMute(int note) const
 {
-    auto it = noteMutes.find(note);
-    return it != noteMutes.end() ? it->second : false;
+    return isValidNote(note) ? noteSettings.mutes[static_cast<size_t>(note)].load(std::memory_order_relaxed) : false;
+}
+
+void SoundFontManager::setNoteRoundRobin(int note, bool enabled)
+{
+    if (isValidNote(note))
+        storeNoteSetting(noteSettings.roundRobins[static_cast<size_t>(note)], enabled);
+}
+
+bool SoundFontManager::getNoteRoundRobin(int note) const
+{
+    return isValidNote(note) ? noteSettings.roundRobins[static_cast<size_t>(note)].load(std::memory_order_relaxed) : false;
 }
 
 // ===== MULTI-OUT SUPPORT =====
 
-void SoundFontManager::setNoteToGroupMapper(std::function<int(int)> mapper)
+void SoundFontManager::setNoteToGroupMapper(const std::function<int(int)>& mapper)
 {
-    juce::ScopedLock sl(lock);
-    noteToGroupMapper = mapper;
+    NoteGroupTable table;
+    
+    for (int note = 0; note < NUM_NOTES; ++note)
+    {
+        const int groupIndex = mapper ? mapper(note) : -1;
+        table[static_cast<size_t>(note)] = static_cast<juce::int8>(groupIndex >= 0 && groupIndex < NUM_OUTPUT_GROUPS
+                                                                       ? groupIndex : -1);
+    }
+    
+    // Engines copy it when they are built (see createEngine) - one already
+    // playing or rendering keeps the table it was built with
+    const CheckedCriticalSection::ScopedLockType sl(loadLock);
+    noteGroups = table;
 }
 
 /*
     NOTE ON TO GROUP - Multi-out
     ----------------------------
-    Triggers a note on a specific output group's soundfont instance.
+    Triggers a note on a specific output group's soundfont instance,
+    bypassing the note-to-group mapper.
 */
 void SoundFontManager::noteOnToGroup(int note, float velocity, int groupIndex)
 {
-    juce::ScopedLock sl(lock);
-    
-    if (groupIndex < 0 || groupIndex >= NUM_OUTPUT_GROUPS)
+    if (blockEngine == nullptr || groupIndex < 0 || groupIndex >= NUM_OUTPUT_GROUPS)
         return;
     
-    tsf* sfGroup = soundFontGroups[groupIndex];
-    if (sfGroup == nullptr)
-        return;
-    
-    // Check if muted
-    if (noteMutes.count(note) && noteMutes[note])
+    startNote(*blockEngine, groupIndex, note, velocity);
+}
+
+void SoundFontManager::noteOffToGroup(int note, int groupIndex)
+{
+    if (blockEngine == nullptr || groupIndex < 0 || groupIndex >= NUM_OUTPUT_GROUPS)
         return;
     
-    // Apply per-note volume
-    float vol = noteVolumes.count(note) ? noteVolumes[note] : 0.5f;
-    float adjustedVelocity = velocity * vol;
-    
-    // Apply per-note pan (inverted for TSF)
-    float pan = notePans.count(note) ? notePans[note] : 0.0f;
-    float tsfPan = (1.0f - pan) / 2.0f;
-    
-    int presetCount = tsf_get_presetcount(sfGroup);
-    if (presetCount > 0)
+    // Release the note using channel 9 (GM drum channel), on the old kit too while
+    // it rings out (see NOTE OFF)
+    for (auto* engine : { blockEngine, outgoingFinished ? nullptr : outgoingEngine })
     {
-        // Use channel 9 for drums with channel-based note triggering
-        tsf_channel_set_presetindex(sfGroup, 9, 0);
-        tsf_channel_set_pan(sfGroup, 9, tsfPan);
-        tsf_channel_note_on(sfGroup, 9, note, adjustedVelocity);
+        if (engine == nullptr)
+            continue;
+    
+        if (tsf* sfGroup = engine->soundFontGroups[static_cast<size_t>(groupIndex)])
+            tsf_channel_note_off(sfGroup, 9, note);
     }
 }
 
-void SoundFontManager::noteOffToGroup(int note, int groupIndex)
+/*
+    SOUNDING OUTPUTS - Idle skipping
+    --------------------------------
+    Most of the time most groups are silent (a groove rarely plays all
+    16), and between hits nothing plays at all. The caller asks first,
+    and only fetches (and so un-clears) the host channels that are about
+    to get audio. An idle kit costs a voice count per instance.
+    
+    Inaudible tails are dropped first, so they don't keep a group awake.
+*/
+SoundFontManager::SoundingOutputs SoundFontManager::getSoundingOutputs()
 {
-    juce::ScopedLock sl(lock);
+    SoundingOutputs sounding;
     
-    if (groupIndex < 0 || groupIndex >= NUM_OUTPUT_GROUPS)
-        return;
+    // No kit loaded yet - output silence
+    if (blockEngine == nullptr)
+        return sounding;
     
-    tsf* sfGroup = soundFontGroups[groupIndex];
-    if (sfGroup == nullptr)
-        return;
+    const bool ringingOut = (outgoingEngine != nullptr && !outgoingFinished);
     
-    // Release the note using channel 9 (GM drum channel)
-    tsf_channel_note_off(sfGroup, 9, note);
+    cullInaudibleVoices(*blockEngine);
+    if (ringingOut)
+        cullInaudibleVoices(*outgoingEngine);
+    
+    auto isSounding = [&](int group)
+    {
+        return blockEngine->isSounding(group) || (ringingOut && outgoingEngine->isSounding(group));
+    };
+    
+    sounding.main = isSounding(-1);
+    
+    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    {
+        sounding.groups[static_cast<size_t>(i)] = isSounding(i);
+        sounding.main = sounding.main || sounding.groups[static_cast<size_t>(i)];
+    }
+    
+    return sounding;
 }
-
+    
 /*
     RENDER AUDIO MULTI-OUT
     ----------------------
-    Renders the main mix and all individual output groups.
+    Renders every output group ONCE and builds the main mix from them.
+    
+    - An enabled group (valid buffer) is rendered into its own bus
+      and then added to the main mix.
+    - A disabled group is rendered straight into the main mix using
+      TSF's flag_mixing, so it costs no extra copy.
+    
+    The instances render unweaved (TSF_STEREO_UNWEAVED), straight into
+    the separate left and right channels JUCE hands us, and the group
+    buses are summed with FloatVectorOperations - no interleaved
+    intermediate buffer and no per-sample deinterleave.
+    
+    A kit that is ringing out after a kit change is rendered on top of
+    the current one, the same way. Instances without voices are skipped.
+    
+    Per-note volume and pan were already applied when the note started,
+    so the sum is identical to what a single main instance would produce.
 */
-void SoundFontManager::renderAudioMultiOut(float* mainBuffer,
-                                            std::array<float*, NUM_OUTPUT_GROUPS>& groupBuffers,
+void SoundFontManager::renderAudioMultiOut(StereoBuffer main,
+                                            const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
                                             int numSamples)
 {
-    juce::ScopedLock sl(lock);
+    // No kit loaded yet - output silence
+    if (blockEngine == nullptr || !main.isValid())
+        return;
+    
+    addEngineOutput(*blockEngine, main, groups, numSamples, 1.0f, 1.0f, activeRenderPool.load());
     
-    // Render main mix
-    if (soundFont != nullptr)
+    if (outgoingEngine != nullptr && !outgoingFinished)
     {
-        tsf_render_float(soundFont, mainBuffer, numSamples, 0);
+        float startGain = 1.0f;
+        float endGain = 1.0f;
+        
+        if (fadeSamplesLeft > 0)
+        {
+            startGain = static_cast<float>(fadeSamplesLeft) / static_cast<float>(fadeLengthSamples);
+            endGain = static_cast<float>(juce::jmax(0, fadeSamplesLeft - numSamples))
+                          / static_cast<float>(fadeLengthSamples);
+        }
+        
+        addEngineOutput(*outgoingEngine, main, groups, numSamples, startGain, endGain);
+        advanceRingOut(numSamples);
     }
-    else
+    
+    // The enabled groups were rendered into their own buses - sum them into the main mix
+    addGroupsToMain(main, groups, numSamples);
+}
+
+void SoundFontManager::setParallelRenderingEnabled(bool shouldRenderInParallel)
+{
+    if (shouldRenderInParallel && renderPool == nullptr)
     {
-        std::memset(mainBuffer, 0, sizeof(float) * numSamples * 2);
+        const int numWorkers = RenderWorkerPool::getDefaultNumWorkers();
+        
+        // A single-core machine has nobody to share the work with
+        if (numWorkers == 0)
+            return;
+        
+        renderPool = std::make_unique<RenderWorkerPool>(numWorkers);
     }
     
-    // Render each output group
-    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    activeRenderPool = shouldRenderInParallel ? renderPool.get() : nullptr;
+}
+
+void SoundFontManager::getActiveVoiceCounts(std::array<int, NUM_OUTPUT_GROUPS + 1>& counts) const noexcept
+{
+    counts.fill(0);
+    
+    auto addEngine = [&counts](const KitEngine* engine)
     {
-        if (groupBuffers[i] != nullptr)
+        if (engine == nullptr)
+            return;
+        
+        if (engine->soundFont != nullptr)
+            counts[0] += tsf_active_voice_count(engine->soundFont);
+        
+        for (size_t i = 0; i < engine->soundFontGroups.size(); ++i)
         {
-            if (soundFontGroups[i] != nullptr)
+            if (auto* instance = engine->soundFontGroups[i])
+                counts[i + 1] += tsf_active_voice_count(instance);
+        }
+    };
+    
+    addEngine(blockEngine);
+    
+    if (!outgoingFinished)
+        addEngine(outgoingEngine);
+}
+
+void SoundFontManager::addGroupsToMain(StereoBuffer main, const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
+                                       int numSamples) noexcept
+{
+    for (const auto& group : groups)
+    {
+        if (!group.isValid())
+            continue;
+        
+        juce::FloatVectorOperations::add(main.left, group.left, numSamples);
+        juce::FloatVectorOperations::add(main.right, group.right, numSamples);
+    }
+}
+
+/*
+    ADD ENGINE OUTPUT
+    -----------------
+    Mixes every instance of one engine into its destination: the main
+    instance and disabled groups into the main mix, enabled groups into
+    their own bus.
+    
+    At constant full gain TSF mixes straight into the destination. For a
+    fade we render through a small fixed scratch buffer and apply the
+    gain ramp while adding.
+    
+    Given a worker pool, the groups with their own bus are rendered as
+    one batch while this thread does the rest (see PARALLEL GROUP
+    RENDERING in the header).
+*/
+void SoundFontManager::addEngineOutput(KitEngine& engine, StereoBuffer main,
+                                        const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
+                                        int numSamples, float startGain, float endGain,
+                                        RenderWorkerPool* pool)
+{
+    const bool fullGain = (startGain == 1.0f && endGain == 1.0f);
+    const float gainStep = (endGain - startGain) / static_cast<float>(juce::jmax(1, numSamples));
+    
+    auto addInstance = [&](tsf* instance, StereoBuffer destination)
+    {
+        // Idle instances add nothing
+        if (instance == nullptr || tsf_active_voice_count(instance) == 0)
+            return;
+        
+        if (fullGain)
+        {
+            tsf_render_float_separate(instance, destination.left, destination.right, numSamples, 1);
+            return;
+        }
+        
+        float* scratchLeft = fadeScratch.data();
+        float* scratchRight = fadeScratch.data() + fadeScratchFrames;
+        
+        for (int done = 0; done < numSamples; done += fadeScratchFrames)
+        {
+            const int numFrames = juce::jmin(fadeScratchFrames, numSamples - done);
+            tsf_render_float_separate(instance, scratchLeft, scratchRight, numFrames, 0);
+            
+            float* outLeft = destination.left + done;
+            float* outRight = destination.right + done;
+            float gain = startGain + gainStep * static_cast<float>(done);
+            
+            for (int i = 0; i < numFrames; ++i)
+            {
+                outLeft[i]  += scratchLeft[i] * gain;
+                outRight[i] += scratchRight[i] * gain;
+                gain += gainStep;
+            }
+        }
+    };
+    
+    if (pool != nullptr && fullGain && numSamples >= minParallelRenderSamples)
+    {
+        auto& batch = groupRenderBatch;
+        batch.numSamples = numSamples;
+        
+        int numJobs = 0;
+        int numOnMain = (engine.soundFont != nullptr && tsf_active_voice_count(engine.soundFont) > 0) ? 1 : 0;
+        
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            tsf* instance = engine.soundFontGroups[i];
+            if (instance == nullptr || tsf_active_voice_count(instance) == 0)
+                continue;
+            
+            if (groups[i].isValid())
             {
-                tsf_render_float(soundFontGroups[i], groupBuffers[i], numSamples, 0);
+                batch.instances[static_cast<size_t>(numJobs)] = instance;
+                batch.destinations[static_cast<size_t>(numJobs)] = groups[i];
+                ++numJobs;
             }
             else
             {
-                std::memset(groupBuffers[i], 0, sizeof(float) * numSamples * 2);
+                ++numOnMain;
+            }
+        }
+        
+        // Worth it only if there are at least two instances to render side by side
+        if (numJobs > 0 && numJobs + numOnMain > 1)
+        {
+            pool->start(renderGroupJob, &batch, numJobs);
+            
+            addInstance(engine.soundFont, main);
+            
+            for (size_t i = 0; i < groups.size(); ++i)
+            {
+                if (!groups[i].isValid())
+                    addInstance(engine.soundFontGroups[i], main);
             }
+            
+            pool->finish();
+            return;
+        }
+    }
+    
+    addInstance(engine.soundFont, main);
+    
+    for (int i = 0; i < NUM_OUTPUT_GROUPS; ++i)
+    {
+        const auto& group = groups[static_cast<size_t>(i)];
+        addInstance(engine.soundFontGroups[static_cast<size_t>(i)], group.isValid() ? group : main);
+    }
+}
+
+void SoundFontManager::renderGroupJob(void* context, int jobIndex) noexcept
+{
+    const auto& batch = *static_cast<const GroupRenderBatch*>(context);
+    const auto& destination = batch.destinations[static_cast<size_t>(jobIndex)];
+    
+    tsf_render_float_separate(batch.instances[static_cast<size_t>(jobIndex)],
+                              destination.left, destination.right, batch.numSamples, 1);
+}
+
+/*
+    CREATE OFFLINE ENGINE
+    ---------------------
+    Built on the loader thread like every other engine, from the current
+    kit's shared pool - normally no disk access and no parsing, just the
+    tsf_copy() calls.
+    The calling thread waits for it.
+*/
+std::unique_ptr<SoundFontManager::OfflineEngine> SoundFontManager::createOfflineEngine(double sampleRate)
+{
+    juce::WaitableEvent finished;
+    KitEngine* newEngine = nullptr;
+    
+    loaderPool.addJob([this, sampleRate, &finished, &newEngine]()
+    {
+        juce::File kitFile;
+        {
+            const CheckedCriticalSection::ScopedLockType sl(loadLock);
+            kitFile = currentKitFile;
+        }
+        
+        if (kitFile.existsAsFile())
+        {
+            if (tsf* pool = kitRegistry->openPool(kitFile, -1.0))  // Any rate - the engine resamples
+                newEngine = createEngine(pool, sampleRate);
         }
+        
+        finished.signal();
+    });
+    
+    finished.wait();
+    
+    if (newEngine == nullptr)
+        return nullptr;
+    
+    return std::unique_ptr<OfflineEngine>(new OfflineEngine(*this, newEngine));
+}
+
+SoundFontManager::OfflineEngine::~OfflineEngine()
+{
+    // tsf_close() must run on the loader thread, like every other engine's
+    {
+        const CheckedCriticalSection::ScopedLockType sl(manager.loadLock);
+        manager.retiredOfflineEngines.push_back(engine);
     }
+    
+    SoundFontManager* owner = &manager;
+    manager.loaderPool.addJob([owner]() { owner->freeRetiredEngines(); });
+}
+
+void SoundFontManager::OfflineEngine::noteOn(int note, float velocity)
+{
+    manager.startNote(*engine, getGroupForNote(note), note, velocity);
+}
+
+void SoundFontManager::OfflineEngine::noteOff(int note)
+{
+    if (tsf* instance = manager.getInstanceForNote(*engine, note))
+        tsf_channel_note_off(instance, 9, note);
+}
+
+int SoundFontManager::OfflineEngine::getGroupForNote(int note) const
+{
+    return SoundFontManager::getGroupForNote(*engine, note);
+}
+
+int SoundFontManager::OfflineEngine::getNumActiveVoices() const
+{
+    return engine->countActiveVoices();
+}
+
+double SoundFontManager::OfflineEngine::getSampleRate() const
+{
+    return engine->sampleRate;
+}
+
+/*
+    OFFLINE RENDER
+    --------------
+    The same routing as renderAudioMultiOut(), for one engine that is
+    never faded: every instance mixes straight into its destination
+    (addEngineOutput() at full gain touches nothing but the engine).
+*/
+void SoundFontManager::OfflineEngine::render(StereoBuffer main,
+                                             const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
+                                             int numSamples)
+{
+    manager.cullInaudibleVoices(*engine);
+    manager.addEngineOutput(*engine, main, groups, numSamples, 1.0f, 1.0f);
+    addGroupsToMain(main, groups, numSamples);
 }
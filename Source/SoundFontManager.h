@@ -17,20 +17,109 @@
     sent to its own stereo output for individual mixing in the DAW.
     
     We maintain separate TSF instances for each output group to enable
-    independent rendering to different output buses.
+    independent rendering to different output buses. With a note-to-group
+    mapper set, each note is played ONLY on its group's instance and the
+    main mix is the sum of all groups (voice routing), so every hit is
+    synthesized once.
+    
+    SHARED SAMPLE POOL
+    ------------------
+    The SF2 file is parsed ONCE into a "sample pool" handle. The main
+    instance and every group instance are created with tsf_copy(), which
+    gives each one its own voices and channels but shares the (large)
+    preset and sample data through a reference count. The sample memory
+    is freed when the last instance sharing it is closed.
+    
+    The pools come from the process-wide KitRegistry, so plugin instances
+    playing the same kit share ONE parsed copy of it as well - memory and
+    load time grow with the number of distinct kits, not of instances.
+    The file is memory-mapped while it is parsed, and only the samples of
+    the drum preset are converted into the pool (see KitRegistry.cpp).
+    
+    THREADING
+    ---------
+    Everything a loaded kit needs (pool + 17 instances) lives in one
+    KitEngine. Kits are built on a background loader thread and handed to
+    the audio thread as a PENDING engine through an atomic pointer - the
+    audio thread never waits for a kit to load, and neither does the UI.
+    
+    Per-note settings are plain atomics, so the UI can change them while
+    the audio thread reads them.
+    
+    The note and render methods are AUDIO THREAD ONLY and must be called
+    between beginAudioBlock() and endAudioBlock() (see ScopedAudioBlock).
+    
+    HOT-SWAP AND RING-OUT
+    ---------------------
+    At the start of a block the audio thread adopts a pending engine: new
+    notes go to the new kit straight away, while the old kit keeps
+    rendering so hits that are still ringing finish naturally. If the old
+    kit is still sounding after a couple of seconds (or another kit is
+    waiting), it is faded out over a few milliseconds instead of being cut.
+    Finished engines are passed back to the loader thread to be freed,
+    a timer tick after their ring-out ends.
+    
+    KIT CACHE
+    ---------
+    The registry keeps the parsed sample pools of the last few kits even
+    when no instance is using them, so switching back to a recent kit
+    only costs a few tsf_copy() calls - no disk access, no parsing.
+    TSF's reference count is a plain int shared across instances, so
+    every tsf_copy()/tsf_close() on a pool holds the registry's lock.
+    
+    HOST-RATE SAMPLES
+    -----------------
+    A kit's samples are usually recorded at 44.1 kHz, so at any other
+    host rate every hit is resampled on the fly - linear interpolation,
+    per voice, per sample. Instead, when a kit is parsed, the samples the
+    GM drum notes (35-81) play are converted ONCE to the host rate with
+    the windowed-sinc Resampler, and a hit at its root pitch becomes a
+    plain copy-and-gain loop. Tuned or pitch-modulated hits still
+    interpolate, from the better source. The file's own samples are
+    kept for everything else, so the pool grows by the converted copies.
+    A shared pool is only reused at the rate it was converted to, and a
+    host rate change rebuilds the current kit in the background.
+    
+    OFFLINE RENDERING
+    -----------------
+    createOfflineEngine() builds one more engine for the current kit, on
+    the loader thread like any other, for bouncing faster than real time
+    on a worker thread. The audio thread never sees it.
+    
+    VOICE MANAGEMENT
+    ----------------
+    Every instance is built with its group's voice budget, and every hit
+    goes through the DrumVoiceManager first: choked notes are released,
+    and a voice is stolen if the hit wouldn't fit. Before each block,
+    voices that have faded below the audibility floor are stopped.
+    
+    SAMPLE SELECTION
+    ----------------
+    Each engine has a SampleSelector, built when the kit is loaded: a
+    hit looks its velocity layer up in a table instead of TSF scanning
+    every region, and notes with round-robin on cycle through the
+    neighbouring layers for variation - on the same instances and
+    voices, with no extra kit loaded.
 */
 
 #pragma once
 
 #include "JuceHeader.h"
-#include <map>
+#include "RealtimeSafety.h"
+#include "DrumVoiceManager.h"
+#include "KitRegistry.h"
+#include "SampleSelector.h"
+#include "RenderWorkerPool.h"
 #include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <vector>
 
 // Forward declaration - tsf is defined in tsf.h
 struct tsf;
 
-class SoundFontManager
+class SoundFontManager : private juce::Timer
 {
 public:
     // Number of individual output groups (one per drum pad)
@@ -42,29 +131,68 @@ public:
     // Get list of available kits (SF2 files in soundFontsPath)
     juce::StringArray getAvailableKits() const;
     
-    // Load a kit by name (without .sf2 extension)
+    // Called on the LOADER thread when a kit request has finished
+    // (true = the kit is ready and will be heard from the next audio block)
+    using KitLoadCallback = std::function<void(bool success)>;
+    
+    // Queue a kit to be loaded on the background loader (without .sf2 extension)
+    // Returns immediately; a newer request supersedes one that hasn't started yet
+    void loadKitAsync(const juce::String& kitName, KitLoadCallback onComplete = nullptr);
+    
+    // Load a kit and wait for it (blocks the CALLING thread, never the audio thread)
     bool loadKit(const juce::String& kitName);
     
     // Get the currently loaded kit name (thread-safe)
     juce::String getCurrentKitName() const;
     
+    // Kit that has been requested but isn't ready yet (empty if none)
+    juce::String getPendingKitName() const;
+    bool isKitLoadPending() const { return pendingLoads.load() > 0; }
+    
     // Set the path where SF2 files are located
     void setSoundFontsPath(const juce::File& path);
     
     // Get the soundfonts path
     juce::File getSoundFontsPath() const { return soundFontsPath; }
     
-    // Set the sample rate for audio rendering
+    // Set the sample rate for audio rendering (applied at the next audio block)
     void setSampleRate(double sampleRate);
     
-    // Trigger a note (velocity 0.0 to 1.0) - main output
+    // Convert the drum samples to the host rate at kit load (see HOST-RATE SAMPLES)
+    // Applies from the next kit load - on by default
+    void setHostRateSamplesEnabled(bool shouldConvert) { hostRateSamplesEnabled = shouldConvert; }
+    bool areHostRateSamplesEnabled() const { return hostRateSamplesEnabled.load(); }
+    
+    // ===== AUDIO THREAD =====
+    
+    // Pick up the current engine for this block (adopting a pending kit) / release it again
+    void beginAudioBlock() noexcept;
+    void endAudioBlock() noexcept;
+    
+    // RAII helper: beginAudioBlock() in the constructor, endAudioBlock() in the destructor
+    class ScopedAudioBlock
+    {
+    public:
+        explicit ScopedAudioBlock(SoundFontManager& m) noexcept : manager(m) { manager.beginAudioBlock(); }
+        ~ScopedAudioBlock() noexcept { manager.endAudioBlock(); }
+    
+    private:
+        SoundFontManager& manager;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedAudioBlock)
+    };
+    
+    // Trigger a note (velocity 0.0 to 1.0)
+    // Routed to the note's output group if a mapper is set, else the main instance
     void noteOn(int note, float velocity);
     
-    // Release a note - main output
+    // Release a note (routed the same way as noteOn), on the kit ringing out as well
     void noteOff(int note);
     
-    // Render audio to output buffer (stereo interleaved) - main output only
-    void renderAudio(float* outputBuffer, int numSamples);
+    // Add the main mix to two channel buffers - audio thread
+    void renderAudio(float* left, float* right, int numSamples);
+    
+    // ===== PER-NOTE SETTINGS (any thread) =====
     
     // Per-note volume control (0.0 to 1.0)
     void setNoteVolume(int note, float volume);
@@ -78,50 +206,306 @@ public:
     void setNoteMute(int note, bool muted);
     bool getNoteMute(int note) const;
     
+    // Per-note round-robin: repeated hits alternate velocity layers (see SampleSelector.h)
+    void setNoteRoundRobin(int note, bool enabled);
+    bool getNoteRoundRobin(int note) const;
+    
+    // Moves on whenever what a note sounds like may have changed: a new kit, or a pad's
+    // volume, pan, mute or round-robin (for caches of rendered audio - any thread)
+    juce::uint32 getSoundRevision() const noexcept { return soundRevision.load(); }
+    
+    // Voice budgets, stealing, choke groups and culling (see DrumVoiceManager.h)
+    DrumVoiceManager& getVoiceManager() { return voiceManager; }
+    
     // ===== MULTI-OUT SUPPORT =====
     
-    // Set the function that maps MIDI notes to output groups
-    void setNoteToGroupMapper(std::function<int(int)> mapper);
+    // Set the function that maps MIDI notes to output groups. It is asked once per
+    // note here, and every engine built afterwards keeps its own copy of the table,
+    // so call it before the first kit is loaded (the processor does in its constructor)
+    void setNoteToGroupMapper(const std::function<int(int)>& mapper);
     
-    // Trigger a note on a specific output group (for multi-out)
+    // Trigger a note on a specific output group (for multi-out) - audio thread
     void noteOnToGroup(int note, float velocity, int groupIndex);
     
-    // Release a note on a specific output group
+    // Release a note on a specific output group - audio thread
     void noteOffToGroup(int note, int groupIndex);
     
-    // Render audio for all output groups (multi-out)
-    // mainBuffer: stereo interleaved buffer for main mix
-    // groupBuffers: array of stereo interleaved buffers for each output group
-    void renderAudioMultiOut(float* mainBuffer, 
-                             std::array<float*, NUM_OUTPUT_GROUPS>& groupBuffers,
+    // One stereo output as two separate channels - JUCE's (and most hosts')
+    // planar layout, so the engine can render straight into the host's buffers
+    struct StereoBuffer
+    {
+        float* left = nullptr;
+        float* right = nullptr;
+        
+        bool isValid() const noexcept { return left != nullptr && right != nullptr; }
+    };
+    
+    // Which outputs have voices to render. A silent output is never touched
+    // by renderAudioMultiOut(), so it doesn't need a buffer at all.
+    struct SoundingOutputs
+    {
+        bool main = false;  // Anything at all (every group is part of the main mix)
+        std::array<bool, NUM_OUTPUT_GROUPS> groups {};
+    };
+    
+    // Stop inaudible voices, then report what the next render will produce - audio thread
+    SoundingOutputs getSoundingOutputs();
+    
+    // Render audio for all output groups (multi-out) - audio thread
+    // Everything is ADDED to the buffers, which are normally the host's
+    // own (already cleared) channels - there is no intermediate copy.
+    // main: the main mix (sum of all groups)
+    // groups: each group's own bus, which must start out silent
+    //         (invalid = bus disabled or silent, group is only mixed into main)
+    void renderAudioMultiOut(StereoBuffer main,
+                             const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
                              int numSamples);
 
+    // Render the groups that have their own bus on worker threads (see PARALLEL GROUP RENDERING)
+    // Message thread - off by default; the workers are started the first time it is switched on
+    void setParallelRenderingEnabled(bool shouldRenderInParallel);
+    bool isParallelRenderingEnabled() const { return activeRenderPool.load() != nullptr; }
+    
+    // Active voices on the main instance ([0]) and each group, counting a kit
+    // that is ringing out - audio thread (for the performance monitor)
+    void getActiveVoiceCounts(std::array<int, NUM_OUTPUT_GROUPS + 1>& counts) const noexcept;
+    
+    // ===== OFFLINE RENDERING =====
+    
+    // A private set of voices for bouncing to audio (defined below the class)
+    class OfflineEngine;
+    
+    // An offline engine for the current kit at this sample rate (nullptr if no kit is loaded)
+    // Waits for the loader thread - call it from a worker thread, never the audio thread.
+    // The manager must outlive every engine it created.
+    std::unique_ptr<OfflineEngine> createOfflineEngine(double sampleRate);
+
 private:
-    // Main TinySoundFont handle (for main stereo mix)
-    tsf* soundFont = nullptr;
+    // All TSF instances for one loaded kit (defined in the .cpp)
+    struct KitEngine;
+    
+    // Build a complete engine on a pool reference from the registry (nullptr on failure)
+    // The engine takes over the reference, even if it fails
+    KitEngine* createEngine(tsf* poolReference, double sampleRate) const;
+    
+    // ===== LOADER THREAD =====
+    
+    // Parse (or fetch from the registry) and publish one kit
+    bool runKitLoad(const juce::String& kitName, const juce::File& kitFile);
+    
+    // The preset every instance plays (see startNote)
+    static constexpr int drumPresetIndex = KitRegistry::drumPresetIndex;
+    
+    // Free engines the audio thread (or an offline render) has finished with
+    void freeRetiredEngines();
+    
+    // ===== MESSAGE THREAD =====
+    
+    // Hands a freshly retired engine to the loader thread to be freed (see RETIRED ENGINES)
+    void timerCallback() override;
+    static constexpr int retiredEngineCheckMs = 250;
+    
+    // ===== AUDIO THREAD =====
+    
+    // Render one engine's contribution (with a gain ramp) and add it to the outputs
+    // (pool: share the groups with their own bus out to its workers, nullptr = all on this thread)
+    void addEngineOutput(KitEngine& engine, StereoBuffer main,
+                         const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
+                         int numSamples, float startGain, float endGain,
+                         RenderWorkerPool* pool = nullptr);
     
-    // Separate TSF instances for each output group (for multi-out)
-    std::array<tsf*, NUM_OUTPUT_GROUPS> soundFontGroups;
+    // One group instance into its own bus - a RenderWorkerPool job (context = GroupRenderBatch)
+    static void renderGroupJob(void* context, int jobIndex) noexcept;
     
-    // Function to map MIDI note to output group index
-    std::function<int(int)> noteToGroupMapper;
+    // Add the groups that have their own bus into the main mix
+    static void addGroupsToMain(StereoBuffer main, const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups,
+                                int numSamples) noexcept;
+    
+    // Advance the ring-out of the outgoing engine after a block has been rendered
+    void advanceRingOut(int numSamples) noexcept;
+    
+    // Number of MIDI notes we keep settings for
+    static constexpr int NUM_NOTES = 128;
+    static bool isValidNote(int note) { return note >= 0 && note < NUM_NOTES; }
+    
+    // Output group of every note (-1 = main instance)
+    using NoteGroupTable = std::array<juce::int8, NUM_NOTES>;
+    
+    // Find the instance a note is routed to (in the current block's engine, or in a given one)
+    tsf* getInstanceForNote(int note) const;
+    tsf* getInstanceForNote(const KitEngine& engine, int note) const;
+    
+    // Output group an engine sends a note to (-1 = main instance)
+    static int getGroupForNote(const KitEngine& engine, int note);
+    
+    // Apply per-note settings, chokes and the group's voice budget, and start
+    // a note on one of the engine's instances (group -1 = main instance)
+    void startNote(KitEngine& engine, int group, int note, float velocity);
+    
+    // Stop the engine's voices that have decayed below the audibility floor
+    void cullInaudibleVoices(const KitEngine& engine) const;
+    
+    // A freshly built engine waiting for the audio thread to adopt it
+    std::atomic<KitEngine*> pendingEngine { nullptr };
+    
+    // Engines owned by the audio thread (current kit, and the kit ringing out)
+    KitEngine* currentEngine = nullptr;
+    KitEngine* outgoingEngine = nullptr;
+    bool outgoingFinished = false;
+    int ringOutSamplesLeft = 0;
+    int fadeSamplesLeft = 0;
+    int fadeLengthSamples = 0;
+    
+    // How long an old kit may keep ringing, and how quickly it is faded out after that
+    static constexpr double maxRingOutSeconds = 2.0;
+    static constexpr double fadeOutSeconds = 0.02;
+    
+    // The engine picked up for the current audio block (audio thread only)
+    KitEngine* blockEngine = nullptr;
+    
+    // Engines the audio thread has finished with, waiting to be freed by the loader
+    SpscQueue<KitEngine*, 8> retiredEngines;
+    
+    // Set by the audio thread once it has retired an engine, cleared by timerCallback()
+    std::atomic<bool> enginesWaitingToBeFreed { false };
+    
+    // Offline engines that have been destroyed, waiting for the same (protected by loadLock)
+    std::vector<KitEngine*> retiredOfflineEngines;
+    
+    // Fixed scratch space for fading an engine out (no allocation on the audio thread)
+    static constexpr int fadeScratchFrames = 128;
+    std::array<float, fadeScratchFrames * 2> fadeScratch {};  // Left half, then right half
+    
+    /*
+        PARALLEL GROUP RENDERING
+        ------------------------
+        With multi-out, every group instance that has voices and its own
+        bus writes to memory nobody else touches, so those instances can
+        render at the same time. The audio thread hands them to the
+        worker pool as one batch, renders the main instance and the
+        groups that only go to the main mix itself, and waits for the
+        batch before summing the buses into the main mix.
+        
+        Below minParallelRenderSamples (a tiny block, or a slice of one
+        split at a tempo change) waking the workers costs more than it
+        saves, so the whole engine is rendered serially - as it is when
+        there's only one instance to render, and for a kit ringing out.
+        
+        The pool is created once and kept until the manager is destroyed:
+        switching it off just stops the audio thread from using it.
+    */
+    struct GroupRenderBatch
+    {
+        std::array<tsf*, NUM_OUTPUT_GROUPS> instances {};
+        std::array<StereoBuffer, NUM_OUTPUT_GROUPS> destinations {};
+        int numSamples = 0;
+    };
+    GroupRenderBatch groupRenderBatch;  // Audio thread only
+    
+    static constexpr int minParallelRenderSamples = 64;
+    
+    std::unique_ptr<RenderWorkerPool> renderPool;  // Message thread
+    std::atomic<RenderWorkerPool*> activeRenderPool { nullptr };
+    
+    /*
+        BACKGROUND LOADER
+        -----------------
+        One loader thread, so requests are handled in order. The parsed
+        pools themselves are shared with every other instance through
+        the registry (which outlives all of this instance's engines).
+    */
+    juce::SharedResourcePointer<KitRegistry> kitRegistry;
+    
+    std::atomic<int> latestLoadRequest { 0 };
+    std::atomic<int> pendingLoads { 0 };
+    juce::String pendingKitName;  // Protected by loadLock
+    
+    // What setNoteToGroupMapper() made of its mapper, copied into each new engine (protected by loadLock)
+    NoteGroupTable noteGroups;
     
     // Path to directory containing SF2 files
     juce::File soundFontsPath;
     
-    // Currently loaded kit name
+    // Currently loaded kit name and file (protected by loadLock)
     juce::String currentKitName;
+    juce::File currentKitFile;
     
     // Audio sample rate
-    double currentSampleRate = 44100.0;
+    std::atomic<double> currentSampleRate { 44100.0 };
+    std::atomic<bool> hostRateSamplesEnabled { true };
     
-    // Per-note volume, pan, and mute settings
-    std::map<int, float> noteVolumes;
-    std::map<int, float> notePans;
-    std::map<int, bool> noteMutes;
+    /*
+        PER-NOTE SETTINGS
+        -----------------
+        A struct of arrays indexed by MIDI note: a hit reads four
+        atomics, with no lookup and no lock. Cache-line aligned, so the
+        arrays the audio thread reads on every hit don't share a line
+        with anything else.
+    */
+    struct alignas(64) NoteSettings
+    {
+        std::array<std::atomic<float>, NUM_NOTES> volumes;
+        std::array<std::atomic<float>, NUM_NOTES> pans;
+        std::array<std::atomic<bool>, NUM_NOTES> mutes;
+        std::array<std::atomic<bool>, NUM_NOTES> roundRobins;
+    };
+    NoteSettings noteSettings;
     
-    // Thread safety lock (mutable to allow use in const methods)
-    mutable juce::CriticalSection lock;
+    // Store a per-note setting, moving soundRevision on if it changed
+    template <typename Value>
+    void storeNoteSetting(std::atomic<Value>& setting, Value newValue) noexcept;
+    
+    std::atomic<juce::uint32> soundRevision { 0 };
+    
+    // Drum-specific voice allocation on top of TSF's
+    DrumVoiceManager voiceManager;
+    
+    // Protects the kit names (never taken on the audio thread)
+    mutable CheckedCriticalSection loadLock;
+    
+    // Declared last so the loader thread stops before anything it uses is destroyed
+    juce::ThreadPool loaderPool { 1 };
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontManager)
 };
+
+/*
+    OFFLINE ENGINE
+    --------------
+    The current kit's instances, built again just for a bounce (see
+    OfflineRenderer.h). It shares the kit's parsed samples but none of
+    the live voices, so rendering with it - on any one thread, as fast
+    as that thread can go - never touches what the audio thread plays.
+    Notes are routed and shaped like live ones: same note-to-group
+    table (the engine's own copy - nothing the message thread changes
+    is read while rendering), same per-note volume, pan and mute.
+*/
+class SoundFontManager::OfflineEngine
+{
+public:
+    // Hands the instances back to the loader thread to be closed
+    ~OfflineEngine();
+    
+    void noteOn(int note, float velocity);
+    void noteOff(int note);
+    
+    // Same buffers and layout as renderAudioMultiOut() (added to, so clear them first)
+    void render(StereoBuffer main, const std::array<StereoBuffer, NUM_OUTPUT_GROUPS>& groups, int numSamples);
+    
+    // Voices still sounding (to tell when the last hits have rung out)
+    int getNumActiveVoices() const;
+    
+    // Output group a note is routed to (-1 = main mix only)
+    int getGroupForNote(int note) const;
+    
+    double getSampleRate() const;
+
+private:
+    friend class SoundFontManager;
+    OfflineEngine(SoundFontManager& owner, KitEngine* kitEngine) : manager(owner), engine(kitEngine) {}
+    
+    SoundFontManager& manager;
+    KitEngine* engine;
+    
+    JUCE_DECLARE_NON_COPYABLE(OfflineEngine)
+};
@@ -0,0 +1,291 @@
+/*
+    AnalyzeMain.cpp
+    ===============
+    
+    Entry point of the jdrummer_analyze console target: batch, offline
+    analysis of the groove library and of reference audio loops, so the
+    plugin only has to load precomputed results.
+    
+    USAGE
+    -----
+        jdrummer_analyze [--grooves <dir>] [--groove-index <file>]
+                         [--audio <dir or file>]... [--audio-index <file>]
+                         [--onsets energy|flux] [--threads <n>] [--force]
+    
+    - Grooves: every MIDI file under the grooves folder is compiled (in
+      parallel) into the groove library index (GrooveLibraryIndex.h),
+      onset histograms included.
+    - Audio: every audio file given (folders are searched recursively) is
+      analyzed with AudioAnalyzer, one analyzer per worker thread, and the
+      results are written to the audio analysis index (AudioAnalysisIndex.h).
+      Files already indexed (with the same onset function) and unchanged
+      are skipped unless --force is given; analyses made with the other
+      function are kept alongside.
+    
+    Both indexes default to the locations the plugin reads them from.
+    Every file gets one line of key=value pairs with its timing, followed
+    by a summary line per library.
+*/
+
+#include "JuceHeader.h"
+#include "AudioAnalysisIndex.h"
+#include "AudioAnalyzer.h"
+#include "GrooveManager.h"
+#include <atomic>
+#include <iostream>
+#include <map>
+
+static juce::String getOption(const juce::ArgumentList& args, const juce::String& option,
+                              const juce::String& defaultValue)
+{
+    return args.containsOption(option) ? args.getValueForOption(option) : defaultValue;
+}
+
+static juce::File getFileOption(const juce::ArgumentList& args, const juce::String& option,
+                                const juce::File& defaultFile)
+{
+    if (!args.containsOption(option))
+        return defaultFile;
+    
+    return juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption(option));
+}
+
+// One line per file, printed whole even when several workers finish at once
+static void printLine(const juce::String& line)
+{
+    static juce::CriticalSection outputLock;
+    const juce::ScopedLock sl(outputLock);
+    std::cout << line << std::endl;
+}
+
+static double secondsSince(juce::int64 startTicks)
+{
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+}
+
+static int analyzeGrooves(const juce::File& groovesDir, const juce::File& indexFile, juce::ThreadPool& pool)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    
+    GrooveManager grooveManager;
+    grooveManager.setLibraryIndexFile(indexFile);
+    grooveManager.setGroovesPath(groovesDir);
+    grooveManager.scanGrooves();  // Restores what the index already has
+    
+    int numGrooves = 0;
+    for (const auto& category : grooveManager.getCategories())
+        numGrooves += static_cast<int>(category.grooves.size());
+    
+    std::atomic<int> numFailed { 0 };
+    
+    const int numParsed = grooveManager.loadAllGrooves(pool, [&numFailed](const Groove& groove, bool parsed, double seconds)
+    {
+        if (!parsed)
+            ++numFailed;
+        
+        printLine("groove=" + groove.file.getFullPathName().quoted()
+                  + " status=" + (parsed ? "parsed" : "failed")
+                  + " events=" + juce::String(static_cast<int>(groove.events.size()))
+                  + " seconds=" + juce::String(seconds, 6));
+    });
+    
+    // Build the features once, so a broken library shows up here rather than in the plugin
+    const auto features = grooveManager.getGrooveFeatures();
+    grooveManager.saveLibraryIndex();
+    
+    printLine("library=grooves path=" + groovesDir.getFullPathName().quoted()
+              + " grooves=" + juce::String(numGrooves)
+              + " restored=" + juce::String(numGrooves - numParsed - numFailed.load())
+              + " parsed=" + juce::String(numParsed)
+              + " failed=" + juce::String(numFailed.load())
+              + " features=" + juce::String(features != nullptr ? static_cast<int>(features->size()) : 0)
+              + " index=" + indexFile.getFullPathName().quoted()
+              + " seconds=" + juce::String(secondsSince(start), 3));
+    
+    return numFailed.load() > 0 ? 1 : 0;
+}
+
+static juce::Array<juce::File> findAudioFiles(const juce::StringArray& paths)
+{
+    const juce::String wildcard = "*.wav;*.aif;*.aiff;*.flac;*.ogg;*.mp3";
+    juce::Array<juce::File> files;
+    
+    for (const auto& path : paths)
+    {
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+        
+        if (file.isDirectory())
+        {
+            auto found = file.findChildFiles(juce::File::findFiles, true, wildcard);
+            found.sort();
+            files.addArray(found);
+        }
+        else if (file.existsAsFile())
+        {
+            files.add(file);
+        }
+        else
+        {
+            printLine("audio=" + file.getFullPathName().quoted() + " status=missing");
+        }
+    }
+    
+    return files;
+}
+
+static int analyzeAudioFiles(const juce::Array<juce::File>& files, const juce::File& indexFile,
+                             OnsetDetector::Function onsetFunction, bool force, juce::ThreadPool& pool)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    
+    AudioAnalysisIndex index;
+    index.setIndexFile(indexFile);
+    
+    // Keep every entry that is still valid, whatever its onset function - this run adds to the index
+    std::map<AudioAnalysisIndex::Key, AudioAnalysisIndex::Entry> entries;
+    for (auto& entry : index.readAll())
+    {
+        if (AudioAnalysisIndex::isUpToDate(entry))
+        {
+            auto key = AudioAnalysisIndex::getKey(entry);
+            entries[std::move(key)] = std::move(entry);
+        }
+    }
+    
+    juce::Array<juce::File> pending;
+    for (const auto& file : files)
+    {
+        if (force || entries.find({ file.getFullPathName(), static_cast<int>(onsetFunction) }) == entries.end())
+            pending.add(file);
+        else
+            printLine("audio=" + file.getFullPathName().quoted() + " status=cached");
+    }
+    
+    // One job per worker, each with its own analyzer, pulling files until none are left
+    std::vector<AudioAnalysisIndex::Entry> results(static_cast<size_t>(pending.size()));
+    std::vector<bool> succeeded(results.size(), false);
+    std::atomic<int> nextFile { 0 };
+    std::atomic<int> workersRemaining { pool.getNumThreads() };
+    juce::WaitableEvent allWorkersDone;
+    
+    for (int worker = 0; worker < pool.getNumThreads(); ++worker)
+    {
+        pool.addJob([&]
+        {
+            AudioAnalyzer analyzer;
+            analyzer.setOnsetFunction(onsetFunction);
+            
+            for (int i = nextFile++; i < pending.size(); i = nextFile++)
+            {
+                const auto& file = pending.getReference(i);
+                const auto fileStart = juce::Time::getHighResolutionTicks();
+                
+                const bool analyzed = analyzer.loadAudioFile(file) && analyzer.analyzeAudio();
+                const auto& pattern = analyzer.getDetectedPattern();
+                
+                if (analyzed)
+                    succeeded[static_cast<size_t>(i)] = AudioAnalysisIndex::makeEntry(file, onsetFunction, pattern,
+                                                                                       results[static_cast<size_t>(i)]);
+                
+                printLine("audio=" + file.getFullPathName().quoted()
+                          + " status=" + (analyzed ? "analyzed" : "failed")
+                          + " length=" + juce::String(analyzer.getAudioLengthSeconds(), 3)
+                          + " bpm=" + juce::String(analyzed ? pattern.bpm : 0.0, 2)
+                          + " onsets=" + juce::String(analyzed ? static_cast<int>(pattern.onsetTimesBeats.size()) : 0)
+                          + " seconds=" + juce::String(secondsSince(fileStart), 6));
+                
+                analyzer.clear();
+            }
+            
+            if (--workersRemaining == 0)
+                allWorkersDone.signal();
+        });
+    }
+    
+    allWorkersDone.wait();
+    
+    int numAnalyzed = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (!succeeded[i])
+            continue;
+        
+        auto key = AudioAnalysisIndex::getKey(results[i]);
+        entries[std::move(key)] = std::move(results[i]);
+        ++numAnalyzed;
+    }
+    
+    std::vector<AudioAnalysisIndex::Entry> allEntries;
+    allEntries.reserve(entries.size());
+    for (auto& entry : entries)
+        allEntries.push_back(std::move(entry.second));
+    
+    const bool written = index.write(allEntries);
+    const int numFailed = pending.size() - numAnalyzed;
+    
+    printLine("library=audio files=" + juce::String(files.size())
+              + " cached=" + juce::String(files.size() - pending.size())
+              + " analyzed=" + juce::String(numAnalyzed)
+              + " failed=" + juce::String(numFailed)
+              + " entries=" + juce::String(static_cast<int>(allEntries.size()))
+              + " index=" + indexFile.getFullPathName().quoted()
+              + (written ? "" : " status=write_failed")
+              + " seconds=" + juce::String(secondsSince(start), 3));
+    
+    return (numFailed > 0 || !written) ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    
+    // --audio may be given several times
+    juce::StringArray audioPaths;
+    for (int i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args.arguments[i].text == "--audio")
+            audioPaths.add(args.arguments[i + 1].text);
+    }
+    
+    const auto onsetName = getOption(args, "--onsets", "energy");
+    if (onsetName != "energy" && onsetName != "flux")
+    {
+        std::cerr << "Unknown onset function: " << onsetName << " (use energy or flux)" << std::endl;
+        return 1;
+    }
+    
+    const auto onsetFunction = onsetName == "flux" ? OnsetDetector::Function::spectralFlux
+                                                   : OnsetDetector::Function::energy;
+    
+    const int numThreads = getOption(args, "--threads", juce::String(juce::SystemStats::getNumCpus())).getIntValue();
+    if (numThreads <= 0)
+    {
+        std::cerr << "Invalid thread count" << std::endl;
+        return 1;
+    }
+    
+    juce::ThreadPool pool(numThreads);
+    int result = 0;
+    
+    // Grooves: the repo's folder unless told otherwise (or only audio was asked for)
+    if (args.containsOption("--grooves") || audioPaths.isEmpty())
+    {
+        const auto groovesDir = getFileOption(args, "--grooves", juce::File::getCurrentWorkingDirectory().getChildFile("Grooves"));
+        if (!groovesDir.isDirectory())
+        {
+            std::cerr << "Grooves folder not found: " << groovesDir.getFullPathName() << std::endl;
+            return 1;
+        }
+        
+        result |= analyzeGrooves(groovesDir, getFileOption(args, "--groove-index", GrooveLibraryIndex::getDefaultIndexFile()), pool);
+    }
+    
+    if (!audioPaths.isEmpty())
+    {
+        result |= analyzeAudioFiles(findAudioFiles(audioPaths),
+                                    getFileOption(args, "--audio-index", AudioAnalysisIndex::getDefaultIndexFile()),
+                                    onsetFunction, args.containsOption("--force"), pool);
+    }
+    
+    return result;
+}
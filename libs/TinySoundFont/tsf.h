@@ -73,6 +73,11 @@ TSFDEF tsf* tsf_load_filename(const char* filename);
 // Load a SoundFont from a block of memory
 TSFDEF tsf* tsf_load_memory(const void* buffer, int size);
 
+// Load a SoundFont from a block of memory, converting only the samples of one preset
+// The other presets' regions are left silent, and their sample data is never read - with
+// a memory-mapped file, the pages it is on are never loaded. The block can be freed after.
+TSFDEF tsf* tsf_load_memory_preset(const void* buffer, int size, int preset_index);
+
 // Stream structure for the generic loading
 struct tsf_stream
 {
@@ -95,6 +100,10 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream);
 // (This function isn't thread-safe without locking.)
 TSFDEF tsf* tsf_copy(tsf* f);
 
+// Number of open instances sharing the soundfont of f (f itself and its linked copies)
+// (Like tsf_copy, this reads the shared count without locking.)
+TSFDEF int tsf_get_refcount(const tsf* f);
+
 // Free the memory related to this tsf instance
 TSFDEF void tsf_close(tsf* f);
 
@@ -174,6 +183,10 @@ TSFDEF int tsf_set_max_voices(tsf* f, int max_voices);
 //   (tsf_bank_note_on returns 0 if preset does not exist or allocation failed, otherwise 1)
 TSFDEF int tsf_note_on(tsf* f, int preset_index, int key, float vel);
 TSFDEF int tsf_bank_note_on(tsf* f, int bank, int preset_number, int key, float vel);
+// Start a note on the given regions of the preset only (for hosts doing their own sample
+// selection - velocity layers, round-robin). The regions' key and velocity ranges are ignored.
+//   region_indices: region_count indices between 0 and tsf_get_regioncount() - 1
+TSFDEF int tsf_note_on_regions(tsf* f, int preset_index, int key, float vel, const int* region_indices, int region_count);
 
 // Stop playing a note
 //   (bank_note_off returns 0 if preset does not exist, otherwise 1)
@@ -186,6 +199,54 @@ TSFDEF void tsf_note_off_all(tsf* f);
 // Returns the number of active voices
 TSFDEF int tsf_active_voice_count(tsf* f);
 
+// Per-voice inspection and control, for hosts doing their own voice management
+// (voice stealing, choke groups, culling). Voices are addressed by slot index,
+// 0 to tsf_voice_slot_count() - 1. Only meaningful with tsf_set_max_voices,
+// which keeps the slots from being reallocated.
+struct tsf_voice_info
+{
+	int key, channel;        // MIDI key and channel the voice plays
+	unsigned int playIndex;  // Increases with every note on (lower is older)
+	float gain;              // Current output gain: note gain times amplitude envelope
+	int attacking;           // 1 until the envelope has passed its delay, attack and hold
+	int released;            // 1 once the voice is in its release segment
+};
+TSFDEF int tsf_voice_slot_count(const tsf* f);
+//   (tsf_voice_get_info returns 0 if the slot is free, otherwise 1)
+TSFDEF int tsf_voice_get_info(const tsf* f, int slot, struct tsf_voice_info* info);
+// Release a voice over release_seconds, whatever the region's own release time
+TSFDEF void tsf_voice_release(tsf* f, int slot, float release_seconds);
+// Stop a voice immediately, freeing its slot for the next note
+TSFDEF void tsf_voice_stop(tsf* f, int slot);
+// Number of voices a note on would start (the preset's regions matching key and velocity)
+TSFDEF int tsf_note_voice_count(const tsf* f, int preset_index, int key, float vel);
+
+// Sample data access, for hosts that convert a preset's samples themselves (for example
+// to the output sample rate, so notes at their root key play without interpolation).
+// Everything here must happen before the first tsf_copy() - copies share the same data.
+struct tsf_region_sample
+{
+	int lokey, hikey;                        // Key range of the region
+	int lovel, hivel;                        // Velocity range of the region
+	float attenuation;                       // Attenuation of the region in dB
+	unsigned int offset, end;                // Sample span in the font's sample data (end is exclusive)
+	unsigned int loop_start, loop_end;       // Loop points (loop_end is the last sample of the loop)
+	unsigned int sample_rate;                // Sample rate of the span
+};
+// Returns the number of regions of a preset (0 if the preset does not exist)
+TSFDEF int tsf_get_regioncount(const tsf* f, int preset_index);
+//   (tsf_region_get_sample returns 0 if the preset or region does not exist, otherwise 1)
+TSFDEF int tsf_region_get_sample(const tsf* f, int preset_index, int region_index, struct tsf_region_sample* info);
+// Point a region at another span and rate (the key and velocity ranges and attenuation in info are ignored)
+//   (returns 0 if the region does not exist or the span is outside the sample data, otherwise 1)
+TSFDEF int tsf_region_set_sample(tsf* f, int preset_index, int region_index, const struct tsf_region_sample* info);
+// All sample data of the font, as 32-bit floats (count receives the number of samples)
+TSFDEF const float* tsf_get_samples(const tsf* f, unsigned int* count);
+// Append samples to the font's sample data, followed by silent padding for the interpolator
+//   offset: receives where the appended samples start
+//   (returns 0 if the allocation failed or the data is already shared by a copy, otherwise 1)
+TSFDEF int tsf_append_samples(tsf* f, const float* samples, unsigned int count, unsigned int* offset);
+
 // Render output samples into a buffer
 // You can either render as signed 16-bit values (tsf_render_short) or
 // as 32-bit float values (tsf_render_float)
@@ -194,6 +255,10 @@ TSFDEF int tsf_active_voice_count(tsf* f);
 //   flag_mixing: if 0 clear the buffer first, otherwise mix into existing data
 TSFDEF void tsf_render_short(tsf* f, short* buffer, int samples, int flag_mixing CPP_DEFAULT0);
 TSFDEF void tsf_render_float(tsf* f, float* buffer, int samples, int flag_mixing CPP_DEFAULT0);
+// Render into two separate channel buffers instead of one (for planar host buffers)
+// The output mode must be TSF_STEREO_UNWEAVED.
+//   left, right: target buffers of size samples * sizeof(float) each
+TSFDEF void tsf_render_float_separate(tsf* f, float* left, float* right, int samples, int flag_mixing CPP_DEFAULT0);
 
 // Higher level channel based functions, set up channel parameters
 //   channel: channel number
@@ -226,6 +291,7 @@ TSFDEF int tsf_channel_set_sustain(tsf* f, int channel, int flag_sustain);
 //   vel: velocity as a float between 0.0 (equal to note off) and 1.0 (full)
 //   (tsf_channel_note_on returns 0 on allocation failure of new voice, otherwise 1)
 TSFDEF int tsf_channel_note_on(tsf* f, int channel, int key, float vel);
+TSFDEF int tsf_channel_note_on_regions(tsf* f, int channel, int key, float vel, const int* region_indices, int region_count);
 TSFDEF void tsf_channel_note_off(tsf* f, int channel, int key);
 TSFDEF void tsf_channel_note_off_all(tsf* f, int channel); //end with sustain and release
 TSFDEF void tsf_channel_sounds_off_all(tsf* f, int channel); //end immediately
@@ -331,6 +397,7 @@ struct tsf
 {
 	struct tsf_preset* presets;
 	float* fontSamples;
+	unsigned int fontSampleNum;
 	struct tsf_voice* voices;
 	struct tsf_channels* channels;
 
@@ -1217,12 +1284,10 @@ static void tsf_voice_calcpitchratio(struct tsf_voice* v, float pitchShift, floa
 	v->pitchOutputFactor = v->region->sample_rate / (tsf_timecents2Secsd(v->region->pitch_keycenter * 100.0) * outSampleRate);
 }
 
-static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, int numSamples)
+static void tsf_voice_render_separate(tsf* f, struct tsf_voice* v, float* outL, float* outR, int numSamples)
 {
 	struct tsf_region* region = v->region;
 	float* input = f->fontSamples;
-	float* outL = outputBuffer;
-	float* outR = (f->outputmode == TSF_STEREO_UNWEAVED ? outL + numSamples : TSF_NULL);
 
 	// Cache some values, to give them at least some chance of ending up in registers.
 	TSF_BOOL updateModEnv = (region->modEnvToPitch || region->modEnvToFilterFc);
@@ -1244,12 +1309,19 @@ static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, i
 	TSF_BOOL dynamicGain = (region->modLfoToVolume != 0);
 	float noteGain = 0, tmpModLfoToVolume;
 
+	TSF_BOOL copySamples;
+
 	if (dynamicLowpass) tmpInitialFilterFc = (float)region->initialFilterFc, tmpModLfoToFilterFc = (float)region->modLfoToFilterFc, tmpModEnvToFilterFc = (float)region->modEnvToFilterFc;
 	else tmpInitialFilterFc = 0, tmpModLfoToFilterFc = 0, tmpModEnvToFilterFc = 0;
 
 	if (dynamicPitchRatio) pitchRatio = 0, tmpModLfoToPitch = (float)region->modLfoToPitch, tmpVibLfoToPitch = (float)region->vibLfoToPitch, tmpModEnvToPitch = (float)region->modEnvToPitch;
 	else pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents) * v->pitchOutputFactor, tmpModLfoToPitch = 0, tmpVibLfoToPitch = 0, tmpModEnvToPitch = 0;
 
+	// A note at its root key on a sample at the output rate steps exactly one sample at a time
+	// (the pow() above only gets within rounding of 1.0), so it can be copied without interpolation
+	if (!dynamicPitchRatio && pitchRatio > 0.999999999 && pitchRatio < 1.000000001) pitchRatio = 1.0;
+	copySamples = (!dynamicPitchRatio && pitchRatio == 1.0 && tmpSourceSamplePosition == (double)(unsigned int)tmpSourceSamplePosition);
+
 	if (dynamicGain) tmpModLfoToVolume = (float)region->modLfoToVolume * 0.1f;
 	else noteGain = tsf_decibelsToGain(v->noteGainDB), tmpModLfoToVolume = 0;
 
@@ -1308,6 +1380,26 @@ static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, i
 
 			case TSF_STEREO_UNWEAVED:
 				gainLeft = gainMono * v->panFactorLeft, gainRight = gainMono * v->panFactorRight;
+				if (copySamples)
+				{
+					// Whole sample steps: same result as below, without the interpolation
+					unsigned int pos = (unsigned int)tmpSourceSamplePosition, tmpSampleEnd = region->end;
+					while (blockSamples-- && pos < tmpSampleEnd)
+					{
+						float val = input[pos];
+
+						// Low-pass filter.
+						if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+
+						*outL++ += val * gainLeft;
+						*outR++ += val * gainRight;
+
+						// Next sample.
+						if (++pos > tmpLoopEnd && isLooping) pos = tmpLoopStart;
+					}
+					tmpSourceSamplePosition = (double)pos;
+					break;
+				}
 				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
 				{
 					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
@@ -1358,7 +1450,13 @@ static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, i
 	if (tmpLowpass.active || dynamicLowpass) v->lowpass = tmpLowpass;
 }
 
-TSFDEF tsf* tsf_load(struct tsf_stream* stream)
+static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, int numSamples)
+{
+	tsf_voice_render_separate(f, v, outputBuffer, (f->outputmode == TSF_STEREO_UNWEAVED ? outputBuffer + numSamples : TSF_NULL), numSamples);
+}
+
+// With memory given, the sample chunk is only located, not read (for tsf_load_memory_preset)
+static tsf* tsf_load_deferred(struct tsf_stream* stream, const struct tsf_stream_memory* memory, const short** pDeferredSamples)
 {
 	tsf* res = TSF_NULL;
 	struct tsf_riffchunk chunkHead;
@@ -1408,7 +1506,13 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 		{
 			while (tsf_riffchunk_read(&chunkList, &chunk, stream))
 			{
-				if ((TSF_FourCCEquals(chunk.id, "smpl")
+				if (memory && TSF_FourCCEquals(chunk.id, "smpl") && !*pDeferredSamples && chunk.size >= sizeof(short))
+				{
+					*pDeferredSamples = (const short*)(memory->buffer + memory->pos);
+					smplCount = chunk.size / (unsigned int)sizeof(short);
+					stream->skip(stream->data, chunk.size);
+				}
+				else if ((TSF_FourCCEquals(chunk.id, "smpl")
 						#ifdef STB_VORBIS_INCLUDE_STB_VORBIS_H
 						|| TSF_FourCCEquals(chunk.id, "smpo")
 						#endif
@@ -1425,7 +1529,7 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 	{
 		//if (e) *e = TSF_INVALID_INCOMPLETE;
 	}
-	else if (!rawBuffer && !floatBuffer)
+	else if (!rawBuffer && !floatBuffer && !(pDeferredSamples && *pDeferredSamples))
 	{
 		//if (e) *e = TSF_INVALID_NOSAMPLEDATA;
 	}
@@ -1439,6 +1543,7 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 		if (!res || !tsf_load_presets(res, &hydra, smplCount)) goto out_of_memory;
 		res->outSampleRate = 44100.0f;
 		res->fontSamples = floatBuffer;
+		res->fontSampleNum = smplCount;
 		floatBuffer = TSF_NULL; // don't free below
 	}
 	if (0)
@@ -1455,6 +1560,98 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 	return res;
 }
 
+TSFDEF tsf* tsf_load(struct tsf_stream* stream)
+{
+	return tsf_load_deferred(stream, TSF_NULL, TSF_NULL);
+}
+
+// Convert the samples of one preset's regions from the file's 16-bit data into a new
+// float buffer, one copy of each distinct span (followed by silent padding for the
+// interpolator), and point the regions at it. The other presets' regions become silent.
+static int tsf_load_preset_samples(tsf* f, const short* samples, int preset_index)
+{
+	enum { paddingNum = 46 };
+	struct tsf_preset* preset;
+	struct tsf_region* region;
+	unsigned int *sourceSpans, sampleNum = 0, pos = 0;
+	int i, j;
+
+	if (preset_index < 0 || preset_index >= f->presetNum) return 0;
+	for (i = 0; i < f->presetNum; i++)
+	{
+		if (i == preset_index) continue;
+		for (j = 0; j < f->presets[i].regionNum; j++)
+		{
+			region = &f->presets[i].regions[j];
+			region->offset = region->end = region->loop_start = region->loop_end = 0;
+		}
+	}
+
+	// The file's span of every region (overwritten below), to find the ones sharing a sample
+	preset = &f->presets[preset_index];
+	sourceSpans = (unsigned int*)TSF_MALLOC((preset->regionNum ? preset->regionNum : 1) * 2 * sizeof(unsigned int));
+	if (!sourceSpans) return 0;
+	for (i = 0; i < preset->regionNum; i++)
+	{
+		region = &preset->regions[i];
+		sourceSpans[i * 2] = region->offset;
+		sourceSpans[i * 2 + 1] = (region->end > region->offset ? region->end : region->offset);
+		for (j = 0; j < i; j++)
+			if (sourceSpans[j * 2] == sourceSpans[i * 2] && sourceSpans[j * 2 + 1] == sourceSpans[i * 2 + 1]) break;
+		if (j == i) sampleNum += sourceSpans[i * 2 + 1] - sourceSpans[i * 2] + paddingNum;
+	}
+
+	f->fontSamples = (float*)TSF_MALLOC((sampleNum ? sampleNum : 1) * sizeof(float));
+	if (!f->fontSamples) { TSF_FREE(sourceSpans); return 0; }
+	f->fontSampleNum = sampleNum;
+
+	for (i = 0; i < preset->regionNum; i++)
+	{
+		unsigned int sourceOffset = sourceSpans[i * 2], sourceEnd = sourceSpans[i * 2 + 1], newOffset, k;
+		region = &preset->regions[i];
+		for (j = 0; j < i; j++)
+			if (sourceSpans[j * 2] == sourceOffset && sourceSpans[j * 2 + 1] == sourceEnd) break;
+		if (j < i) newOffset = preset->regions[j].offset;
+		else
+		{
+			newOffset = pos;
+			for (k = sourceOffset; k != sourceEnd; k++) f->fontSamples[pos++] = (float)(samples[k] / 32767.0);
+			for (k = 0; k != paddingNum; k++) f->fontSamples[pos++] = 0.0f;
+		}
+
+		// Loop points are kept within the span
+		if (region->loop_start < sourceOffset) region->loop_start = sourceOffset;
+		if (region->loop_end < sourceOffset) region->loop_end = sourceOffset;
+		if (region->loop_start > sourceEnd) region->loop_start = sourceEnd;
+		if (region->loop_end > sourceEnd) region->loop_end = sourceEnd;
+		region->loop_start = newOffset + (region->loop_start - sourceOffset);
+		region->loop_end = newOffset + (region->loop_end - sourceOffset);
+		region->offset = newOffset;
+		region->end = newOffset + (sourceEnd - sourceOffset);
+	}
+
+	TSF_FREE(sourceSpans);
+	return 1;
+}
+
+TSFDEF tsf* tsf_load_memory_preset(const void* buffer, int size, int preset_index)
+{
+	struct tsf_stream stream = { TSF_NULL, (int(*)(void*,void*,unsigned int))&tsf_stream_memory_read, (int(*)(void*,unsigned int))&tsf_stream_memory_skip };
+	struct tsf_stream_memory m = { 0, 0, 0 };
+	const short* samples = TSF_NULL;
+	tsf* res;
+	m.buffer = (const char*)buffer;
+	m.total = size;
+	stream.data = &m;
+	res = tsf_load_deferred(&stream, &m, &samples);
+	if (res && !res->fontSamples && (!samples || !tsf_load_preset_samples(res, samples, preset_index)))
+	{
+		tsf_close(res);
+		res = TSF_NULL;
+	}
+	return res;
+}
+
 TSFDEF tsf* tsf_copy(tsf* f)
 {
 	tsf* res;
@@ -1475,6 +1672,11 @@ TSFDEF tsf* tsf_copy(tsf* f)
 	return res;
 }
 
+TSFDEF int tsf_get_refcount(const tsf* f)
+{
+	return (f->refCount ? *f->refCount : 1);
+}
+
 TSFDEF void tsf_close(tsf* f)
 {
 	if (!f) return;
@@ -1550,6 +1752,101 @@ TSFDEF int tsf_set_max_voices(tsf* f, int max_voices)
 	return 1;
 }
 
+// Start a voice for one region of a preset (returns 0 only if allocating more voices failed)
+static int tsf_region_note_on(tsf* f, int preset_index, struct tsf_region* region, int key, float vel, short midiVelocity, unsigned int voicePlayIndex)
+{
+	struct tsf_voice *voice, *v, *vEnd; TSF_BOOL doLoop; float lowpassFilterQDB, lowpassFc;
+
+	voice = TSF_NULL, v = f->voices, vEnd = v + f->voiceNum;
+	if (region->group)
+	{
+		for (; v != vEnd; v++)
+			if (v->playingPreset == preset_index && v->region->group == region->group) tsf_voice_endquick(f, v);
+			else if (v->playingPreset == -1 && !voice) voice = v;
+	}
+	else for (; v != vEnd; v++) if (v->playingPreset == -1) { voice = v; break; }
+
+	if (!voice)
+	{
+		if (f->maxVoiceNum)
+		{
+			// Voices have been pre-allocated and limited to a maximum, try to kill a voice off in its release envelope
+			int bestKillReleaseSamplePos = -999999999;
+			for (v = f->voices; v != vEnd; v++)
+			{
+				if (v->ampenv.segment == TSF_SEGMENT_RELEASE)
+				{
+					// We're looking for the voice furthest into its release
+					int releaseSamplesDone = tsf_voice_envelope_release_samples(&v->ampenv, f->outSampleRate) - v->ampenv.samplesUntilNextSegment;
+					if (releaseSamplesDone > bestKillReleaseSamplePos)
+					{
+						bestKillReleaseSamplePos = releaseSamplesDone;
+						voice = v;
+					}
+				}
+			}
+			if (!voice)
+				return 1;
+			tsf_voice_kill(voice);
+		}
+		else
+		{
+			// Allocate more voices so we don't need to kill one off.
+			struct tsf_voice* newVoices;
+			f->voiceNum += 4;
+			newVoices = (struct tsf_voice*)TSF_REALLOC(f->voices, f->voiceNum * sizeof(struct tsf_voice));
+			if (!newVoices) return 0;
+			f->voices = newVoices;
+			voice = &f->voices[f->voiceNum - 4];
+			voice[1].playingPreset = voice[2].playingPreset = voice[3].playingPreset = -1;
+		}
+	}
+
+	voice->region = region;
+	voice->playingPreset = preset_index;
+	voice->playingKey = key;
+	voice->playIndex = voicePlayIndex;
+	voice->heldSustain = 0;
+	voice->noteGainDB = f->globalGainDB - region->attenuation - tsf_gainToDecibels(1.0f / vel);
+
+	if (f->channels)
+	{
+		f->channels->setupVoice(f, voice);
+	}
+	else
+	{
+		tsf_voice_calcpitchratio(voice, 0, f->outSampleRate);
+		// The SFZ spec is silent about the pan curve, but a 3dB pan law seems common. This sqrt() curve matches what Dimension LE does; Alchemy Free seems closer to sin(adjustedPan * pi/2).
+		voice->panFactorLeft  = TSF_SQRTF(0.5f - region->pan);
+		voice->panFactorRight = TSF_SQRTF(0.5f + region->pan);
+	}
+
+	// Offset/end.
+	voice->sourceSamplePosition = region->offset;
+
+	// Loop.
+	doLoop = (region->loop_mode != TSF_LOOPMODE_NONE && region->loop_start < region->loop_end);
+	voice->loopStart = (doLoop ? region->loop_start : 0);
+	voice->loopEnd = (doLoop ? region->loop_end : 0);
+
+	// Setup envelopes.
+	tsf_voice_envelope_setup(&voice->ampenv, &region->ampenv, key, midiVelocity, TSF_TRUE, f->outSampleRate);
+	tsf_voice_envelope_setup(&voice->modenv, &region->modenv, key, midiVelocity, TSF_FALSE, f->outSampleRate);
+
+	// Setup lowpass filter.
+	lowpassFc = (region->initialFilterFc <= 13500 ? tsf_cents2Hertz((float)region->initialFilterFc) / f->outSampleRate : 1.0f);
+	lowpassFilterQDB = region->initialFilterQ / 10.0f;
+	voice->lowpass.QInv = 1.0 / TSF_POW(10.0, (lowpassFilterQDB / 20.0));
+	voice->lowpass.z1 = voice->lowpass.z2 = 0;
+	voice->lowpass.active = (lowpassFc < 0.499f);
+	if (voice->lowpass.active) tsf_voice_lowpass_setup(&voice->lowpass, lowpassFc);
+
+	// Setup LFO filters.
+	tsf_voice_lfo_setup(&voice->modlfo, region->delayModLFO, region->freqModLFO, f->outSampleRate);
+	tsf_voice_lfo_setup(&voice->viblfo, region->delayVibLFO, region->freqVibLFO, f->outSampleRate);
+	return 1;
+}
+
 TSFDEF int tsf_note_on(tsf* f, int preset_index, int key, float vel)
 {
 	short midiVelocity = (short)(vel * 127);
@@ -1563,96 +1860,27 @@ TSFDEF int tsf_note_on(tsf* f, int preset_index, int key, float vel)
 	voicePlayIndex = f->voicePlayIndex++;
 	for (region = f->presets[preset_index].regions, regionEnd = region + f->presets[preset_index].regionNum; region != regionEnd; region++)
 	{
-		struct tsf_voice *voice, *v, *vEnd; TSF_BOOL doLoop; float lowpassFilterQDB, lowpassFc;
 		if (key < region->lokey || key > region->hikey || midiVelocity < region->lovel || midiVelocity > region->hivel) continue;
+		if (!tsf_region_note_on(f, preset_index, region, key, vel, midiVelocity, voicePlayIndex)) return 0;
+	}
+	return 1;
+}
 
-		voice = TSF_NULL, v = f->voices, vEnd = v + f->voiceNum;
-		if (region->group)
-		{
-			for (; v != vEnd; v++)
-				if (v->playingPreset == preset_index && v->region->group == region->group) tsf_voice_endquick(f, v);
-				else if (v->playingPreset == -1 && !voice) voice = v;
-		}
-		else for (; v != vEnd; v++) if (v->playingPreset == -1) { voice = v; break; }
-
-		if (!voice)
-		{
-			if (f->maxVoiceNum)
-			{
-				// Voices have been pre-allocated and limited to a maximum, try to kill a voice off in its release envelope
-				int bestKillReleaseSamplePos = -999999999;
-				for (v = f->voices; v != vEnd; v++)
-				{
-					if (v->ampenv.segment == TSF_SEGMENT_RELEASE)
-					{
-						// We're looking for the voice furthest into its release
-						int releaseSamplesDone = tsf_voice_envelope_release_samples(&v->ampenv, f->outSampleRate) - v->ampenv.samplesUntilNextSegment;
-						if (releaseSamplesDone > bestKillReleaseSamplePos)
-						{
-							bestKillReleaseSamplePos = releaseSamplesDone;
-							voice = v;
-						}
-					}
-				}
-				if (!voice)
-					continue;
-				tsf_voice_kill(voice);
-			}
-			else
-			{
-				// Allocate more voices so we don't need to kill one off.
-				struct tsf_voice* newVoices;
-				f->voiceNum += 4;
-				newVoices = (struct tsf_voice*)TSF_REALLOC(f->voices, f->voiceNum * sizeof(struct tsf_voice));
-				if (!newVoices) return 0;
-				f->voices = newVoices;
-				voice = &f->voices[f->voiceNum - 4];
-				voice[1].playingPreset = voice[2].playingPreset = voice[3].playingPreset = -1;
-			}
-		}
-
-		voice->region = region;
-		voice->playingPreset = preset_index;
-		voice->playingKey = key;
-		voice->playIndex = voicePlayIndex;
-		voice->heldSustain = 0;
-		voice->noteGainDB = f->globalGainDB - region->attenuation - tsf_gainToDecibels(1.0f / vel);
+TSFDEF int tsf_note_on_regions(tsf* f, int preset_index, int key, float vel, const int* region_indices, int region_count)
+{
+	short midiVelocity = (short)(vel * 127);
+	unsigned int voicePlayIndex;
+	int i;
 
-		if (f->channels)
-		{
-			f->channels->setupVoice(f, voice);
-		}
-		else
-		{
-			tsf_voice_calcpitchratio(voice, 0, f->outSampleRate);
-			// The SFZ spec is silent about the pan curve, but a 3dB pan law seems common. This sqrt() curve matches what Dimension LE does; Alchemy Free seems closer to sin(adjustedPan * pi/2).
-			voice->panFactorLeft  = TSF_SQRTF(0.5f - region->pan);
-			voice->panFactorRight = TSF_SQRTF(0.5f + region->pan);
-		}
+	if (preset_index < 0 || preset_index >= f->presetNum) return 1;
+	if (vel <= 0.0f) { tsf_note_off(f, preset_index, key); return 1; }
 
-		// Offset/end.
-		voice->sourceSamplePosition = region->offset;
-
-		// Loop.
-		doLoop = (region->loop_mode != TSF_LOOPMODE_NONE && region->loop_start < region->loop_end);
-		voice->loopStart = (doLoop ? region->loop_start : 0);
-		voice->loopEnd = (doLoop ? region->loop_end : 0);
-
-		// Setup envelopes.
-		tsf_voice_envelope_setup(&voice->ampenv, &region->ampenv, key, midiVelocity, TSF_TRUE, f->outSampleRate);
-		tsf_voice_envelope_setup(&voice->modenv, &region->modenv, key, midiVelocity, TSF_FALSE, f->outSampleRate);
-
-		// Setup lowpass filter.
-		lowpassFc = (region->initialFilterFc <= 13500 ? tsf_cents2Hertz((float)region->initialFilterFc) / f->outSampleRate : 1.0f);
-		lowpassFilterQDB = region->initialFilterQ / 10.0f;
-		voice->lowpass.QInv = 1.0 / TSF_POW(10.0, (lowpassFilterQDB / 20.0));
-		voice->lowpass.z1 = voice->lowpass.z2 = 0;
-		voice->lowpass.active = (lowpassFc < 0.499f);
-		if (voice->lowpass.active) tsf_voice_lowpass_setup(&voice->lowpass, lowpassFc);
-
-		// Setup LFO filters.
-		tsf_voice_lfo_setup(&voice->modlfo, region->delayModLFO, region->freqModLFO, f->outSampleRate);
-		tsf_voice_lfo_setup(&voice->viblfo, region->delayVibLFO, region->freqVibLFO, f->outSampleRate);
+	// Play the given regions only, whatever their key and velocity ranges.
+	voicePlayIndex = f->voicePlayIndex++;
+	for (i = 0; i < region_count; i++)
+	{
+		if (region_indices[i] < 0 || region_indices[i] >= f->presets[preset_index].regionNum) continue;
+		if (!tsf_region_note_on(f, preset_index, &f->presets[preset_index].regions[region_indices[i]], key, vel, midiVelocity, voicePlayIndex)) return 0;
 	}
 	return 1;
 }
@@ -1707,6 +1935,112 @@ TSFDEF int tsf_active_voice_count(tsf* f)
 	return count;
 }
 
+TSFDEF int tsf_voice_slot_count(const tsf* f)
+{
+	return f->voiceNum;
+}
+
+TSFDEF int tsf_voice_get_info(const tsf* f, int slot, struct tsf_voice_info* info)
+{
+	const struct tsf_voice* v;
+	if (slot < 0 || slot >= f->voiceNum) return 0;
+	v = &f->voices[slot];
+	if (v->playingPreset == -1) return 0;
+	info->key = v->playingKey;
+	info->channel = v->playingChannel;
+	info->playIndex = v->playIndex;
+	info->gain = tsf_decibelsToGain(v->noteGainDB) * v->ampenv.level;
+	info->attacking = (v->ampenv.segment < TSF_SEGMENT_DECAY);
+	info->released = (v->ampenv.segment >= TSF_SEGMENT_RELEASE);
+	return 1;
+}
+
+TSFDEF void tsf_voice_release(tsf* f, int slot, float release_seconds)
+{
+	struct tsf_voice* v;
+	if (slot < 0 || slot >= f->voiceNum) return;
+	v = &f->voices[slot];
+	if (v->playingPreset == -1) return;
+	v->ampenv.parameters.release = release_seconds; tsf_voice_envelope_nextsegment(&v->ampenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+	v->modenv.parameters.release = release_seconds; tsf_voice_envelope_nextsegment(&v->modenv, TSF_SEGMENT_SUSTAIN, f->outSampleRate);
+	if (v->region->loop_mode == TSF_LOOPMODE_SUSTAIN) v->loopEnd = v->loopStart;
+}
+
+TSFDEF void tsf_voice_stop(tsf* f, int slot)
+{
+	if (slot >= 0 && slot < f->voiceNum) tsf_voice_kill(&f->voices[slot]);
+}
+
+TSFDEF int tsf_note_voice_count(const tsf* f, int preset_index, int key, float vel)
+{
+	short midiVelocity = (short)(vel * 127);
+	const struct tsf_region *region, *regionEnd;
+	int count = 0;
+	if (preset_index < 0 || preset_index >= f->presetNum || vel <= 0.0f) return 0;
+	for (region = f->presets[preset_index].regions, regionEnd = region + f->presets[preset_index].regionNum; region != regionEnd; region++)
+		if (key >= region->lokey && key <= region->hikey && midiVelocity >= region->lovel && midiVelocity <= region->hivel) count++;
+	return count;
+}
+
+TSFDEF int tsf_get_regioncount(const tsf* f, int preset_index)
+{
+	return (preset_index < 0 || preset_index >= f->presetNum ? 0 : f->presets[preset_index].regionNum);
+}
+
+TSFDEF int tsf_region_get_sample(const tsf* f, int preset_index, int region_index, struct tsf_region_sample* info)
+{
+	const struct tsf_region* region;
+	if (region_index < 0 || region_index >= tsf_get_regioncount(f, preset_index)) return 0;
+	region = &f->presets[preset_index].regions[region_index];
+	info->lokey = region->lokey;
+	info->hikey = region->hikey;
+	info->lovel = region->lovel;
+	info->hivel = region->hivel;
+	info->attenuation = region->attenuation;
+	info->offset = region->offset;
+	info->end = region->end;
+	info->loop_start = region->loop_start;
+	info->loop_end = region->loop_end;
+	info->sample_rate = region->sample_rate;
+	return 1;
+}
+
+TSFDEF int tsf_region_set_sample(tsf* f, int preset_index, int region_index, const struct tsf_region_sample* info)
+{
+	struct tsf_region* region;
+	if (region_index < 0 || region_index >= tsf_get_regioncount(f, preset_index)) return 0;
+	if (info->offset > info->end || info->end > f->fontSampleNum || info->loop_end > f->fontSampleNum || !info->sample_rate) return 0;
+	region = &f->presets[preset_index].regions[region_index];
+	region->offset = info->offset;
+	region->end = info->end;
+	region->loop_start = info->loop_start;
+	region->loop_end = info->loop_end;
+	region->sample_rate = info->sample_rate;
+	return 1;
+}
+
+TSFDEF const float* tsf_get_samples(const tsf* f, unsigned int* count)
+{
+	if (count) *count = f->fontSampleNum;
+	return f->fontSamples;
+}
+
+TSFDEF int tsf_append_samples(tsf* f, const float* samples, unsigned int count, unsigned int* offset)
+{
+	// Same as the SF2 specification requires after every sample
+	enum { paddingNum = 46 };
+	float* newSamples;
+	if (f->refCount && *f->refCount > 1) return 0;
+	newSamples = (float*)TSF_REALLOC(f->fontSamples, (f->fontSampleNum + count + paddingNum) * sizeof(float));
+	if (!newSamples) return 0;
+	TSF_MEMCPY(newSamples + f->fontSampleNum, samples, count * sizeof(float));
+	TSF_MEMSET(newSamples + f->fontSampleNum + count, 0, paddingNum * sizeof(float));
+	if (offset) *offset = f->fontSampleNum;
+	f->fontSamples = newSamples;
+	f->fontSampleNum += count + paddingNum;
+	return 1;
+}
+
 TSFDEF void tsf_render_short(tsf* f, short* buffer, int samples, int flag_mixing)
 {
 	float outputSamples[TSF_RENDER_SHORTBUFFERBLOCK];
@@ -1744,6 +2078,15 @@ TSFDEF void tsf_render_float(tsf* f, float* buffer, int samples, int flag_mixing
 			tsf_voice_render(f, v, buffer, samples);
 }
 
+TSFDEF void tsf_render_float_separate(tsf* f, float* left, float* right, int samples, int flag_mixing)
+{
+	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
+	if (!flag_mixing) { TSF_MEMSET(left, 0, sizeof(float) * samples); TSF_MEMSET(right, 0, sizeof(float) * samples); }
+	for (; v != vEnd; v++)
+		if (v->playingPreset != -1)
+			tsf_voice_render_separate(f, v, left, right, samples);
+}
+
 static void tsf_channel_setup_voice(tsf* f, struct tsf_voice* v)
 {
 	struct tsf_channel* c = &f->channels->channels[f->channels->activeChannel];
@@ -1940,6 +2283,18 @@ TSFDEF int tsf_channel_note_on(tsf* f, int channel, int key, float vel)
 	return tsf_note_on(f, f->channels->channels[channel].presetIndex, key, vel);
 }
 
+TSFDEF int tsf_channel_note_on_regions(tsf* f, int channel, int key, float vel, const int* region_indices, int region_count)
+{
+	if (!f->channels || channel >= f->channels->channelNum) return 1;
+	f->channels->activeChannel = channel;
+	if (!vel)
+	{
+		tsf_channel_note_off(f, channel, key);
+		return 1;
+	}
+	return tsf_note_on_regions(f, f->channels->channels[channel].presetIndex, key, vel, region_indices, region_count);
+}
+
 TSFDEF void tsf_channel_note_off(tsf* f, int channel, int key)
 {
 	unsigned sustain;
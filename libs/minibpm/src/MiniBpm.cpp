@@ -86,15 +86,62 @@ using std::vector;
 
 #include <iostream>
 
+#ifdef MINIBPM_USE_JUCE_FFT
+#include <juce_dsp/juce_dsp.h>
+#endif
+
 namespace breakfastquay {
 
+/*
+ * Autocorrelation of a detection function, over lags 0 .. m-1.
+ *
+ * The direct sum costs n * m multiply-adds, which for long inputs
+ * and the full lag range (four bars at minimum tempo) dominates
+ * estimateTempo(). Above a size threshold we instead use the
+ * Wiener-Khinchin route: zero-pad to a power of two of at least
+ * n + m points (so there is no circular wrap into the lags we keep),
+ * transform, take the power spectrum and transform back. That is
+ * O(p log p) and gives the same values to within rounding error.
+ *
+ * With MINIBPM_USE_JUCE_FFT defined (as in the jdrummer build) the
+ * transforms use juce::dsp::FFT; otherwise a small built-in radix-2
+ * FFT keeps the library self-contained. Either way the transform
+ * state and scratch buffers live in the object and are reused, so
+ * repeated calls on inputs of the same size don't allocate.
+ */
 class Autocorrelation
 {
 public:
-    Autocorrelation(int n, int m) : m_n(n), m_m(m) { }
+    Autocorrelation(int n, int m) : m_n(n), m_m(m), m_fftSize(0)
+#ifdef MINIBPM_USE_JUCE_FFT
+                                  , m_juceFft(0)
+#endif
+    { }
+
+    ~Autocorrelation() {
+#ifdef MINIBPM_USE_JUCE_FFT
+        delete m_juceFft;
+#endif
+    }
+
+    // Change the input and lag counts, keeping the transform if its
+    // size doesn't change
+    void setLengths(int n, int m) {
+        m_n = n;
+        m_m = m;
+    }
 
     template <typename T>
-    void acf(const T *R__ in, T *R__ out) const {
+    void acf(const T *R__ in, T *R__ out) {
+        if (shouldUseFFT()) {
+            acfFFT(in, out);
+        } else {
+            acfDirect(in, out);
+        }
+    }
+
+    template <typename T>
+    void acfDirect(const T *R__ in, T *R__ out) const {
         for (int i = 0; i < m_m; ++i) {
             out[i] = 0.0;
             for (int j = i; j < m_n; ++j) {
@@ -104,7 +151,55 @@ public:
     }
 
     template <typename T>
-    void acfUnityNormalised(const T *R__ in, T *R__ out) const {
+    void acfFFT(const T *R__ in, T *R__ out) {
+
+        const int p = fftSizeFor(m_n, m_m);
+        prepareFFT(p);
+
+#ifdef MINIBPM_USE_JUCE_FFT
+        // Real-only transforms work in place on 2p floats: p samples in,
+        // p/2 + 1 interleaved complex bins out, and back again (the
+        // inverse includes the 1/p scaling)
+        float *R__ buf = &m_juceBuffer[0];
+        for (int i = 0; i < m_n; ++i) buf[i] = float(in[i]);
+        for (int i = m_n; i < 2 * p; ++i) buf[i] = 0.f;
+
+        m_juceFft->performRealOnlyForwardTransform(buf, true);
+
+        for (int k = 0; k <= p / 2; ++k) {
+            const float re = buf[2 * k], im = buf[2 * k + 1];
+            buf[2 * k] = re * re + im * im;
+            buf[2 * k + 1] = 0.f;
+        }
+
+        m_juceFft->performRealOnlyInverseTransform(buf);
+
+        for (int i = 0; i < m_m; ++i) out[i] = T(buf[i]);
+#else
+        double *R__ re = &m_re[0];
+        double *R__ im = &m_im[0];
+        for (int i = 0; i < m_n; ++i) re[i] = in[i];
+        for (int i = m_n; i < p; ++i) re[i] = 0.0;
+        for (int i = 0; i < p; ++i) im[i] = 0.0;
+
+        transform(re, im);
+
+        for (int i = 0; i < p; ++i) {
+            re[i] = re[i] * re[i] + im[i] * im[i];
+            im[i] = 0.0;
+        }
+
+        // The power spectrum of a real signal is real and even, so the
+        // forward transform doubles as the inverse (up to the 1/p)
+        transform(re, im);
+
+        const double scale = 1.0 / p;
+        for (int i = 0; i < m_m; ++i) out[i] = T(re[i] * scale);
+#endif
+    }
+
+    template <typename T>
+    void acfUnityNormalised(const T *R__ in, T *R__ out) {
 
         acf(in, out);
 
@@ -120,6 +215,24 @@ public:
         }
     }
 
+    // Smallest power of two holding n + m points
+    static int fftSizeFor(int n, int m) {
+        int p = 1;
+        while (p < n + m) p *= 2;
+        return p;
+    }
+
+    // The FFT route wins once n * m is well above p log2 p (a
+    // forward and an inverse transform, plus the spectrum). Small
+    // inputs keep the direct sum, whose results are exact.
+    bool shouldUseFFT() const {
+        if (m_n < minFFTLength || m_m < minFFTLength) return false;
+        const int p = fftSizeFor(m_n, m_m);
+        int logp = 0;
+        while ((1 << logp) < p) ++logp;
+        return double(m_n) * double(m_m) > 8.0 * double(p) * double(logp);
+    }
+
     static int bpmToLag(double bpm, double hopsPerSec) {
         return int((60.0 / bpm) * hopsPerSec + 0.5);
     }
@@ -128,8 +241,91 @@ public:
     }
 
 private:
+    static const int minFFTLength = 64;
+
     int m_n;
     int m_m;
+
+    // Transform state, built by the first FFT call and then reused
+    int m_fftSize;
+
+#ifdef MINIBPM_USE_JUCE_FFT
+    juce::dsp::FFT *m_juceFft;
+    std::vector<float> m_juceBuffer;
+
+    void prepareFFT(int p) {
+        if (m_fftSize == p) return;
+        int order = 0;
+        while ((1 << order) < p) ++order;
+        delete m_juceFft;
+        m_juceFft = new juce::dsp::FFT(order);
+        m_juceBuffer.assign(2 * p, 0.f);
+        m_fftSize = p;
+    }
+#else
+    std::vector<double> m_re;
+    std::vector<double> m_im;
+    std::vector<double> m_cos;
+    std::vector<double> m_sin;
+    std::vector<int> m_bitReverse;
+
+    void prepareFFT(int p) {
+        if (m_fftSize == p) return;
+        m_re.assign(p, 0.0);
+        m_im.assign(p, 0.0);
+        m_cos.resize(p / 2);
+        m_sin.resize(p / 2);
+        for (int k = 0; k < p / 2; ++k) {
+            const double angle = -2.0 * M_PI * k / p;
+            m_cos[k] = cos(angle);
+            m_sin[k] = sin(angle);
+        }
+        int bits = 0;
+        while ((1 << bits) < p) ++bits;
+        m_bitReverse.resize(p);
+        for (int i = 0; i < p; ++i) {
+            int r = 0;
+            for (int b = 0; b < bits; ++b) {
+                if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+            }
+            m_bitReverse[i] = r;
+        }
+        m_fftSize = p;
+    }
+
+    // In-place iterative radix-2 forward transform of size m_fftSize
+    void transform(double *R__ re, double *R__ im) const {
+        const int p = m_fftSize;
+        for (int i = 0; i < p; ++i) {
+            const int j = m_bitReverse[i];
+            if (j > i) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+        for (int half = 1; half < p; half *= 2) {
+            const int stride = p / (2 * half);
+            for (int start = 0; start < p; start += 2 * half) {
+                for (int k = 0; k < half; ++k) {
+                    const double wr = m_cos[k * stride];
+                    const double wi = m_sin[k * stride];
+                    const int a = start + k;
+                    const int b = a + half;
+                    const double tr = re[b] * wr - im[b] * wi;
+                    const double ti = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+    }
+#endif
+
+    // Not copyable (owns the transform)
+    Autocorrelation(const Autocorrelation &);
+    Autocorrelation &operator=(const Autocorrelation &);
 };
 
 class FourierFilterbank
@@ -367,7 +563,8 @@ public:
         m_partialFill(0),
         m_frame(0),
         m_lfprev(0),
-        m_hfprev(0)
+        m_hfprev(0),
+        m_acfcalc(0, 0)
     {
         int lfbinmax = 6;
         m_blockSize = (m_inputSampleRate * lfbinmax) / m_lfmax;
@@ -513,20 +710,23 @@ public:
         int acfLength = Autocorrelation::bpmToLag(barPM, hopsPerSec);
         while (acfLength > dfLength) acfLength /= 2;
 
-        Autocorrelation acfcalc(dfLength, acfLength);
+        // The calculator and buffers are kept between calls, so
+        // estimating again at the same length doesn't reallocate
+        m_acfcalc.setLengths(dfLength, acfLength);
 
-        double *acf = new double[acfLength];
-        double *temp = new double[acfLength];
+        m_acf.assign(acfLength, 0.0);
+        m_acfTemp.resize(acfLength);
 
-        zero(acf, acfLength);
+        double *acf = &m_acf[0];
+        double *temp = &m_acfTemp[0];
 
-        acfcalc.acfUnityNormalised(&m_lfdf[0], temp);
+        m_acfcalc.acfUnityNormalised(&m_lfdf[0], temp);
         for (int i = 0; i < acfLength; ++i) acf[i] += temp[i];
 
-        acfcalc.acfUnityNormalised(&m_hfdf[0], temp);
+        m_acfcalc.acfUnityNormalised(&m_hfdf[0], temp);
         for (int i = 0; i < acfLength; ++i) acf[i] += temp[i] * 0.5;
 
-        acfcalc.acfUnityNormalised(&m_rms[0], temp);
+        m_acfcalc.acfUnityNormalised(&m_rms[0], temp);
         for (int i = 0; i < acfLength; ++i) acf[i] += temp[i] * 0.1;
 
         int minlag = Autocorrelation::bpmToLag(m_maxbpm, hopsPerSec);
@@ -534,14 +734,13 @@ public:
 
         if (acfLength < maxlag) {
             // Not enough data
-            delete[] acf;
-            delete[] temp;
             return 0.0;
         }
 
         ACFCombFilter filter(m_beatsPerBar, minlag, maxlag, hopsPerSec);
         int cflen = filter.getFilteredLength();
-        double *cf = new double[cflen];
+        m_filtered.resize(cflen);
+        double *cf = &m_filtered[0];
         filter.filter(acf, acfLength, cf);
         unityNormalise(cf, cflen);
 
@@ -567,9 +766,6 @@ public:
         }
 
         if (candidateMap.empty()) {
-            delete[] cf;
-            delete[] acf;
-            delete[] temp;
             return 0.0;
         }
 
@@ -587,10 +783,6 @@ public:
             }
         }
 
-        delete[] cf;
-        delete[] acf;
-        delete[] temp;
-
         return m_candidates[0];
     }
         
@@ -620,6 +812,12 @@ private:
     double *m_frame;
     double *m_lfprev;
     double *m_hfprev;
+
+    // Scratch for finish(), reused across estimates
+    Autocorrelation m_acfcalc;
+    std::vector<double> m_acf;
+    std::vector<double> m_acfTemp;
+    std::vector<double> m_filtered;
 };
 
 MiniBPM::MiniBPM(float sampleRate) :
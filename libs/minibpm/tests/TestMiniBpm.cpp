@@ -170,6 +170,40 @@ BOOST_AUTO_TEST_CASE(normalisedUnity)
     BOOST_CHECK_EQUAL(out[8], 0.0);
 }
 
+BOOST_AUTO_TEST_CASE(fftMatchesDirect)
+{
+    // Long enough that acf() takes the FFT route
+    const int n = 5000, m = 1500;
+    double *in = new double[n];
+    double *direct = new double[m];
+    double *fft = new double[m];
+    unsigned int seed = 1;
+    for (int i = 0; i < n; ++i) {
+	seed = seed * 1103515245u + 12345u;
+	in[i] = double((seed >> 16) & 0x7fff) / 32768.0;
+	if (i % 50 == 0) in[i] += 4.0;
+    }
+    Autocorrelation ac(n, m);
+    BOOST_CHECK(ac.shouldUseFFT());
+    ac.acfDirect(in, direct);
+    ac.acf(in, fft);
+    for (int i = 0; i < m; ++i) {
+	BOOST_CHECK_CLOSE(fft[i], direct[i], 1e-6);
+    }
+    // Again, reusing the transform
+    ac.acf(in, fft);
+    BOOST_CHECK_CLOSE(fft[m-1], direct[m-1], 1e-6);
+    delete[] in;
+    delete[] direct;
+    delete[] fft;
+}
+
+BOOST_AUTO_TEST_CASE(shortInputsStayDirect)
+{
+    BOOST_CHECK(!Autocorrelation(12, 12).shouldUseFFT());
+    BOOST_CHECK(!Autocorrelation(1000, 32).shouldUseFFT());
+}
+
 BOOST_AUTO_TEST_CASE(bpmLagConversion)
 {
     int lag = Autocorrelation::bpmToLag(120.0, 2.0);
@@ -372,6 +406,17 @@ BOOST_AUTO_TEST_CASE(complete_120bpm_48000)
     BOOST_CHECK_CLOSE(bpm, 120.0, 0.25);
 }
 
+BOOST_AUTO_TEST_CASE(complete_120bpm_8000_long)
+{
+    // A minute of input: the autocorrelation takes the FFT route
+    float rate = 8000.f;
+    int len;
+    float *data = tap(60.0, rate, 120.0, len);
+    double bpm = MiniBPM(rate).estimateTempoOfSamples(data, len);
+    delete[] data;
+    BOOST_CHECK_CLOSE(bpm, 120.0, 0.25);
+}
+
 BOOST_AUTO_TEST_CASE(buffered_120bpm_44100)
 {
     float rate = 44100.f;